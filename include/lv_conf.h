@@ -35,7 +35,7 @@
 #define LV_USE_ARC 1
 #define LV_USE_ARCLABEL 0
 #define LV_USE_CALENDAR 0
-#define LV_USE_CANVAS 0
+#define LV_USE_CANVAS 1  /* launcher icons are rasterized once at boot */
 #define LV_USE_CHART 0
 #define LV_USE_CHECKBOX 0
 #define LV_USE_DROPDOWN 0
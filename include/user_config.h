@@ -18,6 +18,9 @@
 // --- OpenClaw Gateway ---
 // ws://host:port or wss://host:port
 #define USER_GATEWAY_URL "REPLACE_WITH_GATEWAY_URL"
+// Optional comma-separated fallback gateways, tried when the primary is down
+// or degraded (same credentials).
+#define USER_GATEWAY_FALLBACK_URLS ""
 #define USER_GATEWAY_TOKEN "REPLACE_WITH_GATEWAY_TOKEN"
 #define USER_GATEWAY_PASSWORD ""
 // Default auth mode seed: 0=token, 1=password
@@ -36,6 +39,10 @@
 #define USER_MESSENGER_ENABLE_LEGACY_MEDIA_FALLBACK 0
 #define USER_MESSENGER_BINARY_ATTACH_MAX_BYTES 524288U
 #define USER_MESSENGER_TEXT_FALLBACK_PREVIEW_MAX_CHARS 4000U
+// Messages replayed from the SD log on first Messenger entry, and the
+// History page size (entries held in RAM while scrolling).
+#define USER_MESSENGER_HISTORY_REPLAY_COUNT 24U
+#define USER_MESSENGER_HISTORY_PAGE_SIZE 20U
 
 // --- CC1101 defaults ---
 #define USER_DEFAULT_RF_FREQUENCY_MHZ 433.92f
@@ -120,9 +127,41 @@
 #define USER_NRF24_PA_LEVEL 1
 
 // --- Telemetry ---
+// Telemetry is sampled every USER_TELEMETRY_MIN_INTERVAL_MS while values are
+// changing, backing off to USER_TELEMETRY_INTERVAL_MS while idle; only changed
+// fields are sent, with a full keyframe every USER_TELEMETRY_KEYFRAME_MS.
 #define USER_TELEMETRY_INTERVAL_MS 30000UL
+#define USER_TELEMETRY_MIN_INTERVAL_MS 5000UL
+#define USER_TELEMETRY_KEYFRAME_MS 600000UL
+#define USER_TELEMETRY_RSSI_DEADBAND_DB 6
 #define USER_AUTO_CONNECT_DEFAULT false
 
+// --- Node invokes ---
+// Running background invokes report node.invoke.progress at this interval.
+#define USER_INVOKE_PROGRESS_INTERVAL_MS 1000UL
+// Finished invoke results are kept this long so gateway retries of the same
+// invokeId are answered without running the command again.
+#define USER_INVOKE_CACHE_TTL_MS 600000UL
+
+// --- LAN control ---
+// Optional on-device WebSocket endpoint serving the node command registry to
+// clients on the local network (enabled in OpenClaw > Gateway). Clients must
+// authenticate with the configured token first.
+#define USER_LAN_CONTROL_PORT 8181
+#define USER_LAN_CONTROL_TOKEN "REPLACE_WITH_LAN_CONTROL_TOKEN"
+
+// --- Serial RPC ---
+// COBS-framed binary command/stream protocol on the USB CDC port (see
+// src/core/serial_rpc.h and scripts/serial_rpc_client.py). On by default for
+// headless boards, where the USB port is the main control path.
+#ifndef USER_SERIAL_RPC_ENABLED
+#if HAL_HAS_DISPLAY
+#define USER_SERIAL_RPC_ENABLED 0
+#else
+#define USER_SERIAL_RPC_ENABLED 1
+#endif
+#endif
+
 // --- Clock (NTP) ---
 #define USER_TIMEZONE_TZ "UTC0"
 #define USER_NTP_SERVER_1 "pool.ntp.org"
@@ -131,10 +170,15 @@
 
 // --- Display ---
 #define USER_DISPLAY_BRIGHTNESS_PERCENT 100
+// Flush LVGL chunks with SPI DMA so rendering overlaps the transfer.
+// 0 restores the blocking flush (useful for before/after frame timing).
+#define USER_DISPLAY_DMA_ENABLED 1
 
 // --- Debug ---
 #define USER_MEM_TRACE_ENABLED 0
 #define USER_INPUT_TRACE_ENABLED 0
+// Logs LVGL fps, frame time and flush wait once per second while drawing.
+#define USER_UI_FRAME_TRACE_ENABLED 0
 
 // --- Input pins (encoder defaults from HAL, override here if needed) ---
 #ifndef HAL_PIN_ENCODER_A
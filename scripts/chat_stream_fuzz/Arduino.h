@@ -0,0 +1,40 @@
+// Minimal Arduino stand-in so the chat stream assembler and MessageStore
+// build on a host. Only what those two and the fuzz check use.
+#pragma once
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+
+class String {
+ public:
+  String() = default;
+  String(const char *text) : s_(text ? text : "") {}
+  String(const std::string &text) : s_(text) {}
+
+  const char *c_str() const { return s_.c_str(); }
+  size_t length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  void reserve(size_t len) { s_.reserve(len); }
+  bool concat(const char *text, size_t len) {
+    s_.append(text, len);
+    return true;
+  }
+  const std::string &str() const { return s_; }
+
+  String &operator=(const char *text) {
+    s_ = text ? text : "";
+    return *this;
+  }
+  bool operator==(const String &other) const { return s_ == other.s_; }
+
+ private:
+  std::string s_;
+};
+
+unsigned long millis();
+bool psramFound();
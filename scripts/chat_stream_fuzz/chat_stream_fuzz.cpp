@@ -0,0 +1,203 @@
+// Host fuzz check for ChatStreamAssembler and the MessageStore updates the
+// gateway makes with its output.
+//
+// Random replies built from plain text, control tags (<final>, </analysis>,
+// split tails like "</final") and look-alike markup are fed as snapshot
+// streams and as delta streams cut at random points. The assembled text must
+// equal the one-shot reference stripper the gateway used before the
+// assembler existed. A few fixed MessageStore cases check text replacement
+// and settle de-duplication.
+//
+//   scripts/chat_stream_fuzz/run.sh [iterations] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "chat_stream_assembler.h"
+#include "message_store.h"
+
+unsigned long millis() {
+  static unsigned long now = 0;
+  return ++now;
+}
+
+bool psramFound() {
+  return false;
+}
+
+namespace {
+
+bool isTagNameChar(char c) {
+  return isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+}
+
+bool isControlTag(const std::string &name) {
+  return strcasecmp(name.c_str(), "analysis") == 0 ||
+         strcasecmp(name.c_str(), "commentary") == 0 ||
+         strcasecmp(name.c_str(), "final") == 0;
+}
+
+// The stripper the gateway ran over the whole reply on every event.
+std::string referenceStrip(const std::string &text) {
+  std::string out;
+  size_t i = 0;
+  while (i < text.size()) {
+    if (text[i] != '<') {
+      out += text[i++];
+      continue;
+    }
+    size_t cursor = i + 1;
+    while (cursor < text.size() && isspace(static_cast<unsigned char>(text[cursor]))) {
+      ++cursor;
+    }
+    if (cursor < text.size() && text[cursor] == '/') {
+      ++cursor;
+    }
+    while (cursor < text.size() && isspace(static_cast<unsigned char>(text[cursor]))) {
+      ++cursor;
+    }
+    const size_t nameStart = cursor;
+    while (cursor < text.size() && isTagNameChar(text[cursor])) {
+      ++cursor;
+    }
+    if (nameStart == cursor || !isControlTag(text.substr(nameStart, cursor - nameStart))) {
+      out += text[i++];
+      continue;
+    }
+    while (cursor < text.size() && text[cursor] != '>') {
+      ++cursor;
+    }
+    i = cursor < text.size() ? cursor + 1 : cursor;
+  }
+  return out;
+}
+
+const char *const kPieces[] = {
+    "hello", " ", "world", ".", "\n", "\xED\x95\x9C", "a<b", "x > y", "<", ">", "/",
+    "<final>", "</final>", "<FINAL>", "< / final >", "<analysis>", "</analysis>",
+    "<commentary>", "</commentary", "<final", "</fin", "<fine>", "<b>", "</b>", "<3",
+    "<analysis x=1>", "< final", "<-x>", "<_>",
+};
+
+std::string randomReply(std::mt19937 &rng, size_t index) {
+  // A distinct start keeps a delta stream from looking like a snapshot.
+  std::string text = "run" + std::to_string(index) + ":";
+  const size_t pieces = rng() % 40;
+  for (size_t i = 0; i < pieces; ++i) {
+    text += kPieces[rng() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+  }
+  return text;
+}
+
+std::vector<size_t> randomCuts(std::mt19937 &rng, size_t len) {
+  std::vector<size_t> cuts;
+  size_t pos = 0;
+  while (pos < len) {
+    pos += 1 + rng() % 12;
+    cuts.push_back(pos < len ? pos : len);
+  }
+  return cuts;
+}
+
+void apply(ChatStreamAssembler::Update update, const String &out, std::string &message) {
+  if (update == ChatStreamAssembler::Update::Replace) {
+    message = out.str();
+  } else {
+    message += out.str();
+  }
+}
+
+int gFailures = 0;
+
+void expectEqual(const char *what, const std::string &reply, const std::string &got,
+                 const std::string &want) {
+  if (got == want) {
+    return;
+  }
+  if (++gFailures <= 5) {
+    printf("FAIL %s\n  reply: %s\n  got:   %s\n  want:  %s\n", what, reply.c_str(), got.c_str(),
+           want.c_str());
+  }
+}
+
+void checkSnapshots(ChatStreamAssembler &assembler, const std::string &runId,
+                    const std::string &reply, std::mt19937 &rng) {
+  std::string message;
+  String out;
+  for (size_t cut : randomCuts(rng, reply.size())) {
+    const bool settled = cut == reply.size();
+    apply(assembler.feed(runId.c_str(), reply.data(), cut, settled, out), out, message);
+  }
+  expectEqual("snapshot", reply, message, referenceStrip(reply));
+}
+
+void checkDeltas(ChatStreamAssembler &assembler, const std::string &runId,
+                 const std::string &reply, std::mt19937 &rng) {
+  std::string message;
+  String out;
+  size_t start = 0;
+  for (size_t cut : randomCuts(rng, reply.size())) {
+    apply(assembler.feed(runId.c_str(), reply.data() + start, cut - start, false, out), out,
+          message);
+    start = cut;
+  }
+  // The final event carries the whole reply.
+  apply(assembler.feed(runId.c_str(), reply.data(), reply.size(), true, out), out, message);
+  expectEqual("delta", reply, message, referenceStrip(reply));
+}
+
+void checkStore() {
+  MessageStore store(0, 8);
+  GatewayInboxMessage message;
+  message.id = "m1";
+  message.text = "partial reply";
+  MessageView view;
+  store.upsert(message, &view);
+
+  message.text = "";
+  store.upsert(message, &view);
+  expectEqual("keep text", "", view.text, "partial reply");
+  store.upsert(message, &view, true);
+  expectEqual("replace with empty", "", view.text, "");
+
+  message.text = "final reply";
+  store.upsert(message, &view, true);
+  const bool first = store.markSettled(view.id);
+  store.upsert(message, &view);
+  const bool repeat = store.markSettled(view.id);
+  message.text = "edited reply";
+  store.upsert(message, &view, true);
+  const bool edited = store.markSettled(view.id);
+  expectEqual("settle once", "", std::to_string(first) + std::to_string(repeat) +
+              std::to_string(edited), "101");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+  const unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+  std::mt19937 rng(seed);
+  ChatStreamAssembler assembler;
+
+  for (unsigned long i = 0; i < iterations; ++i) {
+    const std::string reply = randomReply(rng, i);
+    const std::string runId = "run-" + std::to_string(i % 7);
+    if (rng() % 2) {
+      checkSnapshots(assembler, runId, reply, rng);
+    } else {
+      checkDeltas(assembler, runId, reply, rng);
+    }
+    const String stripped = ChatStreamAssembler::strip(reply.data(), reply.size());
+    expectEqual("strip", reply, stripped.str(), referenceStrip(reply));
+  }
+  checkStore();
+
+  printf("%lu replies, seed %lu: %s (%d failures)\n", iterations, seed,
+         gFailures == 0 ? "ok" : "FAILED", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+// Host stand-in: every allocation comes from the C heap.
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline void *heap_caps_calloc(size_t n, size_t size, uint32_t) {
+  return calloc(n, size);
+}
+inline void heap_caps_free(void *ptr) {
+  free(ptr);
+}
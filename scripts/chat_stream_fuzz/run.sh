@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Builds and runs the chat stream fuzz check.
+#   scripts/chat_stream_fuzz/run.sh [iterations] [seed]
+set -euo pipefail
+
+HERE="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT="$(cd "${HERE}/../.." && pwd)"
+OUT="${TMPDIR:-/tmp}/chat_stream_fuzz"
+
+"${CXX:-c++}" -std=c++17 -O2 -Wall -I"${HERE}" -I"${ROOT}/src/core" \
+  "${HERE}/chat_stream_fuzz.cpp" "${ROOT}/src/core/chat_stream_assembler.cpp" \
+  "${ROOT}/src/core/message_store.cpp" -o "${OUT}"
+"${OUT}" "$@"
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Build the SD glyph pack read by src/ui/sd_font.cpp.
+
+Converts an lv_font_conv C font (--format lvgl) into a pack file, which the
+firmware loads one glyph at a time instead of linking the whole font:
+  scripts/font_pack/build_font_pack.py
+  scripts/font_pack/build_font_pack.py lv_font_korean_ui_14.c -o korean_ui_14.zxgp
+
+Copy the result to /fonts/korean_ui_14.zxgp on the SD card, then install the
+pack under Setting > System > Language & Font > Font Packs.
+
+Layout (little-endian):
+  header   32 bytes: "ZXGP" version(2) bpp(1) bitmap_format(1) line_height(2)
+           base_line(2) underline_position(1) underline_thickness(1)
+           range_count(2) glyph_count(4) max_record_bytes(2) reserved(2)
+           ranges_offset(4) offsets_offset(4)
+  ranges   range_count x (range_start(4) range_length(4) glyph_id_start(4))
+  offsets  glyph_count x file offset(4) of each glyph record; id 0 is unused
+  records  adv_w(2, 1/16 px) box_w(1) box_h(1) ofs_x(1) ofs_y(1)
+           bitmap_bytes(2) bitmap; bitmaps are copied as lv_font_conv wrote
+           them, compressed when bitmap_format is 1
+"""
+
+import argparse
+import pathlib
+import re
+import struct
+import sys
+
+MAGIC = b"ZXGP"
+VERSION = 1
+HEADER = struct.Struct("<4sHBBHhbBHIHHII")
+RANGE = struct.Struct("<III")
+RECORD = struct.Struct("<HBBbbH")
+# Must match kMaxRecordBytes in src/ui/sd_font.cpp.
+MAX_RECORD_BYTES = 512
+
+HERE = pathlib.Path(__file__).resolve().parent
+
+
+def field(text, name):
+    match = re.search(r"\." + name + r"\s*=\s*(-?\d+)", text)
+    if not match:
+        sys.exit(f"font source has no .{name}")
+    return int(match.group(1))
+
+
+def block(text, start):
+    begin = text.find(start)
+    if begin < 0:
+        sys.exit(f"font source has no '{start}'")
+    end = text.find("};", begin)
+    return text[begin + len(start):end]
+
+
+def parse(source):
+    text = source.read_text(encoding="utf-8")
+
+    bitmap_text = re.sub(r"/\*.*?\*/", "", block(text, "glyph_bitmap[] = {"), flags=re.S)
+    bitmap = bytes(int(tok, 16) for tok in re.findall(r"0x[0-9a-fA-F]+", bitmap_text))
+
+    glyphs = []
+    for entry in re.finditer(
+        r"\{\.bitmap_index = (\d+), \.adv_w = (\d+), \.box_w = (\d+), \.box_h = (\d+), "
+        r"\.ofs_x = (-?\d+), \.ofs_y = (-?\d+)\}",
+        block(text, "glyph_dsc[] = {"),
+    ):
+        glyphs.append(tuple(int(v) for v in entry.groups()))
+
+    ranges = []
+    cmaps = block(text, "cmaps[] =")
+    for entry in re.finditer(
+        r"\.range_start = (\d+), \.range_length = (\d+), \.glyph_id_start = (\d+),\s*"
+        r"\.unicode_list = NULL, \.glyph_id_ofs_list = NULL, \.list_length = 0, "
+        r"\.type = (\w+)",
+        cmaps,
+    ):
+        if entry.group(4) != "LV_FONT_FMT_TXT_CMAP_FORMAT0_TINY":
+            sys.exit(f"unsupported cmap type {entry.group(4)}")
+        ranges.append(tuple(int(v) for v in entry.groups()[:3]))
+    if cmaps.count(".range_start") != len(ranges):
+        sys.exit("only contiguous cmaps without unicode lists are supported")
+    # The firmware binary-searches the ranges.
+    ranges.sort()
+
+    metrics = {
+        "bpp": field(text, "bpp"),
+        "bitmap_format": field(text, "bitmap_format"),
+        "line_height": field(text, "line_height"),
+        "base_line": field(text, "base_line"),
+        "underline_position": field(text, "underline_position"),
+        "underline_thickness": field(text, "underline_thickness"),
+    }
+    if "kern_dsc = NULL" not in text:
+        print("warning: kerning data is not carried into the pack", file=sys.stderr)
+    return metrics, bitmap, glyphs, ranges
+
+
+def build(metrics, bitmap, glyphs, ranges):
+    starts = [g[0] for g in glyphs] + [len(bitmap)]
+    records = []
+    for gid, (index, adv_w, box_w, box_h, ofs_x, ofs_y) in enumerate(glyphs):
+        # Bitmaps are stored in id order, so a glyph ends where the next begins.
+        data = bitmap[index:starts[gid + 1]] if box_w and box_h else b""
+        records.append(RECORD.pack(adv_w, box_w, box_h, ofs_x, ofs_y, len(data)) + data)
+
+    max_record = max(len(r) for r in records)
+    if max_record > MAX_RECORD_BYTES:
+        sys.exit(f"glyph record of {max_record} bytes exceeds {MAX_RECORD_BYTES}")
+
+    ranges_offset = HEADER.size
+    offsets_offset = ranges_offset + RANGE.size * len(ranges)
+    cursor = offsets_offset + 4 * len(records)
+    offsets = []
+    for record in records:
+        offsets.append(cursor)
+        cursor += len(record)
+
+    out = bytearray(
+        HEADER.pack(
+            MAGIC,
+            VERSION,
+            metrics["bpp"],
+            metrics["bitmap_format"],
+            metrics["line_height"],
+            metrics["base_line"],
+            metrics["underline_position"],
+            metrics["underline_thickness"],
+            len(ranges),
+            len(records),
+            max_record,
+            0,
+            ranges_offset,
+            offsets_offset,
+        )
+    )
+    for entry in ranges:
+        out += RANGE.pack(*entry)
+    out += struct.pack(f"<{len(offsets)}I", *offsets)
+    for record in records:
+        out += record
+    return bytes(out), max_record
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", nargs="?", default=str(HERE / "lv_font_korean_ui_14.c"))
+    parser.add_argument("-o", "--output", default="korean_ui_14.zxgp")
+    args = parser.parse_args()
+
+    metrics, bitmap, glyphs, ranges = parse(pathlib.Path(args.source))
+    pack, max_record = build(metrics, bitmap, glyphs, ranges)
+    pathlib.Path(args.output).write_bytes(pack)
+    print(
+        f"{args.output}: {len(pack)} bytes, {len(glyphs) - 1} glyphs in {len(ranges)} ranges, "
+        f"{len(bitmap)} bitmap bytes, largest record {max_record} bytes"
+    )
+
+
+if __name__ == "__main__":
+    main()
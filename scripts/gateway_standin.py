@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Minimal stand-in OpenClaw gateway for exercising endpoint failover.
+
+It sends connect.challenge, accepts (or rejects) the connect request, acks
+every other request, and can slow down the connect and the pong replies the
+device uses to measure RTT. Run several on different ports and list them as
+the device's gateway URL and fallback URLs.
+
+  # healthy primary that degrades after 60 s, plus a healthy fallback
+  scripts/gateway_standin.py --port 18789 --pong-delay-ms 2500 --degrade-after 60
+  scripts/gateway_standin.py --port 18790
+
+  # an endpoint that is up but never lets the device in
+  scripts/gateway_standin.py --port 18791 --reject
+
+Credentials and device signatures are not checked.
+
+Requires: pip install websockets
+"""
+
+import argparse
+import asyncio
+import json
+import secrets
+import sys
+import time
+
+try:
+    from websockets.legacy.server import WebSocketServerProtocol, serve
+except ImportError:
+    sys.exit("websockets is required: pip install websockets")
+
+ARGS = None
+STARTED = time.monotonic()
+
+
+def log(message):
+    print(f"[{ARGS.port} +{time.monotonic() - STARTED:6.1f}s] {message}", flush=True)
+
+
+class SlowPongProtocol(WebSocketServerProtocol):
+    async def pong(self, data=b""):
+        if time.monotonic() - STARTED >= ARGS.degrade_after and ARGS.pong_delay_ms > 0:
+            await asyncio.sleep(ARGS.pong_delay_ms / 1000.0)
+        await super().pong(data)
+
+
+async def handle(ws, path=None):
+    log(f"client {ws.remote_address[0]} connected")
+    await ws.send(json.dumps({
+        "type": "event",
+        "event": "connect.challenge",
+        "payload": {"nonce": secrets.token_hex(16), "ts": int(time.time() * 1000)},
+    }))
+    try:
+        async for text in ws:
+            frame = json.loads(text)
+            if frame.get("type") != "req":
+                continue
+            method = frame.get("method")
+            reply = {"type": "res", "id": frame.get("id"), "ok": True, "payload": {}}
+            if method == "connect":
+                await asyncio.sleep(ARGS.connect_delay_ms / 1000.0)
+                if ARGS.reject:
+                    reply = {"type": "res", "id": frame.get("id"), "ok": False,
+                             "error": {"message": "stand-in rejects connect"}}
+                log(f"connect -> {'rejected' if ARGS.reject else 'ok'}")
+            await ws.send(json.dumps(reply))
+            if method == "connect" and ARGS.reject:
+                await ws.close()
+    except Exception as exc:  # disconnects are expected while testing failover
+        log(f"closed: {exc}")
+    log("client disconnected")
+
+
+async def main():
+    async with serve(handle, ARGS.host, ARGS.port, create_protocol=SlowPongProtocol,
+                     max_size=None):
+        log(f"listening on ws://{ARGS.host}:{ARGS.port}/")
+        await asyncio.Future()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=18789)
+    parser.add_argument("--connect-delay-ms", type=int, default=0,
+                        help="delay before answering the connect request")
+    parser.add_argument("--pong-delay-ms", type=int, default=0,
+                        help="delay added to every pong (the device's RTT probe)")
+    parser.add_argument("--degrade-after", type=float, default=0.0, metavar="SECONDS",
+                        help="only delay pongs after this many seconds of uptime")
+    parser.add_argument("--reject", action="store_true", help="reject every connect")
+    ARGS = parser.parse_args()
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
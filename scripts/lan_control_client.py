@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Client for the device LAN control endpoint (OpenClaw > Gateway > LAN Control).
+
+Run one command:
+  scripts/lan_control_client.py 192.168.1.50 --token SECRET cc1101.info
+  scripts/lan_control_client.py 192.168.1.50 --token SECRET cc1101.set_freq '{"mhz": 433.92}'
+
+Measure latency and throughput (sequential requests):
+  scripts/lan_control_client.py 192.168.1.50 --token SECRET --bench 200 cc1101.info
+
+Requires: pip install websockets
+"""
+
+import argparse
+import asyncio
+import json
+import statistics
+import sys
+import time
+
+try:
+    import websockets
+except ImportError:
+    sys.exit("websockets is required: pip install websockets")
+
+
+async def call(ws, request_id, command, params):
+    await ws.send(json.dumps({"id": request_id, "command": command, "params": params}))
+    while True:
+        reply = json.loads(await ws.recv())
+        if reply.get("id") == request_id:
+            return reply
+
+
+async def run(args):
+    params = json.loads(args.params) if args.params else {}
+    url = f"ws://{args.host}:{args.port}/"
+    async with websockets.connect(url, max_size=None) as ws:
+        await ws.send(json.dumps({"type": "auth", "token": args.token}))
+        auth = json.loads(await ws.recv())
+        if not auth.get("ok"):
+            sys.exit("auth rejected")
+
+        if args.bench <= 0:
+            reply = await call(ws, 1, args.command, params)
+            print(json.dumps(reply, indent=2))
+            return 0 if reply.get("ok") else 1
+
+        latencies = []
+        failures = 0
+        started = time.perf_counter()
+        for i in range(args.bench):
+            t0 = time.perf_counter()
+            reply = await call(ws, i + 1, args.command, params)
+            latencies.append((time.perf_counter() - t0) * 1000.0)
+            if not reply.get("ok"):
+                failures += 1
+        elapsed = time.perf_counter() - started
+
+        latencies.sort()
+        p95 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.95))]
+        print(f"{args.command}: {args.bench} calls, {failures} failed")
+        print(f"  throughput {args.bench / elapsed:.1f} cmd/s")
+        print(f"  latency ms  p50 {statistics.median(latencies):.1f}  "
+              f"p95 {p95:.1f}  max {latencies[-1]:.1f}")
+        return 0 if failures == 0 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("command")
+    parser.add_argument("params", nargs="?", help="JSON object")
+    parser.add_argument("--port", type=int, default=8181)
+    parser.add_argument("--token", required=True)
+    parser.add_argument("--bench", type=int, default=0, metavar="N",
+                        help="send N sequential requests and report latency")
+    return asyncio.run(run(parser.parse_args()))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,31 @@
+// Minimal Arduino stand-in so the node command registry and param schema
+// build on a host. Only what they and the benchmark use.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+class String {
+ public:
+  String() = default;
+  String(const char *text) : s_(text ? text : "") {}
+
+  const char *c_str() const { return s_.c_str(); }
+  size_t length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+
+  String &operator=(const char *text) {
+    s_ = text ? text : "";
+    return *this;
+  }
+  friend String operator+(const String &a, const char *b) {
+    String out;
+    out.s_ = a.s_ + (b ? b : "");
+    return out;
+  }
+
+ private:
+  std::string s_;
+};
@@ -0,0 +1,177 @@
+// ArduinoJson stand-in: just enough of the read-only object API for
+// decodeNodeParams and the keyed reads it replaced, over a flat list of
+// members built by the benchmark.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct JsonValue {
+  enum Kind { Null, Bool, Int, Float, Text } kind = Null;
+  bool b = false;
+  long long i = 0;
+  double d = 0;
+  std::string s;
+
+  static JsonValue integer(long long v) {
+    JsonValue out;
+    out.kind = Int;
+    out.i = v;
+    return out;
+  }
+  static JsonValue number(double v) {
+    JsonValue out;
+    out.kind = Float;
+    out.d = v;
+    return out;
+  }
+  static JsonValue text(const char *v) {
+    JsonValue out;
+    out.kind = Text;
+    out.s = v;
+    return out;
+  }
+  static JsonValue boolean(bool v) {
+    JsonValue out;
+    out.kind = Bool;
+    out.b = v;
+    return out;
+  }
+};
+
+class JsonVariantConst {
+ public:
+  JsonVariantConst(const JsonValue *value = nullptr) : v_(value) {}
+
+  bool isNull() const { return !v_ || v_->kind == JsonValue::Null; }
+
+  template <typename T>
+  bool is() const {
+    if (!v_) {
+      return false;
+    }
+    if (std::is_same<T, const char *>::value) {
+      return v_->kind == JsonValue::Text;
+    }
+    if (std::is_same<T, bool>::value) {
+      return v_->kind == JsonValue::Bool;
+    }
+    if (std::is_same<T, double>::value) {
+      return v_->kind == JsonValue::Int || v_->kind == JsonValue::Float;
+    }
+    if (std::is_same<T, unsigned long long>::value) {
+      return v_->kind == JsonValue::Int && v_->i >= 0;
+    }
+    if (std::is_integral<T>::value) {
+      return v_->kind == JsonValue::Int;
+    }
+    return false;
+  }
+
+  template <typename T>
+  T as() const;
+
+ private:
+  const JsonValue *v_;
+};
+
+template <>
+inline const char *JsonVariantConst::as<const char *>() const {
+  return v_->kind == JsonValue::Text ? v_->s.c_str() : nullptr;
+}
+template <>
+inline bool JsonVariantConst::as<bool>() const {
+  return v_->b;
+}
+template <>
+inline double JsonVariantConst::as<double>() const {
+  return v_->kind == JsonValue::Int ? static_cast<double>(v_->i) : v_->d;
+}
+template <>
+inline long long JsonVariantConst::as<long long>() const {
+  return v_->i;
+}
+template <>
+inline unsigned long long JsonVariantConst::as<unsigned long long>() const {
+  return static_cast<unsigned long long>(v_->i);
+}
+template <>
+inline int JsonVariantConst::as<int>() const {
+  return static_cast<int>(v_->i);
+}
+template <>
+inline unsigned int JsonVariantConst::as<unsigned int>() const {
+  return static_cast<unsigned int>(v_->i);
+}
+template <>
+inline unsigned long JsonVariantConst::as<unsigned long>() const {
+  return static_cast<unsigned long>(v_->i);
+}
+
+using JsonMembers = std::vector<std::pair<std::string, JsonValue>>;
+
+class JsonString {
+ public:
+  explicit JsonString(const char *text) : text_(text) {}
+  const char *c_str() const { return text_; }
+
+ private:
+  const char *text_;
+};
+
+class JsonPairConst {
+ public:
+  explicit JsonPairConst(const JsonMembers::value_type *member) : member_(member) {}
+  JsonString key() const { return JsonString(member_->first.c_str()); }
+  JsonVariantConst value() const { return JsonVariantConst(&member_->second); }
+
+ private:
+  const JsonMembers::value_type *member_;
+};
+
+class JsonObjectConst {
+ public:
+  JsonObjectConst(const JsonMembers *members = nullptr) : members_(members) {}
+
+  class Iterator {
+   public:
+    explicit Iterator(const JsonMembers::value_type *at) : at_(at) {}
+    JsonPairConst operator*() const { return JsonPairConst(at_); }
+    Iterator &operator++() {
+      ++at_;
+      return *this;
+    }
+    bool operator!=(const Iterator &other) const { return at_ != other.at_; }
+
+   private:
+    const JsonMembers::value_type *at_;
+  };
+
+  // Linear key search, as ArduinoJson does.
+  JsonVariantConst operator[](const char *key) const {
+    if (members_) {
+      for (const auto &member : *members_) {
+        if (member.first == key) {
+          return JsonVariantConst(&member.second);
+        }
+      }
+    }
+    return JsonVariantConst();
+  }
+
+  Iterator begin() const { return Iterator(members_ ? members_->data() : nullptr); }
+  Iterator end() const {
+    return Iterator(members_ ? members_->data() + members_->size() : nullptr);
+  }
+
+ private:
+  const JsonMembers *members_;
+};
+
+// Handlers take a result object; the benchmark's handlers never fill it.
+class JsonObject {};
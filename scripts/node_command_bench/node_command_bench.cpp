@@ -0,0 +1,347 @@
+// Host benchmark for node command dispatch. Runs 10k invokes through the
+// NodeCommandRegistry hash table (lookup plus a no-op handler) and through a
+// strcmp chain in the order of the old handleInvoke if/else dispatch, over
+// the same mix of built-in names and a few unknown ones.
+//
+// Then decodes cc1101.tx params 10k times through decodeNodeParams and
+// through the keyed reads the handler made before, which copied each string
+// value into a String (a heap allocation on the device). It also checks how
+// integer text is parsed: decimal, hex only with "0x".
+//
+//   scripts/node_command_bench/run.sh [invokes] [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "node_command_registry.h"
+#include "node_param_schema.h"
+
+namespace {
+
+// Names of kBuiltinCommands in src/core/node_command_handler.cpp.
+const char *const kBuiltinNames[] = {
+    "system.which",      "system.run",          "system.cancel",    "system.batch",
+    "cc1101.info",       "cc1101.set_freq",     "cc1101.tx",        "cc1101.read_rssi",
+    "cc1101.packet_get", "cc1101.packet_set",   "cc1101.packet_tx_text",
+    "cc1101.packet_rx_once", "sd.bench",        "sd.bench_result",
+};
+constexpr size_t kBuiltinCount = sizeof(kBuiltinNames) / sizeof(kBuiltinNames[0]);
+const char *const kUnknownNames[] = {"camera.snap", "cc1101.scan", "system.reboot"};
+
+volatile uint32_t gCalls = 0;
+
+bool noopHandler(const NodeCommandCall &, JsonObject, NodeCommandError &) {
+  gCalls = gCalls + 1;
+  return true;
+}
+
+std::vector<NodeCommandSpec> makeSpecs() {
+  std::vector<NodeCommandSpec> specs;
+  for (const char *name : kBuiltinNames) {
+    specs.push_back(makeNodeCommand(name, noopHandler));
+  }
+  return specs;
+}
+
+// The old dispatch compared the name against each command in turn.
+bool chainDispatch(const char *name, const NodeCommandCall &call) {
+  NodeCommandError error;
+  for (size_t i = 0; i < kBuiltinCount; ++i) {
+    if (strcmp(name, kBuiltinNames[i]) == 0) {
+      return noopHandler(call, JsonObject(), error);
+    }
+  }
+  return false;
+}
+
+bool registryDispatch(const NodeCommandRegistry &registry,
+                      const char *name,
+                      const NodeCommandCall &call) {
+  NodeCommandError error;
+  const NodeCommandSpec *spec = registry.find(name);
+  return spec && spec->handler(call, JsonObject(), error);
+}
+
+template <typename Fn>
+double bestNsPerInvoke(const std::vector<const char *> &names, int rounds, Fn dispatch,
+                       size_t &found) {
+  double best = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const char *name : names) {
+      found += dispatch(name) ? 1 : 0;
+    }
+    const double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count();
+    best = std::min(best, ns / static_cast<double>(names.size()));
+  }
+  return best;
+}
+
+// kTxParams in src/core/node_command_handler.cpp.
+struct TxParams {
+  uint32_t code = 0;
+  uint32_t bits = 0;
+  uint32_t pulseLength = 0;
+  uint32_t protocol = 0;
+  uint32_t repeat = 0;
+};
+constexpr NodeCommandParam kTxParams[] = {
+    requiredParam("code", NodeParamType::UInt, offsetof(TxParams, code)),
+    requiredParam("bits", NodeParamType::UInt, offsetof(TxParams, bits), 1, 32),
+    optionalParam("pulseLength", NodeParamType::UInt, offsetof(TxParams, pulseLength), 50, 5000, 350),
+    optionalParam("protocol", NodeParamType::UInt, offsetof(TxParams, protocol), 1, 12, 1),
+    optionalParam("repeat", NodeParamType::UInt, offsetof(TxParams, repeat), 1, 50, 10),
+};
+
+size_t gStringCopies = 0;
+
+// readUInt32FromJson / readUInt64FromJson as cmdCc1101Tx used them.
+bool legacyReadUInt32(JsonVariantConst v, uint32_t &out) {
+  if (v.is<uint32_t>()) {
+    out = v.as<uint32_t>();
+    return true;
+  }
+  if (v.is<const char *>()) {
+    const String text = String(v.as<const char *>());
+    ++gStringCopies;
+    char *endPtr = nullptr;
+    const unsigned long value = strtoul(text.c_str(), &endPtr, 0);
+    if (endPtr == text.c_str() || *endPtr != '\0') {
+      return false;
+    }
+    out = static_cast<uint32_t>(value);
+    return true;
+  }
+  return false;
+}
+
+bool legacyReadUInt64(JsonVariantConst v, uint64_t &out) {
+  if (v.is<unsigned long long>()) {
+    out = static_cast<uint64_t>(v.as<unsigned long long>());
+    return true;
+  }
+  if (v.is<const char *>()) {
+    const String token = String(v.as<const char *>());
+    ++gStringCopies;
+    char *endPtr = nullptr;
+    const unsigned long long value = strtoull(token.c_str(), &endPtr, 0);
+    if (endPtr == token.c_str() || *endPtr != '\0') {
+      return false;
+    }
+    out = static_cast<uint64_t>(value);
+    return true;
+  }
+  return false;
+}
+
+bool legacyDecodeTx(JsonObjectConst params, TxParams &args) {
+  uint64_t code64 = 0;
+  args.pulseLength = 350;
+  args.protocol = 1;
+  args.repeat = 10;
+  if (!legacyReadUInt64(params["code"], code64) || code64 > 0xFFFFFFFFULL) {
+    return false;
+  }
+  args.code = static_cast<uint32_t>(code64);
+  if (!legacyReadUInt32(params["bits"], args.bits)) {
+    return false;
+  }
+  if (!params["pulseLength"].isNull() && !legacyReadUInt32(params["pulseLength"], args.pulseLength)) {
+    return false;
+  }
+  if (!params["protocol"].isNull() && !legacyReadUInt32(params["protocol"], args.protocol)) {
+    return false;
+  }
+  if (!params["repeat"].isNull() && !legacyReadUInt32(params["repeat"], args.repeat)) {
+    return false;
+  }
+  return true;
+}
+
+bool schemaDecodeTx(JsonObjectConst params, TxParams &args) {
+  NodeCommandError error;
+  return decodeNodeParams(params, kTxParams, args, error);
+}
+
+// Gateway calls send JSON numbers; system.run argument arrays send strings.
+std::vector<JsonMembers> makeTxParams(size_t count, bool asText) {
+  std::mt19937 rng(2);
+  std::vector<JsonMembers> out;
+  out.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t values[] = {static_cast<uint32_t>(rng() % 0x1000000), 24,
+                               static_cast<uint32_t>(100 + rng() % 600),
+                               static_cast<uint32_t>(1 + rng() % 3),
+                               static_cast<uint32_t>(5 + rng() % 10)};
+    const char *const keys[] = {"code", "bits", "pulseLength", "protocol", "repeat"};
+    const size_t present = 2 + rng() % 4;
+    JsonMembers members;
+    for (size_t k = 0; k < present; ++k) {
+      members.emplace_back(keys[k], asText ? JsonValue::text(std::to_string(values[k]).c_str())
+                                           : JsonValue::integer(values[k]));
+    }
+    out.push_back(std::move(members));
+  }
+  return out;
+}
+
+template <typename Fn>
+double bestNsPerDecode(const std::vector<JsonMembers> &calls, int rounds, Fn decode,
+                       uint64_t &checksum) {
+  double best = 1e30;
+  for (int round = 0; round < rounds; ++round) {
+    checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const JsonMembers &members : calls) {
+      TxParams args;
+      if (decode(JsonObjectConst(&members), args)) {
+        checksum += args.code ^ args.bits ^ args.pulseLength ^ args.protocol ^ args.repeat;
+      }
+    }
+    const double ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count();
+    best = std::min(best, ns / static_cast<double>(calls.size()));
+  }
+  return best;
+}
+
+// Decodes {"code": text, "bits": "8"}; returns false when the schema rejects it.
+bool decodeCodeText(const char *text, uint32_t &code) {
+  const JsonMembers members = {{"code", JsonValue::text(text)}, {"bits", JsonValue::text("8")}};
+  TxParams args;
+  NodeCommandError error;
+  if (!decodeNodeParams(JsonObjectConst(&members), kTxParams, args, error)) {
+    return false;
+  }
+  code = args.code;
+  return true;
+}
+
+bool checkNumberText() {
+  struct Case {
+    const char *text;
+    bool ok;
+    uint32_t code;
+  };
+  const Case cases[] = {
+      {"10", true, 10},       {"010", true, 10},  {"0x1F", true, 31}, {"0X10", true, 16},
+      {"4294967295", true, 4294967295u},          {"0x", false, 0},   {"12x", false, 0},
+      {"", false, 0},         {"0b101", false, 0}, {"4294967296", false, 0},
+  };
+  bool ok = true;
+  for (const Case &c : cases) {
+    uint32_t code = 0;
+    const bool decoded = decodeCodeText(c.text, code);
+    if (decoded != c.ok || (decoded && code != c.code)) {
+      fprintf(stderr, "code \"%s\": got %s %u, want %s %u\n", c.text,
+              decoded ? "ok" : "rejected", code, c.ok ? "ok" : "rejected", c.code);
+      ok = false;
+    }
+  }
+
+  struct OffsetParams {
+    int32_t offset = 0;
+  };
+  constexpr NodeCommandParam kOffsetParams[] = {
+      requiredParam("offset", NodeParamType::Int, offsetof(OffsetParams, offset), -100, 100),
+  };
+  const char *const signedTexts[] = {"-010", "-0x10"};
+  const int32_t signedWant[] = {-10, -16};
+  for (size_t i = 0; i < 2; ++i) {
+    const JsonMembers members = {{"offset", JsonValue::text(signedTexts[i])}};
+    OffsetParams args;
+    NodeCommandError error;
+    if (!decodeNodeParams(JsonObjectConst(&members), kOffsetParams, args, error) ||
+        args.offset != signedWant[i]) {
+      fprintf(stderr, "offset \"%s\": want %d\n", signedTexts[i], signedWant[i]);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const size_t invokes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000;
+  const int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+  const std::vector<NodeCommandSpec> specs = makeSpecs();
+  NodeCommandRegistry registry;
+  for (const NodeCommandSpec &spec : specs) {
+    if (!registry.add(spec)) {
+      fprintf(stderr, "registry refused %s\n", spec.name);
+      return 1;
+    }
+  }
+
+  // Mostly radio commands, as a gateway automation sends them, 2% unknown.
+  // Names are copied so neither path can compare pointers.
+  std::mt19937 rng(1);
+  std::vector<std::string> storage;
+  storage.reserve(invokes);
+  for (size_t i = 0; i < invokes; ++i) {
+    const unsigned roll = rng() % 100;
+    const char *name = roll < 2 ? kUnknownNames[rng() % 3]
+                       : roll < 70 ? kBuiltinNames[4 + rng() % 8]
+                                   : kBuiltinNames[rng() % kBuiltinCount];
+    storage.emplace_back(name);
+  }
+  std::vector<const char *> names;
+  for (const std::string &name : storage) {
+    names.push_back(name.c_str());
+  }
+
+  const NodeCommandCall call{registry, JsonObjectConst(), nullptr};
+  size_t chainFound = 0;
+  size_t tableFound = 0;
+  const double chainNs = bestNsPerInvoke(
+      names, rounds, [&](const char *name) { return chainDispatch(name, call); }, chainFound);
+  const double tableNs = bestNsPerInvoke(
+      names, rounds, [&](const char *name) { return registryDispatch(registry, name, call); },
+      tableFound);
+  if (chainFound != tableFound) {
+    fprintf(stderr, "dispatch mismatch: chain %zu, registry %zu\n", chainFound, tableFound);
+    return 1;
+  }
+
+  printf("%zu invokes (%zu known, %zu commands), best of %d rounds\n", names.size(),
+         tableFound, kBuiltinCount, rounds);
+  printf("  strcmp chain  %7.1f ns/invoke  %8.3f ms total\n", chainNs,
+         chainNs * static_cast<double>(names.size()) / 1e6);
+  printf("  registry      %7.1f ns/invoke  %8.3f ms total\n", tableNs,
+         tableNs * static_cast<double>(names.size()) / 1e6);
+
+  if (!checkNumberText()) {
+    return 1;
+  }
+  printf("cc1101.tx params, %zu decodes, best of %d rounds\n", invokes, rounds);
+  for (const bool asText : {false, true}) {
+    const std::vector<JsonMembers> calls = makeTxParams(invokes, asText);
+    uint64_t legacySum = 0;
+    uint64_t schemaSum = 0;
+    gStringCopies = 0;
+    const double legacyNs = bestNsPerDecode(calls, rounds, legacyDecodeTx, legacySum);
+    const size_t copies = gStringCopies / static_cast<size_t>(rounds);
+    const double schemaNs = bestNsPerDecode(calls, rounds, schemaDecodeTx, schemaSum);
+    if (legacySum != schemaSum) {
+      fprintf(stderr, "decode mismatch (%s values)\n", asText ? "string" : "number");
+      return 1;
+    }
+    printf("  %s values\n", asText ? "string" : "number");
+    printf("    keyed reads   %7.1f ns/decode  %zu String copies\n", legacyNs, copies);
+    printf("    schema        %7.1f ns/decode\n", schemaNs);
+  }
+  printf("integer text: decimal unless 0x-prefixed ok\n");
+  return 0;
+}
@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Builds and runs the node command dispatch and param decode host benchmark.
+#   scripts/node_command_bench/run.sh [invokes] [rounds]
+set -euo pipefail
+
+HERE="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT="$(cd "${HERE}/../.." && pwd)"
+OUT="${TMPDIR:-/tmp}/node_command_bench"
+
+"${CXX:-c++}" -std=c++17 -O2 -I"${HERE}" -I"${ROOT}/src/core" \
+  "${HERE}/node_command_bench.cpp" "${ROOT}/src/core/node_command_registry.cpp" \
+  "${ROOT}/src/core/node_param_schema.cpp" -o "${OUT}"
+"${OUT}" "$@"
@@ -9,6 +9,7 @@ FIRMWARE_BIN_PATH="${FIRMWARE_BIN_PATH:-.pio/build/${PIO_ENV}/firmware.bin}"
 REPO_SLUG="${REPO_SLUG:-${GITHUB_REPOSITORY:-unknown/unknown}}"
 INCLUDE_LATEST_ALIAS="${INCLUDE_LATEST_ALIAS:-false}"
 INCLUDE_APP_BUNDLE="${INCLUDE_APP_BUNDLE:-true}"
+INCLUDE_FONT_PACK="${INCLUDE_FONT_PACK:-true}"
 
 sha256_file() {
   local target="$1"
@@ -87,5 +88,13 @@ EOF
   sha256_file "${APP_BUNDLE_PATH}" > "${APP_BUNDLE_PATH}.sha256"
 fi
 
+if [[ "${INCLUDE_FONT_PACK}" == "true" ]]; then
+  # Copied to /fonts/korean_ui_14.zxgp on the SD card; the firmware no
+  # longer links the Korean font.
+  FONT_PACK_PATH="${DIST_DIR}/korean_ui_14.zxgp"
+  python3 "$(dirname "$0")/font_pack/build_font_pack.py" -o "${FONT_PACK_PATH}"
+  sha256_file "${FONT_PACK_PATH}" > "${FONT_PACK_PATH}.sha256"
+fi
+
 echo "Packaged assets in ${DIST_DIR}:"
 find "${DIST_DIR}" -maxdepth 1 -type f -print | sort
@@ -0,0 +1,34 @@
+// Minimal Arduino stand-in so src/core/sd_buffered_writer.cpp builds on a
+// host. Only what the writer and the benchmark use.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+class String {
+ public:
+  String() = default;
+  String(const char *text) : s_(text ? text : "") {}
+  explicit String(uint32_t value) : s_(std::to_string(value)) {}
+
+  const char *c_str() const { return s_.c_str(); }
+  size_t length() const { return s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+
+  String &operator=(const char *text) {
+    s_ = text ? text : "";
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) {
+    String out;
+    out.s_ = a.s_ + b.s_;
+    return out;
+  }
+  friend String operator+(const String &a, const char *b) { return a + String(b); }
+  friend String operator+(const char *a, const String &b) { return String(a) + b; }
+
+ private:
+  std::string s_;
+};
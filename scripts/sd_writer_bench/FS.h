@@ -0,0 +1,50 @@
+// File-backed SD stand-in. Every write() is one unbuffered write(2), the way
+// every File::write on the device is one trip through FatFs and the SD
+// driver. It also counts calls and writes that start or end mid-sector,
+// which the card has to read-modify-write.
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+struct SdStandInStats {
+  uint64_t calls = 0;
+  uint64_t partialSectorWrites = 0;
+};
+
+class File {
+ public:
+  File() = default;
+  explicit File(int fd) : fd_(fd) {}
+
+  explicit operator bool() const { return fd_ >= 0; }
+  size_t position() const { return static_cast<size_t>(pos_); }
+
+  size_t write(const uint8_t *data, size_t len) {
+    ++stats.calls;
+    if ((pos_ % 512) != 0 || (len % 512) != 0) {
+      ++stats.partialSectorWrites;
+    }
+    const ssize_t put = ::write(fd_, data, len);
+    if (put <= 0) {
+      return 0;
+    }
+    pos_ += static_cast<uint64_t>(put);
+    return static_cast<size_t>(put);
+  }
+  void flush() {}
+  void close() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  SdStandInStats stats;
+
+ private:
+  int fd_ = -1;
+  uint64_t pos_ = 0;
+};
@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# Builds and runs the SdBufferedWriter host benchmark.
+#   scripts/sd_writer_bench/run.sh [megabytes] [buffer-bytes]
+set -euo pipefail
+
+HERE="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT="$(cd "${HERE}/../.." && pwd)"
+OUT="${TMPDIR:-/tmp}/sd_writer_bench"
+
+"${CXX:-c++}" -std=c++17 -O2 -I"${HERE}" -I"${ROOT}/src/core" \
+  "${HERE}/sd_writer_bench.cpp" "${ROOT}/src/core/sd_buffered_writer.cpp" -o "${OUT}"
+cd "${TMPDIR:-/tmp}"
+"${OUT}" "$@"
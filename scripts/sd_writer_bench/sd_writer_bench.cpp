@@ -0,0 +1,158 @@
+// Host benchmark for SdBufferedWriter against a file-backed SD stand-in.
+// For each caller chunk size it writes the same payload directly (one
+// File::write per chunk, as the old code did), through the writer inline,
+// and in background mode with pump() after every write (as the recorder
+// does), and reports MB/s, write calls and partial-sector writes. Every
+// file is read back and compared with the payload.
+//
+//   scripts/sd_writer_bench/run.sh [megabytes] [buffer-bytes]
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "sd_buffered_writer.h"
+#include "sd_storage.h"
+
+namespace sdstorage {
+
+// The writer retains the card while started; nothing remounts it here.
+int gRetained = 0;
+
+void retain() {
+  ++gRetained;
+}
+
+void release() {
+  --gRetained;
+}
+
+}  // namespace sdstorage
+
+namespace {
+
+// The WAV writers leave a 44-byte header in front of the samples.
+constexpr size_t kHeaderBytes = 44;
+constexpr size_t kChunkSizes[] = {2, 64, 512, 768, 2048, 4096, 16384};
+
+enum class Path { Direct, Inline, Pumped };
+
+struct Result {
+  double mbPerSec = 0;
+  SdStandInStats stats;
+  bool ok = false;
+};
+
+File openStandIn(const char *path) {
+  return File(::open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644));
+}
+
+// The file must hold the header and then the payload repeated.
+bool contentMatches(const char *path, const std::vector<uint8_t> &payload, size_t totalBytes) {
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  std::vector<uint8_t> data(kHeaderBytes + totalBytes + 1);
+  size_t got = 0;
+  ssize_t n = 0;
+  while ((n = ::read(fd, data.data() + got, data.size() - got)) > 0) {
+    got += static_cast<size_t>(n);
+  }
+  ::close(fd);
+  if (got != kHeaderBytes + totalBytes) {
+    return false;
+  }
+  for (size_t i = 0; i < totalBytes; ++i) {
+    if (data[kHeaderBytes + i] != payload[i % payload.size()]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Result run(const char *path, size_t chunk, size_t totalBytes, size_t bufferBytes, Path mode) {
+  std::vector<uint8_t> payload(chunk);
+  for (size_t i = 0; i < chunk; ++i) {
+    payload[i] = static_cast<uint8_t>(i * 31U);
+  }
+  const uint8_t header[kHeaderBytes] = {0};
+
+  Result result;
+  File file = openStandIn(path);
+  if (!file) {
+    return result;
+  }
+  file.write(header, sizeof(header));
+  file.stats = SdStandInStats();
+
+  SdBufferedWriter writer(bufferBytes, mode == Path::Pumped ? SdBufferedWriter::Mode::Background
+                                                             : SdBufferedWriter::Mode::Inline);
+  const bool buffered = mode != Path::Direct;
+  if (buffered && !writer.begin(file)) {
+    file.close();
+    return result;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  for (size_t done = 0; ok && done < totalBytes; done += chunk) {
+    ok = buffered ? writer.write(payload.data(), chunk)
+                  : file.write(payload.data(), chunk) == chunk;
+    if (ok && mode == Path::Pumped) {
+      ok = writer.pump();
+    }
+  }
+  if (buffered) {
+    ok = writer.end() && ok;
+  }
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result.stats = file.stats;
+  result.mbPerSec = static_cast<double>(totalBytes) / (1024.0 * 1024.0) / seconds;
+  file.close();
+  // The last chunk may run past totalBytes.
+  const size_t writtenBytes = (totalBytes + chunk - 1) / chunk * chunk;
+  result.ok = ok && sdstorage::gRetained == 0 && contentMatches(path, payload, writtenBytes);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const size_t megabytes = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 8;
+  const size_t bufferBytes =
+      argc > 2 ? static_cast<size_t>(atoi(argv[2])) : SdBufferedWriter::kDefaultBufferBytes;
+  const size_t totalBytes = megabytes * 1024U * 1024U;
+  const char *path = "sd_writer_bench.tmp";
+
+  printf("payload %zu MB, writer buffer %zu bytes, %zu-byte header first\n\n",
+         megabytes, bufferBytes, kHeaderBytes);
+  printf("%8s | %10s %10s %9s | %10s %10s %9s | %10s %10s %9s\n", "chunk", "direct MB/s",
+         "calls", "partial", "buffer MB/s", "calls", "partial", "pumped MB/s", "calls",
+         "partial");
+  for (const size_t chunk : kChunkSizes) {
+    const Result direct = run(path, chunk, totalBytes, bufferBytes, Path::Direct);
+    const Result buffered = run(path, chunk, totalBytes, bufferBytes, Path::Inline);
+    const Result pumped = run(path, chunk, totalBytes, bufferBytes, Path::Pumped);
+    if (!direct.ok || !buffered.ok || !pumped.ok) {
+      fprintf(stderr, "write or read-back failed at chunk %zu\n", chunk);
+      unlink(path);
+      return 1;
+    }
+    printf("%8zu | %11.1f %10llu %9llu | %11.1f %10llu %9llu | %11.1f %10llu %9llu\n", chunk,
+           direct.mbPerSec, static_cast<unsigned long long>(direct.stats.calls),
+           static_cast<unsigned long long>(direct.stats.partialSectorWrites),
+           buffered.mbPerSec, static_cast<unsigned long long>(buffered.stats.calls),
+           static_cast<unsigned long long>(buffered.stats.partialSectorWrites),
+           pumped.mbPerSec, static_cast<unsigned long long>(pumped.stats.calls),
+           static_cast<unsigned long long>(pumped.stats.partialSectorWrites));
+  }
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""Client for the binary serial RPC on the device USB port (USER_SERIAL_RPC_ENABLED).
+
+Run one command:
+  scripts/serial_rpc_client.py /dev/ttyACM0 call cc1101.info
+  scripts/serial_rpc_client.py /dev/ttyACM0 call cc1101.set_freq '{"mhz": 433.92}'
+
+Measure round trips and throughput with echoed ping frames:
+  scripts/serial_rpc_client.py /dev/ttyACM0 bench --count 500 --size 1024
+
+Stream received packets or RSSI samples (Ctrl+C to stop):
+  scripts/serial_rpc_client.py /dev/ttyACM0 stream packets
+  scripts/serial_rpc_client.py /dev/ttyACM0 stream rssi --interval 5
+
+Check the framing code without a device:
+  scripts/serial_rpc_client.py --loopback
+
+Frames are type(1) seq(2) payload crc32(4), COBS-encoded and sent between
+two 0x00 bytes. Log text printed on the same port between frames arrives as
+its own 0x00-delimited chunk, fails the CRC and is skipped; a log line printed
+in the middle of a frame costs that one frame. scripts/serial_rpc_framing
+checks this against the firmware's encoder.
+
+Requires: pip install pyserial
+"""
+
+import argparse
+import json
+import os
+import statistics
+import struct
+import sys
+import time
+import zlib
+
+CALL, PING, STREAM_START, STREAM_STOP = 0x01, 0x02, 0x03, 0x04
+RESULT, PONG, STREAM_ACK, STREAM_DATA, ERROR = 0x81, 0x82, 0x83, 0x90, 0xFF
+CHANNELS = {"packets": 1, "rssi": 2}
+STREAM_STATUS = {0: "ok", 1: "radio busy", 2: "invalid", 3: "radio unavailable"}
+MAX_FRAME = 2048
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_index] = code
+            code_index, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_index] = code
+            code_index, code = len(out), 1
+            out.append(0)
+    out[code_index] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def build_frame(frame_type, seq, payload=b""):
+    raw = struct.pack("<BH", frame_type, seq & 0xFFFF) + payload
+    raw += struct.pack("<I", zlib.crc32(raw))
+    return b"\x00" + cobs_encode(raw) + b"\x00"
+
+
+def parse_frame(encoded):
+    """Returns (type, seq, payload), or None for log text and damaged frames."""
+    try:
+        raw = cobs_decode(encoded)
+    except ValueError:
+        return None
+    if len(raw) < 7 or zlib.crc32(raw[:-4]) != struct.unpack("<I", raw[-4:])[0]:
+        return None
+    frame_type, seq = struct.unpack("<BH", raw[:3])
+    return frame_type, seq, raw[3:-4]
+
+
+class Link:
+    def __init__(self, port):
+        """`port` is an open pyserial port, or anything with read() and in_waiting."""
+        self.port = port
+        self.buffer = bytearray()
+        self.seq = 0
+
+    @classmethod
+    def open(cls, port, baud):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required: pip install pyserial")
+        return cls(serial.Serial(port, baud, timeout=0.2))
+
+    def send(self, frame_type, payload=b""):
+        self.seq = (self.seq + 1) & 0xFFFF
+        self.port.write(build_frame(frame_type, self.seq, payload))
+        return self.seq
+
+    def frames(self, timeout):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            chunk = self.port.read(max(1, self.port.in_waiting))
+            self.buffer += chunk
+            while True:
+                end = self.buffer.find(b"\x00")
+                if end < 0:
+                    break
+                encoded = bytes(self.buffer[:end])
+                del self.buffer[:end + 1]
+                frame = parse_frame(encoded) if encoded else None
+                if frame:
+                    yield frame
+
+    def wait(self, want_type, seq, timeout=5.0):
+        for frame_type, frame_seq, payload in self.frames(timeout):
+            if frame_type == ERROR:
+                raise RuntimeError(f"device rejected frame (reason {payload[0] if payload else '?'})")
+            if frame_type == want_type and frame_seq == seq:
+                return payload
+        raise TimeoutError("no reply from device")
+
+
+def run_call(link, args):
+    params = json.loads(args.params) if args.params else {}
+    body = json.dumps({"command": args.command, "params": params}).encode()
+    reply = json.loads(link.wait(RESULT, link.send(CALL, body), timeout=args.timeout))
+    print(json.dumps(reply, indent=2))
+    return 0 if reply.get("ok") else 1
+
+
+def run_bench(link, args):
+    size = max(0, min(args.size, MAX_FRAME - 7))
+    latencies = []
+    started = time.perf_counter()
+    for _ in range(args.count):
+        payload = os.urandom(size)
+        t0 = time.perf_counter()
+        echoed = link.wait(PONG, link.send(PING, payload))
+        latencies.append((time.perf_counter() - t0) * 1000.0)
+        if echoed != payload:
+            sys.exit("echo mismatch")
+    elapsed = time.perf_counter() - started
+
+    latencies.sort()
+    p95 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.95))]
+    mbit = args.count * size * 2 * 8 / elapsed / 1e6
+    print(f"ping {size} B: {args.count} round trips")
+    print(f"  throughput {args.count / elapsed:.1f} frames/s, {mbit:.2f} Mbit/s (both directions)")
+    print(f"  latency ms  p50 {statistics.median(latencies):.2f}  "
+          f"p95 {p95:.2f}  max {latencies[-1]:.2f}")
+    return 0
+
+
+def run_stream(link, args):
+    channel = CHANNELS[args.channel]
+    ack = link.wait(STREAM_ACK, link.send(STREAM_START, struct.pack("<BH", channel, args.interval)))
+    if ack[1] != 0:
+        sys.exit(f"stream refused: {STREAM_STATUS.get(ack[1], ack[1])}")
+
+    samples = 0
+    last_ping = time.monotonic()
+    started = last_ping
+    try:
+        while True:
+            # The device stops streams when the host goes quiet.
+            if time.monotonic() - last_ping > 2.0:
+                link.send(PING)
+                last_ping = time.monotonic()
+            for frame_type, _, payload in link.frames(0.1):
+                if frame_type != STREAM_DATA or not payload or payload[0] != channel:
+                    continue
+                if channel == CHANNELS["packets"]:
+                    rssi, length = struct.unpack("<bB", payload[1:3])
+                    print(f"{rssi:4d} dBm  {payload[3:3 + length].hex()}")
+                    samples += 1
+                else:
+                    first_ms, interval, count = struct.unpack("<IHB", payload[1:8])
+                    values = struct.unpack(f"<{count}b", payload[8:8 + count])
+                    samples += count
+                    rate = samples / max(time.monotonic() - started, 1e-6)
+                    print(f"t={first_ms} ms  +{interval} ms x{count}  "
+                          f"min {min(values)} max {max(values)} dBm  ({rate:.0f} samples/s)")
+    except KeyboardInterrupt:
+        pass
+    link.send(STREAM_STOP, bytes([channel]))
+    return 0
+
+
+def run_loopback():
+    cases = [b"", b"\x00", b"\x00\x00", b"\x11\x00\x22", bytes(range(1, 255)),
+             bytes(range(256)) * 4, bytes(254), os.urandom(MAX_FRAME - 7)]
+    for payload in cases:
+        encoded = build_frame(CALL, 0x1234, payload)
+        assert encoded.index(b"\x00", 1) == len(encoded) - 1, "delimiter inside frame"
+        assert parse_frame(encoded[1:-1]) == (CALL, 0x1234, payload), "round trip failed"
+        damaged = bytearray(encoded[1:-1])
+        damaged[len(damaged) // 2] ^= 0x40
+        assert parse_frame(bytes(damaged)) is None, "CRC missed corruption"
+    assert parse_frame(b"I (1234) log line") is None
+    print(f"loopback ok ({len(cases)} frames)")
+    return 0
+
+
+def main():
+    if "--loopback" in sys.argv[1:]:
+        return run_loopback()
+
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200,
+                        help="ignored by USB CDC, kept for UART bridges")
+    parser.add_argument("--loopback", action="store_true",
+                        help="self-test the framing code without a device")
+    sub = parser.add_subparsers(dest="mode", required=True)
+
+    call = sub.add_parser("call")
+    call.add_argument("command")
+    call.add_argument("params", nargs="?", help="JSON object")
+    call.add_argument("--timeout", type=float, default=15.0)
+
+    bench = sub.add_parser("bench")
+    bench.add_argument("--count", type=int, default=200)
+    bench.add_argument("--size", type=int, default=1024, help="ping payload bytes")
+
+    stream = sub.add_parser("stream")
+    stream.add_argument("channel", choices=sorted(CHANNELS))
+    stream.add_argument("--interval", type=int, default=10, help="RSSI sample interval ms")
+
+    args = parser.parse_args()
+    link = Link.open(args.port, args.baud)
+    if args.mode == "call":
+        return run_call(link, args)
+    if args.mode == "bench":
+        return run_bench(link, args)
+    return run_stream(link, args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Parses a framing_stream capture with the host client's Link and checks it.
+
+  check_stream.py <stream> <expected> [--report-only]
+
+Every frame marked intact must arrive exactly once with its payload, and
+nothing else may parse as a frame. A frame with log text inside it may be
+lost but must never arrive damaged. --report-only prints the counts without
+failing (used for the old wire format).
+"""
+
+import pathlib
+import sys
+
+sys.path.insert(0, str(pathlib.Path(__file__).resolve().parent.parent))
+import serial_rpc_client as client  # noqa: E402
+
+
+class CapturePort:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    @property
+    def in_waiting(self):
+        return len(self.data) - self.pos
+
+    def read(self, size):
+        # Odd read sizes split frames and log lines across reads.
+        size = min(size, 61)
+        chunk = self.data[self.pos:self.pos + size]
+        self.pos += len(chunk)
+        return chunk
+
+
+def main():
+    stream = pathlib.Path(sys.argv[1]).read_bytes()
+    report_only = "--report-only" in sys.argv[3:]
+    expected = {}
+    for line in pathlib.Path(sys.argv[2]).read_text().splitlines():
+        seq, intact, payload = (line.split(" ") + [""])[:3]
+        expected[int(seq)] = (intact == "1", bytes.fromhex(payload))
+
+    link = client.Link(CapturePort(stream))
+    received = {}
+    problems = []
+    port = link.port
+    while port.in_waiting:
+        for frame_type, seq, payload in link.frames(0.05):
+            if frame_type != 0x90 or seq not in expected or seq in received:
+                problems.append(f"unexpected frame type {frame_type:#x} seq {seq}")
+            elif payload != expected[seq][1]:
+                problems.append(f"frame {seq} arrived damaged")
+            received[seq] = True
+
+    intact = [seq for seq, (ok, _) in expected.items() if ok]
+    lost_intact = [seq for seq in intact if seq not in received]
+    hit = len(expected) - len(intact)
+    lost_hit = sum(1 for seq, (ok, _) in expected.items() if not ok and seq not in received)
+    print(f"{len(expected)} frames, {len(stream)} bytes: {len(received)} received, "
+          f"{len(lost_intact)} of {len(intact)} clean frames lost, "
+          f"{lost_hit} of {hit} frames with log text inside lost")
+    for seq in lost_intact[:5]:
+        problems.append(f"clean frame {seq} lost")
+    for problem in problems[:10]:
+        print("  " + problem)
+    if report_only:
+        return 0
+    return 1 if problems or lost_intact else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
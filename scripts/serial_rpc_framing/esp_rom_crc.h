@@ -0,0 +1,17 @@
+// Host stand-in for the ESP ROM CRC used by src/core/serial_rpc_frame.cpp.
+// esp_rom_crc32_le(0, ...) is the standard CRC-32 (zlib.crc32).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; ++i) {
+    crc ^= buf[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+  }
+  return ~crc;
+}
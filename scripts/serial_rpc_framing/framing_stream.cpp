@@ -0,0 +1,118 @@
+// Writes a device-side serial RPC byte stream with ESP log text mixed in, as
+// the USB CDC port carries it, for check_stream.py to parse with the host
+// client. Frames come from the firmware's own encoder (serial_rpc_frame.cpp).
+//
+// Log text lands before frames (with and without a trailing newline), right
+// after them, and sometimes inside a frame, which is the one case that may
+// cost the frame. The expected outcome of each frame goes to `expected`.
+//
+//   framing_stream <stream-out> <expected-out> [frames] [seed] [--no-lead]
+//
+// --no-lead drops the leading 0x00 of every frame (the old wire format) to
+// show how many frames log text used to cost.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "serial_rpc_frame.h"
+
+namespace {
+
+const char *const kLogLines[] = {
+    "I (1234) wifi: connected\r\n",
+    "E (88) sd: mount failed",
+    "[sd] mounted at 20000000 Hz in 41 ms\n",
+    "W (5) boot: \x01\x02\xff binary-ish",
+    "rst:0x1 (POWERON),boot:0x8 (SPI_FAST_FLASH_BOOT)\n",
+    ">",
+};
+
+const char *pickLog(std::mt19937 &rng) {
+  return kLogLines[rng() % (sizeof(kLogLines) / sizeof(kLogLines[0]))];
+}
+
+void append(std::vector<uint8_t> &out, const char *text) {
+  out.insert(out.end(), text, text + strlen(text));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <stream-out> <expected-out> [frames] [seed] [--no-lead]\n",
+            argv[0]);
+    return 2;
+  }
+  const unsigned long frames = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2000;
+  const unsigned long seed = argc > 4 ? strtoul(argv[4], nullptr, 10) : 1;
+  const bool noLead = argc > 5 && strcmp(argv[5], "--no-lead") == 0;
+  std::mt19937 rng(seed);
+
+  FILE *expected = fopen(argv[2], "w");
+  if (!expected) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  std::vector<uint8_t> stream;
+  std::vector<uint8_t> raw(2048);
+  std::vector<uint8_t> wire(serialRpcMaxWireSize(raw.size()));
+  for (unsigned long i = 0; i < frames; ++i) {
+    std::vector<uint8_t> payload(rng() % 300);
+    for (uint8_t &b : payload) {
+      // Plenty of zeros, so COBS has work to do.
+      b = rng() % 4 == 0 ? 0 : static_cast<uint8_t>(rng());
+    }
+    const uint16_t seq = static_cast<uint16_t>(i);
+    size_t len = serialRpcEncodeFrame(0x90, seq, nullptr, 0, payload.data(), payload.size(),
+                                      raw.data(), raw.size(), wire.data(), wire.size());
+    if (len == 0) {
+      fprintf(stderr, "encode failed for frame %lu\n", i);
+      return 1;
+    }
+    const uint8_t *start = wire.data();
+    if (noLead) {
+      ++start;
+      --len;
+    }
+
+    const unsigned roll = rng() % 10;
+    if (roll < 4) {
+      append(stream, pickLog(rng));
+    }
+    bool intact = true;
+    if (roll == 9 && len > 4) {
+      // Another task's log line lands in the middle of the frame.
+      const size_t cut = 2 + rng() % (len - 3);
+      stream.insert(stream.end(), start, start + cut);
+      append(stream, pickLog(rng));
+      stream.insert(stream.end(), start + cut, start + len);
+      intact = false;
+    } else {
+      stream.insert(stream.end(), start, start + len);
+    }
+    if (roll == 5) {
+      append(stream, pickLog(rng));
+    }
+
+    fprintf(expected, "%u %d ", static_cast<unsigned>(seq), intact ? 1 : 0);
+    for (uint8_t b : payload) {
+      fprintf(expected, "%02x", b);
+    }
+    fprintf(expected, "\n");
+  }
+  fclose(expected);
+
+  FILE *out = fopen(argv[1], "wb");
+  if (!out || fwrite(stream.data(), 1, stream.size(), out) != stream.size()) {
+    perror(argv[1]);
+    return 1;
+  }
+  fclose(out);
+  return 0;
+}
@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# Builds the serial RPC framing stream generator and checks its output with
+# the host client, then shows what the old format (no leading 0x00) lost.
+#   scripts/serial_rpc_framing/run.sh [frames] [seed]
+set -euo pipefail
+
+HERE="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+ROOT="$(cd "${HERE}/../.." && pwd)"
+TMP="${TMPDIR:-/tmp}"
+OUT="${TMP}/serial_rpc_framing"
+FRAMES="${1:-2000}"
+SEED="${2:-1}"
+
+"${CXX:-c++}" -std=c++17 -O2 -Wall -I"${HERE}" -I"${ROOT}/src/core" \
+  "${HERE}/framing_stream.cpp" "${ROOT}/src/core/serial_rpc_frame.cpp" \
+  "${ROOT}/src/core/cobs.cpp" -o "${OUT}"
+
+"${OUT}" "${TMP}/serial_rpc_stream.bin" "${TMP}/serial_rpc_expected.txt" "${FRAMES}" "${SEED}"
+python3 "${HERE}/check_stream.py" "${TMP}/serial_rpc_stream.bin" "${TMP}/serial_rpc_expected.txt"
+
+echo "old format, for comparison:"
+"${OUT}" "${TMP}/serial_rpc_stream.bin" "${TMP}/serial_rpc_expected.txt" "${FRAMES}" "${SEED}" \
+  --no-lead
+python3 "${HERE}/check_stream.py" "${TMP}/serial_rpc_stream.bin" "${TMP}/serial_rpc_expected.txt" \
+  --report-only
@@ -0,0 +1,38 @@
+#include "app_context.h"
+
+#include "../core/ble_manager.h"
+#include "../core/gateway_client.h"
+#include "../core/lan_control_server.h"
+#include "../core/wifi_manager.h"
+#include "../hal/board_config.h"
+#include "../ui/i18n.h"
+#include "../ui/ui_runtime.h"
+
+void applyRuntimeConfig(AppContext &ctx) {
+  ctx.wifi->configure(ctx.config);
+  ctx.gateway->configure(ctx.config);
+  if (ctx.lanControl) {
+    ctx.lanControl->configure(ctx.config);
+  }
+  ctx.ble->configure(ctx.config);
+
+  const GatewayStatus gs = ctx.gateway->status();
+  if ((gs.wsConnected || gs.gatewayReady || gs.shouldConnect) &&
+      !ctx.config.gatewayUrl.isEmpty() &&
+      hasGatewayCredentials(ctx.config)) {
+    ctx.gateway->reconnectNow();
+  }
+
+#if HAL_HAS_DISPLAY
+  if (ctx.uiRuntime) {
+    applyUiConfig(ctx);
+  }
+#endif
+}
+
+void applyUiConfig(AppContext &ctx) {
+  ctx.uiRuntime->setKoreanFontInstalledDeferred(ctx.config.koreanFontInstalled);
+  ctx.uiRuntime->setLanguage(uiLanguageFromConfigCode(ctx.config.uiLanguage));
+  ctx.uiRuntime->setTimezone(ctx.config.timezoneTz);
+  ctx.uiRuntime->setDisplayBrightnessPercent(ctx.config.displayBrightnessPercent);
+}
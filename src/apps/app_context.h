@@ -6,6 +6,9 @@
 
 class WifiManager;
 class GatewayClient;
+class MessageLog;
+class NodeCommandHandler;
+class LanControlServer;
 class BleManager;
 class UiRuntime;
 class UiNavigator;
@@ -25,8 +28,17 @@ struct AppContext {
   RuntimeConfig config;
   WifiManager *wifi = nullptr;
   GatewayClient *gateway = nullptr;
+  MessageLog *messageLog = nullptr;
+  NodeCommandHandler *nodeCommands = nullptr;
+  LanControlServer *lanControl = nullptr;
   BleManager *ble = nullptr;
   UiRuntime *uiRuntime = nullptr;
   UiNavigator *uiNav = nullptr;
   bool configDirty = false;
 };
+
+// Pushes ctx.config to every service, e.g. after an SD import replaced it.
+void applyRuntimeConfig(AppContext &ctx);
+// UI part only: language, timezone, brightness and the font pack flag. The
+// font pack is opened later (see UiRuntime::setKoreanFontInstalledDeferred).
+void applyUiConfig(AppContext &ctx);
@@ -3,7 +3,6 @@
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <SD.h>
-#include <SPI.h>
 #include <Update.h>
 #include <WiFi.h>
 #include <WiFiClient.h>
@@ -15,9 +14,9 @@
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
 
-#include "../core/board_pins.h"
 #include "../core/runtime_config.h"
-#include "../core/shared_spi_bus.h"
+#include "../core/sd_buffered_writer.h"
+#include "../core/sd_storage.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
@@ -55,8 +54,6 @@ struct FsEntry {
   uint32_t size = 0;
 };
 
-bool gSdMountedForMarket = false;
-
 class OverlayScope {
  public:
   OverlayScope(UiRuntime *ui, const String &title, const String &message, int percent = -1)
@@ -162,44 +159,6 @@ String buildChildPath(const String &dirPath, const String &name) {
   return dirPath + "/" + name;
 }
 
-bool ensureSdMounted(bool forceMount, String *error) {
-  if (gSdMountedForMarket && !forceMount) {
-    return true;
-  }
-
-#if HAL_HAS_DISPLAY
-  pinMode(boardpins::kTftCs, OUTPUT);
-  digitalWrite(boardpins::kTftCs, HIGH);
-#endif
-#if HAL_HAS_CC1101
-  pinMode(boardpins::kCc1101Cs, OUTPUT);
-  digitalWrite(boardpins::kCc1101Cs, HIGH);
-#endif
-#if HAL_HAS_SD_CARD
-  pinMode(boardpins::kSdCs, OUTPUT);
-  digitalWrite(boardpins::kSdCs, HIGH);
-
-  SPIClass *spiBus = sharedspi::bus();
-  const bool mounted = SD.begin(boardpins::kSdCs,
-                                *spiBus,
-                                25000000,
-                                "/sd",
-                                8,
-                                false);
-  gSdMountedForMarket = mounted;
-  if (!mounted && error) {
-    *error = "SD mount failed";
-  }
-  return mounted;
-#else
-  gSdMountedForMarket = false;
-  if (error) {
-    *error = "SD card not available";
-  }
-  return false;
-#endif
-}
-
 bool ensureMarketDirectory(String *error) {
   File node = SD.open(kAppMarketDir, FILE_READ);
   if (node) {
@@ -658,7 +617,7 @@ bool downloadUrlToSdFile(const String &url,
   }
 
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
+  if (!sdstorage::ensureMounted(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
@@ -719,6 +678,18 @@ bool downloadUrlToSdFile(const String &url,
     return false;
   }
 
+  SdBufferedWriter writer;
+  String writeErr;
+  if (!writer.begin(file, &writeErr)) {
+    file.close();
+    http.end();
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = writeErr;
+    }
+    return false;
+  }
+
   WiFiClient *stream = http.getStreamPtr();
   int remain = http.getSize();
   uint8_t buffer[kTransferChunkBytes];
@@ -753,20 +724,19 @@ bool downloadUrlToSdFile(const String &url,
       continue;
     }
 
-    const size_t written = file.write(buffer, static_cast<size_t>(readLen));
-    if (written != static_cast<size_t>(readLen)) {
+    if (!writer.write(buffer, static_cast<size_t>(readLen))) {
       file.close();
       http.end();
       SD.remove(tempPath.c_str());
       if (error) {
-        *error = "SD write failed";
+        *error = writer.lastError();
       }
       return false;
     }
 
-    writtenTotal += static_cast<uint32_t>(written);
+    writtenTotal += static_cast<uint32_t>(readLen);
     if (remain > 0) {
-      remain -= static_cast<int>(written);
+      remain -= readLen;
     }
 
     lastProgressMs = millis();
@@ -778,9 +748,17 @@ bool downloadUrlToSdFile(const String &url,
     }
   }
 
+  const bool flushed = writer.end(&writeErr);
   file.close();
   http.end();
 
+  if (!flushed) {
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = writeErr;
+    }
+    return false;
+  }
   if (writtenTotal == 0) {
     SD.remove(tempPath.c_str());
     if (error) {
@@ -814,7 +792,7 @@ bool installFirmwareFromSd(const String &path,
                            const std::function<void(size_t, size_t)> &progressTick,
                            String *error) {
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
+  if (!sdstorage::ensureMounted(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
@@ -906,7 +884,7 @@ bool backupRunningFirmwareToSd(const char *destPath,
                                const std::function<void(size_t, size_t)> &progressTick,
                                String *error) {
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
+  if (!sdstorage::ensureMounted(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
@@ -943,6 +921,17 @@ bool backupRunningFirmwareToSd(const char *destPath,
     return false;
   }
 
+  SdBufferedWriter writer;
+  String writeErr;
+  if (!writer.begin(out, &writeErr)) {
+    out.close();
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = writeErr;
+    }
+    return false;
+  }
+
   uint8_t buffer[kTransferChunkBytes];
   uint32_t offset = 0;
   if (progressTick) {
@@ -964,12 +953,11 @@ bool backupRunningFirmwareToSd(const char *destPath,
       return false;
     }
 
-    const size_t written = out.write(buffer, chunk);
-    if (written != chunk) {
+    if (!writer.write(buffer, chunk)) {
       out.close();
       SD.remove(tempPath.c_str());
       if (error) {
-        *error = "Backup SD write failed";
+        *error = "Backup " + writer.lastError();
       }
       return false;
     }
@@ -983,7 +971,15 @@ bool backupRunningFirmwareToSd(const char *destPath,
     }
   }
 
+  const bool flushed = writer.end(&writeErr);
   out.close();
+  if (!flushed) {
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = "Backup " + writeErr;
+    }
+    return false;
+  }
 
   if (SD.exists(destPath)) {
     SD.remove(destPath);
@@ -1074,7 +1070,7 @@ bool selectBinFileFromSd(AppContext &ctx,
                          String &selectedPathOut,
                          const std::function<void()> &backgroundTick) {
   String err;
-  if (!ensureSdMounted(false, &err)) {
+  if (!sdstorage::ensureMounted(&err)) {
     ctx.uiRuntime->showToast("SD Card",
                       err.isEmpty() ? String("Mount failed") : err,
                       1700,
@@ -1190,7 +1186,7 @@ void showStatus(AppContext &ctx,
   uint32_t backupSize = 0;
 
   String sdErr;
-  if (ensureSdMounted(false, &sdErr)) {
+  if (sdstorage::ensureMounted(&sdErr)) {
     statSdFile(kLatestPackagePath, latestSize);
     statSdFile(kBackupPackagePath, backupSize);
   }
@@ -1246,7 +1242,7 @@ void runAppMarketApp(AppContext &ctx,
 
   while (true) {
     uint32_t latestSize = 0;
-    const bool latestExists = ensureSdMounted(false, nullptr) &&
+    const bool latestExists = sdstorage::ensureMounted() &&
                               statSdFile(kLatestPackagePath, latestSize);
 
     std::vector<String> menu;
@@ -1489,6 +1485,7 @@ void runAppMarketApp(AppContext &ctx,
       }
 
       ctx.uiRuntime->showToast("APPMarket", "Install complete, rebooting", 1200, backgroundTick);
+      flushConfig();
       delay(300);
       ESP.restart();
       return;
@@ -1560,6 +1557,7 @@ void runAppMarketApp(AppContext &ctx,
       }
 
       ctx.uiRuntime->showToast("APPMarket", "Reinstall complete, rebooting", 1200, backgroundTick);
+      flushConfig();
       delay(300);
       ESP.restart();
       return;
@@ -1601,6 +1599,7 @@ void runAppMarketApp(AppContext &ctx,
       }
 
       ctx.uiRuntime->showToast("APPMarket", "Install complete, rebooting", 1200, backgroundTick);
+      flushConfig();
       delay(300);
       ESP.restart();
       return;
@@ -1608,7 +1607,7 @@ void runAppMarketApp(AppContext &ctx,
 
     if (choice == 10) {
       String err;
-      if (!ensureSdMounted(false, &err)) {
+      if (!sdstorage::ensureMounted(&err)) {
         ctx.uiRuntime->showToast("APPMarket", err, 1700, backgroundTick);
         continue;
       }
@@ -1624,7 +1623,7 @@ void runAppMarketApp(AppContext &ctx,
 
     if (choice == 11) {
       String err;
-      if (!ensureSdMounted(false, &err)) {
+      if (!sdstorage::ensureMounted(&err)) {
         ctx.uiRuntime->showToast("APPMarket", err, 1700, backgroundTick);
         continue;
       }
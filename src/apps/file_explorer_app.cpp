@@ -4,14 +4,13 @@
 #include <Audio.h>
 #endif
 #include <SD.h>
-#include <SPI.h>
 #include <lvgl.h>
 
 #include <algorithm>
 #include <vector>
 
-#include "../core/board_pins.h"
-#include "../core/shared_spi_bus.h"
+#include "../core/sd_benchmark.h"
+#include "../core/sd_storage.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
@@ -23,8 +22,6 @@ struct FsEntry {
   uint64_t size = 0;
 };
 
-bool gSdMounted = false;
-
 String formatBytes(uint64_t bytes) {
   static const char *kUnits[] = {"B", "KB", "MB", "GB"};
 
@@ -104,45 +101,6 @@ String cardTypeName(uint8_t cardType) {
   }
 }
 
-bool ensureSdMounted(bool forceMount, String *error) {
-  if (gSdMounted && !forceMount) {
-    return true;
-  }
-
-#if HAL_HAS_DISPLAY
-  pinMode(boardpins::kTftCs, OUTPUT);
-  digitalWrite(boardpins::kTftCs, HIGH);
-#endif
-#if HAL_HAS_CC1101
-  pinMode(boardpins::kCc1101Cs, OUTPUT);
-  digitalWrite(boardpins::kCc1101Cs, HIGH);
-#endif
-#if HAL_HAS_SD_CARD
-  pinMode(boardpins::kSdCs, OUTPUT);
-  digitalWrite(boardpins::kSdCs, HIGH);
-
-  SPIClass *spiBus = sharedspi::bus();
-  const bool mounted = SD.begin(boardpins::kSdCs,
-                                *spiBus,
-                                25000000,
-                                "/sd",
-                                8,
-                                false);
-
-  gSdMounted = mounted;
-  if (!mounted && error) {
-    *error = "SD mount failed";
-  }
-  return mounted;
-#else
-  gSdMounted = false;
-  if (error) {
-    *error = "SD card not available";
-  }
-  return false;
-#endif
-}
-
 bool listDirectory(const String &path,
                    std::vector<FsEntry> &outEntries,
                    String *error) {
@@ -201,7 +159,7 @@ bool listDirectory(const String &path,
 void showSdInfo(AppContext &ctx,
                 const std::function<void()> &backgroundTick) {
   String err;
-  if (!ensureSdMounted(false, &err)) {
+  if (!sdstorage::ensureMounted(&err)) {
     ctx.uiRuntime->showToast("SD Card",
                       err.isEmpty() ? String("Mount failed") : err,
                       1800,
@@ -223,9 +181,89 @@ void showSdInfo(AppContext &ctx,
   lines.push_back("FS Free: " + formatBytes(freeBytes));
   lines.push_back("Mount Point: /sd");
 
+  const sdstorage::Info sd = sdstorage::info();
+  lines.push_back("SPI Clock: " + String(sd.spiHz / 1000000.0f, 1) + " MHz" +
+                  (sd.clockProbed ? " (probed)" : ""));
+  lines.push_back("Mount Time: " + String(sd.lastMountMs) + " ms");
+
   ctx.uiRuntime->showInfo("SD Card Info", lines, backgroundTick, "OK/BACK Exit");
 }
 
+String formatClockMhz(uint32_t hz) {
+  return String(hz / 1000000.0f, 1) + " MHz";
+}
+
+void showSdBenchmarkReport(AppContext &ctx,
+                           const sdbench::Report &report,
+                           const std::function<void()> &backgroundTick) {
+  std::vector<String> lines;
+  lines.push_back("File: " + formatBytes(report.fileBytes) + "  Time: " +
+                  String(report.durationMs / 1000UL) + " s");
+  for (uint8_t i = 0; i < report.clockCount; ++i) {
+    const sdbench::ClockResult &c = report.clocks[i];
+    lines.push_back("-- " + formatClockMhz(c.spiHz) + (c.verifyOk ? "" : "  VERIFY FAILED"));
+    for (size_t k = 0; k < sdbench::kChunkCount; ++k) {
+      lines.push_back("Seq " + formatBytes(sdbench::kChunkSizes[k]) + ": W " +
+                      String(c.seqWriteKBps[k]) + " / R " + String(c.seqReadKBps[k]) +
+                      " KB/s");
+    }
+    lines.push_back("4K random: R " + String(c.randReadIops) + " / W " +
+                    String(c.randWriteIops) + " IOPS");
+    lines.push_back("Files: create " + String(c.createPerSec) + " / delete " +
+                    String(c.deletePerSec) + " per s");
+  }
+  lines.push_back(String("Saved: ") + sdbench::kResultsPath);
+
+  ctx.uiRuntime->showInfo("SD Benchmark", lines, backgroundTick, "OK/BACK Exit");
+}
+
+void runSdBenchmark(AppContext &ctx,
+                    const std::function<void()> &backgroundTick) {
+  if (!ctx.uiRuntime->confirm("SD Benchmark",
+                              "Writes a 512 KB test file in /sdbench (about a minute)",
+                              backgroundTick,
+                              "Start",
+                              "Cancel")) {
+    return;
+  }
+
+  String err;
+  if (!sdbench::start(512, &err)) {
+    ctx.uiRuntime->showToast("SD Benchmark",
+                             err.isEmpty() ? String("Start failed") : err,
+                             1800,
+                             backgroundTick);
+    return;
+  }
+
+  unsigned long lastOverlayMs = 0;
+  ctx.uiRuntime->resetInputState();
+  while (sdbench::step(40)) {
+    const unsigned long now = millis();
+    if (lastOverlayMs == 0 || now - lastOverlayMs >= 150UL) {
+      lastOverlayMs = now;
+      ctx.uiRuntime->showProgressOverlay("SD Benchmark",
+                                         sdbench::phaseLabel() + "  (BACK cancels)",
+                                         sdbench::progressPercent());
+    }
+    if (backgroundTick) {
+      backgroundTick();
+    }
+    const UiEvent ev = ctx.uiRuntime->pollInput();
+    if (ev.back) {
+      sdbench::cancel();
+    }
+  }
+  ctx.uiRuntime->hideProgressOverlay();
+  ctx.uiRuntime->resetInputState();
+
+  if (!sdbench::report().complete) {
+    ctx.uiRuntime->showToast("SD Benchmark", sdbench::lastError(), 1800, backgroundTick);
+    return;
+  }
+  showSdBenchmarkReport(ctx, sdbench::report(), backgroundTick);
+}
+
 String sanitizeTextLine(const String &input) {
   String out;
   out.reserve(input.length());
@@ -660,7 +698,7 @@ bool deletePathRecursive(const String &path,
 bool quickFormatSd(const std::function<void()> &backgroundTick,
                    String *error) {
   String mountErr;
-  if (!ensureSdMounted(false, &mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     if (error) {
       *error = mountErr;
     }
@@ -689,7 +727,7 @@ bool quickFormatSd(const std::function<void()> &backgroundTick,
 void formatSdCard(AppContext &ctx,
                   const std::function<void()> &backgroundTick) {
   String err;
-  if (!ensureSdMounted(false, &err)) {
+  if (!sdstorage::ensureMounted(&err)) {
     ctx.uiRuntime->showToast("SD Card",
                       err.isEmpty() ? String("Mount failed") : err,
                       1800,
@@ -727,7 +765,7 @@ void formatSdCard(AppContext &ctx,
 void browseSd(AppContext &ctx,
               const std::function<void()> &backgroundTick) {
   String err;
-  if (!ensureSdMounted(false, &err)) {
+  if (!sdstorage::ensureMounted(&err)) {
     ctx.uiRuntime->showToast("SD Card",
                       err.isEmpty() ? String("Mount failed") : err,
                       1800,
@@ -817,19 +855,20 @@ void runFileExplorerApp(AppContext &ctx,
   while (true) {
     std::vector<String> menu;
     menu.push_back("SD Card Info");
+    menu.push_back("SD Benchmark");
     menu.push_back("Browse SD");
     menu.push_back("Format SD Card");
     menu.push_back("Remount SD");
     menu.push_back("Back");
 
-    const String subtitle = gSdMounted ? "SD: Mounted" : "SD: Not mounted";
+    const String subtitle = sdstorage::isMounted() ? "SD: Mounted" : "SD: Not mounted";
     const int choice = ctx.uiRuntime->menuLoop("File Explorer",
                                         menu,
                                         selected,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         subtitle);
-    if (choice < 0 || choice == 4) {
+    if (choice < 0 || choice == 5) {
       return;
     }
 
@@ -838,12 +877,14 @@ void runFileExplorerApp(AppContext &ctx,
     if (choice == 0) {
       showSdInfo(ctx, backgroundTick);
     } else if (choice == 1) {
-      browseSd(ctx, backgroundTick);
+      runSdBenchmark(ctx, backgroundTick);
     } else if (choice == 2) {
-      formatSdCard(ctx, backgroundTick);
+      browseSd(ctx, backgroundTick);
     } else if (choice == 3) {
+      formatSdCard(ctx, backgroundTick);
+    } else if (choice == 4) {
       String err;
-      if (ensureSdMounted(true, &err)) {
+      if (sdstorage::remount(&err)) {
         ctx.uiRuntime->showToast("SD Card", "Mounted", 1200, backgroundTick);
       } else {
         ctx.uiRuntime->showToast("SD Card",
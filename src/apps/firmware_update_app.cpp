@@ -3,7 +3,6 @@
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <SD.h>
-#include <SPI.h>
 #include <Update.h>
 #include <WiFi.h>
 #include <WiFiClient.h>
@@ -12,8 +11,9 @@
 #include <algorithm>
 #include <vector>
 
-#include "../core/board_pins.h"
-#include "../core/shared_spi_bus.h"
+#include "../core/runtime_config.h"
+#include "../core/sd_buffered_writer.h"
+#include "../core/sd_storage.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
@@ -31,8 +31,6 @@ struct ReleaseInfo {
   uint32_t size = 0;
 };
 
-bool gSdMountedForFirmware = false;
-
 class OverlayScope {
  public:
   OverlayScope(UiRuntime *ui, const String &title, const String &message, int percent = -1)
@@ -109,44 +107,6 @@ bool hasBinExtension(const String &pathOrNameRaw) {
   return pathOrName.endsWith(".bin");
 }
 
-bool ensureSdMounted(bool forceMount, String *error) {
-  if (gSdMountedForFirmware && !forceMount) {
-    return true;
-  }
-
-#if HAL_HAS_DISPLAY
-  pinMode(boardpins::kTftCs, OUTPUT);
-  digitalWrite(boardpins::kTftCs, HIGH);
-#endif
-#if HAL_HAS_CC1101
-  pinMode(boardpins::kCc1101Cs, OUTPUT);
-  digitalWrite(boardpins::kCc1101Cs, HIGH);
-#endif
-#if HAL_HAS_SD_CARD
-  pinMode(boardpins::kSdCs, OUTPUT);
-  digitalWrite(boardpins::kSdCs, HIGH);
-
-  SPIClass *spiBus = sharedspi::bus();
-  const bool mounted = SD.begin(boardpins::kSdCs,
-                                *spiBus,
-                                25000000,
-                                "/sd",
-                                8,
-                                false);
-  gSdMountedForFirmware = mounted;
-  if (!mounted && error) {
-    *error = "SD mount failed";
-  }
-  return mounted;
-#else
-  gSdMountedForFirmware = false;
-  if (error) {
-    *error = "SD card not available";
-  }
-  return false;
-#endif
-}
-
 bool ensureFirmwareDirectory(String *error) {
   File node = SD.open(kFirmwareDir, FILE_READ);
   if (node) {
@@ -437,7 +397,7 @@ bool downloadUrlToSdFile(const String &url,
   }
 
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
+  if (!sdstorage::ensureMounted(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
@@ -498,6 +458,18 @@ bool downloadUrlToSdFile(const String &url,
     return false;
   }
 
+  SdBufferedWriter writer;
+  String writeErr;
+  if (!writer.begin(file, &writeErr)) {
+    file.close();
+    http.end();
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = writeErr;
+    }
+    return false;
+  }
+
   WiFiClient *stream = http.getStreamPtr();
   int remain = http.getSize();
   uint8_t buffer[kTransferChunkBytes];
@@ -532,20 +504,19 @@ bool downloadUrlToSdFile(const String &url,
       continue;
     }
 
-    const size_t written = file.write(buffer, static_cast<size_t>(readLen));
-    if (written != static_cast<size_t>(readLen)) {
+    if (!writer.write(buffer, static_cast<size_t>(readLen))) {
       file.close();
       http.end();
       SD.remove(tempPath.c_str());
       if (error) {
-        *error = "SD write failed";
+        *error = writer.lastError();
       }
       return false;
     }
 
-    writtenTotal += static_cast<uint32_t>(written);
+    writtenTotal += static_cast<uint32_t>(readLen);
     if (remain > 0) {
-      remain -= static_cast<int>(written);
+      remain -= readLen;
     }
 
     lastProgressMs = millis();
@@ -557,9 +528,17 @@ bool downloadUrlToSdFile(const String &url,
     }
   }
 
+  const bool flushed = writer.end(&writeErr);
   file.close();
   http.end();
 
+  if (!flushed) {
+    SD.remove(tempPath.c_str());
+    if (error) {
+      *error = writeErr;
+    }
+    return false;
+  }
   if (writtenTotal == 0) {
     SD.remove(tempPath.c_str());
     if (error) {
@@ -593,7 +572,7 @@ bool installFirmwareFromSd(const String &path,
                            const std::function<void(size_t, size_t)> &progressTick,
                            String *error) {
   String sdErr;
-  if (!ensureSdMounted(false, &sdErr)) {
+  if (!sdstorage::ensureMounted(&sdErr)) {
     if (error) {
       *error = sdErr;
     }
@@ -705,7 +684,7 @@ void showStatus(AppContext &ctx,
   uint32_t latestSize = 0;
 
   String sdErr;
-  if (ensureSdMounted(false, &sdErr)) {
+  if (sdstorage::ensureMounted(&sdErr)) {
     statSdFile(kLatestFirmwarePath, latestSize);
   }
 
@@ -783,7 +762,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
 
   while (true) {
     uint32_t latestSize = 0;
-    const bool latestExists = ensureSdMounted(false, nullptr) &&
+    const bool latestExists = sdstorage::ensureMounted() &&
                               statSdFile(kLatestFirmwarePath, latestSize);
 
     std::vector<String> menu;
@@ -871,6 +850,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
       }
 
       ctx.uiRuntime->showToast("Firmware", "Install complete, rebooting", 1200, backgroundTick);
+      flushConfig();
       delay(300);
       ESP.restart();
       return;
@@ -913,6 +893,7 @@ void runFirmwareUpdateApp(AppContext &ctx,
       }
 
       ctx.uiRuntime->showToast("Firmware", "Update complete, rebooting", 1200, backgroundTick);
+      flushConfig();
       delay(300);
       ESP.restart();
       return;
@@ -2,7 +2,6 @@
 
 #include <SD.h>
 #include <SHA256.h>
-#include <SPI.h>
 #include <WiFi.h>
 #include <limits.h>
 #include <time.h>
@@ -17,10 +16,12 @@ extern "C" {
 #include "../core/cc1101_radio.h"
 #include "../core/audio_recorder.h"
 #include "../core/ble_manager.h"
-#include "../core/board_pins.h"
 #include "../core/gateway_client.h"
+#include "../core/lan_control_server.h"
+#include "../core/message_log.h"
+#include "../core/message_store.h"
 #include "../core/runtime_config.h"
-#include "../core/shared_spi_bus.h"
+#include "../core/sd_storage.h"
 #include "../core/wifi_manager.h"
 #include "../ui/ui_runtime.h"
 #include "user_config.h"
@@ -55,20 +56,17 @@ constexpr uint32_t kChatSendAttachmentMaxBytes = 98304;
 constexpr uint8_t kChunkSendMaxRetries = 3;
 constexpr unsigned long kChunkRetryWaitMs = 2500UL;
 constexpr size_t kOutboxCapacity = 40;
-constexpr size_t kOutboxMaxIdLen = 96;
-constexpr size_t kOutboxMaxMetaLen = 64;
-constexpr size_t kOutboxMaxTextLen = 768;
-constexpr size_t kOutboxMaxFileNameLen = 128;
-
-GatewayInboxMessage gOutbox[kOutboxCapacity];
-size_t gOutboxStart = 0;
-size_t gOutboxCount = 0;
+constexpr size_t kHistoryReplayCount = USER_MESSENGER_HISTORY_REPLAY_COUNT;
+constexpr size_t kHistoryPageSize = USER_MESSENGER_HISTORY_PAGE_SIZE;
+
+MessageStore gOutbox(kOutboxCapacity, kOutboxCapacity);
+bool gHistoryReplayed = false;
 String gMessengerSessionKey;
 String gSubscribedSessionKey;
 unsigned long gSubscribedConnectOkMs = 0;
 
 struct ChatEntry {
-  GatewayInboxMessage message;
+  MessageView message;
   bool outgoing = false;
 };
 
@@ -266,63 +264,15 @@ String activeMessengerSessionKey() {
   return gMessengerSessionKey;
 }
 
-void clampString(String &value, size_t maxLen) {
-  if (maxLen == 0) {
-    value = "";
-    return;
-  }
-  if (value.length() <= maxLen) {
-    return;
-  }
-  if (maxLen <= 3) {
-    value = value.substring(0, maxLen);
-    return;
-  }
-  value = value.substring(0, maxLen - 3) + "...";
-}
-
-void clampOutboxMessage(GatewayInboxMessage &message) {
-  clampString(message.id, kOutboxMaxIdLen);
-  clampString(message.event, kOutboxMaxMetaLen);
-  clampString(message.type, kOutboxMaxMetaLen);
-  clampString(message.from, kOutboxMaxMetaLen);
-  clampString(message.to, kOutboxMaxMetaLen);
-  clampString(message.text, kOutboxMaxTextLen);
-  clampString(message.fileName, kOutboxMaxFileNameLen);
-  clampString(message.contentType, kOutboxMaxMetaLen);
-}
-
-void pushOutbox(const GatewayInboxMessage &message) {
-  if (kOutboxCapacity == 0) {
-    return;
-  }
-
-  GatewayInboxMessage bounded = message;
-  clampOutboxMessage(bounded);
-
-  size_t pos = 0;
-  if (gOutboxCount < kOutboxCapacity) {
-    pos = (gOutboxStart + gOutboxCount) % kOutboxCapacity;
-    ++gOutboxCount;
-  } else {
-    pos = gOutboxStart;
-    gOutboxStart = (gOutboxStart + 1) % kOutboxCapacity;
-  }
-  gOutbox[pos] = bounded;
-}
-
-bool outboxMessage(size_t index, GatewayInboxMessage &out) {
-  if (index >= gOutboxCount) {
-    return false;
+void pushOutbox(AppContext &ctx, const GatewayInboxMessage &message) {
+  MessageView stored;
+  if (gOutbox.append(message, &stored) && ctx.messageLog) {
+    ctx.messageLog->append(stored, true);
   }
-  const size_t pos = (gOutboxStart + index) % kOutboxCapacity;
-  out = gOutbox[pos];
-  return true;
 }
 
 void clearOutbox() {
-  gOutboxStart = 0;
-  gOutboxCount = 0;
+  gOutbox.clear();
 }
 
 void clearMessengerMessages(AppContext &ctx) {
@@ -579,38 +529,6 @@ bool encodeBase64(const uint8_t *data,
   return true;
 }
 
-bool ensureSdMountedForVoice(String *error = nullptr) {
-#if HAL_HAS_DISPLAY
-  pinMode(boardpins::kTftCs, OUTPUT);
-  digitalWrite(boardpins::kTftCs, HIGH);
-#endif
-#if HAL_HAS_CC1101
-  pinMode(boardpins::kCc1101Cs, OUTPUT);
-  digitalWrite(boardpins::kCc1101Cs, HIGH);
-#endif
-#if HAL_HAS_SD_CARD
-  pinMode(boardpins::kSdCs, OUTPUT);
-  digitalWrite(boardpins::kSdCs, HIGH);
-
-  SPIClass *spiBus = sharedspi::bus();
-  const bool mounted = SD.begin(boardpins::kSdCs,
-                                *spiBus,
-                                25000000,
-                                "/sd",
-                                8,
-                                false);
-  if (!mounted && error) {
-    *error = "SD mount failed";
-  }
-  return mounted;
-#else
-  if (error) {
-    *error = "SD card not available on this board";
-  }
-  return false;
-#endif
-}
-
 bool listSdDirectory(const String &path,
                      std::vector<SdSelectEntry> &outEntries,
                      String *error = nullptr) {
@@ -872,7 +790,7 @@ bool sendTextPayload(AppContext &ctx,
   sent.to = target;
   sent.text = text;
   sent.tsMs = ts;
-  pushOutbox(sent);
+  pushOutbox(ctx, sent);
 
   ctx.uiRuntime->showToast("Messenger", "Text sent", 1100, backgroundTick);
   return true;
@@ -1802,7 +1720,7 @@ bool sendAttachmentMessage(AppContext &ctx,
   sent.contentType = sendResult.mimeType.isEmpty() ? mimeType : sendResult.mimeType;
   sent.voiceBytes = sendResult.totalBytes > 0 ? sendResult.totalBytes : totalBytes;
   sent.tsMs = currentUnixMs();
-  pushOutbox(sent);
+  pushOutbox(ctx, sent);
 
   ctx.uiRuntime->showToast(uiTitle, attachmentRouteToast(sendResult.route), 1300, backgroundTick);
   return true;
@@ -1838,7 +1756,7 @@ void sendVoiceMessage(AppContext &ctx,
   }
 
   String mountErr;
-  if (!ensureSdMountedForVoice(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     ctx.uiRuntime->showToast("Voice",
                       mountErr.isEmpty() ? String("SD mount failed") : mountErr,
                       1600,
@@ -1866,7 +1784,7 @@ void recordVoiceFromMic(AppContext &ctx,
   }
 
   String mountErr;
-  if (!ensureSdMountedForVoice(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     ctx.uiRuntime->showToast("Voice",
                       mountErr.isEmpty() ? String("SD mount failed") : mountErr,
                       1600,
@@ -1941,7 +1859,7 @@ bool recordVoiceFromBle(AppContext &ctx,
   }
 
   String mountErr;
-  if (!ensureSdMountedForVoice(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     ctx.uiRuntime->showToast("Voice",
                       mountErr.isEmpty() ? String("SD mount failed") : mountErr,
                       1600,
@@ -2003,7 +1921,7 @@ void sendFileMessage(AppContext &ctx,
   }
 
   String mountErr;
-  if (!ensureSdMountedForVoice(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     ctx.uiRuntime->showToast("File",
                       mountErr.isEmpty() ? String("SD mount failed") : mountErr,
                       1600,
@@ -2025,14 +1943,14 @@ void sendFileMessage(AppContext &ctx,
 }
 
 String makeChatPreview(const ChatEntry &entry) {
-  const GatewayInboxMessage &message = entry.message;
+  const MessageView &message = entry.message;
   String body;
-  const bool isVoice = message.type.startsWith("voice");
-  const bool isFile = message.type.startsWith("file");
+  const bool isVoice = strncmp(message.type, "voice", 5) == 0;
+  const bool isFile = strncmp(message.type, "file", 4) == 0;
 
   if (isVoice) {
     body = "[Voice] ";
-    if (!message.fileName.isEmpty()) {
+    if (message.fileName[0] != '\0') {
       body += message.fileName;
     } else if (message.voiceBytes > 0) {
       body += String(message.voiceBytes) + " bytes";
@@ -2041,16 +1959,16 @@ String makeChatPreview(const ChatEntry &entry) {
     }
   } else if (isFile) {
     body = "[File] ";
-    if (!message.fileName.isEmpty()) {
+    if (message.fileName[0] != '\0') {
       body += message.fileName;
     } else if (message.voiceBytes > 0) {
       body += String(message.voiceBytes) + " bytes";
     } else {
       body += "attachment";
     }
-  } else if (!message.text.isEmpty()) {
+  } else if (message.text[0] != '\0') {
     body = message.text;
-  } else if (!message.fileName.isEmpty()) {
+  } else if (message.fileName[0] != '\0') {
     body = message.fileName;
   } else {
     body = "(no text)";
@@ -2061,32 +1979,25 @@ String makeChatPreview(const ChatEntry &entry) {
   return label;
 }
 
+// Entries are views into the inbox/outbox stores; use them before the next
+// backgroundTick, which may modify either store.
 std::vector<ChatEntry> collectChatEntries(AppContext &ctx) {
   std::vector<ChatEntry> entries;
-  const size_t inboxCount = ctx.gateway->inboxCount();
-  entries.reserve(inboxCount + gOutboxCount);
+  entries.reserve(ctx.gateway->inboxCount() + gOutbox.count());
 
-  for (size_t i = 0; i < inboxCount; ++i) {
-    GatewayInboxMessage message;
-    if (!ctx.gateway->inboxMessage(i, message)) {
-      continue;
-    }
+  ctx.gateway->inbox().forEach([&](const MessageView &message) {
     ChatEntry entry;
     entry.message = message;
     entry.outgoing = false;
     entries.push_back(entry);
-  }
+  });
 
-  for (size_t i = 0; i < gOutboxCount; ++i) {
-    GatewayInboxMessage message;
-    if (!outboxMessage(i, message)) {
-      continue;
-    }
+  gOutbox.forEach([&](const MessageView &message) {
     ChatEntry entry;
     entry.message = message;
     entry.outgoing = true;
     entries.push_back(entry);
-  }
+  });
 
   std::sort(entries.begin(),
             entries.end(),
@@ -2097,7 +2008,7 @@ std::vector<ChatEntry> collectChatEntries(AppContext &ctx) {
                 if (a.outgoing != b.outgoing) {
                   return a.outgoing && !b.outgoing;
                 }
-                return a.message.id < b.message.id;
+                return strcmp(a.message.id, b.message.id) < 0;
               }
               if (ta == 0) {
                 return false;
@@ -2125,9 +2036,140 @@ std::vector<String> buildMessengerPreviewLines(const std::vector<ChatEntry> &ent
   return lines;
 }
 
+MessageView viewOf(const GatewayInboxMessage &message) {
+  MessageView view;
+  view.id = message.id.c_str();
+  view.event = message.event.c_str();
+  view.type = message.type.c_str();
+  view.from = message.from.c_str();
+  view.to = message.to.c_str();
+  view.text = message.text.c_str();
+  view.fileName = message.fileName.c_str();
+  view.contentType = message.contentType.c_str();
+  view.voiceBytes = message.voiceBytes;
+  view.tsMs = message.tsMs;
+  return view;
+}
+
+// Seeds the RAM inbox/outbox with the newest log entries once per boot.
+void replayMessengerHistory(AppContext &ctx) {
+  if (gHistoryReplayed || !ctx.messageLog) {
+    return;
+  }
+  gHistoryReplayed = true;
+
+  ctx.messageLog->setSession(activeMessengerSessionKey());
+  if (ctx.gateway->inboxCount() > 0 || gOutbox.count() > 0) {
+    return;
+  }
+
+  std::vector<MessageLogEntry> recent;
+  ctx.messageLog->readRecent(kHistoryReplayCount, recent);
+  for (size_t i = 0; i < recent.size(); ++i) {
+    if (recent[i].outgoing) {
+      gOutbox.append(recent[i].message);
+    } else {
+      ctx.gateway->restoreInboxMessage(recent[i].message);
+    }
+  }
+}
+
+void runHistoryMenu(AppContext &ctx,
+                    const std::function<void()> &backgroundTick) {
+  if (!ctx.messageLog) {
+    return;
+  }
+  ctx.messageLog->setSession(activeMessengerSessionKey());
+
+  const size_t total = ctx.messageLog->count();
+  if (total == 0) {
+    String err = ctx.messageLog->lastError();
+    ctx.uiRuntime->showToast("History",
+                             err.isEmpty() ? String("No saved messages") : err,
+                             1400,
+                             backgroundTick);
+    return;
+  }
+
+  // Only one page of entries is held in RAM; paging re-reads from SD.
+  size_t first = total > kHistoryPageSize ? (total - kHistoryPageSize) : 0;
+  int selected = 0;
+  std::vector<MessageLogEntry> page;
+
+  while (true) {
+    String readErr;
+    ctx.messageLog->readPage(first, kHistoryPageSize, page, &readErr);
+    if (page.empty()) {
+      ctx.uiRuntime->showToast("History",
+                               readErr.isEmpty() ? String("History read failed") : readErr,
+                               1400,
+                               backgroundTick);
+      return;
+    }
+
+    const bool hasOlder = first > 0;
+    const bool hasNewer = first + page.size() < total;
+
+    std::vector<String> menu;
+    if (hasOlder) {
+      menu.push_back("< Older");
+    }
+    for (size_t i = 0; i < page.size(); ++i) {
+      ChatEntry entry;
+      entry.message = viewOf(page[i].message);
+      entry.outgoing = page[i].outgoing;
+      menu.push_back(makeChatPreview(entry));
+    }
+    if (hasNewer) {
+      menu.push_back("Newer >");
+    }
+
+    String subtitle = String(static_cast<unsigned long>(first + 1)) + "-" +
+                      String(static_cast<unsigned long>(first + page.size())) + " / " +
+                      String(static_cast<unsigned long>(total));
+    const int choice = ctx.uiRuntime->menuLoop("OpenClaw / History",
+                                               menu,
+                                               selected,
+                                               backgroundTick,
+                                               "OK Select  BACK Exit",
+                                               subtitle);
+    if (choice < 0) {
+      return;
+    }
+
+    const int entryBase = hasOlder ? 1 : 0;
+    if (hasOlder && choice == 0) {
+      first = first > kHistoryPageSize ? (first - kHistoryPageSize) : 0;
+      selected = static_cast<int>(menu.size()) - 1;
+      continue;
+    }
+    if (hasNewer && choice == static_cast<int>(menu.size()) - 1) {
+      first += page.size();
+      selected = 0;
+      continue;
+    }
+
+    selected = choice;
+    const MessageLogEntry &picked = page[static_cast<size_t>(choice - entryBase)];
+    std::vector<String> lines;
+    lines.push_back(String(picked.outgoing ? "To: " : "From: ") +
+                    (picked.outgoing ? picked.message.to : picked.message.from));
+    lines.push_back("Type: " + picked.message.type);
+    lines.push_back("Time: " + String(static_cast<unsigned long long>(picked.message.tsMs)));
+    if (!picked.message.fileName.isEmpty()) {
+      lines.push_back("File: " + picked.message.fileName);
+    }
+    if (!picked.message.text.isEmpty()) {
+      lines.push_back(picked.message.text);
+    }
+    ctx.uiRuntime->showInfo("History", lines, backgroundTick, "OK/BACK Exit");
+  }
+}
+
 void runMessagingMenu(AppContext &ctx,
                       const std::function<void()> &backgroundTick) {
   int selected = 0;
+  replayMessengerHistory(ctx);
 
   while (true) {
     ensureMessengerSessionSubscription(ctx, backgroundTick, false);
@@ -2182,8 +2224,11 @@ void runGatewayMenu(AppContext &ctx,
   while (true) {
     std::vector<String> menu;
     menu.push_back("Edit URL");
+    menu.push_back("Fallback URLs");
     menu.push_back("Auth Mode");
     menu.push_back("Edit Credential");
+    menu.push_back(String("LAN Control: ") + (ctx.config.lanControlEnabled ? "On" : "Off"));
+    menu.push_back("LAN Token");
     menu.push_back("Clear Gateway");
     menu.push_back("Back");
 
@@ -2196,7 +2241,7 @@ void runGatewayMenu(AppContext &ctx,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         subtitle);
-    if (choice < 0 || choice == 4) {
+    if (choice < 0 || choice == 7) {
       return;
     }
     selected = choice;
@@ -2211,6 +2256,15 @@ void runGatewayMenu(AppContext &ctx,
     }
 
     if (choice == 1) {
+      String urls = ctx.config.gatewayFallbackUrls;
+      if (ctx.uiRuntime->textInput("Fallback URLs (comma)", urls, false, backgroundTick)) {
+        ctx.config.gatewayFallbackUrls = urls;
+        markDirty(ctx);
+      }
+      continue;
+    }
+
+    if (choice == 2) {
       std::vector<String> authItems;
       authItems.push_back("Token");
       authItems.push_back("Password");
@@ -2231,7 +2285,7 @@ void runGatewayMenu(AppContext &ctx,
       continue;
     }
 
-    if (choice == 2) {
+    if (choice == 3) {
       if (ctx.config.gatewayAuthMode == GatewayAuthMode::Password) {
         String password = ctx.config.gatewayPassword;
         if (ctx.uiRuntime->textInput("Gateway Password", password, true, backgroundTick)) {
@@ -2248,8 +2302,24 @@ void runGatewayMenu(AppContext &ctx,
       continue;
     }
 
-    if (choice == 3) {
+    if (choice == 4) {
+      ctx.config.lanControlEnabled = !ctx.config.lanControlEnabled;
+      markDirty(ctx);
+      continue;
+    }
+
+    if (choice == 5) {
+      String token = ctx.config.lanControlToken;
+      if (ctx.uiRuntime->textInput("LAN Token (8+)", token, true, backgroundTick)) {
+        ctx.config.lanControlToken = token;
+        markDirty(ctx);
+      }
+      continue;
+    }
+
+    if (choice == 6) {
       ctx.config.gatewayUrl = "";
+      ctx.config.gatewayFallbackUrls = "";
       ctx.config.gatewayToken = "";
       ctx.config.gatewayPassword = "";
       ctx.config.gatewayDeviceToken = "";
@@ -2281,6 +2351,9 @@ void applyRuntimeConfig(AppContext &ctx,
   ctx.wifi->configure(ctx.config);
   ctx.gateway->configure(ctx.config);
   ctx.ble->configure(ctx.config);
+  if (ctx.lanControl) {
+    ctx.lanControl->configure(ctx.config);
+  }
 
   if (!ctx.config.gatewayUrl.isEmpty() && hasGatewayCredentials(ctx.config)) {
     ctx.gateway->reconnectNow();
@@ -2322,15 +2395,67 @@ std::vector<String> buildStatusLines(AppContext &ctx) {
     lines.push_back("Wi-Fi Error: " + ctx.wifi->lastConnectionError());
   }
   lines.push_back("Gateway URL: " + (ctx.config.gatewayUrl.isEmpty() ? String("(empty)") : ctx.config.gatewayUrl));
+  const GatewayEndpointPool &endpoints = ctx.gateway->endpoints();
+  if (endpoints.count() > 1) {
+    for (size_t i = 0; i < endpoints.count(); ++i) {
+      const GatewayEndpointHealth &e = endpoints.at(i);
+      String line = i == ctx.gateway->activeEndpoint() ? "* " : "  ";
+      line += e.url + " rtt " + (e.rttMs > 0 ? String(e.rttMs) + "ms" : String("-")) +
+              " conn " + (e.connectMs > 0 ? String(e.connectMs) + "ms" : String("-")) +
+              " fail " + String(e.failStreak);
+      lines.push_back(line);
+    }
+  }
   lines.push_back("WS Connected: " + boolLabel(gs.wsConnected));
   lines.push_back("Gateway Ready: " + boolLabel(gs.gatewayReady));
   lines.push_back("Should Connect: " + boolLabel(gs.shouldConnect));
   const size_t receivedCount = ctx.gateway->inboxCount();
-  const size_t sentCount = gOutboxCount;
+  const size_t sentCount = gOutbox.count();
   lines.push_back("Chat Messages: " +
                   String(static_cast<unsigned long>(receivedCount + sentCount)) +
                   " (Rx " + String(static_cast<unsigned long>(receivedCount)) +
                   " / Tx " + String(static_cast<unsigned long>(sentCount)) + ")");
+  const size_t storeBytes = ctx.gateway->inbox().memoryBytes() + gOutbox.memoryBytes();
+  lines.push_back("Chat Store: " +
+                  String(static_cast<unsigned long>(ctx.gateway->inbox().capacity())) +
+                  " slots / " + String(static_cast<unsigned long>(storeBytes / 1024U)) + " KB");
+  if (ctx.lanControl && ctx.lanControl->isRunning()) {
+    const LanControlStats &lan = ctx.lanControl->stats();
+    const uint32_t avgUs =
+        lan.requests > 0 ? static_cast<uint32_t>(lan.totalHandleUs / lan.requests) : 0;
+    lines.push_back("LAN Control: :" + String(USER_LAN_CONTROL_PORT) + " / " +
+                    String(ctx.lanControl->clientCount()) + " clients / " +
+                    String(lan.requests) + " req avg " + String(avgUs) + " us");
+  } else {
+    lines.push_back("LAN Control: " + boolLabel(ctx.config.lanControlEnabled) + " (idle)");
+  }
+  const GatewayLinkStats &link = ctx.gateway->linkStats();
+  lines.push_back("Link Ready: " + String(link.lastReadyMs) + " ms (best " +
+                  String(link.bestReadyMs) + ")");
+  lines.push_back("Link DNS/TLS: " + String(link.lastDnsMs) + " / " +
+                  String(link.lastTransportMs) + " ms");
+  lines.push_back("Connect: chal " + String(link.lastChallengeWaitMs) + " / sign " +
+                  String(link.lastSignUs / 1000U) + " / rtt " +
+                  String(link.lastConnectRttMs) + " ms");
+  lines.push_back("TLS Heap: " + String(link.lastHandshakeHeapBytes / 1024U) + " KB (peak " +
+                  String(link.peakHandshakeHeapBytes / 1024U) + " KB)");
+  lines.push_back("Reconnects: " + String(link.connects) + " / Fast: " +
+                  String(link.fastReconnects) + (link.resumedFromSleep ? " (wake)" : ""));
+  const GatewayTelemetryStats &telemetry = ctx.gateway->telemetryStats();
+  lines.push_back("Telemetry: " + String(telemetry.frames) + " frames (" +
+                  String(telemetry.keyframes) + " key) / " +
+                  String(telemetry.bytes / 1024U) + " KB");
+  lines.push_back("Pending Req: " +
+                  String(static_cast<unsigned long>(ctx.gateway->pendingRequestCount())) +
+                  " / Lost: " + String(static_cast<unsigned long>(ctx.gateway->lostRequestCount())));
+  GatewayLatencySummary latency;
+  for (size_t i = 0; ctx.gateway->latencySummary(i, latency); ++i) {
+    lines.push_back("RTT " + String(latency.method) + ": " +
+                    String(static_cast<unsigned long>(latency.p50Ms)) + "/" +
+                    String(static_cast<unsigned long>(latency.p95Ms)) + "/" +
+                    String(static_cast<unsigned long>(latency.p99Ms)) + " ms (" +
+                    String(static_cast<unsigned long>(latency.count)) + ")");
+  }
   lines.push_back("Auth Mode: " + String(gatewayAuthModeName(ctx.config.gatewayAuthMode)));
   lines.push_back("Device Name: " + effectiveDeviceName(ctx.config));
   lines.push_back("Device Token: " + boolLabel(!ctx.config.gatewayDeviceToken.isEmpty()));
@@ -2429,6 +2554,7 @@ void runOpenClawApp(AppContext &ctx,
     menu.push_back("Status");
     menu.push_back("Gateway");
     menu.push_back("Messenger");
+    menu.push_back("History");
     menu.push_back("Save & Apply");
     menu.push_back("Back");
 
@@ -2439,7 +2565,7 @@ void runOpenClawApp(AppContext &ctx,
                                         "OK Select  BACK Exit",
                                         subtitle);
 
-    if (choice < 0 || choice == 4) {
+    if (choice < 0 || choice == 5) {
       return;
     }
 
@@ -2464,6 +2590,11 @@ void runOpenClawApp(AppContext &ctx,
     }
 
     if (choice == 3) {
+      runHistoryMenu(ctx, backgroundTick);
+      continue;
+    }
+
+    if (choice == 4) {
       applyRuntimeConfig(ctx, backgroundTick);
       continue;
     }
@@ -5,9 +5,11 @@
 
 #include "../core/ble_manager.h"
 #include "../core/gateway_client.h"
+#include "../core/lan_control_server.h"
 #include "../core/runtime_config.h"
 #include "../core/wifi_manager.h"
 #include "../ui/i18n.h"
+#include "../ui/sd_font.h"
 #include "../ui/ui_runtime.h"
 
 namespace {
@@ -232,10 +234,13 @@ String keyboardPreview(const String &input) {
   return out;
 }
 
+// A pack that failed to open (e.g. missing after an update) is shown as
+// unavailable instead of plain "Not Installed".
 String fontPackStatusLabel(bool installed, UiLanguage lang) {
-  const char *status = installed
-                           ? uiText(lang, UiTextKey::Installed)
-                           : uiText(lang, UiTextKey::NotInstalled);
+  const char *status = sdfont::isOpen() || sdfont::lastError().isEmpty()
+                           ? (installed ? uiText(lang, UiTextKey::Installed)
+                                        : uiText(lang, UiTextKey::NotInstalled))
+                           : uiText(lang, UiTextKey::PackUnavailable);
   return String(uiText(lang, UiTextKey::KoreanFontPack)) + ": " + status;
 }
 
@@ -255,7 +260,10 @@ void runFontPacksMenu(AppContext &ctx,
                    ": " + actionLabel);
     menu.push_back("Back");
 
-    const String subtitle = fontPackStatusLabel(installed, lang);
+    String subtitle = fontPackStatusLabel(installed, lang);
+    if (!sdfont::isOpen() && !sdfont::lastError().isEmpty()) {
+      subtitle = sdfont::lastError();
+    }
 
     const int choice = ctx.uiRuntime->menuLoop(
         uiText(lang, UiTextKey::FontPacks),
@@ -270,8 +278,14 @@ void runFontPacksMenu(AppContext &ctx,
     selected = choice;
 
     if (choice == 0) {
+      String err;
+      if (!ctx.uiRuntime->setKoreanFontInstalled(!installed, &err)) {
+        // Pack missing or unreadable: stay uninstalled.
+        ctx.uiRuntime->setKoreanFontInstalled(false);
+        ctx.uiRuntime->showToast("System", err, 2200, backgroundTick);
+        continue;
+      }
       ctx.config.koreanFontInstalled = !installed;
-      ctx.uiRuntime->setKoreanFontInstalled(ctx.config.koreanFontInstalled);
       markDirty(ctx);
 
       if (!ctx.config.koreanFontInstalled &&
@@ -490,7 +504,7 @@ void runBleMenu(AppContext &ctx,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         buildBleSubtitle(ctx));
-    if (choice < 0 || choice == 8) {
+    if (choice < 0 || choice == 9) {
       return;
     }
     selected = choice;
@@ -590,6 +604,10 @@ void runSystemMenu(AppContext &ctx,
     menu.push_back(displayBrightnessLabel(ctx.config.displayBrightnessPercent));
     menu.push_back(String("Timezone: ") + tzLabel);
     menu.push_back("Sync Timezone (IP)");
+    menu.push_back("Import SD Config");
+    menu.push_back(String("Perf Overlay: ") +
+                   (ctx.uiRuntime->perfOverlayEnabled() ? "On" : "Off"));
+    menu.push_back("Render Benchmark");
     menu.push_back("Factory Reset");
     menu.push_back("Back");
 
@@ -599,7 +617,7 @@ void runSystemMenu(AppContext &ctx,
                                         backgroundTick,
                                         "OK Select  BACK Exit",
                                         "Runtime config control");
-    if (choice < 0 || choice == 6) {
+    if (choice < 0 || choice == 8) {
       return;
     }
 
@@ -723,7 +741,44 @@ void runSystemMenu(AppContext &ctx,
       continue;
     }
 
-    if (choice != 5) {
+    if (choice == 5) {
+      if (ctx.configDirty) {
+        ctx.uiRuntime->showToast("System", "Save pending changes first", 1500, backgroundTick);
+        continue;
+      }
+
+      bool changed = false;
+      String importErr;
+      const bool imported = syncConfigFromSd(ctx.config, true, &changed, &importErr);
+      if (changed) {
+        applyRuntimeConfig(ctx);
+      }
+      if (!imported) {
+        if (importErr.isEmpty()) {
+          importErr = "SD import failed";
+        }
+        ctx.uiRuntime->showToast("System", importErr, 1800, backgroundTick);
+      } else {
+        ctx.uiRuntime->showToast("System",
+                                 changed ? "Config imported from SD"
+                                         : "No changes on SD",
+                                 1500,
+                                 backgroundTick);
+      }
+      continue;
+    }
+
+    if (choice == 6) {
+      ctx.uiRuntime->setPerfOverlayEnabled(!ctx.uiRuntime->perfOverlayEnabled());
+      continue;
+    }
+
+    if (choice == 7) {
+      ctx.uiRuntime->runRenderBenchmark(backgroundTick);
+      continue;
+    }
+
+    if (choice != 8) {
       continue;
     }
 
@@ -757,14 +812,14 @@ void runSystemMenu(AppContext &ctx,
 
     ctx.gateway->disconnectNow();
     ctx.gateway->configure(ctx.config);
+    if (ctx.lanControl) {
+      ctx.lanControl->configure(ctx.config);
+    }
 
     ctx.ble->disconnectNow();
     ctx.ble->configure(ctx.config);
 
-    ctx.uiRuntime->setKoreanFontInstalled(ctx.config.koreanFontInstalled);
-    ctx.uiRuntime->setLanguage(uiLanguageFromConfigCode(ctx.config.uiLanguage));
-    ctx.uiRuntime->setTimezone(ctx.config.timezoneTz);
-    ctx.uiRuntime->setDisplayBrightnessPercent(ctx.config.displayBrightnessPercent);
+    applyUiConfig(ctx);
     ctx.uiRuntime->showToast("System", "Factory reset completed", 1600, backgroundTick);
     return;
   }
@@ -784,7 +839,17 @@ void runSettingsApp(AppContext &ctx,
     menu.push_back("Firmware Update");
     menu.push_back("Back");
 
-    const String subtitle = ctx.configDirty ? "Unsaved changes" : "Saved";
+    // Saves are written in the background, so a failed write only shows up
+    // here, after the save itself was accepted.
+    const String flushErr = lastConfigFlushError();
+    String subtitle = "Saved";
+    if (ctx.configDirty) {
+      subtitle = "Unsaved changes";
+    } else if (!flushErr.isEmpty()) {
+      subtitle = "Save failed: " + flushErr;
+    } else if (configSavePending()) {
+      subtitle = "Saving...";
+    }
     const int choice = ctx.uiRuntime->menuLoop("Setting",
                                         menu,
                                         selected,
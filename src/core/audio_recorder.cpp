@@ -17,6 +17,7 @@
 
 #include "user_config.h"
 #include "board_pins.h"
+#include "sd_buffered_writer.h"
 
 namespace {
 
@@ -146,7 +147,7 @@ bool hasPdmPinConflict(String *detail) {
   return false;
 }
 
-bool captureAdcSamples(File &file,
+bool captureAdcSamples(SdBufferedWriter &out,
                        uint32_t totalSamples,
                        uint32_t sampleRate,
                        const std::function<void()> &backgroundTick,
@@ -186,15 +187,20 @@ bool captureAdcSamples(File &file,
     hp = std::max<int32_t>(-32768, std::min<int32_t>(32767, hp));
 
     const int16_t sample = static_cast<int16_t>(hp);
-    if (file.write(reinterpret_cast<const uint8_t *>(&sample), sizeof(sample)) !=
-        sizeof(sample)) {
-      setError(error, "Failed to write voice sample");
+    if (!out.write(reinterpret_cast<const uint8_t *>(&sample), sizeof(sample))) {
+      setError(error, out.lastError());
       return false;
     }
     ++writtenSamples;
 
-    if (backgroundTick && ((i % tickStride) == 0U)) {
-      backgroundTick();
+    if ((i % tickStride) == 0U) {
+      if (!out.pump()) {
+        setError(error, out.lastError());
+        return false;
+      }
+      if (backgroundTick) {
+        backgroundTick();
+      }
     }
 
     nextSampleUs += sampleIntervalUs;
@@ -214,7 +220,7 @@ bool captureAdcSamples(File &file,
 
 #if defined(ARDUINO_ARCH_ESP32)
 #if AUDIO_RECORDER_HAS_I2S_PDM_CHANNEL && SOC_I2S_SUPPORTS_PDM_RX
-bool capturePdmSamplesWithChannelApi(File &file,
+bool capturePdmSamplesWithChannelApi(SdBufferedWriter &out,
                                      uint32_t targetDataBytes,
                                      uint32_t sampleRate,
                                      const std::function<void()> &backgroundTick,
@@ -331,10 +337,10 @@ bool capturePdmSamplesWithChannelApi(File &file,
       }
 
       emptyReads = 0;
-      if (file.write(chunk, readBytes) != readBytes) {
+      if (!out.write(chunk, readBytes) || !out.pump()) {
         i2s_channel_disable(rxChan);
         i2s_del_channel(rxChan);
-        setError(error, "Failed to write voice sample");
+        setError(error, out.lastError());
         return false;
       }
       written += static_cast<uint32_t>(readBytes);
@@ -372,7 +378,7 @@ bool capturePdmSamplesWithChannelApi(File &file,
 }
 #endif
 
-bool capturePdmSamples(File &file,
+bool capturePdmSamples(SdBufferedWriter &out,
                        uint32_t targetDataBytes,
                        uint32_t sampleRate,
                        const std::function<void()> &backgroundTick,
@@ -380,7 +386,7 @@ bool capturePdmSamples(File &file,
                        uint32_t *dataBytesWritten,
                        String *error) {
 #if AUDIO_RECORDER_HAS_I2S_PDM_CHANNEL && SOC_I2S_SUPPORTS_PDM_RX
-  return capturePdmSamplesWithChannelApi(file,
+  return capturePdmSamplesWithChannelApi(out,
                                          targetDataBytes,
                                          sampleRate,
                                          backgroundTick,
@@ -542,9 +548,9 @@ bool capturePdmSamples(File &file,
       }
 
       emptyReads = 0;
-      if (file.write(chunk, readBytes) != readBytes) {
+      if (!out.write(chunk, readBytes) || !out.pump()) {
         shutdownI2s();
-        setError(error, "Failed to write voice sample");
+        setError(error, out.lastError());
         return false;
       }
       written += static_cast<uint32_t>(readBytes);
@@ -662,11 +668,23 @@ bool recordMicWavToSd(const String &path,
     return false;
   }
 
+  // Samples go out in sector-aligned blocks, written a slice at a time
+  // between reads so no single SD write stalls the capture for long.
+  SdBufferedWriter writer(SdBufferedWriter::kDefaultBufferBytes,
+                          SdBufferedWriter::Mode::Background);
+  String writerErr;
+  if (!writer.begin(file, &writerErr)) {
+    file.close();
+    SD.remove(path.c_str());
+    setError(error, writerErr);
+    return false;
+  }
+
   bool captured = false;
   uint32_t capturedDataBytes = 0;
   if (hasAdcMicConfigured()) {
     uint32_t capturedSamples = 0;
-    captured = captureAdcSamples(file,
+    captured = captureAdcSamples(writer,
                                  maxSamples,
                                  sampleRate,
                                  backgroundTick,
@@ -678,7 +696,7 @@ bool recordMicWavToSd(const String &path,
 #if defined(ARDUINO_ARCH_ESP32)
   else if (hasPdmMicConfigured()) {
     const uint32_t targetDataBytes = maxSamples * 2U;
-    captured = capturePdmSamples(file,
+    captured = capturePdmSamples(writer,
                                  targetDataBytes,
                                  sampleRate,
                                  backgroundTick,
@@ -688,6 +706,12 @@ bool recordMicWavToSd(const String &path,
   }
 #endif
 
+  if (captured && !writer.end(&writerErr)) {
+    captured = false;
+    setError(error, writerErr);
+  }
+  writer.end();
+
   if (!captured) {
     file.close();
     SD.remove(path.c_str());
@@ -8,6 +8,8 @@
 #include <string>
 #include <cstring>
 
+#include "sd_buffered_writer.h"
+
 #if __has_include(<NimBLEExtAdvertising.h>)
 #define NIMBLE_V2_PLUS 1
 #endif
@@ -445,6 +447,18 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     return false;
   }
 
+  // The ring buffer absorbs incoming packets while a block is written.
+  SdBufferedWriter writer;
+  String writerErr;
+  if (!writer.begin(file, &writerErr)) {
+    file.close();
+    SD.remove(path.c_str());
+    if (error) {
+      *error = writerErr;
+    }
+    return false;
+  }
+
   resetAudioCaptureBuffer();
   portENTER_CRITICAL(&gBleAudioMux);
   audioCaptureActive_ = true;
@@ -460,6 +474,7 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     portENTER_CRITICAL(&gBleAudioMux);
     audioCaptureActive_ = false;
     portEXIT_CRITICAL(&gBleAudioMux);
+    writer.end();
     file.close();
     SD.remove(path.c_str());
     if (error) {
@@ -497,9 +512,9 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
       size_t offset = 0;
       if (hasPendingByte) {
         uint8_t pair[2] = {pendingByte, drain[0]};
-        if (file.write(pair, sizeof(pair)) != sizeof(pair)) {
+        if (!writer.write(pair, sizeof(pair))) {
           failed = true;
-          failReason = "Failed to write BLE audio";
+          failReason = writer.lastError();
           break;
         }
         dataBytes += 2;
@@ -511,9 +526,9 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
         const size_t remain = readBytes - offset;
         const size_t evenBytes = remain & ~static_cast<size_t>(1);
         if (evenBytes > 0) {
-          if (file.write(drain + offset, evenBytes) != evenBytes) {
+          if (!writer.write(drain + offset, evenBytes)) {
             failed = true;
-            failReason = "Failed to write BLE audio";
+            failReason = writer.lastError();
             break;
           }
           dataBytes += static_cast<uint32_t>(evenBytes);
@@ -568,9 +583,9 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
     size_t offset = 0;
     if (hasPendingByte) {
       uint8_t pair[2] = {pendingByte, drain[0]};
-      if (file.write(pair, sizeof(pair)) != sizeof(pair)) {
+      if (!writer.write(pair, sizeof(pair))) {
         failed = true;
-        failReason = "Failed to write BLE audio";
+        failReason = writer.lastError();
         break;
       }
       dataBytes += 2;
@@ -582,9 +597,9 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
       const size_t remain = readBytes - offset;
       const size_t evenBytes = remain & ~static_cast<size_t>(1);
       if (evenBytes > 0) {
-        if (file.write(drain + offset, evenBytes) != evenBytes) {
+        if (!writer.write(drain + offset, evenBytes)) {
           failed = true;
-          failReason = "Failed to write BLE audio";
+          failReason = writer.lastError();
           break;
         }
         dataBytes += static_cast<uint32_t>(evenBytes);
@@ -606,6 +621,11 @@ bool BleManager::recordAudioStreamWavToSd(const String &path,
   portEXIT_CRITICAL(&gBleAudioMux);
   audioStreamChr_->unsubscribe();
 
+  if (!writer.end(&writerErr) && !failed) {
+    failed = true;
+    failReason = writerErr;
+  }
+
   if (!failed && dataBytes < kBleAudioMinBytes) {
     failed = true;
     failReason = "BLE audio data is too small";
@@ -8,6 +8,7 @@
 
 #include "board_pins.h"
 #include "shared_spi_bus.h"
+#include "telemetry_encoder.h"
 #include "user_config.h"
 #include "../hal/board_config.h"
 
@@ -303,35 +304,71 @@ bool sendCc1101PacketText(const String &text,
   return sendCc1101Packet(tx, len, txDelayMs, errorOut);
 }
 
+bool startCc1101PacketReceive(String &errorOut) {
+  if (!gCc1101Ready) {
+    errorOut = "CC1101 not initialized";
+    return false;
+  }
+
+  ELECHOUSE_cc1101.SetRx();
+  errorOut = "";
+  return true;
+}
+
+bool pollCc1101PacketReceive(uint8_t *out, size_t outCapacity, size_t &outLen, int *rssiOut) {
+  outLen = 0;
+  if (!gCc1101Ready || !out || outCapacity < CC1101_MAX_PACKET_BYTES ||
+      !ELECHOUSE_cc1101.CheckRxFifo(0)) {
+    return false;
+  }
+
+  const uint8_t rxLen = ELECHOUSE_cc1101.ReceiveData(out);
+  if (rxLen == 0) {
+    return false;
+  }
+  outLen = rxLen;
+  if (rssiOut) {
+    *rssiOut = ELECHOUSE_cc1101.getRssi();
+  }
+  return true;
+}
+
+void stopCc1101PacketReceive() {
+  if (gCc1101Ready) {
+    ELECHOUSE_cc1101.setSidle();
+  }
+}
+
+bool sampleCc1101RssiDbm(int &rssiOut) {
+  if (!gCc1101Ready) {
+    return false;
+  }
+  rssiOut = ELECHOUSE_cc1101.getRssi();
+  return true;
+}
+
 bool receiveCc1101Packet(std::vector<uint8_t> &outData,
                          int timeoutMs,
                          int *rssiOut,
                          String &errorOut) {
   outData.clear();
 
-  if (!gCc1101Ready) {
-    errorOut = "CC1101 not initialized";
-    return false;
-  }
   if (timeoutMs < 1 || timeoutMs > CC1101_MAX_RX_TIMEOUT_MS) {
     errorOut = "timeout must be 1..60000 ms";
     return false;
   }
+  if (!startCc1101PacketReceive(errorOut)) {
+    return false;
+  }
 
-  ELECHOUSE_cc1101.SetRx();
   const unsigned long startedAt = millis();
   while (millis() - startedAt < static_cast<unsigned long>(timeoutMs)) {
-    if (ELECHOUSE_cc1101.CheckRxFifo(0)) {
-      uint8_t rx[CC1101_MAX_PACKET_BYTES] = {0};
-      const uint8_t rxLen = ELECHOUSE_cc1101.ReceiveData(rx);
-      if (rxLen > 0) {
-        outData.assign(rx, rx + rxLen);
-        if (rssiOut) {
-          *rssiOut = ELECHOUSE_cc1101.getRssi();
-        }
-        errorOut = "";
-        return true;
-      }
+    uint8_t rx[CC1101_MAX_PACKET_BYTES] = {0};
+    size_t rxLen = 0;
+    if (pollCc1101PacketReceive(rx, sizeof(rx), rxLen, rssiOut)) {
+      outData.assign(rx, rx + rxLen);
+      errorOut = "";
+      return true;
     }
     delay(CC1101_RX_POLL_MS);
   }
@@ -399,3 +436,19 @@ void appendCc1101Info(JsonObject obj) {
   obj["packetLengthConfig"] = gPacketConfig.lengthConfig;
   obj["packetLength"] = gPacketConfig.packetLength;
 }
+
+void appendCc1101Telemetry(TelemetryEncoder &telemetry) {
+  telemetry.setString("board", HAL_BOARD_NAME);
+  telemetry.setBool("cc1101Ready", gCc1101Ready);
+  telemetry.setBool("cc1101Present", gCc1101Ready ? ELECHOUSE_cc1101.getCC1101() : false);
+  telemetry.setFloat("frequencyMhz", gCurrentFrequencyMhz, 3);
+  telemetry.setInt("packetModulation", gPacketConfig.modulation);
+  telemetry.setInt("packetChannel", gPacketConfig.channel);
+  telemetry.setFloat("packetDataRateKbps", gPacketConfig.dataRateKbps);
+  telemetry.setFloat("packetDeviationKHz", gPacketConfig.deviationKHz);
+  telemetry.setFloat("packetRxBandwidthKHz", gPacketConfig.rxBandwidthKHz);
+  telemetry.setInt("packetSyncMode", gPacketConfig.syncMode);
+  telemetry.setInt("packetFormat", gPacketConfig.packetFormat);
+  telemetry.setInt("packetLengthConfig", gPacketConfig.lengthConfig);
+  telemetry.setInt("packetLength", gPacketConfig.packetLength);
+}
@@ -5,6 +5,8 @@
 
 #include <vector>
 
+class TelemetryEncoder;
+
 enum class Cc1101Modulation : uint8_t {
   Fsk2 = 0,
   Gfsk = 1,
@@ -44,6 +46,16 @@ bool sendCc1101Packet(const uint8_t *data,
 bool sendCc1101PacketText(const String &text,
                           int txDelayMs,
                           String &errorOut);
+// Non-blocking receive for callers that run their own deadline: start once,
+// then poll until a packet arrives. `out` must hold at least 61 bytes.
+bool startCc1101PacketReceive(String &errorOut);
+bool pollCc1101PacketReceive(uint8_t *out, size_t outCapacity, size_t &outLen, int *rssiOut);
+// Leaves RX for idle, for a receive abandoned before a packet arrived.
+void stopCc1101PacketReceive();
+// RSSI of the radio already in RX (after startCc1101PacketReceive), without
+// the mode switch and settle delay of readCc1101RssiDbm.
+bool sampleCc1101RssiDbm(int &rssiOut);
+
 bool receiveCc1101Packet(std::vector<uint8_t> &outData,
                          int timeoutMs,
                          int *rssiOut,
@@ -57,3 +69,4 @@ bool transmitCc1101(uint32_t code,
                     String &errorOut);
 
 void appendCc1101Info(JsonObject obj);
+void appendCc1101Telemetry(TelemetryEncoder &telemetry);
@@ -0,0 +1,318 @@
+#include "chat_stream_assembler.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace {
+
+enum class TagClass : uint8_t { NeedMore, Literal, Control };
+
+constexpr const char *kControlTags[] = {"analysis", "commentary", "final"};
+
+bool isMarkupTagNameChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+// `exact` requires the whole tag name; otherwise `name` may be a prefix.
+bool matchesControlTag(const char *name, size_t len, bool exact) {
+  for (const char *tag : kControlTags) {
+    const size_t tagLen = strlen(tag);
+    if (len > tagLen || (exact && len != tagLen)) {
+      continue;
+    }
+    if (strncasecmp(name, tag, len) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Classifies a held-back "<..." sequence: "< / final>" and split tails like
+// "</final" are control tags; anything else is literal text.
+TagClass classifyTag(const char *pending, size_t len, bool atEnd) {
+  size_t i = 1;
+  while (i < len && isspace(static_cast<unsigned char>(pending[i]))) {
+    ++i;
+  }
+  if (i < len && pending[i] == '/') {
+    ++i;
+  }
+  while (i < len && isspace(static_cast<unsigned char>(pending[i]))) {
+    ++i;
+  }
+
+  const size_t nameStart = i;
+  while (i < len && isMarkupTagNameChar(pending[i])) {
+    ++i;
+  }
+  const size_t nameLen = i - nameStart;
+
+  if (i == len && !atEnd) {
+    if (nameLen > 0 && !matchesControlTag(pending + nameStart, nameLen, false)) {
+      return TagClass::Literal;
+    }
+    return TagClass::NeedMore;
+  }
+  if (nameLen == 0) {
+    return TagClass::Literal;
+  }
+  return matchesControlTag(pending + nameStart, nameLen, true) ? TagClass::Control
+                                                               : TagClass::Literal;
+}
+
+uint32_t hashRunId(const char *text, size_t len) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= static_cast<uint8_t>(text[i]);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+void ChatStreamAssembler::Emitter::put(char c) {
+  if (len == sizeof(buf)) {
+    flush();
+  }
+  buf[len++] = c;
+}
+
+void ChatStreamAssembler::Emitter::flush() {
+  if (len > 0) {
+    out.concat(buf, len);
+    len = 0;
+  }
+}
+
+ChatStreamAssembler::Update ChatStreamAssembler::feed(const String &runId,
+                                                      const char *text,
+                                                      size_t len,
+                                                      bool settled,
+                                                      String &out) {
+  const size_t idLen = runId.length() < kMaxRunIdLen ? runId.length() : kMaxRunIdLen;
+  const uint32_t idHash = hashRunId(runId.c_str(), idLen);
+  Run *run = findRun(runId, idHash);
+  if (!run) {
+    run = claimRun(runId, idHash);
+  }
+  run->lastUsedMs = millis();
+
+  out = "";
+  Update update = run->rawLen == 0 ? Update::Replace : Update::Append;
+  size_t start = 0;
+  if (run->rawLen > 0) {
+    const bool continues = snapshotContinues(*run, text, len);
+    if (run->mode == Mode::Unknown && !settled) {
+      run->mode = continues ? Mode::Snapshot : Mode::Delta;
+    }
+    if (run->mode == Mode::Snapshot || settled) {
+      if (continues) {
+        start = run->rawLen;
+      } else {
+        const Mode mode = run->mode;
+        resetRun(*run);
+        run->mode = mode;
+        update = Update::Replace;
+      }
+    }
+  }
+
+  Emitter emit(out);
+  consume(*run, text + start, len - start, emit);
+  if (settled) {
+    flushPending(*run, emit);
+    run->used = false;
+  }
+  emit.flush();
+  return update;
+}
+
+void ChatStreamAssembler::finish(const String &runId, String &out) {
+  out = "";
+  const size_t idLen = runId.length() < kMaxRunIdLen ? runId.length() : kMaxRunIdLen;
+  Run *run = findRun(runId, hashRunId(runId.c_str(), idLen));
+  if (!run) {
+    return;
+  }
+  Emitter emit(out);
+  flushPending(*run, emit);
+  emit.flush();
+  run->used = false;
+}
+
+void ChatStreamAssembler::clear() {
+  for (Run &run : runs_) {
+    run.used = false;
+  }
+}
+
+size_t ChatStreamAssembler::activeRuns() const {
+  size_t count = 0;
+  for (const Run &run : runs_) {
+    if (run.used) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+String ChatStreamAssembler::strip(const char *text, size_t len) {
+  String out;
+  if (!text || len == 0) {
+    return out;
+  }
+  if (!memchr(text, '<', len)) {
+    out.concat(text, len);
+    return out;
+  }
+
+  Run run;
+  out.reserve(len);
+  Emitter emit(out);
+  consume(run, text, len, emit);
+  flushPending(run, emit);
+  emit.flush();
+  return out;
+}
+
+ChatStreamAssembler::Run *ChatStreamAssembler::findRun(const String &runId,
+                                                       uint32_t idHash) {
+  for (Run &run : runs_) {
+    if (run.used && run.idHash == idHash &&
+        strncmp(run.id, runId.c_str(), kMaxRunIdLen) == 0) {
+      return &run;
+    }
+  }
+  return nullptr;
+}
+
+ChatStreamAssembler::Run *ChatStreamAssembler::claimRun(const String &runId,
+                                                        uint32_t idHash) {
+  // Reuse a free slot, else the least recently fed run; an evicted run just
+  // keeps the text it already has.
+  Run *slot = &runs_[0];
+  for (Run &run : runs_) {
+    if (!run.used) {
+      slot = &run;
+      break;
+    }
+    if (run.lastUsedMs < slot->lastUsedMs) {
+      slot = &run;
+    }
+  }
+
+  resetRun(*slot);
+  slot->used = true;
+  slot->idHash = idHash;
+  strncpy(slot->id, runId.c_str(), kMaxRunIdLen);
+  slot->id[kMaxRunIdLen] = '\0';
+  return slot;
+}
+
+void ChatStreamAssembler::resetRun(Run &run) {
+  run.mode = Mode::Unknown;
+  run.tag = TagState::Text;
+  run.pendingLen = 0;
+  run.headLen = 0;
+  run.tailLen = 0;
+  run.rawLen = 0;
+}
+
+// A snapshot repeats everything consumed so far; matching the first and last
+// few raw bytes at their old offsets tells it from a delta or a restart.
+bool ChatStreamAssembler::snapshotContinues(const Run &run, const char *text, size_t len) {
+  if (len < run.rawLen || run.tailLen == 0) {
+    return false;
+  }
+  return memcmp(text, run.head, run.headLen) == 0 &&
+         memcmp(text + run.rawLen - run.tailLen, run.tail, run.tailLen) == 0;
+}
+
+void ChatStreamAssembler::consume(Run &run, const char *text, size_t len, Emitter &emit) {
+  for (size_t i = 0; i < len; ++i) {
+    putChar(run, text[i], emit);
+  }
+
+  if (run.headLen < kTailBytes) {
+    const size_t take = len < kTailBytes - run.headLen ? len : kTailBytes - run.headLen;
+    memcpy(run.head + run.headLen, text, take);
+    run.headLen = static_cast<uint8_t>(run.headLen + take);
+  }
+  run.rawLen += static_cast<uint32_t>(len);
+  if (len >= kTailBytes) {
+    memcpy(run.tail, text + len - kTailBytes, kTailBytes);
+    run.tailLen = kTailBytes;
+  } else if (len > 0) {
+    const size_t keep = run.tailLen < kTailBytes - len ? run.tailLen : kTailBytes - len;
+    memmove(run.tail, run.tail + run.tailLen - keep, keep);
+    memcpy(run.tail + keep, text, len);
+    run.tailLen = static_cast<uint8_t>(keep + len);
+  }
+}
+
+void ChatStreamAssembler::putChar(Run &run, char c, Emitter &emit) {
+  switch (run.tag) {
+    case TagState::Text:
+      if (c == '<') {
+        run.tag = TagState::Candidate;
+        run.pending[0] = c;
+        run.pendingLen = 1;
+      } else {
+        emit.put(c);
+      }
+      return;
+
+    case TagState::Skip:
+      if (c == '>') {
+        run.tag = TagState::Text;
+      }
+      return;
+
+    case TagState::Candidate:
+      break;
+  }
+
+  run.pending[run.pendingLen++] = c;
+  TagClass kind = classifyTag(run.pending, run.pendingLen, false);
+  if (kind == TagClass::NeedMore && run.pendingLen >= kMaxTagBytes) {
+    kind = TagClass::Literal;
+  }
+  if (kind == TagClass::NeedMore) {
+    return;
+  }
+  if (kind == TagClass::Control) {
+    run.pendingLen = 0;
+    run.tag = c == '>' ? TagState::Text : TagState::Skip;
+    return;
+  }
+  releasePending(run, emit);
+}
+
+void ChatStreamAssembler::flushPending(Run &run, Emitter &emit) {
+  while (run.tag == TagState::Candidate) {
+    if (classifyTag(run.pending, run.pendingLen, true) == TagClass::Control) {
+      run.pendingLen = 0;
+      run.tag = TagState::Text;
+    } else {
+      releasePending(run, emit);
+    }
+  }
+  run.tag = TagState::Text;
+}
+
+// The held '<' was literal: emit it and rescan the rest, which may itself
+// start another tag.
+void ChatStreamAssembler::releasePending(Run &run, Emitter &emit) {
+  char rest[kMaxTagBytes];
+  const size_t restLen = run.pendingLen - 1;
+  memcpy(rest, run.pending + 1, restLen);
+  run.pendingLen = 0;
+  run.tag = TagState::Text;
+
+  emit.put('<');
+  for (size_t i = 0; i < restLen; ++i) {
+    putChar(run, rest[i], emit);
+  }
+}
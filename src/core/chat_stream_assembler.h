@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Assembles streamed assistant replies per run id, stripping control tags
+// (<analysis>, <commentary>, <final>) as text arrives. Only text not seen
+// before is scanned, and tags split across events are held back until they
+// can be classified, so work per event is proportional to the new text.
+class ChatStreamAssembler {
+ public:
+  static constexpr size_t kMaxRuns = 4;
+  static constexpr size_t kMaxRunIdLen = 96;
+
+  enum class Update : uint8_t {
+    Append,   // `out` is new text to append to the run's message
+    Replace,  // `out` is the whole reply: first event, or the stream restarted
+  };
+
+  // Feeds one chat event. Events may carry the reply so far (snapshots) or
+  // only new text (deltas); settled events are always snapshots and end the
+  // run. `out` is overwritten.
+  Update feed(const String &runId,
+              const char *text,
+              size_t len,
+              bool settled,
+              String &out);
+  // Ends a run whose final event had no text, flushing a held-back tag.
+  void finish(const String &runId, String &out);
+  void clear();
+
+  size_t activeRuns() const;
+
+  // One-shot strip of a complete text.
+  static String strip(const char *text, size_t len);
+
+ private:
+  static constexpr size_t kTailBytes = 16;
+  static constexpr size_t kMaxTagBytes = 24;
+
+  enum class Mode : uint8_t { Unknown, Snapshot, Delta };
+  enum class TagState : uint8_t { Text, Candidate, Skip };
+
+  struct Run {
+    bool used = false;
+    Mode mode = Mode::Unknown;
+    TagState tag = TagState::Text;
+    uint8_t pendingLen = 0;
+    uint8_t headLen = 0;
+    uint8_t tailLen = 0;
+    uint32_t idHash = 0;
+    uint32_t rawLen = 0;
+    unsigned long lastUsedMs = 0;
+    char id[kMaxRunIdLen + 1] = {0};
+    char pending[kMaxTagBytes];
+    char head[kTailBytes];
+    char tail[kTailBytes];
+  };
+
+  // Buffers emitted characters so `out` grows in chunks, not per character.
+  struct Emitter {
+    explicit Emitter(String &target) : out(target) {}
+    void put(char c);
+    void flush();
+
+    String &out;
+    char buf[64];
+    size_t len = 0;
+  };
+
+  Run *findRun(const String &runId, uint32_t idHash);
+  Run *claimRun(const String &runId, uint32_t idHash);
+  static void resetRun(Run &run);
+  static bool snapshotContinues(const Run &run, const char *text, size_t len);
+  static void consume(Run &run, const char *text, size_t len, Emitter &emit);
+  static void putChar(Run &run, char c, Emitter &emit);
+  static void flushPending(Run &run, Emitter &emit);
+  static void releasePending(Run &run, Emitter &emit);
+
+  Run runs_[kMaxRuns];
+};
@@ -0,0 +1,51 @@
+#include "cobs.h"
+
+size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out, size_t outCapacity) {
+  if (outCapacity < cobsMaxEncodedSize(len)) {
+    return 0;
+  }
+
+  size_t codeIndex = 0;
+  size_t write = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; ++i) {
+    if (in[i] == 0) {
+      out[codeIndex] = code;
+      codeIndex = write++;
+      code = 1;
+      continue;
+    }
+    out[write++] = in[i];
+    if (++code == 0xFF) {
+      out[codeIndex] = code;
+      codeIndex = write++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  return write;
+}
+
+size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out, size_t outCapacity) {
+  size_t read = 0;
+  size_t write = 0;
+  while (read < len) {
+    const uint8_t code = in[read++];
+    if (code == 0 || read + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; ++i) {
+      if (write >= outCapacity) {
+        return 0;
+      }
+      out[write++] = in[read++];
+    }
+    if (code != 0xFF && read < len) {
+      if (write >= outCapacity) {
+        return 0;
+      }
+      out[write++] = 0;
+    }
+  }
+  return write;
+}
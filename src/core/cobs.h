@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Consistent Overhead Byte Stuffing: encoded data contains no 0x00, so 0x00
+// can delimit frames on a byte stream.
+
+constexpr size_t cobsMaxEncodedSize(size_t rawLen) {
+  return rawLen + rawLen / 254 + 1;
+}
+
+// Returns the encoded length (no trailing delimiter), or 0 if `outCapacity`
+// is too small.
+size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out, size_t outCapacity);
+
+// Decodes one frame (without delimiter). `out` may alias `in`. Returns the
+// decoded length, or 0 on malformed input or overflow.
+size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out, size_t outCapacity);
@@ -3,10 +3,14 @@
 #include <Ed25519.h>
 #include <SHA256.h>
 #include <WiFi.h>
+#include <esp_attr.h>
 #include <esp_heap_caps.h>
+#include <esp_netif.h>
 #include <esp_system.h>
+#include <lwip/dns.h>
 #include <mbedtls/base64.h>
 #include <ctype.h>
+#include <string.h>
 #include <time.h>
 
 #include "user_config.h"
@@ -20,128 +24,150 @@ constexpr int OPENCLAW_PROTOCOL_MIN = 1;
 constexpr int OPENCLAW_PROTOCOL_MAX = 3;
 
 constexpr unsigned long kReconnectRetryMs = 2000UL;
+constexpr unsigned long kFastReconnectRetryMs = 200UL;
 constexpr unsigned long kConnectDelayMs = 750UL;
 constexpr unsigned long kLowMemRetryMs = 8000UL;
 constexpr unsigned long kTlsFailMaxBackoffMs = 30000UL;
 constexpr unsigned long kConnectAttemptTimeoutMs = 9000UL;
+// lwIP answers or gives up well before this; it only guards a lost callback.
+constexpr unsigned long kDnsLookupTimeoutMs = 15000UL;
+constexpr unsigned long kRttProbeIntervalMs = 10000UL;
+constexpr unsigned long kFailoverMinDwellMs = 30000UL;
+// Consecutive unanswered probes before the endpoint is charged a timeout.
+constexpr uint8_t kRttMissesForTimeout = 2;
 constexpr uint32_t kTlsMinInternalFreeBytes = 36000U;
 constexpr uint32_t kTlsMinInternalLargestBytes = 18000U;
+constexpr uint32_t kRtcLinkMagic = 0x474C4E4BUL;  // "GLNK"
 
-constexpr size_t kDevicePrivateKeyLen = 32;
-constexpr size_t kDevicePublicKeyLen = 32;
 constexpr size_t kDeviceSignatureLen = 64;
+constexpr size_t kDeviceSignatureB64Len = 86;  // unpadded base64url of 64 bytes
 constexpr size_t kGatewayFrameDocCapacity = 8192;
 constexpr size_t kGatewayFrameFilterCapacity = 1024;
 constexpr size_t kMaxGatewayFrameBytes = 131072;
 constexpr size_t kMaxGatewaySendFrameBytes = 6144;
-constexpr size_t kMaxMsgIdLen = 96;
-constexpr size_t kMaxMsgMetaLen = 64;
-constexpr size_t kMaxMsgTextLen = 768;
-constexpr size_t kMaxMsgFileNameLen = 128;
+// Request frame plus the id/nodeId/ok fields around an invoke result.
+constexpr size_t kInvokeResultEnvelopeBytes = 384;
 
-bool isMarkupTagNameChar(char c) {
-  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-         (c >= '0' && c <= '9') || c == '_' || c == '-';
-}
-
-bool isControlChatTag(const String &tagName) {
-  return tagName.equalsIgnoreCase("analysis") ||
-         tagName.equalsIgnoreCase("commentary") ||
-         tagName.equalsIgnoreCase("final");
-}
-
-String stripControlChatTags(const String &text) {
-  if (text.isEmpty() || text.indexOf('<') < 0) {
-    return text;
+bool startsWithErrorMarker(const String &text) {
+  if (text.isEmpty()) {
+    return false;
   }
 
-  String cleaned;
-  cleaned.reserve(text.length());
+  String normalized = text;
+  normalized.trim();
+  return normalized.startsWith("[error]");
+}
 
-  const size_t len = text.length();
-  size_t i = 0;
-  while (i < len) {
-    if (text[i] != '<') {
-      cleaned += text[i];
-      ++i;
-      continue;
-    }
+// Survives deep sleep so the first connect after wake can take the fast
+// reconnect path when the previous session to the same host was healthy.
+struct RtcLinkState {
+  uint32_t magic;
+  uint32_t hostHash;
+  uint32_t bestReadyMs;
+  uint8_t wasReady;
+};
+
+RTC_DATA_ATTR RtcLinkState gRtcLinkState;
+
+// Gateway host lookup running inside lwIP. The found callback runs on the
+// tcpip task, so the result is handed over under a lock and tagged with a
+// generation; an answer for a lookup that was since replaced is dropped.
+enum class DnsLookupState : uint8_t { Idle, Pending, Resolved, Failed };
+
+struct DnsLookup {
+  DnsLookupState state = DnsLookupState::Idle;
+  uint32_t generation = 0;
+  uint32_t hostHash = 0;
+  unsigned long startedMs = 0;
+};
+
+DnsLookup gDnsLookup;
+portMUX_TYPE gDnsLookupMux = portMUX_INITIALIZER_UNLOCKED;
+
+struct DnsStartArgs {
+  const char *host;
+  uint32_t generation;
+  ip_addr_t addr;
+};
+
+void onDnsFound(const char *, const ip_addr_t *addr, void *arg) {
+  const uint32_t generation = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg));
+  portENTER_CRITICAL(&gDnsLookupMux);
+  if (gDnsLookup.state == DnsLookupState::Pending && gDnsLookup.generation == generation) {
+    gDnsLookup.state = addr ? DnsLookupState::Resolved : DnsLookupState::Failed;
+  }
+  portEXIT_CRITICAL(&gDnsLookupMux);
+}
 
-    size_t cursor = i + 1;
-    while (cursor < len &&
-           isspace(static_cast<unsigned char>(text[cursor]))) {
-      ++cursor;
-    }
-    if (cursor < len && text[cursor] == '/') {
-      ++cursor;
-    }
-    while (cursor < len &&
-           isspace(static_cast<unsigned char>(text[cursor]))) {
-      ++cursor;
-    }
+// Runs on the tcpip task: lwIP's DNS API is not safe to call from the loop.
+esp_err_t startDnsLookupInTcpip(void *param) {
+  DnsStartArgs *args = static_cast<DnsStartArgs *>(param);
+  return static_cast<esp_err_t>(
+      dns_gethostbyname(args->host, &args->addr, onDnsFound,
+                        reinterpret_cast<void *>(static_cast<uintptr_t>(args->generation))));
+}
 
-    const size_t nameStart = cursor;
-    while (cursor < len && isMarkupTagNameChar(text[cursor])) {
-      ++cursor;
+// Starts a lookup of `host` or reports how the running one went. A settled
+// result is consumed, so the next connect attempt asks lwIP again; repeat
+// lookups are answered from its cache until the record expires. `lookupMs`
+// gets the lookup time once it has resolved.
+DnsLookupState resolveHost(const String &host, uint32_t hostHash, uint32_t *lookupMs) {
+  const unsigned long now = millis();
+  portENTER_CRITICAL(&gDnsLookupMux);
+  DnsLookupState state = gDnsLookup.state;
+  const bool sameHost = gDnsLookup.hostHash == hostHash;
+  const unsigned long startedMs = gDnsLookup.startedMs;
+  if (state != DnsLookupState::Idle && sameHost) {
+    if (state == DnsLookupState::Pending && now - startedMs >= kDnsLookupTimeoutMs) {
+      state = DnsLookupState::Failed;
     }
-
-    if (nameStart == cursor) {
-      cleaned += text[i];
-      ++i;
-      continue;
+    if (state != DnsLookupState::Pending) {
+      gDnsLookup.state = DnsLookupState::Idle;
     }
+  }
+  portEXIT_CRITICAL(&gDnsLookupMux);
+  if (state != DnsLookupState::Idle && sameHost) {
+    *lookupMs = now - startedMs;
+    return state;
+  }
 
-    const String tagName = text.substring(nameStart, cursor);
-    if (!isControlChatTag(tagName)) {
-      cleaned += text[i];
-      ++i;
-      continue;
-    }
+  DnsStartArgs args = {host.c_str(), 0, {}};
+  portENTER_CRITICAL(&gDnsLookupMux);
+  args.generation = ++gDnsLookup.generation;
+  gDnsLookup.hostHash = hostHash;
+  gDnsLookup.startedMs = now;
+  gDnsLookup.state = DnsLookupState::Pending;
+  portEXIT_CRITICAL(&gDnsLookupMux);
 
-    // Handle both complete tags ("</final>") and split tail chunks ("</final").
-    while (cursor < len && text[cursor] != '>') {
-      ++cursor;
-    }
-    i = cursor < len ? (cursor + 1) : cursor;
+  const err_t err = static_cast<err_t>(esp_netif_tcpip_exec(startDnsLookupInTcpip, &args));
+  if (err == ERR_INPROGRESS) {
+    return DnsLookupState::Pending;
   }
-
-  return cleaned;
+  // Answered from lwIP's cache, or refused outright.
+  portENTER_CRITICAL(&gDnsLookupMux);
+  if (gDnsLookup.generation == args.generation) {
+    gDnsLookup.state = DnsLookupState::Idle;
+  }
+  portEXIT_CRITICAL(&gDnsLookupMux);
+  *lookupMs = 0;
+  return err == ERR_OK ? DnsLookupState::Resolved : DnsLookupState::Failed;
 }
 
-bool startsWithErrorMarker(const String &text) {
-  if (text.isEmpty()) {
-    return false;
+uint32_t hashHost(const String &host) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < host.length(); ++i) {
+    hash ^= static_cast<uint8_t>(tolower(static_cast<unsigned char>(host[i])));
+    hash *= 16777619UL;
   }
-
-  String normalized = text;
-  normalized.trim();
-  return normalized.startsWith("[error]");
+  return hash;
 }
 
-void clampString(String &value, size_t maxLen) {
-  if (maxLen == 0) {
-    value = "";
-    return;
-  }
-  if (value.length() <= maxLen) {
-    return;
-  }
-  if (maxLen <= 3) {
-    value = value.substring(0, maxLen);
-    return;
-  }
-  value = value.substring(0, maxLen - 3) + "...";
+uint32_t internalFreeBytes() {
+  return heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
 }
 
-void clampInboxMessage(GatewayInboxMessage &message) {
-  clampString(message.id, kMaxMsgIdLen);
-  clampString(message.event, kMaxMsgMetaLen);
-  clampString(message.type, kMaxMsgMetaLen);
-  clampString(message.from, kMaxMsgMetaLen);
-  clampString(message.to, kMaxMsgMetaLen);
-  clampString(message.fileName, kMaxMsgFileNameLen);
-  clampString(message.contentType, kMaxMsgMetaLen);
-  clampString(message.text, kMaxMsgTextLen);
+uint32_t internalMinFreeBytes() {
+  return heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
 }
 
 bool hasTlsHeapHeadroom() {
@@ -185,6 +211,15 @@ void GatewayClient::begin() {
   ws_.setReconnectInterval(kReconnectRetryMs);
   ws_.enableHeartbeat(15000, 3000, 2);
 
+  if (esp_reset_reason() == ESP_RST_DEEPSLEEP && gRtcLinkState.magic == kRtcLinkMagic &&
+      gRtcLinkState.wasReady) {
+    fastReconnectPending_ = true;
+    linkStats_.resumedFromSleep = true;
+    linkStats_.bestReadyMs = gRtcLinkState.bestReadyMs;
+  } else {
+    memset(&gRtcLinkState, 0, sizeof(gRtcLinkState));
+  }
+
   initialized_ = true;
 }
 
@@ -196,8 +231,33 @@ void GatewayClient::setTelemetryBuilder(TelemetryBuilder builder) {
   telemetryBuilder_ = builder;
 }
 
+void GatewayClient::setMessageHandler(MessageHandler handler) {
+  messageHandler_ = handler;
+}
+
+void GatewayClient::setCommandCatalog(CommandCatalog catalog) {
+  commandCatalog_ = catalog;
+}
+
 void GatewayClient::configure(const RuntimeConfig &config) {
+  const bool keysChanged =
+      config.gatewayDevicePrivateKey != config_.gatewayDevicePrivateKey ||
+      config.gatewayDevicePublicKey != config_.gatewayDevicePublicKey;
   config_ = config;
+  connectAuth_.ready = false;
+  endpoints_.configure(config.gatewayUrl, config.gatewayFallbackUrls);
+  if (activeEndpoint_ >= endpoints_.count()) {
+    activeEndpoint_ = 0;
+  }
+
+  // Decode (or create) the device keys now rather than on the connect path.
+  if (keysChanged || !identity_.valid) {
+    identity_.valid = false;
+    String identityErr;
+    if (!ensureDeviceIdentity(&identityErr) && !identityErr.isEmpty()) {
+      lastError_ = identityErr;
+    }
+  }
 }
 
 void GatewayClient::connectNow() {
@@ -219,12 +279,16 @@ void GatewayClient::disconnectNow() {
   connectAttemptStartedMs_ = 0;
   connectUsedDeviceToken_ = false;
   connectCanFallbackToShared_ = false;
-  tlsFailStreak_ = 0;
+  endpoints_.clearFailures();
+  fastReconnectPending_ = false;
+  dnsPending_ = false;
+  gRtcLinkState.wasReady = 0;
 
   if (wsStarted_) {
     ws_.disconnect();
     wsStarted_ = false;
   }
+  requests_.failAll(GatewayRequestOutcome::Disconnected);
 }
 
 void GatewayClient::reconnectNow() {
@@ -251,11 +315,9 @@ void GatewayClient::tick() {
       connectSent_ = false;
       connectQueuedAtMs_ = 0;
       connectAttemptStartedMs_ = 0;
-      if (tlsFailStreak_ < 0xFFU) {
-        ++tlsFailStreak_;
-      }
+      endpoints_.recordFailure(activeEndpoint_);
       lastConnectAttemptMs_ = now;
-      if (config_.gatewayUrl.startsWith("wss://")) {
+      if (endpoints_.at(activeEndpoint_).url.startsWith("wss://")) {
         lastError_ = "TLS connect timeout; retrying";
       } else {
         lastError_ = "Gateway connect timeout";
@@ -266,8 +328,11 @@ void GatewayClient::tick() {
   if (shouldConnect_ && !wsStarted_) {
     const unsigned long now = millis();
     unsigned long retryMs = hasTlsHeapHeadroom() ? kReconnectRetryMs : kLowMemRetryMs;
-    if (tlsFailStreak_ > 0) {
-      const uint8_t shift = tlsFailStreak_ > 4 ? 4 : tlsFailStreak_;
+    // Back off by the streak of the endpoint the next attempt will use, so
+    // failing over to a healthy fallback is not delayed.
+    const uint8_t failStreak = endpoints_.at(endpoints_.select()).failStreak;
+    if (failStreak > 0) {
+      const uint8_t shift = failStreak > 4 ? 4 : failStreak;
       const unsigned long backoff = kReconnectRetryMs << shift;
       if (backoff > retryMs) {
         retryMs = backoff;
@@ -276,30 +341,240 @@ void GatewayClient::tick() {
         retryMs = kTlsFailMaxBackoffMs;
       }
     }
-    if (now - lastConnectAttemptMs_ >= retryMs) {
+    if (fastReconnectPending_ && failStreak == 0) {
+      // A healthy session just dropped (Wi-Fi blip, server restart): retry
+      // almost immediately instead of waiting out the regular interval.
+      retryMs = kFastReconnectRetryMs;
+    }
+    if (dnsPending_ || now - lastConnectAttemptMs_ >= retryMs) {
       startWebSocket();
     }
   }
 
   if (wsConnected_ && !connectSent_) {
     const unsigned long now = millis();
-    if (now - connectQueuedAtMs_ >= kConnectDelayMs) {
+    // Once the challenge nonce is in, sign and send on the next tick; the
+    // delay only applies while waiting for a gateway that never challenges.
+    const unsigned long delayMs = connectNonce_.isEmpty() ? kConnectDelayMs : 0;
+    if (now - connectQueuedAtMs_ >= delayMs) {
       sendConnectRequest();
     }
   }
 
-  if (gatewayReady_ && telemetryBuilder_) {
+  requests_.expire(millis());
+
+  if (gatewayReady_) {
+    probeRtt(millis());
+  }
+
+  if (gatewayReady_ && telemetryBuilder_ && !telemetryInFlight_) {
     const unsigned long now = millis();
-    if (now - lastTelemetryMs_ >= USER_TELEMETRY_INTERVAL_MS) {
+    if (now - lastTelemetryMs_ >= telemetryIntervalMs_) {
       lastTelemetryMs_ = now;
-      DynamicJsonDocument payload(1024);
-      JsonObject obj = payload.to<JsonObject>();
-      telemetryBuilder_(obj);
-      sendNodeEvent("cc1101.telemetry", payload);
+      sampleTelemetry(telemetryKeyframeDue_ ||
+                      now - lastKeyframeMs_ >= USER_TELEMETRY_KEYFRAME_MS);
     }
   }
 }
 
+void GatewayClient::sampleTelemetry(bool keyframe) {
+  telemetryBuilder_(telemetry_);
+  ++telemetryStats_.samples;
+
+  // Sample faster while something is changing, back off while idle.
+  const bool changed = telemetry_.hasChanges();
+  if (changed) {
+    telemetryIntervalMs_ = USER_TELEMETRY_MIN_INTERVAL_MS;
+  } else {
+    telemetryIntervalMs_ = telemetryIntervalMs_ < USER_TELEMETRY_MIN_INTERVAL_MS
+                               ? USER_TELEMETRY_MIN_INTERVAL_MS
+                               : telemetryIntervalMs_ * 2U;
+    if (telemetryIntervalMs_ > USER_TELEMETRY_INTERVAL_MS) {
+      telemetryIntervalMs_ = USER_TELEMETRY_INTERVAL_MS;
+    }
+  }
+  telemetryStats_.intervalMs = telemetryIntervalMs_;
+  if (!keyframe && !changed) {
+    return;
+  }
+
+  // The frame is written as text: only the members that changed since the
+  // last acknowledged frame (all of them for a keyframe).
+  const uint32_t seq = ++telemetrySeq_;
+  const String reqId = nextReqId("req");
+  String body;
+  body.reserve(keyframe ? 1536 : 256);
+  body += "{\"type\":\"req\",\"id\":\"";
+  body += reqId;
+  body += "\",\"method\":\"node.event\",\"params\":{\"event\":\"cc1101.telemetry\",\"payload\":{";
+  if (telemetry_.writeFields(body, keyframe) > 0) {
+    body += ',';
+  }
+  if (keyframe) {
+    appendKeyframeStats(body);
+  }
+  body += "\"seq\":";
+  body += String(seq);
+  body += ",\"keyframe\":";
+  body += keyframe ? "true" : "false";
+  body += "}}}";
+
+  if (!sendFrame(body)) {
+    telemetry_.discardPending();
+    return;
+  }
+
+  ++telemetryStats_.frames;
+  telemetryStats_.bytes += body.length();
+  if (keyframe) {
+    ++telemetryStats_.keyframes;
+    lastKeyframeMs_ = millis();
+    telemetryKeyframeDue_ = false;
+  }
+
+  // Only one frame is in flight, so the ack maps onto the pending fields.
+  telemetryInFlight_ = true;
+  requests_.track(reqCounter_, "node.event", millis(), kDefaultRequestTimeoutMs,
+                  [this, keyframe](GatewayRequestOutcome outcome, JsonObjectConst) {
+                    telemetryInFlight_ = false;
+                    if (outcome == GatewayRequestOutcome::Ok) {
+                      telemetry_.commitPending();
+                      return;
+                    }
+                    telemetry_.discardPending();
+                    if (keyframe) {
+                      telemetryKeyframeDue_ = true;
+                    }
+                  });
+}
+
+void GatewayClient::appendKeyframeStats(String &out) const {
+  DynamicJsonDocument stats(1536);
+  requests_.appendStats(stats.createNestedObject("gatewayLatency"));
+  appendLinkStats(stats.createNestedObject("gatewayLink"));
+  JsonObject telemetry = stats.createNestedObject("telemetry");
+  telemetry["frames"] = telemetryStats_.frames;
+  telemetry["keyframes"] = telemetryStats_.keyframes;
+  telemetry["bytes"] = telemetryStats_.bytes;
+
+  // Splice the members in without the enclosing braces.
+  String text;
+  serializeJson(stats, text);
+  if (text.length() > 2) {
+    out.concat(text.c_str() + 1, text.length() - 2);
+    out += ',';
+  }
+}
+
+void GatewayClient::appendLinkStats(JsonObject obj) const {
+  obj["attempts"] = linkStats_.attempts;
+  obj["connects"] = linkStats_.connects;
+  obj["fast"] = linkStats_.fastReconnects;
+  obj["dnsFail"] = linkStats_.dnsFailures;
+  obj["dnsMs"] = linkStats_.lastDnsMs;
+  obj["transportMs"] = linkStats_.lastTransportMs;
+  obj["challengeMs"] = linkStats_.lastChallengeWaitMs;
+  obj["signUs"] = linkStats_.lastSignUs;
+  obj["connectRttMs"] = linkStats_.lastConnectRttMs;
+  obj["readyMs"] = linkStats_.lastReadyMs;
+  obj["bestReadyMs"] = linkStats_.bestReadyMs;
+  obj["tlsHeap"] = linkStats_.lastHandshakeHeapBytes;
+  obj["tlsHeapPeak"] = linkStats_.peakHandshakeHeapBytes;
+  obj["resumed"] = linkStats_.resumedFromSleep;
+  obj["endpoint"] = activeEndpoint_;
+  obj["rttMs"] = linkStats_.lastRttMs;
+  obj["failovers"] = linkStats_.failovers;
+}
+
+void GatewayClient::recordTransportOpen() {
+  if (linkAttemptStartedMs_ == 0) {
+    return;
+  }
+  linkStats_.lastTransportMs = millis() - linkAttemptStartedMs_;
+
+  // The TLS buffers are still held here; the global low-water mark catches
+  // the transient peak inside the handshake if it went below the old one.
+  uint32_t used = 0;
+  const uint32_t freeNow = internalFreeBytes();
+  if (handshakeHeapStart_ > freeNow) {
+    used = handshakeHeapStart_ - freeNow;
+  }
+  const uint32_t minNow = internalMinFreeBytes();
+  if (minNow < handshakeHeapMinBefore_ && handshakeHeapStart_ > minNow &&
+      handshakeHeapStart_ - minNow > used) {
+    used = handshakeHeapStart_ - minNow;
+  }
+  linkStats_.lastHandshakeHeapBytes = used;
+  if (used > linkStats_.peakHandshakeHeapBytes) {
+    linkStats_.peakHandshakeHeapBytes = used;
+  }
+}
+
+void GatewayClient::recordGatewayReady() {
+  ++linkStats_.connects;
+  if (connectSentAtMs_ > 0) {
+    linkStats_.lastConnectRttMs = millis() - connectSentAtMs_;
+    connectSentAtMs_ = 0;
+  }
+  if (linkAttemptStartedMs_ > 0) {
+    linkStats_.lastReadyMs = millis() - linkAttemptStartedMs_;
+    if (linkStats_.bestReadyMs == 0 || linkStats_.lastReadyMs < linkStats_.bestReadyMs) {
+      linkStats_.bestReadyMs = linkStats_.lastReadyMs;
+    }
+    linkAttemptStartedMs_ = 0;
+  }
+  endpoints_.recordReady(activeEndpoint_, linkStats_.lastReadyMs);
+  lastRttProbeMs_ = millis();
+  rttProbePending_ = false;
+  missedRttProbes_ = 0;
+  if (fastReconnectAttempt_) {
+    ++linkStats_.fastReconnects;
+    fastReconnectAttempt_ = false;
+  }
+  fastReconnectPending_ = false;
+
+  gRtcLinkState.magic = kRtcLinkMagic;
+  gRtcLinkState.hostHash = linkHostHash_;
+  gRtcLinkState.bestReadyMs = linkStats_.bestReadyMs;
+  gRtcLinkState.wasReady = 1;
+}
+
+// Sends a timestamped ping; the pong gives the endpoint's RTT. Probes still
+// unanswered a full interval later are only charged as a timeout once
+// kRttMissesForTimeout of them have gone missing in a row.
+void GatewayClient::probeRtt(unsigned long nowMs) {
+  if (nowMs - lastRttProbeMs_ < kRttProbeIntervalMs) {
+    return;
+  }
+  if (rttProbePending_ && ++missedRttProbes_ >= kRttMissesForTimeout) {
+    endpoints_.recordRttTimeout(activeEndpoint_);
+    missedRttProbes_ = 0;
+  }
+  endpoints_.ageInactive(activeEndpoint_);
+  uint8_t stamp[4];
+  const uint32_t sentMs = static_cast<uint32_t>(nowMs);
+  stamp[0] = static_cast<uint8_t>(sentMs);
+  stamp[1] = static_cast<uint8_t>(sentMs >> 8);
+  stamp[2] = static_cast<uint8_t>(sentMs >> 16);
+  stamp[3] = static_cast<uint8_t>(sentMs >> 24);
+  rttProbePending_ = ws_.sendPing(stamp, sizeof(stamp));
+  lastRttProbeMs_ = nowMs;
+  checkFailover(nowMs);
+}
+
+void GatewayClient::checkFailover(unsigned long nowMs) {
+  if (nowMs - lastConnectOkMs_ < kFailoverMinDwellMs) {
+    return;
+  }
+  const int target = endpoints_.switchTarget(activeEndpoint_);
+  if (target < 0) {
+    return;
+  }
+  ++linkStats_.failovers;
+  lastError_ = "Gateway degraded; switching to " + endpoints_.at(static_cast<size_t>(target)).url;
+  reconnectNow();
+}
+
 bool GatewayClient::isReady() const {
   return gatewayReady_;
 }
@@ -319,6 +594,32 @@ GatewayStatus GatewayClient::status() const {
   return s;
 }
 
+const GatewayLinkStats &GatewayClient::linkStats() const {
+  return linkStats_;
+}
+
+const GatewayEndpointPool &GatewayClient::endpoints() const {
+  return endpoints_;
+}
+
+size_t GatewayClient::activeEndpoint() const {
+  return activeEndpoint_;
+}
+
+const GatewayTelemetryStats &GatewayClient::telemetryStats() const {
+  return telemetryStats_;
+}
+
+bool GatewayClient::request(const char *method,
+                            JsonDocument &paramsDoc,
+                            GatewayResponseHandler handler,
+                            unsigned long timeoutMs) {
+  if (!gatewayReady_) {
+    return false;
+  }
+  return sendRequest(method, paramsDoc, nullptr, handler, timeoutMs);
+}
+
 bool GatewayClient::sendNodeEvent(const char *eventName, JsonDocument &payloadDoc) {
   if (!gatewayReady_) {
     return false;
@@ -349,11 +650,20 @@ bool GatewayClient::sendNodeEvent(const char *eventName, JsonDocument &payloadDo
 bool GatewayClient::sendInvokeOk(const String &invokeId,
                                  const String &nodeId,
                                  JsonDocument &payloadDoc) {
-  StaticJsonDocument<4096> params;
+  // A result that cannot go out whole is reported as an error, not cut.
+  if (measureJson(payloadDoc) + kInvokeResultEnvelopeBytes >= kMaxGatewaySendFrameBytes) {
+    return sendInvokeError(invokeId, nodeId, "RESULT_TOO_LARGE",
+                           "invoke result exceeds the gateway frame size");
+  }
+  DynamicJsonDocument params(payloadDoc.memoryUsage() + kInvokeResultEnvelopeBytes);
   params["id"] = invokeId;
   params["nodeId"] = nodeId;
   params["ok"] = true;
   params["payload"] = payloadDoc.as<JsonVariantConst>();
+  if (params.overflowed()) {
+    return sendInvokeError(invokeId, nodeId, "RESULT_TOO_LARGE",
+                           "invoke result exceeds the gateway frame size");
+  }
   return sendRequest("node.invoke.result", params, nullptr);
 }
 
@@ -372,22 +682,40 @@ bool GatewayClient::sendInvokeError(const String &invokeId,
 }
 
 size_t GatewayClient::inboxCount() const {
-  return inboxCount_;
+  return inbox_.count();
 }
 
-bool GatewayClient::inboxMessage(size_t index, GatewayInboxMessage &out) const {
-  if (index >= inboxCount_) {
-    return false;
-  }
+bool GatewayClient::inboxMessage(size_t index, MessageView &out) const {
+  return inbox_.at(index, out);
+}
 
-  const size_t pos = (inboxStart_ + index) % kInboxCapacity;
-  out = inbox_[pos];
-  return true;
+const MessageStore &GatewayClient::inbox() const {
+  return inbox_;
 }
 
 void GatewayClient::clearInbox() {
-  inboxStart_ = 0;
-  inboxCount_ = 0;
+  inbox_.clear();
+  chatStreams_.clear();
+}
+
+size_t GatewayClient::latencyMethodCount() const {
+  return requests_.methodCount();
+}
+
+bool GatewayClient::latencySummary(size_t index, GatewayLatencySummary &out) const {
+  return requests_.summary(index, out);
+}
+
+size_t GatewayClient::pendingRequestCount() const {
+  return requests_.pendingCount();
+}
+
+uint32_t GatewayClient::lostRequestCount() const {
+  return requests_.lostCount();
+}
+
+void GatewayClient::restoreInboxMessage(const GatewayInboxMessage &message) {
+  inbox_.upsert(message);
 }
 
 void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
@@ -395,6 +723,7 @@ void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
     case WStype_DISCONNECTED:
       {
       const String wsReason = wsReasonText(payload, length);
+      const bool wasReady = gatewayReady_;
       wsConnected_ = false;
       gatewayReady_ = false;
       connectRequestId_ = "";
@@ -406,8 +735,11 @@ void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
       connectUsedDeviceToken_ = false;
       connectCanFallbackToShared_ = false;
       wsStarted_ = false;
-      if (shouldConnect_ && !gatewayReady_ && tlsFailStreak_ < 0xFFU) {
-        ++tlsFailStreak_;
+      requests_.failAll(GatewayRequestOutcome::Disconnected);
+      if (wasReady && shouldConnect_) {
+        fastReconnectPending_ = true;
+      } else if (shouldConnect_) {
+        endpoints_.recordFailure(activeEndpoint_);
       }
       if (shouldConnect_) {
         if (wsReason.length()) {
@@ -431,20 +763,33 @@ void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
       connectAttemptStartedMs_ = 0;
       connectUsedDeviceToken_ = false;
       connectCanFallbackToShared_ = false;
-      tlsFailStreak_ = 0;
+      wsOpenedAtMs_ = millis();
+      recordTransportOpen();
       break;
 
     case WStype_TEXT:
       handleGatewayFrame(reinterpret_cast<const char *>(payload), length);
       break;
 
+    case WStype_PONG:
+      // Library heartbeat pongs are empty; ours echo the 4-byte send time.
+      if (rttProbePending_ && payload && length == 4) {
+        const uint32_t sentMs = static_cast<uint32_t>(payload[0]) |
+                                (static_cast<uint32_t>(payload[1]) << 8) |
+                                (static_cast<uint32_t>(payload[2]) << 16) |
+                                (static_cast<uint32_t>(payload[3]) << 24);
+        linkStats_.lastRttMs = static_cast<uint32_t>(millis()) - sentMs;
+        endpoints_.recordRtt(activeEndpoint_, linkStats_.lastRttMs);
+        rttProbePending_ = false;
+        missedRttProbes_ = 0;
+      }
+      break;
+
     case WStype_ERROR:
       {
       const String wsReason = wsReasonText(payload, length);
       lastError_ = wsReason.length() ? ("WebSocket error: " + wsReason) : String("WebSocket error");
-      if (tlsFailStreak_ < 0xFFU) {
-        ++tlsFailStreak_;
-      }
+      endpoints_.recordFailure(activeEndpoint_);
       ws_.disconnect();
       wsStarted_ = false;
       wsConnected_ = false;
@@ -453,6 +798,7 @@ void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
       connectQueuedAtMs_ = 0;
       connectAttemptStartedMs_ = 0;
       lastConnectAttemptMs_ = millis();
+      requests_.failAll(GatewayRequestOutcome::Disconnected);
       break;
       }
 
@@ -462,6 +808,7 @@ void GatewayClient::onWsEvent(WStype_t type, uint8_t *payload, size_t length) {
 }
 
 void GatewayClient::startWebSocket() {
+  dnsPending_ = false;
   if (!hasTlsHeapHeadroom()) {
     lastError_ = "Gateway retry deferred (low heap)";
     lastConnectAttemptMs_ = millis();
@@ -474,12 +821,52 @@ void GatewayClient::startWebSocket() {
     return;
   }
 
+  activeEndpoint_ = endpoints_.select();
   GatewayEndpoint endpoint;
-  if (!parseGatewayUrl(config_.gatewayUrl, endpoint)) {
+  if (!parseGatewayUrl(endpoints_.at(activeEndpoint_).url, endpoint)) {
+    endpoints_.recordFailure(activeEndpoint_);
     lastError_ = "Invalid gateway URL";
     return;
   }
 
+  // Resolve up front without blocking the loop: the lookup runs in lwIP and
+  // tick() comes back here until it settles. A failed lookup backs off
+  // immediately instead of burning the connect timeout, and the transport's
+  // own lookup is then answered from lwIP's cache.
+  const uint32_t hostHash = hashHost(endpoint.host);
+  IPAddress hostIp;
+  if (hostIp.fromString(endpoint.host)) {
+    linkStats_.lastDnsMs = 0;
+  } else {
+    uint32_t lookupMs = 0;
+    const DnsLookupState dns = resolveHost(endpoint.host, hostHash, &lookupMs);
+    dnsPending_ = dns == DnsLookupState::Pending;
+    if (dnsPending_) {
+      return;
+    }
+    if (dns != DnsLookupState::Resolved) {
+      ++linkStats_.dnsFailures;
+      endpoints_.recordFailure(activeEndpoint_);
+      lastError_ = "Gateway DNS lookup failed: " + endpoint.host;
+      lastConnectAttemptMs_ = millis();
+      return;
+    }
+    linkStats_.lastDnsMs = lookupMs;
+  }
+
+  if (fastReconnectPending_ && linkStats_.resumedFromSleep && linkStats_.connects == 0 &&
+      gRtcLinkState.hostHash != hostHash) {
+    fastReconnectPending_ = false;
+  }
+  linkHostHash_ = hostHash;
+  fastReconnectAttempt_ = fastReconnectPending_;
+  ++linkStats_.attempts;
+  endpoints_.recordAttempt(activeEndpoint_);
+  handshakeHeapStart_ = internalFreeBytes();
+  handshakeHeapMinBefore_ = internalMinFreeBytes();
+  linkAttemptStartedMs_ = millis();
+  prepareConnectAuth();
+
   if (wsStarted_) {
     ws_.disconnect();
   }
@@ -506,7 +893,7 @@ void GatewayClient::startWebSocket() {
 }
 
 bool GatewayClient::canStartConnection(String *reason) const {
-  if (config_.gatewayUrl.isEmpty()) {
+  if (endpoints_.count() == 0) {
     if (reason) {
       *reason = "Gateway URL is empty";
     }
@@ -532,22 +919,21 @@ bool GatewayClient::canStartConnection(String *reason) const {
 
 bool GatewayClient::sendRequest(const char *method,
                                 JsonDocument &paramsDoc,
-                                String *requestIdOut) {
+                                String *requestIdOut,
+                                GatewayResponseHandler handler,
+                                unsigned long timeoutMs) {
   if (!wsConnected_) {
     return false;
   }
 
-  size_t paramsLen = measureJson(paramsDoc);
-  if (paramsLen == 0) {
-    paramsLen = 2;  // "{}"
-  }
-
-  size_t frameCapacity = paramsLen + 768U;
+  // Sized from pool use, not text length: a copy of params needs at least
+  // as much. The text size limit is checked below.
+  size_t frameCapacity = paramsDoc.memoryUsage() + 768U;
   if (frameCapacity < 1024U) {
     frameCapacity = 1024U;
   }
-  if (frameCapacity > kMaxGatewaySendFrameBytes + 1024U) {
-    frameCapacity = kMaxGatewaySendFrameBytes + 1024U;
+  if (frameCapacity > 2U * kMaxGatewaySendFrameBytes) {
+    frameCapacity = 2U * kMaxGatewaySendFrameBytes;
   }
 
   DynamicJsonDocument frame(frameCapacity);
@@ -576,66 +962,89 @@ bool GatewayClient::sendRequest(const char *method,
     return false;
   }
 
-  const bool sent = ws_.sendTXT(body);
+  const bool sent = sendFrame(body);
+  if (sent) {
+    requests_.track(reqCounter_, method, millis(), timeoutMs, handler);
+  }
   if (sent && requestIdOut) {
     *requestIdOut = reqId;
   }
   return sent;
 }
 
-void GatewayClient::sendConnectRequest() {
-  if (!wsConnected_ || connectSent_) {
+void GatewayClient::prepareConnectAuth() {
+  connectAuth_ = ConnectAuth();
+  if (!identity_.valid) {
     return;
   }
 
-  String identityErr;
-  if (!ensureDeviceIdentity(&identityErr)) {
-    lastError_ = identityErr.isEmpty() ? String("Device identity unavailable") : identityErr;
-    connectSent_ = true;
-    return;
-  }
+  if (!config_.gatewayDeviceToken.isEmpty()) {
+    connectAuth_.token = config_.gatewayDeviceToken;
+    connectAuth_.usedDeviceToken = true;
+    connectAuth_.canFallbackToShared = hasSharedCredential();
+  } else if (config_.gatewayAuthMode == GatewayAuthMode::Password) {
+    connectAuth_.usePassword = true;
+  } else {
+    connectAuth_.token = config_.gatewayToken;
+  }
+
+  String &core = connectAuth_.payloadCore;
+  core.reserve(config_.gatewayDeviceId.length() + 32);
+  core = "|";
+  core += config_.gatewayDeviceId;
+  core += "|";
+  core += OPENCLAW_CLIENT_ID;
+  core += "|";
+  core += OPENCLAW_CLIENT_MODE;
+  core += "|";
+  core += "node";
+  core += "|";
+  core += "";  // scopes csv
+  core += "|";
+  connectAuth_.ready = true;
+}
 
-  uint8_t privateKey[kDevicePrivateKeyLen] = {0};
-  uint8_t publicKey[kDevicePublicKeyLen] = {0};
-  if (!decodeBase64Url(config_.gatewayDevicePrivateKey, privateKey, sizeof(privateKey)) ||
-      !decodeBase64Url(config_.gatewayDevicePublicKey, publicKey, sizeof(publicKey))) {
-    lastError_ = "Device identity decode failed";
-    connectSent_ = true;
+void GatewayClient::sendConnectRequest() {
+  if (!wsConnected_ || connectSent_) {
     return;
   }
 
-  String authToken;
-  bool usePassword = false;
-  connectUsedDeviceToken_ = false;
-  connectCanFallbackToShared_ = false;
-
-  if (!config_.gatewayDeviceToken.isEmpty()) {
-    authToken = config_.gatewayDeviceToken;
-    connectUsedDeviceToken_ = true;
-    connectCanFallbackToShared_ = hasSharedCredential();
-  } else if (config_.gatewayAuthMode == GatewayAuthMode::Password) {
-    usePassword = true;
-  } else {
-    authToken = config_.gatewayToken;
+  if (!identity_.valid) {
+    String identityErr;
+    if (!ensureDeviceIdentity(&identityErr)) {
+      lastError_ = identityErr.isEmpty() ? String("Device identity unavailable") : identityErr;
+      connectSent_ = true;
+      return;
+    }
   }
+  if (!connectAuth_.ready) {
+    prepareConnectAuth();
+  }
+
+  connectUsedDeviceToken_ = connectAuth_.usedDeviceToken;
+  connectCanFallbackToShared_ = connectAuth_.canFallbackToShared;
+  const bool usePassword = connectAuth_.usePassword;
+  const String &authToken = connectAuth_.token;
 
   const uint64_t signedAtMs =
       connectChallengeTsMs_ > 0 ? connectChallengeTsMs_ : currentUnixMs();
-  const String tokenForSignature = usePassword ? String("") : authToken;
-  const String authPayload = buildDeviceAuthPayload(signedAtMs, tokenForSignature);
+  const String authPayload = buildDeviceAuthPayload(signedAtMs);
 
+  const unsigned long signStartUs = micros();
   uint8_t signatureBytes[kDeviceSignatureLen] = {0};
   Ed25519::sign(signatureBytes,
-                privateKey,
-                publicKey,
+                identity_.privateKey,
+                identity_.publicKey,
                 authPayload.c_str(),
                 authPayload.length());
-  const String signatureB64 = encodeBase64Url(signatureBytes, sizeof(signatureBytes));
-  if (signatureB64.isEmpty()) {
+  char signatureB64[kDeviceSignatureB64Len + 1] = {0};
+  if (encodeBase64Url(signatureBytes, sizeof(signatureBytes),
+                      signatureB64, sizeof(signatureB64)) == 0) {
     lastError_ = "Device signature encode failed";
     connectSent_ = true;
     return;
   }
+  linkStats_.lastSignUs = micros() - signStartUs;
 
   DynamicJsonDocument params(4096);
   params["minProtocol"] = OPENCLAW_PROTOCOL_MIN;
@@ -659,16 +1068,9 @@ void GatewayClient::sendConnectRequest() {
   caps.add("cc1101");
 
   JsonArray commands = params.createNestedArray("commands");
-  commands.add("system.which");
-  commands.add("system.run");
-  commands.add("cc1101.info");
-  commands.add("cc1101.set_freq");
-  commands.add("cc1101.tx");
-  commands.add("cc1101.read_rssi");
-  commands.add("cc1101.packet_get");
-  commands.add("cc1101.packet_set");
-  commands.add("cc1101.packet_tx_text");
-  commands.add("cc1101.packet_rx_once");
+  if (commandCatalog_) {
+    commandCatalog_(commands);
+  }
 
   JsonObject auth = params.createNestedObject("auth");
   if (usePassword) {
@@ -693,6 +1095,7 @@ void GatewayClient::sendConnectRequest() {
   }
 
   connectSent_ = true;
+  connectSentAtMs_ = millis();
 }
 
 void GatewayClient::handleGatewayFrame(const char *text, size_t len) {
@@ -792,11 +1195,20 @@ void GatewayClient::handleGatewayFrame(const char *text, size_t len) {
 
 void GatewayClient::handleGatewayResponse(JsonObjectConst frame) {
   const String id = frame["id"].as<String>();
+  const bool ok = frame["ok"] | false;
+
+  if (id.startsWith("req-")) {
+    char *endPtr = nullptr;
+    const unsigned long reqNum = strtoul(id.c_str() + 4, &endPtr, 10);
+    if (endPtr != id.c_str() + 4 && *endPtr == '\0') {
+      requests_.complete(static_cast<uint32_t>(reqNum), ok, frame, millis());
+    }
+  }
+
   if (id != connectRequestId_) {
     return;
   }
 
-  const bool ok = frame["ok"] | false;
   if (!ok) {
     gatewayReady_ = false;
     const String message = String(static_cast<const char *>(frame["error"]["message"] |
@@ -819,6 +1231,7 @@ void GatewayClient::handleGatewayResponse(JsonObjectConst frame) {
   gatewayReady_ = true;
   lastError_ = "";
   lastConnectOkMs_ = millis();
+  recordGatewayReady();
 
   if (frame["payload"].is<JsonObjectConst>()) {
     const JsonObjectConst payload = frame["payload"].as<JsonObjectConst>();
@@ -833,10 +1246,11 @@ void GatewayClient::handleGatewayResponse(JsonObjectConst frame) {
   }
 
   if (telemetryBuilder_) {
-    DynamicJsonDocument payload(1024);
-    JsonObject obj = payload.to<JsonObject>();
-    telemetryBuilder_(obj);
-    sendNodeEvent("cc1101.telemetry", payload);
+    // The gateway may have restarted: start over from a keyframe.
+    telemetry_.invalidate();
+    telemetryInFlight_ = false;
+    telemetryIntervalMs_ = USER_TELEMETRY_MIN_INTERVAL_MS;
+    sampleTelemetry(true);
     lastTelemetryMs_ = millis();
   }
 }
@@ -853,6 +1267,9 @@ void GatewayClient::handleGatewayEvent(JsonObjectConst frame) {
       if (!connectSent_ && !connectNonce_.isEmpty()) {
         // Defer connect request to tick() to avoid deep call stacks inside WS callback.
         connectQueuedAtMs_ = millis();
+        if (wsOpenedAtMs_ > 0) {
+          linkStats_.lastChallengeWaitMs = connectQueuedAtMs_ - wsOpenedAtMs_;
+        }
       }
     }
     return;
@@ -957,6 +1374,14 @@ bool GatewayClient::parseGatewayUrl(const String &rawUrl,
   return true;
 }
 
+bool GatewayClient::sendFrame(const String &body) {
+  if (body.length() >= kMaxGatewaySendFrameBytes) {
+    lastError_ = "Gateway send frame too large";
+    return false;
+  }
+  return ws_.sendTXT(body.c_str(), body.length());
+}
+
 String GatewayClient::nextReqId(const char *prefix) {
   ++reqCounter_;
   String id(prefix);
@@ -1025,6 +1450,9 @@ bool GatewayClient::ensureDeviceIdentity(String *error) {
     persistGatewayConfigBestEffort();
   }
 
+  memcpy(identity_.privateKey, privateKey, sizeof(privateKey));
+  memcpy(identity_.publicKey, publicKey, sizeof(publicKey));
+  identity_.valid = true;
   return true;
 }
 
@@ -1050,25 +1478,44 @@ bool GatewayClient::decodeBase64Url(const String &in, uint8_t *out, size_t outLe
 }
 
 String GatewayClient::encodeBase64Url(const uint8_t *data, size_t len) const {
-  if (!data || len == 0) {
+  char encoded[192] = {0};
+  if (encodeBase64Url(data, len, encoded, sizeof(encoded)) == 0) {
     return "";
   }
+  return String(encoded);
+}
+
+size_t GatewayClient::encodeBase64Url(const uint8_t *data,
+                                      size_t len,
+                                      char *out,
+                                      size_t outSize) const {
+  if (!data || len == 0 || !out || outSize == 0) {
+    return 0;
+  }
 
-  unsigned char encoded[192] = {0};
   size_t encodedLen = 0;
-  const int rc = mbedtls_base64_encode(encoded, sizeof(encoded), &encodedLen, data, len);
-  if (rc != 0 || encodedLen == 0 || encodedLen >= sizeof(encoded)) {
-    return "";
+  const int rc = mbedtls_base64_encode(reinterpret_cast<unsigned char *>(out),
+                                       outSize,
+                                       &encodedLen,
+                                       data,
+                                       len);
+  if (rc != 0 || encodedLen == 0 || encodedLen >= outSize) {
+    out[0] = '\0';
+    return 0;
   }
 
-  encoded[encodedLen] = '\0';
-  String out(reinterpret_cast<const char *>(encoded));
-  out.replace('+', '-');
-  out.replace('/', '_');
-  while (out.endsWith("=")) {
-    out.remove(out.length() - 1);
+  while (encodedLen > 0 && out[encodedLen - 1] == '=') {
+    --encodedLen;
   }
-  return out;
+  out[encodedLen] = '\0';
+  for (size_t i = 0; i < encodedLen; ++i) {
+    if (out[i] == '+') {
+      out[i] = '-';
+    } else if (out[i] == '/') {
+      out[i] = '_';
+    }
+  }
+  return encodedLen;
 }
 
 String GatewayClient::sha256Hex(const uint8_t *data, size_t len) const {
@@ -1092,28 +1539,22 @@ String GatewayClient::sha256Hex(const uint8_t *data, size_t len) const {
   return String(out);
 }
 
-String GatewayClient::buildDeviceAuthPayload(uint64_t signedAtMs,
-                                             const String &tokenForSignature) const {
-  const String version = connectNonce_.isEmpty() ? "v1" : "v2";
+String GatewayClient::buildDeviceAuthPayload(uint64_t signedAtMs) const {
+  const bool withNonce = !connectNonce_.isEmpty();
+  // Password auth signs an empty token; prepareConnectAuth() leaves it empty.
+  const String &token = connectAuth_.token;
+  char signedAt[24] = {0};
+  snprintf(signedAt, sizeof(signedAt), "%llu", static_cast<unsigned long long>(signedAtMs));
 
   String payload;
-  payload.reserve(256 + tokenForSignature.length() + connectNonce_.length());
-  payload += version;
-  payload += "|";
-  payload += config_.gatewayDeviceId;
-  payload += "|";
-  payload += OPENCLAW_CLIENT_ID;
-  payload += "|";
-  payload += OPENCLAW_CLIENT_MODE;
-  payload += "|";
-  payload += "node";
-  payload += "|";
-  payload += "";  // scopes csv
+  payload.reserve(connectAuth_.payloadCore.length() + token.length() +
+                  connectNonce_.length() + 32);
+  payload += withNonce ? "v2" : "v1";
+  payload += connectAuth_.payloadCore;
+  payload += signedAt;
   payload += "|";
-  payload += String(static_cast<unsigned long long>(signedAtMs));
-  payload += "|";
-  payload += tokenForSignature;
-  if (version == "v2") {
+  payload += token;
+  if (withNonce) {
     payload += "|";
     payload += connectNonce_;
   }
@@ -1167,11 +1608,22 @@ bool GatewayClient::captureMessageEvent(const String &eventName, JsonObjectConst
 
   message.from = readMessageString(payload, "from", "sender", "source");
   message.to = readMessageString(payload, "to", "target", "recipient");
-  message.text = readMessageString(payload, "text", "message", "body");
+  // Chat replies can be long and arrive as growing snapshots; their text is
+  // handed to the assembler below without being copied here.
+  if (!isChatEvent) {
+    message.text = readMessageString(payload, "text", "message", "body");
+  }
   message.fileName = readMessageString(payload, "fileName", "name", "file");
   message.contentType = readMessageString(payload, "contentType", "mime", "mimeType");
 
+  // Streaming chat deltas are only logged once the run settles.
+  bool settled = true;
+  bool appendText = false;
+  bool replaceText = false;
   if (isChatEvent) {
+    const String state = readMessageString(payload, "state");
+    settled = state != "delta";
+
     if (message.from.isEmpty()) {
       message.from = "assistant";
     }
@@ -1179,7 +1631,19 @@ bool GatewayClient::captureMessageEvent(const String &eventName, JsonObjectConst
       message.to = readMessageString(payload, "sessionKey");
     }
 
-    if (message.text.isEmpty() && payload["message"].is<JsonObjectConst>()) {
+    // Reply text is read in place from the parsed payload; the assembler
+    // scans and copies only the part of each event it has not seen yet.
+    const char *chatText = "";
+    size_t chatTextLen = 0;
+    for (const char *key : {"text", "message", "body"}) {
+      const char *value = payload[key].as<const char *>();
+      if (value && value[0] != '\0') {
+        chatText = value;
+        chatTextLen = strlen(value);
+        break;
+      }
+    }
+    if (chatTextLen == 0 && payload["message"].is<JsonObjectConst>()) {
       const JsonObjectConst messageObject = payload["message"].as<JsonObjectConst>();
       if (messageObject["content"].is<JsonArrayConst>()) {
         const JsonArrayConst content = messageObject["content"].as<JsonArrayConst>();
@@ -1194,19 +1658,31 @@ bool GatewayClient::captureMessageEvent(const String &eventName, JsonObjectConst
           }
           const char *blockText = block["text"] | "";
           if (blockText && blockText[0] != '\0') {
-            message.text = String(blockText);
+            chatText = blockText;
+            chatTextLen = strlen(blockText);
             break;
           }
         }
       }
     }
 
-    if (!message.text.isEmpty()) {
-      message.text = stripControlChatTags(message.text);
+    const String runId = readMessageString(payload, "runId");
+    if (chatTextLen > 0 && !runId.isEmpty()) {
+      const ChatStreamAssembler::Update update =
+          chatStreams_.feed(runId, chatText, chatTextLen, settled, chatTail_);
+      appendText = update == ChatStreamAssembler::Update::Append;
+      // A restarted stream may begin with nothing visible yet (e.g. only a
+      // control tag); the old text must still go.
+      replaceText = !appendText;
+      message.text = appendText ? String() : chatTail_;
+    } else if (chatTextLen > 0) {
+      message.text = ChatStreamAssembler::strip(chatText, chatTextLen);
+    } else if (settled && !runId.isEmpty()) {
+      chatStreams_.finish(runId, chatTail_);
+      appendText = !chatTail_.isEmpty();
     }
 
-    if (message.text.isEmpty()) {
-      const String state = readMessageString(payload, "state");
+    if (message.text.isEmpty() && !appendText) {
       const String errorMessage = readMessageString(payload, "errorMessage");
       if (!errorMessage.isEmpty()) {
         message.text = "[error] " + errorMessage;
@@ -1272,40 +1748,17 @@ bool GatewayClient::captureMessageEvent(const String &eventName, JsonObjectConst
     return true;
   }
 
-  clampInboxMessage(message);
-  pushInboxMessage(message);
-  return true;
-}
-
-void GatewayClient::pushInboxMessage(const GatewayInboxMessage &message) {
-  if (kInboxCapacity == 0) {
-    return;
-  }
-
-  if (!message.id.isEmpty()) {
-    for (size_t i = 0; i < inboxCount_; ++i) {
-      const size_t existingPos = (inboxStart_ + i) % kInboxCapacity;
-      if (inbox_[existingPos].id == message.id) {
-        GatewayInboxMessage merged = message;
-        if (merged.text.isEmpty() && !inbox_[existingPos].text.isEmpty()) {
-          merged.text = inbox_[existingPos].text;
-        }
-        inbox_[existingPos] = merged;
-        return;
-      }
-    }
-  }
-
-  size_t pos = 0;
-  if (inboxCount_ < kInboxCapacity) {
-    pos = (inboxStart_ + inboxCount_) % kInboxCapacity;
-    ++inboxCount_;
-  } else {
-    pos = inboxStart_;
-    inboxStart_ = (inboxStart_ + 1) % kInboxCapacity;
+  // The store clamps each field to its slot size and merges updates by id;
+  // streamed replies only append their new tail to the slot.
+  MessageView stored;
+  const bool storedOk =
+      appendText ? inbox_.upsertAppend(message, chatTail_.c_str(), chatTail_.length(), &stored)
+                 : inbox_.upsert(message, &stored, replaceText);
+  // A repeated final event for an unchanged message is not handed on again.
+  if (storedOk && settled && messageHandler_ && inbox_.markSettled(stored.id)) {
+    messageHandler_(stored);
   }
-
-  inbox_[pos] = message;
+  return true;
 }
 
 String GatewayClient::readMessageString(JsonObjectConst payload,
@@ -6,7 +6,12 @@
 
 #include <functional>
 
+#include "chat_stream_assembler.h"
+#include "gateway_endpoint_pool.h"
+#include "gateway_request_tracker.h"
+#include "message_store.h"
 #include "runtime_config.h"
+#include "telemetry_encoder.h"
 
 struct GatewayStatus {
   bool shouldConnect = false;
@@ -17,31 +22,59 @@ struct GatewayStatus {
   unsigned long lastConnectOkMs = 0;
 };
 
-struct GatewayInboxMessage {
-  String id;
-  String event;
-  String type;
-  String from;
-  String to;
-  String text;
-  String fileName;
-  String contentType;
-  uint32_t voiceBytes = 0;
-  uint64_t tsMs = 0;
+// Connection-setup timings for the most recent attempt; the heap figures are
+// the internal-heap drop observed across the TCP/TLS/WebSocket handshake.
+struct GatewayLinkStats {
+  uint32_t attempts = 0;
+  uint32_t connects = 0;
+  uint32_t fastReconnects = 0;
+  uint32_t dnsFailures = 0;
+  uint32_t lastDnsMs = 0;
+  uint32_t lastTransportMs = 0;
+  uint32_t lastChallengeWaitMs = 0;
+  uint32_t lastSignUs = 0;
+  uint32_t lastConnectRttMs = 0;
+  uint32_t lastReadyMs = 0;
+  uint32_t bestReadyMs = 0;
+  uint32_t lastHandshakeHeapBytes = 0;
+  uint32_t peakHandshakeHeapBytes = 0;
+  uint32_t lastRttMs = 0;
+  uint32_t failovers = 0;
+  bool resumedFromSleep = false;
+};
+
+struct GatewayTelemetryStats {
+  uint32_t samples = 0;
+  uint32_t frames = 0;
+  uint32_t keyframes = 0;
+  uint32_t bytes = 0;
+  uint32_t intervalMs = 0;
 };
 
 class GatewayClient {
  public:
+  static constexpr unsigned long kDefaultRequestTimeoutMs = 10000UL;
+
   using InvokeRequestHandler = std::function<void(const String &invokeId,
                                                   const String &nodeId,
                                                   const String &command,
                                                   JsonObjectConst params)>;
 
-  using TelemetryBuilder = std::function<void(JsonObject payload)>;
+  // Writes the current value of every telemetry field; called once per sample.
+  using TelemetryBuilder = std::function<void(TelemetryEncoder &telemetry)>;
+
+  // Fills the command names advertised in the connect request.
+  using CommandCatalog = std::function<void(JsonArray commands)>;
+
+  // Called with each settled inbox message (not for streaming chat deltas),
+  // once per distinct content: a repeated final event is not reported again.
+  using MessageHandler = std::function<void(const MessageView &message)>;
 
   void begin();
   void setInvokeRequestHandler(InvokeRequestHandler handler);
   void setTelemetryBuilder(TelemetryBuilder builder);
+  void setMessageHandler(MessageHandler handler);
+  void setCommandCatalog(CommandCatalog catalog);
 
   void configure(const RuntimeConfig &config);
 
@@ -53,6 +86,17 @@ class GatewayClient {
   bool isReady() const;
   String lastError() const;
   GatewayStatus status() const;
+  const GatewayLinkStats &linkStats() const;
+  const GatewayEndpointPool &endpoints() const;
+  size_t activeEndpoint() const;
+  const GatewayTelemetryStats &telemetryStats() const;
+
+  // Sends a gateway request and tracks its response; `handler` runs once with
+  // the outcome (response, error, timeout or disconnect).
+  bool request(const char *method,
+               JsonDocument &paramsDoc,
+               GatewayResponseHandler handler = nullptr,
+               unsigned long timeoutMs = kDefaultRequestTimeoutMs);
 
   bool sendNodeEvent(const char *eventName, JsonDocument &payloadDoc);
   bool sendInvokeOk(const String &invokeId,
@@ -64,10 +108,40 @@ class GatewayClient {
                        const String &message);
 
   size_t inboxCount() const;
-  bool inboxMessage(size_t index, GatewayInboxMessage &out) const;
+  bool inboxMessage(size_t index, MessageView &out) const;
+  const MessageStore &inbox() const;
   void clearInbox();
 
+  size_t latencyMethodCount() const;
+  bool latencySummary(size_t index, GatewayLatencySummary &out) const;
+  size_t pendingRequestCount() const;
+  uint32_t lostRequestCount() const;
+
+  // Inserts a message without notifying the message handler (history replay).
+  void restoreInboxMessage(const GatewayInboxMessage &message);
+
  private:
+  static constexpr size_t kDevicePrivateKeyLen = 32;
+  static constexpr size_t kDevicePublicKeyLen = 32;
+
+  // Binary key material decoded once per key change instead of per connect.
+  struct DeviceIdentity {
+    bool valid = false;
+    uint8_t privateKey[kDevicePrivateKeyLen] = {0};
+    uint8_t publicKey[kDevicePublicKeyLen] = {0};
+  };
+
+  // Nonce-independent part of the connect auth, prepared when the socket is
+  // started so only signing remains once the challenge arrives.
+  struct ConnectAuth {
+    bool ready = false;
+    bool usePassword = false;
+    bool usedDeviceToken = false;
+    bool canFallbackToShared = false;
+    String token;
+    String payloadCore;  // "|<deviceId>|<client>|<mode>|<role>|<scopes>|"
+  };
+
   struct GatewayEndpoint {
     bool valid = false;
     bool secure = false;
@@ -92,10 +166,19 @@ class GatewayClient {
   unsigned long lastConnectAttemptMs_ = 0;
   unsigned long lastConnectOkMs_ = 0;
   unsigned long lastTelemetryMs_ = 0;
+  unsigned long lastKeyframeMs_ = 0;
+  unsigned long telemetryIntervalMs_ = 0;
+  uint32_t telemetrySeq_ = 0;
+  bool telemetryInFlight_ = false;
+  bool telemetryKeyframeDue_ = true;
+  TelemetryEncoder telemetry_;
+  GatewayTelemetryStats telemetryStats_;
   unsigned long connectAttemptStartedMs_ = 0;
 
   InvokeRequestHandler invokeHandler_;
   TelemetryBuilder telemetryBuilder_;
+  MessageHandler messageHandler_;
+  CommandCatalog commandCatalog_;
 
   void onWsEvent(WStype_t type, uint8_t *payload, size_t length);
   void startWebSocket();
@@ -103,7 +186,18 @@ class GatewayClient {
 
   bool sendRequest(const char *method,
                    JsonDocument &paramsDoc,
-                   String *requestIdOut = nullptr);
+                   String *requestIdOut = nullptr,
+                   GatewayResponseHandler handler = nullptr,
+                   unsigned long timeoutMs = kDefaultRequestTimeoutMs);
+  // Every outgoing frame goes through here so the size cap applies to all.
+  bool sendFrame(const String &body);
+  void sampleTelemetry(bool keyframe);
+  void appendKeyframeStats(String &out) const;
+  void appendLinkStats(JsonObject obj) const;
+  void recordTransportOpen();
+  void recordGatewayReady();
+  void probeRtt(unsigned long nowMs);
+  void checkFailover(unsigned long nowMs);
   void sendConnectRequest();
 
   void handleGatewayFrame(const char *text, size_t len);
@@ -114,12 +208,13 @@ class GatewayClient {
   String nextReqId(const char *prefix);
   void persistGatewayConfigBestEffort();
   bool ensureDeviceIdentity(String *error = nullptr);
+  void prepareConnectAuth();
   bool decodeBase64Url(const String &in, uint8_t *out, size_t outLen) const;
   String encodeBase64Url(const uint8_t *data, size_t len) const;
+  size_t encodeBase64Url(const uint8_t *data, size_t len, char *out, size_t outSize) const;
   String sha256Hex(const uint8_t *data, size_t len) const;
-  String buildDeviceAuthPayload(uint64_t signedAtMs, const String &tokenForSignature) const;
+  String buildDeviceAuthPayload(uint64_t signedAtMs) const;
   bool captureMessageEvent(const String &eventName, JsonObjectConst payload);
-  void pushInboxMessage(const GatewayInboxMessage &message);
   String readMessageString(JsonObjectConst payload,
                            const char *key1,
                            const char *key2 = nullptr,
@@ -127,10 +222,12 @@ class GatewayClient {
   bool hasSharedCredential() const;
   uint64_t currentUnixMs() const;
 
-  static constexpr size_t kInboxCapacity = 24;
-  GatewayInboxMessage inbox_[kInboxCapacity];
-  size_t inboxStart_ = 0;
-  size_t inboxCount_ = 0;
+  static constexpr size_t kInboxPsramCapacity = 256;
+  static constexpr size_t kInboxInternalCapacity = 24;
+  MessageStore inbox_{kInboxPsramCapacity, kInboxInternalCapacity};
+  ChatStreamAssembler chatStreams_;
+  String chatTail_;  // reused per event so streaming does not reallocate
+  GatewayRequestTracker requests_;
 
   String connectNonce_;
   uint64_t connectChallengeTsMs_ = 0;
@@ -138,5 +235,23 @@ class GatewayClient {
   bool connectSent_ = false;
   bool connectUsedDeviceToken_ = false;
   bool connectCanFallbackToShared_ = false;
-  uint8_t tlsFailStreak_ = 0;
+  GatewayEndpointPool endpoints_;
+  size_t activeEndpoint_ = 0;
+  unsigned long lastRttProbeMs_ = 0;
+  bool rttProbePending_ = false;
+  uint8_t missedRttProbes_ = 0;
+  bool dnsPending_ = false;  // host lookup running; tick() polls it
+
+  DeviceIdentity identity_;
+  ConnectAuth connectAuth_;
+  unsigned long wsOpenedAtMs_ = 0;
+  unsigned long connectSentAtMs_ = 0;
+
+  GatewayLinkStats linkStats_;
+  bool fastReconnectPending_ = false;
+  bool fastReconnectAttempt_ = false;
+  uint32_t linkHostHash_ = 0;
+  unsigned long linkAttemptStartedMs_ = 0;
+  uint32_t handshakeHeapStart_ = 0;
+  uint32_t handshakeHeapMinBefore_ = 0;
 };
@@ -0,0 +1,180 @@
+#include "gateway_endpoint_pool.h"
+
+namespace {
+
+constexpr uint32_t kUnknownRttMs = 300;
+constexpr uint32_t kUnknownConnectMs = 2000;
+constexpr uint32_t kFailPenaltyMs = 5000;
+// Switch away from a connected endpoint only when it is this slow and the
+// alternative scores at most half as much.
+constexpr uint32_t kDegradedScoreMs = 1000;
+// A timed-out probe counts as this RTT. After smoothing, one timeout leaves a
+// healthy endpoint well under kDegradedScoreMs; only a run of them degrades it.
+constexpr uint32_t kTimeoutRttMs = kDegradedScoreMs * 2U;
+// Inactive endpoints shed one failure from their streak every this many
+// ageInactive() calls (one minute at the 10 s heartbeat).
+constexpr uint8_t kFailStreakDecayTicks = 6;
+
+uint32_t smooth(uint32_t current, uint32_t sample) {
+  if (sample == 0) {
+    sample = 1;
+  }
+  return current == 0 ? sample : (current * 3U + sample) / 4U;
+}
+
+bool isUrlSeparator(char c) {
+  return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+}  // namespace
+
+void GatewayEndpointPool::configure(const String &primary, const String &fallbacks) {
+  GatewayEndpointHealth previous[kMaxEndpoints];
+  const size_t previousCount = count_;
+  for (size_t i = 0; i < previousCount; ++i) {
+    previous[i] = endpoints_[i];
+  }
+
+  count_ = 0;
+  auto add = [&](const String &url) {
+    if (url.isEmpty() || count_ >= kMaxEndpoints) {
+      return;
+    }
+    for (size_t i = 0; i < count_; ++i) {
+      if (endpoints_[i].url == url) {
+        return;
+      }
+    }
+    GatewayEndpointHealth entry;
+    entry.url = url;
+    for (size_t i = 0; i < previousCount; ++i) {
+      if (previous[i].url == url) {
+        entry = previous[i];
+        break;
+      }
+    }
+    endpoints_[count_++] = entry;
+  };
+
+  String trimmed = primary;
+  trimmed.trim();
+  add(trimmed);
+
+  // Fallbacks only make sense behind a primary.
+  if (count_ == 0) {
+    return;
+  }
+  const size_t len = fallbacks.length();
+  size_t start = 0;
+  for (size_t i = 0; i <= len; ++i) {
+    if (i < len && !isUrlSeparator(fallbacks[i])) {
+      continue;
+    }
+    if (i > start) {
+      add(fallbacks.substring(start, i));
+    }
+    start = i + 1;
+  }
+}
+
+size_t GatewayEndpointPool::count() const {
+  return count_;
+}
+
+const GatewayEndpointHealth &GatewayEndpointPool::at(size_t index) const {
+  return endpoints_[index < count_ ? index : 0];
+}
+
+uint32_t GatewayEndpointPool::score(size_t index) const {
+  const GatewayEndpointHealth &e = at(index);
+  const uint32_t rtt = e.rttMs > 0 ? e.rttMs : kUnknownRttMs;
+  const uint32_t connect = e.connectMs > 0 ? e.connectMs : kUnknownConnectMs;
+  return rtt + connect / 4U + e.failStreak * kFailPenaltyMs;
+}
+
+size_t GatewayEndpointPool::select() const {
+  size_t best = 0;
+  for (size_t i = 1; i < count_; ++i) {
+    if (score(i) < score(best)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+int GatewayEndpointPool::switchTarget(size_t current) const {
+  if (count_ < 2 || current >= count_) {
+    return -1;
+  }
+  const uint32_t currentScore = score(current);
+  if (currentScore < kDegradedScoreMs) {
+    return -1;
+  }
+  const size_t best = select();
+  if (best == current || score(best) * 2U > currentScore) {
+    return -1;
+  }
+  return static_cast<int>(best);
+}
+
+void GatewayEndpointPool::recordAttempt(size_t index) {
+  if (index < count_) {
+    ++endpoints_[index].attempts;
+  }
+}
+
+void GatewayEndpointPool::recordReady(size_t index, uint32_t connectMs) {
+  if (index >= count_) {
+    return;
+  }
+  GatewayEndpointHealth &e = endpoints_[index];
+  ++e.connects;
+  e.failStreak = 0;
+  e.connectMs = smooth(e.connectMs, connectMs);
+}
+
+void GatewayEndpointPool::recordFailure(size_t index) {
+  if (index >= count_) {
+    return;
+  }
+  GatewayEndpointHealth &e = endpoints_[index];
+  ++e.failures;
+  if (e.failStreak < 0xFFU) {
+    ++e.failStreak;
+  }
+}
+
+void GatewayEndpointPool::recordRtt(size_t index, uint32_t rttMs) {
+  if (index < count_) {
+    endpoints_[index].rttMs = smooth(endpoints_[index].rttMs, rttMs);
+  }
+}
+
+void GatewayEndpointPool::recordRttTimeout(size_t index) {
+  recordRtt(index, kTimeoutRttMs);
+}
+
+void GatewayEndpointPool::ageInactive(size_t active) {
+  const bool decayStreak = ++agingTicks_ >= kFailStreakDecayTicks;
+  if (decayStreak) {
+    agingTicks_ = 0;
+  }
+  for (size_t i = 0; i < count_; ++i) {
+    if (i == active) {
+      continue;
+    }
+    GatewayEndpointHealth &e = endpoints_[i];
+    if (e.rttMs > kUnknownRttMs) {
+      e.rttMs = smooth(e.rttMs, kUnknownRttMs);
+    }
+    if (decayStreak && e.failStreak > 0) {
+      --e.failStreak;
+    }
+  }
+}
+
+void GatewayEndpointPool::clearFailures() {
+  for (size_t i = 0; i < count_; ++i) {
+    endpoints_[i].failStreak = 0;
+  }
+}
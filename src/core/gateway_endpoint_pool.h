@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct GatewayEndpointHealth {
+  String url;
+  uint32_t attempts = 0;
+  uint32_t connects = 0;
+  uint32_t failures = 0;
+  uint8_t failStreak = 0;
+  uint32_t connectMs = 0;  // smoothed attempt-to-ready time, 0 = unknown
+  uint32_t rttMs = 0;      // smoothed heartbeat round trip, 0 = unknown
+};
+
+// Primary gateway URL plus fallbacks, ranked by observed health. Lower score
+// is better: heartbeat RTT plus a share of the connect time, with a large
+// penalty per consecutive failure so a dead endpoint is skipped while any
+// other is healthier. Ties go to the earlier entry (the primary first).
+class GatewayEndpointPool {
+ public:
+  static constexpr size_t kMaxEndpoints = 4;
+
+  // `fallbacks` is a comma or space separated list. Health is kept for URLs
+  // that were already configured.
+  void configure(const String &primary, const String &fallbacks);
+
+  size_t count() const;
+  const GatewayEndpointHealth &at(size_t index) const;
+  uint32_t score(size_t index) const;
+
+  // Best endpoint for the next connect attempt.
+  size_t select() const;
+  // Endpoint clearly better than the connected `current` one, or -1.
+  int switchTarget(size_t current) const;
+
+  void recordAttempt(size_t index);
+  void recordReady(size_t index, uint32_t connectMs);
+  void recordFailure(size_t index);
+  void recordRtt(size_t index, uint32_t rttMs);
+  // Unanswered heartbeat: a slow sample capped near the degraded threshold,
+  // so one lost probe alone never triggers a failover.
+  void recordRttTimeout(size_t index);
+  void clearFailures();
+  // Called once per heartbeat interval. Health of endpoints other than
+  // `active` is no longer being observed, so their RTT drifts back toward
+  // the unknown default and their failure streak runs down; a recovered
+  // primary can then win the next selection again.
+  void ageInactive(size_t active);
+
+ private:
+  GatewayEndpointHealth endpoints_[kMaxEndpoints];
+  size_t count_ = 0;
+  uint8_t agingTicks_ = 0;
+};
@@ -0,0 +1,225 @@
+#include "gateway_request_tracker.h"
+
+#include <string.h>
+
+namespace {
+
+// Upper bounds (ms) of the latency buckets; the last bucket is open-ended.
+constexpr uint32_t kBucketUpperMs[GatewayRequestTracker::kBucketCount] = {
+    5, 10, 20, 35, 50, 75, 100, 150, 200, 300, 500, 750, 1000, 2000, 5000, 0xFFFFFFFFUL};
+
+}  // namespace
+
+const char *gatewayRequestOutcomeName(GatewayRequestOutcome outcome) {
+  switch (outcome) {
+    case GatewayRequestOutcome::Ok:           return "ok";
+    case GatewayRequestOutcome::Error:        return "error";
+    case GatewayRequestOutcome::Timeout:      return "timeout";
+    case GatewayRequestOutcome::Disconnected: return "disconnected";
+    case GatewayRequestOutcome::Evicted:      return "evicted";
+  }
+  return "unknown";
+}
+
+uint8_t GatewayRequestTracker::methodIndexFor(const char *method) {
+  if (!method || method[0] == '\0') {
+    return 0xFF;
+  }
+  for (size_t i = 0; i < methodCount_; ++i) {
+    if (strncmp(methods_[i].name, method, kMaxMethodNameLen) == 0) {
+      return static_cast<uint8_t>(i);
+    }
+  }
+  if (methodCount_ >= kMaxMethods) {
+    return 0xFF;
+  }
+  MethodStats &stats = methods_[methodCount_];
+  strncpy(stats.name, method, kMaxMethodNameLen);
+  stats.name[kMaxMethodNameLen] = '\0';
+  return static_cast<uint8_t>(methodCount_++);
+}
+
+void GatewayRequestTracker::track(uint32_t reqNum,
+                                  const char *method,
+                                  unsigned long nowMs,
+                                  unsigned long timeoutMs,
+                                  GatewayResponseHandler handler) {
+  Pending *slot = nullptr;
+  Pending *oldest = nullptr;
+  for (size_t i = 0; i < kMaxPending; ++i) {
+    Pending &entry = pending_[i];
+    if (!entry.active) {
+      slot = &entry;
+      break;
+    }
+    if (!oldest || static_cast<long>(entry.sentAtMs - oldest->sentAtMs) < 0) {
+      oldest = &entry;
+    }
+  }
+
+  // Table full: the oldest request is reported as evicted and counted lost.
+  GatewayResponseHandler evicted;
+  if (!slot) {
+    ++lost_;
+    evicted = oldest->handler;
+    slot = oldest;
+  }
+
+  slot->active = true;
+  slot->reqNum = reqNum;
+  slot->methodIndex = methodIndexFor(method);
+  slot->sentAtMs = nowMs;
+  slot->deadlineMs = nowMs + timeoutMs;
+  slot->handler = handler;
+
+  if (evicted) {
+    evicted(GatewayRequestOutcome::Evicted, JsonObjectConst());
+  }
+}
+
+void GatewayRequestTracker::finish(Pending &entry,
+                                   GatewayRequestOutcome outcome,
+                                   JsonObjectConst frame) {
+  // Free the slot before the callback so it may issue new requests.
+  GatewayResponseHandler handler = entry.handler;
+  entry.active = false;
+  entry.handler = nullptr;
+  if (handler) {
+    handler(outcome, frame);
+  }
+}
+
+bool GatewayRequestTracker::complete(uint32_t reqNum,
+                                     bool ok,
+                                     JsonObjectConst frame,
+                                     unsigned long nowMs) {
+  for (size_t i = 0; i < kMaxPending; ++i) {
+    Pending &entry = pending_[i];
+    if (!entry.active || entry.reqNum != reqNum) {
+      continue;
+    }
+    recordLatency(entry.methodIndex, static_cast<uint32_t>(nowMs - entry.sentAtMs), ok);
+    finish(entry, ok ? GatewayRequestOutcome::Ok : GatewayRequestOutcome::Error, frame);
+    return true;
+  }
+  return false;
+}
+
+void GatewayRequestTracker::expire(unsigned long nowMs) {
+  for (size_t i = 0; i < kMaxPending; ++i) {
+    Pending &entry = pending_[i];
+    if (!entry.active || static_cast<long>(nowMs - entry.deadlineMs) < 0) {
+      continue;
+    }
+    ++lost_;
+    recordTimeout(entry.methodIndex);
+    finish(entry, GatewayRequestOutcome::Timeout, JsonObjectConst());
+  }
+}
+
+void GatewayRequestTracker::failAll(GatewayRequestOutcome outcome) {
+  for (size_t i = 0; i < kMaxPending; ++i) {
+    Pending &entry = pending_[i];
+    if (!entry.active) {
+      continue;
+    }
+    ++lost_;
+    finish(entry, outcome, JsonObjectConst());
+  }
+}
+
+void GatewayRequestTracker::recordLatency(uint8_t methodIndex, uint32_t latencyMs, bool ok) {
+  if (methodIndex >= methodCount_) {
+    return;
+  }
+  MethodStats &stats = methods_[methodIndex];
+  size_t bucket = 0;
+  while (bucket + 1 < kBucketCount && latencyMs > kBucketUpperMs[bucket]) {
+    ++bucket;
+  }
+  ++stats.buckets[bucket];
+  ++stats.count;
+  if (!ok) {
+    ++stats.errors;
+  }
+  if (latencyMs > stats.maxMs) {
+    stats.maxMs = latencyMs;
+  }
+}
+
+void GatewayRequestTracker::recordTimeout(uint8_t methodIndex) {
+  if (methodIndex >= methodCount_) {
+    return;
+  }
+  ++methods_[methodIndex].timeouts;
+}
+
+uint32_t GatewayRequestTracker::percentile(const MethodStats &stats, uint8_t pct) const {
+  if (stats.count == 0) {
+    return 0;
+  }
+  const uint32_t rank = (stats.count * pct + 99U) / 100U;
+  uint32_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += stats.buckets[i];
+    if (seen >= rank) {
+      // Report the bucket bound, capped by the worst sample actually seen.
+      return kBucketUpperMs[i] < stats.maxMs ? kBucketUpperMs[i] : stats.maxMs;
+    }
+  }
+  return stats.maxMs;
+}
+
+size_t GatewayRequestTracker::pendingCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < kMaxPending; ++i) {
+    if (pending_[i].active) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint32_t GatewayRequestTracker::lostCount() const {
+  return lost_;
+}
+
+size_t GatewayRequestTracker::methodCount() const {
+  return methodCount_;
+}
+
+bool GatewayRequestTracker::summary(size_t index, GatewayLatencySummary &out) const {
+  if (index >= methodCount_) {
+    return false;
+  }
+  const MethodStats &stats = methods_[index];
+  out.method = stats.name;
+  out.count = stats.count;
+  out.errors = stats.errors;
+  out.timeouts = stats.timeouts;
+  out.p50Ms = percentile(stats, 50);
+  out.p95Ms = percentile(stats, 95);
+  out.p99Ms = percentile(stats, 99);
+  out.maxMs = stats.maxMs;
+  return true;
+}
+
+void GatewayRequestTracker::appendStats(JsonObject obj) const {
+  obj["pending"] = static_cast<uint32_t>(pendingCount());
+  obj["lost"] = lost_;
+  JsonObject methods = obj.createNestedObject("methods");
+  GatewayLatencySummary s;
+  for (size_t i = 0; i < methodCount_; ++i) {
+    if (!summary(i, s)) {
+      continue;
+    }
+    JsonObject m = methods.createNestedObject(s.method);
+    m["n"] = s.count;
+    m["err"] = s.errors;
+    m["timeout"] = s.timeouts;
+    m["p50"] = s.p50Ms;
+    m["p95"] = s.p95Ms;
+    m["p99"] = s.p99Ms;
+    m["max"] = s.maxMs;
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <functional>
+
+enum class GatewayRequestOutcome : uint8_t {
+  Ok = 0,
+  Error = 1,
+  Timeout = 2,
+  Disconnected = 3,
+  Evicted = 4,
+};
+
+// `frame` is the filtered response frame for Ok/Error and null otherwise.
+using GatewayResponseHandler =
+    std::function<void(GatewayRequestOutcome outcome, JsonObjectConst frame)>;
+
+struct GatewayLatencySummary {
+  const char *method = "";
+  uint32_t count = 0;
+  uint32_t errors = 0;
+  uint32_t timeouts = 0;
+  uint32_t p50Ms = 0;
+  uint32_t p95Ms = 0;
+  uint32_t p99Ms = 0;
+  uint32_t maxMs = 0;
+};
+
+const char *gatewayRequestOutcomeName(GatewayRequestOutcome outcome);
+
+// Fixed-capacity table of in-flight gateway requests keyed by the numeric
+// part of the request id, plus per-method latency histograms.
+class GatewayRequestTracker {
+ public:
+  static constexpr size_t kMaxPending = 16;
+  static constexpr size_t kMaxMethods = 8;
+  static constexpr size_t kMaxMethodNameLen = 31;
+  static constexpr size_t kBucketCount = 16;
+
+  void track(uint32_t reqNum,
+             const char *method,
+             unsigned long nowMs,
+             unsigned long timeoutMs,
+             GatewayResponseHandler handler);
+  // Returns false when the id is not pending (late or untracked response).
+  bool complete(uint32_t reqNum, bool ok, JsonObjectConst frame, unsigned long nowMs);
+  void expire(unsigned long nowMs);
+  void failAll(GatewayRequestOutcome outcome);
+
+  size_t pendingCount() const;
+  uint32_t lostCount() const;
+  size_t methodCount() const;
+  bool summary(size_t index, GatewayLatencySummary &out) const;
+  void appendStats(JsonObject obj) const;
+
+ private:
+  struct Pending {
+    bool active = false;
+    uint32_t reqNum = 0;
+    uint8_t methodIndex = 0xFF;
+    unsigned long sentAtMs = 0;
+    unsigned long deadlineMs = 0;
+    GatewayResponseHandler handler;
+  };
+
+  struct MethodStats {
+    char name[kMaxMethodNameLen + 1] = {0};
+    uint32_t buckets[kBucketCount] = {0};
+    uint32_t count = 0;
+    uint32_t errors = 0;
+    uint32_t timeouts = 0;
+    uint32_t maxMs = 0;
+  };
+
+  uint8_t methodIndexFor(const char *method);
+  void recordLatency(uint8_t methodIndex, uint32_t latencyMs, bool ok);
+  void recordTimeout(uint8_t methodIndex);
+  uint32_t percentile(const MethodStats &stats, uint8_t pct) const;
+  void finish(Pending &entry, GatewayRequestOutcome outcome, JsonObjectConst frame);
+
+  Pending pending_[kMaxPending];
+  MethodStats methods_[kMaxMethods];
+  size_t methodCount_ = 0;
+  uint32_t lost_ = 0;
+};
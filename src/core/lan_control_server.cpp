@@ -0,0 +1,206 @@
+#include "lan_control_server.h"
+
+#include <WiFi.h>
+
+#include "node_command_handler.h"
+#include "user_config.h"
+
+namespace {
+
+constexpr size_t kRequestCapacity = 2048;
+constexpr size_t kReplyCapacity = 6144;
+
+// Compares without an early exit so response timing does not leak how much
+// of the token matched.
+bool tokenMatches(const String &expected, const char *given) {
+  if (!given) {
+    return false;
+  }
+  const size_t givenLen = strlen(given);
+  uint8_t diff = expected.length() == givenLen ? 0 : 1;
+  for (size_t i = 0; i < expected.length(); ++i) {
+    const char g = i < givenLen ? given[i] : 0;
+    diff |= static_cast<uint8_t>(expected[i] ^ g);
+  }
+  return diff == 0 && !expected.isEmpty();
+}
+
+}  // namespace
+
+LanControlServer::LanControlServer() : server_(USER_LAN_CONTROL_PORT) {}
+
+void LanControlServer::setCommandHandler(NodeCommandHandler *commands) {
+  commands_ = commands;
+}
+
+void LanControlServer::configure(const RuntimeConfig &config) {
+  const bool tokenChanged = token_ != config.lanControlToken;
+  enabled_ = config.lanControlEnabled && config.lanControlToken.length() >= 8;
+  token_ = config.lanControlToken;
+
+  // A new token must not keep earlier sessions authorized.
+  if (running_ && (!enabled_ || tokenChanged)) {
+    stop();
+  }
+}
+
+void LanControlServer::start() {
+  server_.onEvent([this](uint8_t num, WStype_t type, uint8_t *payload, size_t length) {
+    handleEvent(num, type, payload, length);
+  });
+  server_.begin();
+  server_.enableHeartbeat(15000, 3000, 2);
+  running_ = true;
+  Serial.printf("[lan] control listening on %s:%u\n",
+                WiFi.localIP().toString().c_str(),
+                static_cast<unsigned>(USER_LAN_CONTROL_PORT));
+}
+
+void LanControlServer::stop() {
+  server_.close();
+  for (uint8_t i = 0; i < kMaxClients; ++i) {
+    clients_[i].connected = false;
+    clients_[i].authed = false;
+    ++clients_[i].generation;
+  }
+  running_ = false;
+}
+
+void LanControlServer::tick() {
+  const bool wifiUp = WiFi.status() == WL_CONNECTED;
+  if (!running_) {
+    if (enabled_ && wifiUp && commands_) {
+      start();
+    }
+    return;
+  }
+  if (!wifiUp) {
+    stop();
+    return;
+  }
+  server_.loop();
+}
+
+bool LanControlServer::isRunning() const {
+  return running_;
+}
+
+uint8_t LanControlServer::clientCount() {
+  return running_ ? server_.connectedClients(false) : 0;
+}
+
+const LanControlStats &LanControlServer::stats() const {
+  return stats_;
+}
+
+void LanControlServer::handleEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length) {
+  if (num >= kMaxClients) {
+    return;
+  }
+  Client &client = clients_[num];
+
+  switch (type) {
+    case WStype_CONNECTED:
+      client.connected = true;
+      client.authed = false;
+      ++client.generation;
+      break;
+    case WStype_DISCONNECTED:
+      client.connected = false;
+      client.authed = false;
+      ++client.generation;
+      break;
+    case WStype_TEXT:
+      handleFrame(num, payload, length);
+      break;
+    default:
+      break;
+  }
+}
+
+void LanControlServer::handleAuth(uint8_t num, JsonObjectConst frame) {
+  Client &client = clients_[num];
+  if (!tokenMatches(token_, frame["token"].as<const char *>())) {
+    ++stats_.authFailures;
+    server_.sendTXT(num, "{\"type\":\"auth\",\"ok\":false}");
+    server_.disconnect(num);
+    return;
+  }
+  client.authed = true;
+  server_.sendTXT(num, "{\"type\":\"auth\",\"ok\":true}");
+}
+
+void LanControlServer::handleFrame(uint8_t num, const uint8_t *payload, size_t length) {
+  const unsigned long startedUs = micros();
+  DynamicJsonDocument request(kRequestCapacity);
+  if (deserializeJson(request, payload, length) != DeserializationError::Ok ||
+      !request.is<JsonObject>()) {
+    sendReply(num, clients_[num].generation, "null", nullptr, "INVALID_REQUEST", "invalid JSON");
+    return;
+  }
+
+  JsonObjectConst frame = request.as<JsonObjectConst>();
+  if (frame["type"] == "auth") {
+    handleAuth(num, frame);
+    return;
+  }
+
+  String idJson;
+  serializeJson(frame["id"], idJson);
+  if (!clients_[num].authed) {
+    ++stats_.authFailures;
+    sendReply(num, clients_[num].generation, idJson, nullptr, "UNAUTHORIZED", "auth required");
+    return;
+  }
+
+  const char *command = frame["command"].as<const char *>();
+  if (!command || command[0] == '\0') {
+    sendReply(num, clients_[num].generation, idJson, nullptr, "INVALID_REQUEST", "command required");
+    return;
+  }
+
+  ++stats_.requests;
+  const uint16_t generation = clients_[num].generation;
+  commands_->invokeLocal(String(num) + ":" + idJson,
+                         command,
+                         frame["params"].as<JsonObjectConst>(),
+                         [this, num, generation, idJson](JsonDocument *result,
+                                                         const NodeCommandError &error) {
+                           sendReply(num, generation, idJson, result, error.code, error.message);
+                         });
+
+  const uint32_t elapsedUs = static_cast<uint32_t>(micros() - startedUs);
+  stats_.lastHandleUs = elapsedUs;
+  stats_.totalHandleUs += elapsedUs;
+  if (elapsedUs > stats_.maxHandleUs) {
+    stats_.maxHandleUs = elapsedUs;
+  }
+}
+
+void LanControlServer::sendReply(uint8_t num,
+                                 uint16_t generation,
+                                 const String &idJson,
+                                 JsonDocument *result,
+                                 const char *code,
+                                 const String &message) {
+  // The client may have gone (or its slot been reused) while a job ran.
+  if (!running_ || !clients_[num].connected || clients_[num].generation != generation) {
+    return;
+  }
+
+  DynamicJsonDocument reply(kReplyCapacity);
+  reply["id"] = serialized(idJson);
+  reply["ok"] = result != nullptr;
+  if (result) {
+    reply["result"] = result->as<JsonVariantConst>();
+  } else {
+    ++stats_.errors;
+    JsonObject error = reply.createNestedObject("error");
+    error["code"] = code;
+    error["message"] = message;
+  }
+
+  String text;
+  serializeJson(reply, text);
+  server_.sendTXT(num, text);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsServer.h>
+
+#include "runtime_config.h"
+
+class NodeCommandHandler;
+
+struct LanControlStats {
+  uint32_t requests = 0;
+  uint32_t errors = 0;
+  uint32_t authFailures = 0;
+  uint32_t lastHandleUs = 0;
+  uint32_t maxHandleUs = 0;
+  uint64_t totalHandleUs = 0;
+};
+
+// Optional WebSocket endpoint on the local network that runs node commands
+// directly, without the gateway round trip. Protocol (JSON text frames):
+//   -> {"type":"auth","token":"..."}            <- {"type":"auth","ok":true}
+//   -> {"id":1,"command":"cc1101.info","params":{}}
+//   <- {"id":1,"ok":true,"result":{...}} or {"id":1,"ok":false,"error":{...}}
+// Serviced from tick(); background jobs reply when they finish.
+class LanControlServer {
+ public:
+  LanControlServer();
+
+  void setCommandHandler(NodeCommandHandler *commands);
+  void configure(const RuntimeConfig &config);
+  void tick();
+
+  bool isRunning() const;
+  uint8_t clientCount();
+  const LanControlStats &stats() const;
+
+ private:
+  static constexpr uint8_t kMaxClients = WEBSOCKETS_SERVER_CLIENT_MAX;
+
+  struct Client {
+    bool connected = false;
+    bool authed = false;
+    uint16_t generation = 0;
+  };
+
+  void start();
+  void stop();
+  void handleEvent(uint8_t num, WStype_t type, uint8_t *payload, size_t length);
+  void handleFrame(uint8_t num, const uint8_t *payload, size_t length);
+  void handleAuth(uint8_t num, JsonObjectConst frame);
+  void sendReply(uint8_t num,
+                 uint16_t generation,
+                 const String &idJson,
+                 JsonDocument *result,
+                 const char *code,
+                 const String &message);
+
+  WebSocketsServer server_;
+  NodeCommandHandler *commands_ = nullptr;
+  Client clients_[kMaxClients];
+  LanControlStats stats_;
+  String token_;
+  bool enabled_ = false;
+  bool running_ = false;
+};
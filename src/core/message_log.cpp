@@ -0,0 +1,391 @@
+#include "message_log.h"
+
+#include <SD.h>
+#include <string.h>
+
+#include "sd_storage.h"
+
+namespace {
+
+constexpr const char *kLogDir = "/msglog";
+constexpr unsigned long kUnavailableRetryMs = 30000UL;
+
+constexpr uint16_t kRecordMagic = 0x4C4D;  // "ML"
+constexpr uint8_t kRecordVersion = 1;
+constexpr uint8_t kRecordFlagOutgoing = 0x01;
+constexpr size_t kFieldCount = 8;
+constexpr size_t kRecordHeaderBytes = 4 + 8 + 4 + (kFieldCount * 2);
+constexpr size_t kFieldMaxLen[kFieldCount] = {
+    MessageStore::kMaxIdLen,       // id
+    MessageStore::kMaxMetaLen,     // event
+    MessageStore::kMaxMetaLen,     // type
+    MessageStore::kMaxMetaLen,     // from
+    MessageStore::kMaxMetaLen,     // to
+    MessageStore::kMaxMetaLen,     // contentType
+    MessageStore::kMaxFileNameLen, // fileName
+    MessageStore::kMaxTextLen,     // text
+};
+constexpr size_t kMaxRecordBytes =
+    kRecordHeaderBytes + MessageStore::kMaxIdLen + (MessageStore::kMaxMetaLen * 5) +
+    MessageStore::kMaxFileNameLen + MessageStore::kMaxTextLen;
+constexpr size_t kIndexReadBatch = 32;
+
+// Single-threaded callers (loop task) share one record buffer.
+uint8_t gRecordBuf[kMaxRecordBytes];
+
+String sessionFileStem(const String &sessionKey) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < sessionKey.length(); ++i) {
+    hash ^= static_cast<uint8_t>(sessionKey[i]);
+    hash *= 16777619UL;
+  }
+  char stem[24] = {0};
+  snprintf(stem, sizeof(stem), "%s/%08lx", kLogDir, static_cast<unsigned long>(hash));
+  return String(stem);
+}
+
+void putU16(uint8_t *p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void putU32(uint8_t *p, uint32_t v) {
+  for (size_t i = 0; i < 4; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+void putU64(uint8_t *p, uint64_t v) {
+  for (size_t i = 0; i < 8; ++i) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+uint16_t getU16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t getU32(const uint8_t *p) {
+  uint32_t v = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    v |= static_cast<uint32_t>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+uint64_t getU64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+size_t encodeRecord(const MessageView &message, bool outgoing, uint8_t *out) {
+  const char *fields[kFieldCount] = {message.id,
+                                     message.event,
+                                     message.type,
+                                     message.from,
+                                     message.to,
+                                     message.contentType,
+                                     message.fileName,
+                                     message.text};
+
+  putU16(out, kRecordMagic);
+  out[2] = kRecordVersion;
+  out[3] = outgoing ? kRecordFlagOutgoing : 0;
+  putU64(out + 4, message.tsMs);
+  putU32(out + 12, message.voiceBytes);
+
+  size_t cursor = kRecordHeaderBytes;
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    const char *field = fields[i] ? fields[i] : "";
+    size_t len = strlen(field);
+    if (len > kFieldMaxLen[i]) {
+      len = kFieldMaxLen[i];
+    }
+    putU16(out + 16 + (i * 2), static_cast<uint16_t>(len));
+    memcpy(out + cursor, field, len);
+    cursor += len;
+  }
+  return cursor;
+}
+
+String fieldString(const uint8_t *data, size_t len) {
+  String out;
+  if (len == 0) {
+    return out;
+  }
+  out.reserve(len);
+  out.concat(reinterpret_cast<const char *>(data), len);
+  return out;
+}
+
+bool readRecordAt(File &file, uint32_t offset, MessageLogEntry &out) {
+  if (!file.seek(offset)) {
+    return false;
+  }
+  if (file.read(gRecordBuf, kRecordHeaderBytes) != kRecordHeaderBytes) {
+    return false;
+  }
+  if (getU16(gRecordBuf) != kRecordMagic || gRecordBuf[2] != kRecordVersion) {
+    return false;
+  }
+
+  uint16_t lens[kFieldCount] = {0};
+  size_t bodyLen = 0;
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    lens[i] = getU16(gRecordBuf + 16 + (i * 2));
+    if (lens[i] > kFieldMaxLen[i]) {
+      return false;
+    }
+    bodyLen += lens[i];
+  }
+
+  const bool outgoing = (gRecordBuf[3] & kRecordFlagOutgoing) != 0;
+  const uint64_t tsMs = getU64(gRecordBuf + 4);
+  const uint32_t voiceBytes = getU32(gRecordBuf + 12);
+
+  if (bodyLen > 0 &&
+      file.read(gRecordBuf + kRecordHeaderBytes, bodyLen) != bodyLen) {
+    return false;
+  }
+
+  String *targets[kFieldCount] = {&out.message.id,
+                                  &out.message.event,
+                                  &out.message.type,
+                                  &out.message.from,
+                                  &out.message.to,
+                                  &out.message.contentType,
+                                  &out.message.fileName,
+                                  &out.message.text};
+  const uint8_t *cursor = gRecordBuf + kRecordHeaderBytes;
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    *targets[i] = fieldString(cursor, lens[i]);
+    cursor += lens[i];
+  }
+  out.message.tsMs = tsMs;
+  out.message.voiceBytes = voiceBytes;
+  out.outgoing = outgoing;
+  return true;
+}
+
+}  // namespace
+
+void MessageLog::setSession(const String &sessionKey) {
+  if (sessionKey == sessionKey_ && !recordPath_.isEmpty()) {
+    return;
+  }
+  sessionKey_ = sessionKey;
+  const String stem = sessionFileStem(sessionKey);
+  recordPath_ = stem + ".log";
+  indexPath_ = stem + ".idx";
+  count_ = 0;
+  opened_ = false;
+  retryAfterMs_ = 0;
+}
+
+const String &MessageLog::sessionKey() const {
+  return sessionKey_;
+}
+
+String MessageLog::lastError() const {
+  return lastError_;
+}
+
+bool MessageLog::ensureOpen(String *error) {
+  if (opened_) {
+    return true;
+  }
+  if (recordPath_.isEmpty()) {
+    lastError_ = "Message log session not set";
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+  if (retryAfterMs_ != 0 && static_cast<long>(millis() - retryAfterMs_) < 0) {
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+
+  String mountErr;
+  if (!sdstorage::ensureMounted(&mountErr)) {
+    lastError_ = mountErr;
+    retryAfterMs_ = millis() + kUnavailableRetryMs;
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+
+  if (!SD.exists(kLogDir) && !SD.mkdir(kLogDir)) {
+    lastError_ = "Message log dir create failed";
+    retryAfterMs_ = millis() + kUnavailableRetryMs;
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+
+  count_ = 0;
+  if (SD.exists(indexPath_.c_str())) {
+    File index = SD.open(indexPath_.c_str(), FILE_READ);
+    if (index) {
+      const uint32_t indexSize = static_cast<uint32_t>(index.size());
+      index.close();
+      count_ = static_cast<size_t>(indexSize / 4U);
+      if ((indexSize % 4U) != 0U) {
+        // A torn trailing write left a partial offset: drop it.
+        sdstorage::truncateFile(indexPath_.c_str(), static_cast<uint32_t>(count_ * 4U));
+      }
+    }
+  }
+
+  opened_ = true;
+  retryAfterMs_ = 0;
+  lastError_ = "";
+  return true;
+}
+
+bool MessageLog::append(const MessageView &message, bool outgoing, String *error) {
+  if (!ensureOpen(error)) {
+    return false;
+  }
+
+  const size_t recordLen = encodeRecord(message, outgoing, gRecordBuf);
+
+  File record = SD.open(recordPath_.c_str(), FILE_APPEND);
+  if (!record) {
+    lastError_ = "Message log open failed";
+    opened_ = false;
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+  const uint32_t offset = static_cast<uint32_t>(record.size());
+  const size_t written = record.write(gRecordBuf, recordLen);
+  record.close();
+  if (written != recordLen) {
+    lastError_ = "Message log write failed";
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+
+  // Index entry goes last so a crash never exposes a half-written record.
+  File index = SD.open(indexPath_.c_str(), FILE_APPEND);
+  if (!index) {
+    lastError_ = "Message log index open failed";
+    opened_ = false;
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+  const uint32_t indexSize = static_cast<uint32_t>(index.size());
+  if ((indexSize % 4U) != 0U) {
+    // An earlier write in this session was torn: cut back to the last whole
+    // entry, so no offset is read twice or misaligned.
+    index.close();
+    if (sdstorage::truncateFile(indexPath_.c_str(), indexSize - (indexSize % 4U))) {
+      index = SD.open(indexPath_.c_str(), FILE_APPEND);
+    }
+    if (!index) {
+      lastError_ = "Message log index repair failed";
+      opened_ = false;
+      if (error) {
+        *error = lastError_;
+      }
+      return false;
+    }
+  }
+  uint8_t entry[4] = {0};
+  putU32(entry, offset);
+  const bool indexed = index.write(entry, sizeof(entry)) == sizeof(entry);
+  count_ = static_cast<size_t>(index.size() / 4U);
+  index.close();
+  if (!indexed) {
+    lastError_ = "Message log index write failed";
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+  return true;
+}
+
+size_t MessageLog::count() {
+  if (!ensureOpen(nullptr)) {
+    return 0;
+  }
+  return count_;
+}
+
+size_t MessageLog::readPage(size_t first,
+                            size_t maxCount,
+                            std::vector<MessageLogEntry> &out,
+                            String *error) {
+  out.clear();
+  if (!ensureOpen(error) || first >= count_ || maxCount == 0) {
+    return 0;
+  }
+
+  size_t last = first + maxCount;
+  if (last > count_) {
+    last = count_;
+  }
+
+  File index = SD.open(indexPath_.c_str(), FILE_READ);
+  File record = SD.open(recordPath_.c_str(), FILE_READ);
+  if (!index || !record) {
+    if (index) {
+      index.close();
+    }
+    if (record) {
+      record.close();
+    }
+    lastError_ = "Message log read failed";
+    if (error) {
+      *error = lastError_;
+    }
+    return 0;
+  }
+
+  out.reserve(last - first);
+  uint8_t offsets[kIndexReadBatch * 4];
+  size_t pos = first;
+  while (pos < last) {
+    size_t batch = last - pos;
+    if (batch > kIndexReadBatch) {
+      batch = kIndexReadBatch;
+    }
+    if (!index.seek(static_cast<uint32_t>(pos * 4U)) ||
+        index.read(offsets, batch * 4U) != batch * 4U) {
+      break;
+    }
+    for (size_t i = 0; i < batch; ++i) {
+      MessageLogEntry entry;
+      if (readRecordAt(record, getU32(offsets + (i * 4U)), entry)) {
+        out.push_back(entry);
+      }
+    }
+    pos += batch;
+  }
+
+  index.close();
+  record.close();
+  return out.size();
+}
+
+size_t MessageLog::readRecent(size_t maxCount,
+                              std::vector<MessageLogEntry> &out,
+                              String *error) {
+  const size_t total = count();
+  const size_t first = total > maxCount ? (total - maxCount) : 0;
+  return readPage(first, maxCount, out, error);
+}
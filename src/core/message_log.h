@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "message_store.h"
+
+struct MessageLogEntry {
+  GatewayInboxMessage message;
+  bool outgoing = false;
+};
+
+// Append-only chat history on SD. Each session has a record file
+// (/msglog/<hash>.log) and an index file (/msglog/<hash>.idx) holding one
+// uint32 record offset per entry, so any page of history is one index read
+// plus one read per record. Nothing is kept in RAM besides the entry count.
+class MessageLog {
+ public:
+  // Selects the session; files are opened lazily on first access.
+  void setSession(const String &sessionKey);
+  const String &sessionKey() const;
+
+  bool append(const MessageView &message, bool outgoing, String *error = nullptr);
+
+  size_t count();
+  // Reads up to maxCount entries starting at `first` (0 = oldest).
+  size_t readPage(size_t first,
+                  size_t maxCount,
+                  std::vector<MessageLogEntry> &out,
+                  String *error = nullptr);
+  size_t readRecent(size_t maxCount,
+                    std::vector<MessageLogEntry> &out,
+                    String *error = nullptr);
+
+  String lastError() const;
+
+ private:
+  bool ensureOpen(String *error);
+
+  String sessionKey_;
+  String recordPath_;
+  String indexPath_;
+  size_t count_ = 0;
+  bool opened_ = false;
+  unsigned long retryAfterMs_ = 0;
+  String lastError_;
+};
@@ -0,0 +1,320 @@
+#include "message_store.h"
+
+#include <esp_heap_caps.h>
+#include <string.h>
+
+namespace {
+
+constexpr size_t kMinFallbackCapacity = 4;
+
+constexpr uint32_t kHashSeed = 2166136261UL;
+
+uint32_t hashBytes(uint32_t hash, const void *data, size_t len) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+uint32_t hashId(const char *text, size_t len) {
+  return hashBytes(kHashSeed, text, len);
+}
+
+// Same truncation rule as the old String clamp: keep maxLen chars, ending in
+// "..." when the source had to be cut.
+size_t copyClamped(char *dst, size_t maxLen, const char *src, size_t srcLen) {
+  if (maxLen == 0 || !src) {
+    dst[0] = '\0';
+    return 0;
+  }
+  if (srcLen <= maxLen) {
+    memcpy(dst, src, srcLen);
+    dst[srcLen] = '\0';
+    return srcLen;
+  }
+  if (maxLen <= 3) {
+    memcpy(dst, src, maxLen);
+    dst[maxLen] = '\0';
+    return maxLen;
+  }
+  memcpy(dst, src, maxLen - 3);
+  memcpy(dst + maxLen - 3, "...", 3);
+  dst[maxLen] = '\0';
+  return maxLen;
+}
+
+size_t copyClamped(char *dst, size_t maxLen, const String &src) {
+  return copyClamped(dst, maxLen, src.c_str(), src.length());
+}
+
+void *allocateZeroed(size_t bytes, bool psram) {
+  const uint32_t caps = psram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                              : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  return heap_caps_calloc(1, bytes, caps);
+}
+
+}  // namespace
+
+MessageStore::MessageStore(size_t psramCapacity, size_t internalCapacity)
+    : psramCapacity_(psramCapacity), internalCapacity_(internalCapacity) {}
+
+MessageStore::~MessageStore() {
+  if (slots_) {
+    heap_caps_free(slots_);
+  }
+  if (text_) {
+    heap_caps_free(text_);
+  }
+}
+
+size_t MessageStore::count() const {
+  return count_;
+}
+
+size_t MessageStore::capacity() const {
+  return capacity_;
+}
+
+size_t MessageStore::memoryBytes() const {
+  return capacity_ * bytesPerMessage();
+}
+
+size_t MessageStore::bytesPerMessage() {
+  return sizeof(Slot) + kTextStride;
+}
+
+bool MessageStore::ensureAllocated() {
+  if (slots_) {
+    return true;
+  }
+  if (allocFailed_) {
+    return false;
+  }
+
+  const bool psram = psramFound() && psramCapacity_ > 0;
+  size_t capacity = psram ? psramCapacity_ : internalCapacity_;
+  while (capacity > 0) {
+    slots_ = static_cast<Slot *>(allocateZeroed(capacity * sizeof(Slot), psram));
+    text_ = static_cast<char *>(allocateZeroed(capacity * kTextStride, psram));
+    if (slots_ && text_) {
+      capacity_ = capacity;
+      return true;
+    }
+    if (slots_) {
+      heap_caps_free(slots_);
+      slots_ = nullptr;
+    }
+    if (text_) {
+      heap_caps_free(text_);
+      text_ = nullptr;
+    }
+    if (capacity <= kMinFallbackCapacity) {
+      break;
+    }
+    capacity /= 2;
+  }
+
+  allocFailed_ = true;
+  return false;
+}
+
+size_t MessageStore::slotIndex(size_t index) const {
+  return (start_ + index) % capacity_;
+}
+
+bool MessageStore::at(size_t index, MessageView &out) const {
+  if (index >= count_ || !slots_) {
+    return false;
+  }
+
+  viewAt(slotIndex(index), out);
+  return true;
+}
+
+void MessageStore::viewAt(size_t pos, MessageView &out) const {
+  const Slot &slot = slots_[pos];
+  out.id = slot.id;
+  out.event = slot.event;
+  out.type = slot.type;
+  out.from = slot.from;
+  out.to = slot.to;
+  out.contentType = slot.contentType;
+  out.fileName = slot.fileName;
+  out.text = text_ + (pos * kTextStride);
+  out.voiceBytes = slot.voiceBytes;
+  out.tsMs = slot.tsMs;
+}
+
+int MessageStore::findById(const char *id, uint32_t idHash) const {
+  for (size_t i = 0; i < count_; ++i) {
+    const Slot &slot = slots_[slotIndex(i)];
+    if (slot.idHash == idHash && strcmp(slot.id, id) == 0) {
+      return static_cast<int>(slotIndex(i));
+    }
+  }
+  return -1;
+}
+
+void MessageStore::writeSlot(size_t pos,
+                             const GatewayInboxMessage &message,
+                             bool keepText) {
+  Slot &slot = slots_[pos];
+  const size_t idLen = copyClamped(slot.id, kMaxIdLen, message.id);
+  slot.idHash = hashId(slot.id, idLen);
+  copyClamped(slot.event, kMaxMetaLen, message.event);
+  copyClamped(slot.type, kMaxMetaLen, message.type);
+  copyClamped(slot.from, kMaxMetaLen, message.from);
+  copyClamped(slot.to, kMaxMetaLen, message.to);
+  copyClamped(slot.contentType, kMaxMetaLen, message.contentType);
+  copyClamped(slot.fileName, kMaxFileNameLen, message.fileName);
+  slot.voiceBytes = message.voiceBytes;
+  slot.tsMs = message.tsMs;
+
+  if (keepText && message.text.isEmpty()) {
+    return;
+  }
+  slot.textLen = static_cast<uint16_t>(
+      copyClamped(text_ + (pos * kTextStride), kMaxTextLen, message.text));
+}
+
+// Everything a log record keeps except the id and timestamp. Never 0, so 0
+// can mean "not logged yet".
+uint32_t MessageStore::contentHash(size_t pos) const {
+  const Slot &slot = slots_[pos];
+  const char *fields[] = {slot.event, slot.type, slot.from, slot.to, slot.contentType, slot.fileName};
+  uint32_t hash = kHashSeed;
+  for (const char *field : fields) {
+    // The terminator separates fields, so "ab","c" differs from "a","bc".
+    hash = hashBytes(hash, field, strlen(field) + 1);
+  }
+  hash = hashBytes(hash, &slot.voiceBytes, sizeof(slot.voiceBytes));
+  hash = hashBytes(hash, text_ + (pos * kTextStride), slot.textLen);
+  return hash == 0 ? 1 : hash;
+}
+
+// Appends without rewriting existing text; once the slot is full the text
+// ends in "..." like a clamped copy and further appends are dropped.
+void MessageStore::appendSlotText(size_t pos, const char *text, size_t len) {
+  Slot &slot = slots_[pos];
+  char *dst = text_ + (pos * kTextStride);
+  size_t used = slot.textLen;
+  if (len == 0 || used >= kMaxTextLen) {
+    return;
+  }
+
+  if (used + len <= kMaxTextLen) {
+    memcpy(dst + used, text, len);
+    used += len;
+  } else {
+    const size_t keep = kMaxTextLen - 3;
+    if (used < keep) {
+      memcpy(dst + used, text, keep - used);
+    }
+    memcpy(dst + keep, "...", 3);
+    used = kMaxTextLen;
+  }
+  dst[used] = '\0';
+  slot.textLen = static_cast<uint16_t>(used);
+}
+
+bool MessageStore::append(const GatewayInboxMessage &message, MessageView *stored) {
+  if (!ensureAllocated()) {
+    return false;
+  }
+
+  size_t pos = 0;
+  if (count_ < capacity_) {
+    pos = slotIndex(count_);
+    ++count_;
+  } else {
+    pos = start_;
+    start_ = (start_ + 1) % capacity_;
+  }
+
+  writeSlot(pos, message, false);
+  slots_[pos].loggedHash = 0;
+  if (stored) {
+    viewAt(pos, *stored);
+  }
+  return true;
+}
+
+bool MessageStore::markSettled(const char *id) {
+  if (!slots_ || !id || id[0] == '\0') {
+    return true;
+  }
+  const int pos = findById(id, hashId(id, strlen(id)));
+  if (pos < 0) {
+    return true;
+  }
+  Slot &slot = slots_[pos];
+  const uint32_t hash = contentHash(static_cast<size_t>(pos));
+  if (slot.loggedHash == hash) {
+    return false;
+  }
+  slot.loggedHash = hash;
+  return true;
+}
+
+bool MessageStore::upsert(const GatewayInboxMessage &message,
+                          MessageView *stored,
+                          bool replaceText) {
+  if (!ensureAllocated()) {
+    return false;
+  }
+
+  if (!message.id.isEmpty()) {
+    char id[kMaxIdLen + 1];
+    const size_t idLen = copyClamped(id, kMaxIdLen, message.id);
+    const int existing = findById(id, hashId(id, idLen));
+    if (existing >= 0) {
+      writeSlot(static_cast<size_t>(existing), message, !replaceText);
+      if (stored) {
+        viewAt(static_cast<size_t>(existing), *stored);
+      }
+      return true;
+    }
+  }
+
+  return append(message, stored);
+}
+
+bool MessageStore::upsertAppend(const GatewayInboxMessage &message,
+                                const char *text,
+                                size_t len,
+                                MessageView *stored) {
+  if (!ensureAllocated()) {
+    return false;
+  }
+
+  int existing = -1;
+  if (!message.id.isEmpty()) {
+    char id[kMaxIdLen + 1];
+    const size_t idLen = copyClamped(id, kMaxIdLen, message.id);
+    existing = findById(id, hashId(id, idLen));
+  }
+
+  size_t pos = 0;
+  if (existing >= 0) {
+    pos = static_cast<size_t>(existing);
+    writeSlot(pos, message, true);
+  } else {
+    GatewayInboxMessage meta = message;
+    meta.text = "";
+    append(meta);
+    pos = slotIndex(count_ - 1);
+  }
+
+  appendSlotText(pos, text, len);
+  if (stored) {
+    viewAt(pos, *stored);
+  }
+  return true;
+}
+
+void MessageStore::clear() {
+  start_ = 0;
+  count_ = 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+
+struct GatewayInboxMessage {
+  String id;
+  String event;
+  String type;
+  String from;
+  String to;
+  String text;
+  String fileName;
+  String contentType;
+  uint32_t voiceBytes = 0;
+  uint64_t tsMs = 0;
+};
+
+// Read-only view into a MessageStore slot. Pointers stay valid until the
+// store is next modified (append/upsert/clear).
+struct MessageView {
+  const char *id = "";
+  const char *event = "";
+  const char *type = "";
+  const char *from = "";
+  const char *to = "";
+  const char *text = "";
+  const char *fileName = "";
+  const char *contentType = "";
+  uint32_t voiceBytes = 0;
+  uint64_t tsMs = 0;
+};
+
+// Fixed-slot ring of chat messages. Metadata lives inline in each slot and
+// text lives in one arena with a fixed stride, so memory per message is
+// constant and reads never copy. Storage is allocated on first write, in
+// PSRAM when available, otherwise in internal RAM at a reduced capacity.
+class MessageStore {
+ public:
+  static constexpr size_t kMaxIdLen = 96;
+  static constexpr size_t kMaxMetaLen = 64;
+  static constexpr size_t kMaxTextLen = 768;
+  static constexpr size_t kMaxFileNameLen = 128;
+
+  MessageStore(size_t psramCapacity, size_t internalCapacity);
+  ~MessageStore();
+
+  MessageStore(const MessageStore &) = delete;
+  MessageStore &operator=(const MessageStore &) = delete;
+
+  size_t count() const;
+  size_t capacity() const;
+  size_t memoryBytes() const;
+  static size_t bytesPerMessage();
+
+  // index 0 is the oldest message.
+  bool at(size_t index, MessageView &out) const;
+
+  template <typename Fn>
+  void forEach(Fn &&fn) const {
+    MessageView view;
+    for (size_t i = 0; i < count_; ++i) {
+      if (at(i, view)) {
+        fn(view);
+      }
+    }
+  }
+
+  // `stored`, when given, receives a view of the slot that was written.
+  bool append(const GatewayInboxMessage &message, MessageView *stored = nullptr);
+  // Replaces the slot with the same id or appends a new message. An update
+  // without text keeps the slot's text, unless `replaceText` is set: then the
+  // slot takes `message.text` even when it is empty.
+  bool upsert(const GatewayInboxMessage &message,
+              MessageView *stored = nullptr,
+              bool replaceText = false);
+  // Like upsert, but appends `text` to the slot's text in place (streamed
+  // replies); `message.text` is ignored.
+  bool upsertAppend(const GatewayInboxMessage &message,
+                    const char *text,
+                    size_t len,
+                    MessageView *stored = nullptr);
+  // Call when the message with `id` settles. Returns false when its content
+  // is the same as at its last settle, so repeated final events are not
+  // persisted twice. Messages without an id always return true.
+  bool markSettled(const char *id);
+  void clear();
+
+ private:
+  struct Slot {
+    uint64_t tsMs;
+    uint32_t voiceBytes;
+    uint32_t idHash;
+    uint32_t loggedHash;  // contentHash() at the last markSettled(), 0 = never
+    uint16_t textLen;
+    char id[kMaxIdLen + 1];
+    char event[kMaxMetaLen + 1];
+    char type[kMaxMetaLen + 1];
+    char from[kMaxMetaLen + 1];
+    char to[kMaxMetaLen + 1];
+    char contentType[kMaxMetaLen + 1];
+    char fileName[kMaxFileNameLen + 1];
+  };
+
+  static constexpr size_t kTextStride = kMaxTextLen + 1;
+
+  bool ensureAllocated();
+  size_t slotIndex(size_t index) const;
+  void viewAt(size_t pos, MessageView &out) const;
+  int findById(const char *id, uint32_t idHash) const;
+  uint32_t contentHash(size_t pos) const;
+  void writeSlot(size_t pos, const GatewayInboxMessage &message, bool keepText);
+  void appendSlotText(size_t pos, const char *text, size_t len);
+
+  size_t psramCapacity_ = 0;
+  size_t internalCapacity_ = 0;
+  size_t capacity_ = 0;
+  size_t start_ = 0;
+  size_t count_ = 0;
+  Slot *slots_ = nullptr;
+  char *text_ = nullptr;
+  bool allocFailed_ = false;
+};
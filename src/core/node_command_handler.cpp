@@ -1,10 +1,14 @@
 #include "node_command_handler.h"
 
-#include <limits.h>
+#include <stddef.h>
+#include <string.h>
 #include <WiFi.h>
 
+#include <new>
+
 #include "cc1101_radio.h"
 #include "gateway_client.h"
+#include "sd_benchmark.h"
 
 namespace {
 
@@ -40,140 +44,6 @@ bool parseArgArray(JsonVariantConst value, ArgList &outArgs) {
   return outArgs.count > 0;
 }
 
-bool parseUInt64Token(const String &token, uint64_t &out) {
-  char *endPtr = nullptr;
-  const unsigned long long value = strtoull(token.c_str(), &endPtr, 0);
-  if (endPtr == token.c_str() || *endPtr != '\0') {
-    return false;
-  }
-  out = static_cast<uint64_t>(value);
-  return true;
-}
-
-bool parseIntToken(const String &token, int &out) {
-  char *endPtr = nullptr;
-  const long value = strtol(token.c_str(), &endPtr, 10);
-  if (endPtr == token.c_str() || *endPtr != '\0') {
-    return false;
-  }
-  out = static_cast<int>(value);
-  return true;
-}
-
-bool parseFloatToken(const String &token, float &out) {
-  char *endPtr = nullptr;
-  const float value = strtof(token.c_str(), &endPtr);
-  if (endPtr == token.c_str() || *endPtr != '\0') {
-    return false;
-  }
-  out = value;
-  return true;
-}
-
-bool readFloatFromJson(JsonVariantConst v, float &out) {
-  if (v.is<float>()) {
-    out = v.as<float>();
-    return true;
-  }
-  if (v.is<double>()) {
-    out = static_cast<float>(v.as<double>());
-    return true;
-  }
-  if (v.is<const char *>()) {
-    return parseFloatToken(String(v.as<const char *>()), out);
-  }
-  return false;
-}
-
-bool readIntFromJson(JsonVariantConst v, int &out) {
-  if (v.is<int>()) {
-    out = v.as<int>();
-    return true;
-  }
-  if (v.is<long>()) {
-    out = static_cast<int>(v.as<long>());
-    return true;
-  }
-  if (v.is<unsigned long>()) {
-    const unsigned long value = v.as<unsigned long>();
-    if (value > static_cast<unsigned long>(INT_MAX)) {
-      return false;
-    }
-    out = static_cast<int>(value);
-    return true;
-  }
-  if (v.is<const char *>()) {
-    return parseIntToken(String(v.as<const char *>()), out);
-  }
-  return false;
-}
-
-bool readBoolFromJson(JsonVariantConst v, bool &out) {
-  if (v.is<bool>()) {
-    out = v.as<bool>();
-    return true;
-  }
-  if (v.is<int>()) {
-    out = v.as<int>() != 0;
-    return true;
-  }
-  if (v.is<const char *>()) {
-    String text = String(v.as<const char *>());
-    text.trim();
-    text.toLowerCase();
-    if (text == "1" || text == "true" || text == "yes" || text == "on") {
-      out = true;
-      return true;
-    }
-    if (text == "0" || text == "false" || text == "no" || text == "off") {
-      out = false;
-      return true;
-    }
-  }
-  return false;
-}
-
-bool readUInt32FromJson(JsonVariantConst v, uint32_t &out) {
-  if (v.is<uint32_t>()) {
-    out = v.as<uint32_t>();
-    return true;
-  }
-  if (v.is<int>()) {
-    const int iv = v.as<int>();
-    if (iv < 0) {
-      return false;
-    }
-    out = static_cast<uint32_t>(iv);
-    return true;
-  }
-  if (v.is<const char *>()) {
-    const String text = String(v.as<const char *>());
-    char *endPtr = nullptr;
-    const unsigned long value = strtoul(text.c_str(), &endPtr, 0);
-    if (endPtr == text.c_str() || *endPtr != '\0') {
-      return false;
-    }
-    out = static_cast<uint32_t>(value);
-    return true;
-  }
-  return false;
-}
-
-bool readUInt64FromJson(JsonVariantConst v, uint64_t &out) {
-  if (v.is<uint64_t>()) {
-    out = v.as<uint64_t>();
-    return true;
-  }
-  if (v.is<unsigned long long>()) {
-    out = static_cast<uint64_t>(v.as<unsigned long long>());
-    return true;
-  }
-  if (v.is<const char *>()) {
-    return parseUInt64Token(String(v.as<const char *>()), out);
-  }
-  return false;
-}
-
 void appendPacketConfigPayload(JsonObject obj, const Cc1101PacketConfig &cfg) {
   obj["modulation"] = cfg.modulation;
   obj["channel"] = cfg.channel;
@@ -211,19 +81,6 @@ String bytesToAscii(const std::vector<uint8_t> &bytes) {
   return out;
 }
 
-bool isSupportedBin(const String &bin) {
-  return bin == "system.which" ||
-         bin == "system.run" ||
-         bin == "cc1101.info" ||
-         bin == "cc1101.set_freq" ||
-         bin == "cc1101.tx" ||
-         bin == "cc1101.read_rssi" ||
-         bin == "cc1101.packet_get" ||
-         bin == "cc1101.packet_set" ||
-         bin == "cc1101.packet_tx_text" ||
-         bin == "cc1101.packet_rx_once";
-}
-
 void buildInfoPayload(JsonObject obj) {
   appendCc1101Info(obj);
   obj["wifiConnected"] = WiFi.status() == WL_CONNECTED;
@@ -232,87 +89,417 @@ void buildInfoPayload(JsonObject obj) {
   obj["uptimeMs"] = millis();
 }
 
-}  // namespace
 
-void NodeCommandHandler::setGatewayClient(GatewayClient *gateway) {
-  gateway_ = gateway;
+bool failWith(NodeCommandError &error, const char *code, const String &message) {
+  error.code = code;
+  error.message = message;
+  return false;
 }
 
-void NodeCommandHandler::handleInvoke(const String &invokeId,
-                                      const String &nodeId,
-                                      const String &command,
-                                      JsonObjectConst params) {
-  if (!gateway_) {
-    return;
+bool invalid(NodeCommandError &error, const String &message) {
+  return failWith(error, "INVALID_REQUEST", message);
+}
+
+bool unavailable(NodeCommandError &error, const String &message) {
+  return failWith(error, "UNAVAILABLE", message);
+}
+
+String usageFor(const NodeCommandSpec &spec) {
+  String usage = "usage: ";
+  usage += spec.name;
+  for (uint8_t i = 0; i < spec.paramCount; ++i) {
+    usage += spec.params[i].required ? " <" : " [";
+    usage += spec.params[i].name;
+    usage += spec.params[i].required ? ">" : "]";
   }
+  return usage;
+}
 
-  if (command == "system.which") {
-    if (handleSystemWhich(invokeId, nodeId, params)) {
-      return;
-    }
-    gateway_->sendInvokeError(invokeId,
-                              nodeId,
-                              "INVALID_REQUEST",
-                              "bins array required");
-    return;
+bool cmdCc1101Info(const NodeCommandCall &, JsonObject result, NodeCommandError &) {
+  buildInfoPayload(result);
+  return true;
+}
+
+struct SetFreqParams {
+  float mhz = 0.0f;
+};
+constexpr NodeCommandParam kSetFreqParams[] = {
+    requiredParam("mhz", NodeParamType::Float, offsetof(SetFreqParams, mhz)),
+};
+
+bool cmdCc1101SetFreq(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  SetFreqParams args;
+  if (!decodeNodeParams(call.params, kSetFreqParams, args, error)) {
+    return false;
   }
 
-  if (command == "system.run") {
-    if (handleSystemRun(invokeId, nodeId, params)) {
-      return;
-    }
-    return;
+  setCc1101FrequencyMhz(args.mhz);
+  result["frequencyMhz"] = getCc1101FrequencyMhz();
+  result["applied"] = true;
+  return true;
+}
+
+struct TxParams {
+  uint32_t code = 0;
+  uint32_t bits = 0;
+  uint32_t pulseLength = 0;
+  uint32_t protocol = 0;
+  uint32_t repeat = 0;
+};
+constexpr NodeCommandParam kTxParams[] = {
+    requiredParam("code", NodeParamType::UInt, offsetof(TxParams, code)),
+    requiredParam("bits", NodeParamType::UInt, offsetof(TxParams, bits), 1, 32),
+    optionalParam("pulseLength", NodeParamType::UInt, offsetof(TxParams, pulseLength), 50, 5000, 350),
+    optionalParam("protocol", NodeParamType::UInt, offsetof(TxParams, protocol), 1, 12, 1),
+    optionalParam("repeat", NodeParamType::UInt, offsetof(TxParams, repeat), 1, 50, 10),
+};
+
+bool cmdCc1101Tx(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  TxParams args;
+  if (!decodeNodeParams(call.params, kTxParams, args, error)) {
+    return false;
   }
 
-  if (command.startsWith("cc1101.")) {
-    if (handleCc1101Command(invokeId, nodeId, command, params)) {
-      return;
+  String txErr;
+  if (!transmitCc1101(args.code,
+                      static_cast<int>(args.bits),
+                      static_cast<int>(args.pulseLength),
+                      static_cast<int>(args.protocol),
+                      static_cast<int>(args.repeat),
+                      txErr)) {
+    return unavailable(error, txErr);
+  }
+
+  result["sent"] = true;
+  result["code"] = args.code;
+  result["bits"] = args.bits;
+  result["pulseLength"] = args.pulseLength;
+  result["protocol"] = args.protocol;
+  result["repeat"] = args.repeat;
+  result["frequencyMhz"] = getCc1101FrequencyMhz();
+  return true;
+}
+
+bool cmdCc1101ReadRssi(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  // While an RX job or serial stream holds the radio it is already in RX:
+  // sample the RSSI register instead of switching modes under the receiver.
+  if (call.executor && (call.executor->busyResources() & kNodeResourceRadio)) {
+    int rssi = 0;
+    if (!sampleCc1101RssiDbm(rssi)) {
+      return unavailable(error, "CC1101 not initialized");
     }
-    return;
+    result["rssiDbm"] = rssi;
+    return true;
   }
 
-  gateway_->sendInvokeError(invokeId,
-                            nodeId,
-                            "UNAVAILABLE",
-                            "command not supported");
+  String rssiErr;
+  const int rssi = readCc1101RssiDbm(&rssiErr);
+  if (!rssiErr.isEmpty()) {
+    return unavailable(error, rssiErr);
+  }
+
+  result["rssiDbm"] = rssi;
+  return true;
+}
+
+bool cmdCc1101PacketGet(const NodeCommandCall &, JsonObject result, NodeCommandError &) {
+  appendPacketConfigPayload(result, getCc1101PacketConfig());
+  return true;
+}
+
+// Decodes straight into the current config; omitted fields keep their value.
+constexpr NodeCommandParam kPacketSetParams[] = {
+    optionalParam("modulation", NodeParamType::Byte, offsetof(Cc1101PacketConfig, modulation), 0, 4),
+    optionalParam("channel", NodeParamType::Byte, offsetof(Cc1101PacketConfig, channel), 0, 0),
+    optionalParam("dataRateKbps",
+                  NodeParamType::Float,
+                  offsetof(Cc1101PacketConfig, dataRateKbps),
+                  0.05,
+                  500),
+    optionalParam("deviationKHz",
+                  NodeParamType::Float,
+                  offsetof(Cc1101PacketConfig, deviationKHz),
+                  1,
+                  380),
+    optionalParam("rxBandwidthKHz",
+                  NodeParamType::Float,
+                  offsetof(Cc1101PacketConfig, rxBandwidthKHz),
+                  58,
+                  812),
+    optionalParam("syncMode", NodeParamType::Byte, offsetof(Cc1101PacketConfig, syncMode), 0, 7),
+    optionalParam("packetFormat",
+                  NodeParamType::Byte,
+                  offsetof(Cc1101PacketConfig, packetFormat),
+                  0,
+                  3),
+    optionalParam("crcEnabled", NodeParamType::Bool, offsetof(Cc1101PacketConfig, crcEnabled), 0, 0),
+    optionalParam("lengthConfig",
+                  NodeParamType::Byte,
+                  offsetof(Cc1101PacketConfig, lengthConfig),
+                  0,
+                  3),
+    optionalParam("packetLength",
+                  NodeParamType::Byte,
+                  offsetof(Cc1101PacketConfig, packetLength),
+                  1,
+                  255),
+    optionalParam("whitening", NodeParamType::Bool, offsetof(Cc1101PacketConfig, whitening), 0, 0),
+    optionalParam("manchester", NodeParamType::Bool, offsetof(Cc1101PacketConfig, manchester), 0, 0),
+};
+
+bool cmdCc1101PacketSet(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  Cc1101PacketConfig cfg = getCc1101PacketConfig();
+  if (!decodeNodeParams(call.params, kPacketSetParams, cfg, error)) {
+    return false;
+  }
+
+  String applyErr;
+  if (!configureCc1101Packet(cfg, applyErr)) {
+    return invalid(error, applyErr);
+  }
+
+  result["applied"] = true;
+  appendPacketConfigPayload(result, getCc1101PacketConfig());
+  return true;
+}
+
+struct PacketTxTextParams {
+  const char *text = nullptr;
+  int32_t txDelayMs = 0;
+};
+constexpr NodeCommandParam kPacketTxTextParams[] = {
+    requiredParam("text", NodeParamType::Text, offsetof(PacketTxTextParams, text), 1, 61),
+    optionalParam("txDelayMs",
+                  NodeParamType::Int,
+                  offsetof(PacketTxTextParams, txDelayMs),
+                  0,
+                  0,
+                  25),
+};
+
+bool cmdCc1101PacketTxText(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  PacketTxTextParams args;
+  if (!decodeNodeParams(call.params, kPacketTxTextParams, args, error)) {
+    return false;
+  }
+
+  const String text(args.text);
+  String txErr;
+  if (!sendCc1101PacketText(text, args.txDelayMs, txErr)) {
+    return unavailable(error, txErr);
+  }
+
+  result["sent"] = true;
+  result["bytes"] = text.length();
+  result["txDelayMs"] = args.txDelayMs;
+  return true;
+}
+
+struct PacketRxOnceParams {
+  int32_t timeoutMs = 0;
+};
+constexpr NodeCommandParam kPacketRxOnceParams[] = {
+    optionalParam("timeoutMs",
+                  NodeParamType::Int,
+                  offsetof(PacketRxOnceParams, timeoutMs),
+                  1,
+                  60000,
+                  5000),
+};
+
+bool cmdCc1101PacketRxOnce(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  PacketRxOnceParams args;
+  if (!decodeNodeParams(call.params, kPacketRxOnceParams, args, error)) {
+    return false;
+  }
+
+  std::vector<uint8_t> packet;
+  int rssi = 0;
+  String rxErr;
+  if (!receiveCc1101Packet(packet, args.timeoutMs, &rssi, rxErr)) {
+    return unavailable(error, rxErr);
+  }
+
+  result["size"] = static_cast<uint32_t>(packet.size());
+  result["rssiDbm"] = rssi;
+  result["hex"] = bytesToHex(packet);
+  result["ascii"] = bytesToAscii(packet);
+  return true;
 }
 
-bool NodeCommandHandler::handleSystemWhich(const String &invokeId,
-                                           const String &nodeId,
-                                           JsonObjectConst params) {
-  if (!params["bins"].is<JsonArrayConst>()) {
+// Background form of cc1101.packet_rx_once: the radio stays in RX while the
+// executor polls, so other commands keep running during the wait.
+struct PacketRxJobState {
+  unsigned long startedMs;
+  uint32_t timeoutMs;
+  int rssi;
+  uint8_t len;
+  uint8_t data[61];
+};
+static_assert(sizeof(PacketRxJobState) <= NodeInvokeExecutor::kJobStateBytes,
+              "packet rx job state too large");
+
+bool startPacketRxJob(const NodeCommandCall &call, void *state, NodeCommandError &error) {
+  PacketRxOnceParams args;
+  if (!decodeNodeParams(call.params, kPacketRxOnceParams, args, error)) {
     return false;
   }
 
-  DynamicJsonDocument payload(768);
-  JsonObject binsOut = payload.createNestedObject("bins");
-  JsonArrayConst bins = params["bins"].as<JsonArrayConst>();
+  String rxErr;
+  if (!startCc1101PacketReceive(rxErr)) {
+    return unavailable(error, rxErr);
+  }
+
+  PacketRxJobState *rx = static_cast<PacketRxJobState *>(state);
+  rx->startedMs = millis();
+  rx->timeoutMs = static_cast<uint32_t>(args.timeoutMs);
+  return true;
+}
+
+NodeJobStatus pollPacketRxJob(void *state, NodeCommandError &error) {
+  PacketRxJobState *rx = static_cast<PacketRxJobState *>(state);
+  size_t len = 0;
+  if (pollCc1101PacketReceive(rx->data, sizeof(rx->data), len, &rx->rssi)) {
+    rx->len = static_cast<uint8_t>(len);
+    return NodeJobStatus::Done;
+  }
+  if (millis() - rx->startedMs >= rx->timeoutMs) {
+    unavailable(error, "RX timeout");
+    return NodeJobStatus::Failed;
+  }
+  return NodeJobStatus::Running;
+}
+
+void finishPacketRxJob(const void *state, JsonObject result) {
+  const PacketRxJobState *rx = static_cast<const PacketRxJobState *>(state);
+  const std::vector<uint8_t> packet(rx->data, rx->data + rx->len);
+  result["size"] = static_cast<uint32_t>(packet.size());
+  result["rssiDbm"] = rx->rssi;
+  result["hex"] = bytesToHex(packet);
+  result["ascii"] = bytesToAscii(packet);
+}
+
+void packetRxJobProgress(const void *state, JsonObject progress) {
+  const PacketRxJobState *rx = static_cast<const PacketRxJobState *>(state);
+  progress["timeoutMs"] = rx->timeoutMs;
+  progress["frequencyMhz"] = getCc1101FrequencyMhz();
+}
+
+void cancelPacketRxJob(void *) {
+  stopCc1101PacketReceive();
+}
+
+constexpr NodeCommandJobOps kPacketRxJob = {
+    startPacketRxJob, pollPacketRxJob, finishPacketRxJob, packetRxJobProgress, cancelPacketRxJob};
+
+struct SdBenchParams {
+  uint32_t fileKb = 0;
+};
+constexpr NodeCommandParam kSdBenchParams[] = {
+    optionalParam("fileKb", NodeParamType::UInt, offsetof(SdBenchParams, fileKb), 64, 4096, 512),
+};
+
+// sd.bench runs only as a job (no blocking handler): each poll runs a slice
+// of the benchmark.
+bool startSdBenchJob(const NodeCommandCall &call, void *, NodeCommandError &error) {
+  SdBenchParams args;
+  if (!decodeNodeParams(call.params, kSdBenchParams, args, error)) {
+    return false;
+  }
+  String startErr;
+  if (!sdbench::start(args.fileKb, &startErr)) {
+    return unavailable(error, startErr);
+  }
+  return true;
+}
+
+NodeJobStatus pollSdBenchJob(void *, NodeCommandError &error) {
+  if (sdbench::step(20)) {
+    return NodeJobStatus::Running;
+  }
+  if (sdbench::report().complete) {
+    return NodeJobStatus::Done;
+  }
+  unavailable(error, sdbench::lastError());
+  return NodeJobStatus::Failed;
+}
+
+void finishSdBenchJob(const void *, JsonObject result) {
+  sdbench::reportToJson(sdbench::report(), result);
+}
+
+void sdBenchJobProgress(const void *, JsonObject progress) {
+  progress["percent"] = sdbench::progressPercent();
+  progress["phase"] = sdbench::phaseLabel();
+}
+
+void cancelSdBenchJob(void *) {
+  sdbench::cancel();
+}
+
+constexpr NodeCommandJobOps kSdBenchJob = {
+    startSdBenchJob, pollSdBenchJob, finishSdBenchJob, sdBenchJobProgress, cancelSdBenchJob};
+
+bool cmdSdBenchResult(const NodeCommandCall &, JsonObject result, NodeCommandError &error) {
+  DynamicJsonDocument saved(4096);
+  String loadErr;
+  if (!sdbench::loadSaved(saved, &loadErr)) {
+    return failWith(error, "NOT_FOUND", loadErr.isEmpty() ? String("no saved results") : loadErr);
+  }
+  result["path"] = sdbench::kResultsPath;
+  result["results"] = saved.as<JsonVariantConst>();
+  return true;
+}
 
-  for (JsonVariantConst v : bins) {
+struct CancelParams {
+  const char *invokeId = nullptr;
+};
+constexpr NodeCommandParam kCancelParams[] = {
+    requiredParam("invokeId", NodeParamType::Text, offsetof(CancelParams, invokeId), 1, 128),
+};
+
+bool cmdSystemCancel(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  CancelParams args;
+  if (!decodeNodeParams(call.params, kCancelParams, args, error)) {
+    return false;
+  }
+  if (!call.executor) {
+    return unavailable(error, "no background invokes");
+  }
+  const String invokeId(args.invokeId);
+  if (!call.executor->cancel(invokeId)) {
+    return failWith(error, "NOT_FOUND", "invoke not running");
+  }
+
+  result["invokeId"] = invokeId;
+  result["cancelled"] = true;
+  return true;
+}
+
+bool cmdSystemWhich(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  if (!call.params["bins"].is<JsonArrayConst>()) {
+    return invalid(error, "bins array required");
+  }
+
+  JsonObject binsOut = result.createNestedObject("bins");
+  for (JsonVariantConst v : call.params["bins"].as<JsonArrayConst>()) {
     if (!v.is<const char *>()) {
       continue;
     }
-
-    const String bin = v.as<const char *>();
-    if (isSupportedBin(bin)) {
-      binsOut[bin] = "builtin://t-embed-cc1101";
+    const NodeCommandSpec *spec = call.registry.find(v.as<const char *>());
+    if (spec) {
+      binsOut[spec->name] = "builtin://t-embed-cc1101";
     }
   }
-
-  gateway_->sendInvokeOk(invokeId, nodeId, payload);
   return true;
 }
 
-bool NodeCommandHandler::handleSystemRun(const String &invokeId,
-                                         const String &nodeId,
-                                         JsonObjectConst params) {
+// Runs a registered command from a positional argument array and reports it
+// in shell form (exit code, stdout/stderr) instead of an invoke error.
+bool cmdSystemRun(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
   ArgList args;
-  if (!parseArgArray(params["command"], args)) {
-    gateway_->sendInvokeError(invokeId,
-                              nodeId,
-                              "INVALID_REQUEST",
-                              "command array required");
-    return true;
+  if (!parseArgArray(call.params["command"], args)) {
+    return invalid(error, "command array required");
   }
 
   String stdoutText;
@@ -320,448 +507,524 @@ bool NodeCommandHandler::handleSystemRun(const String &invokeId,
   int exitCode = 0;
   bool success = false;
 
-  DynamicJsonDocument resultPayload(1024);
-  JsonObject result = resultPayload.to<JsonObject>();
-
-  const String cmd = args.values[0];
+  DynamicJsonDocument resultPayload(1536);
+  JsonObject subResult = resultPayload.to<JsonObject>();
 
-  if (cmd == "cc1101.info") {
-    buildInfoPayload(result);
-    serializeJson(resultPayload, stdoutText);
-    success = true;
-  } else if (cmd == "cc1101.set_freq") {
-    if (args.count < 2) {
-      exitCode = 2;
-      stderrText = "usage: cc1101.set_freq <mhz>";
-    } else {
-      float mhz = 0.0f;
-      if (!parseFloatToken(args.values[1], mhz)) {
-        exitCode = 2;
-        stderrText = "invalid frequency";
-      } else {
-        setCc1101FrequencyMhz(mhz);
-        result["frequencyMhz"] = getCc1101FrequencyMhz();
-        result["applied"] = true;
-        serializeJson(resultPayload, stdoutText);
-        success = true;
-      }
-    }
-  } else if (cmd == "cc1101.tx") {
-    if (args.count < 3) {
-      exitCode = 2;
-      stderrText = "usage: cc1101.tx <code> <bits> [pulseLength] [protocol] [repeat]";
-    } else {
-      uint64_t code64 = 0;
-      int bits = 0;
-      int pulseLength = 350;
-      int protocol = 1;
-      int repeat = 10;
-
-      if (!parseUInt64Token(args.values[1], code64) || code64 > 0xFFFFFFFFULL) {
-        exitCode = 2;
-        stderrText = "code must be uint32";
-      } else if (!parseIntToken(args.values[2], bits)) {
-        exitCode = 2;
-        stderrText = "invalid bits";
-      } else if (args.count >= 4 && !parseIntToken(args.values[3], pulseLength)) {
-        exitCode = 2;
-        stderrText = "invalid pulseLength";
-      } else if (args.count >= 5 && !parseIntToken(args.values[4], protocol)) {
-        exitCode = 2;
-        stderrText = "invalid protocol";
-      } else if (args.count >= 6 && !parseIntToken(args.values[5], repeat)) {
-        exitCode = 2;
-        stderrText = "invalid repeat";
-      } else {
-        String txErr;
-        if (!transmitCc1101(static_cast<uint32_t>(code64),
-                            bits,
-                            pulseLength,
-                            protocol,
-                            repeat,
-                            txErr)) {
-          exitCode = 1;
-          stderrText = txErr;
-        } else {
-          result["sent"] = true;
-          result["code"] = static_cast<uint32_t>(code64);
-          result["bits"] = bits;
-          result["pulseLength"] = pulseLength;
-          result["protocol"] = protocol;
-          result["repeat"] = repeat;
-          result["frequencyMhz"] = getCc1101FrequencyMhz();
-          serializeJson(resultPayload, stdoutText);
-          success = true;
-        }
+  const String &cmd = args.values[0];
+  const NodeCommandSpec *spec = cmd.startsWith("system.") ? nullptr
+                                                          : call.registry.find(cmd.c_str());
+  if (!spec) {
+    exitCode = 127;
+    stderrText = "unsupported command: " + cmd;
+  } else {
+    uint8_t required = 0;
+    for (uint8_t i = 0; i < spec->paramCount; ++i) {
+      if (spec->params[i].required) {
+        ++required;
       }
     }
-  } else if (cmd == "cc1101.read_rssi") {
-    String rssiErr;
-    const int rssi = readCc1101RssiDbm(&rssiErr);
-    if (!rssiErr.isEmpty()) {
+
+    if (!spec->handler) {
       exitCode = 1;
-      stderrText = rssiErr;
-    } else {
-      result["rssiDbm"] = rssi;
-      serializeJson(resultPayload, stdoutText);
-      success = true;
-    }
-  } else if (cmd == "cc1101.packet_get") {
-    appendPacketConfigPayload(result, getCc1101PacketConfig());
-    serializeJson(resultPayload, stdoutText);
-    success = true;
-  } else if (cmd == "cc1101.packet_tx_text") {
-    if (args.count < 2) {
+      stderrText = cmd + " runs only as a background invoke";
+    } else if (args.count - 1 < required) {
       exitCode = 2;
-      stderrText = "usage: cc1101.packet_tx_text <text> [txDelayMs]";
+      stderrText = usageFor(*spec);
+    } else if (call.executor && (spec->resources & call.executor->busyResources())) {
+      exitCode = 1;
+      stderrText = "resource in use by a running invoke";
     } else {
-      int txDelayMs = 25;
-      if (args.count >= 3 && !parseIntToken(args.values[2], txDelayMs)) {
-        exitCode = 2;
-        stderrText = "invalid txDelayMs";
-      } else {
-        String txErr;
-        if (!sendCc1101PacketText(args.values[1], txDelayMs, txErr)) {
-          exitCode = 1;
-          stderrText = txErr;
-        } else {
-          result["sent"] = true;
-          result["bytes"] = args.values[1].length();
-          result["txDelayMs"] = txDelayMs;
-          serializeJson(resultPayload, stdoutText);
-          success = true;
-        }
+      DynamicJsonDocument argsDoc(512);
+      JsonObject argsObj = argsDoc.to<JsonObject>();
+      for (size_t i = 1; i < args.count && i - 1 < spec->paramCount; ++i) {
+        argsObj[spec->params[i - 1].name] = args.values[i];
       }
-    }
-  } else if (cmd == "cc1101.packet_rx_once") {
-    int timeoutMs = 5000;
-    if (args.count >= 2 && !parseIntToken(args.values[1], timeoutMs)) {
-      exitCode = 2;
-      stderrText = "invalid timeoutMs";
-    } else {
-      std::vector<uint8_t> packet;
-      int rssi = 0;
-      String rxErr;
-      if (!receiveCc1101Packet(packet, timeoutMs, &rssi, rxErr)) {
-        exitCode = 1;
-        stderrText = rxErr;
-      } else {
-        result["size"] = static_cast<uint32_t>(packet.size());
-        result["rssiDbm"] = rssi;
-        result["hex"] = bytesToHex(packet);
-        result["ascii"] = bytesToAscii(packet);
+
+      NodeCommandError subError;
+      const NodeCommandCall subCall{call.registry, argsObj, call.executor};
+      if (spec->handler(subCall, subResult, subError)) {
         serializeJson(resultPayload, stdoutText);
         success = true;
+      } else {
+        exitCode = strcmp(subError.code, "INVALID_REQUEST") == 0 ? 2 : 1;
+        stderrText = subError.message;
+        resultPayload.clear();
       }
     }
-  } else {
-    exitCode = 127;
-    stderrText = "unsupported command: " + cmd;
   }
 
-  DynamicJsonDocument payload(3072);
-  payload["exitCode"] = exitCode;
-  payload["timedOut"] = false;
-  payload["success"] = success;
-  payload["stdout"] = stdoutText;
-  payload["stderr"] = stderrText;
+  result["exitCode"] = exitCode;
+  result["timedOut"] = false;
+  result["success"] = success;
+  result["stdout"] = stdoutText;
+  result["stderr"] = stderrText;
   if (success) {
-    payload["error"] = nullptr;
+    result["error"] = nullptr;
   } else {
-    payload["error"] = stderrText;
+    result["error"] = stderrText;
   }
-  payload["truncated"] = false;
+  result["truncated"] = false;
   if (resultPayload.size() > 0) {
-    payload["result"] = resultPayload.as<JsonVariantConst>();
+    result["result"] = resultPayload.as<JsonVariantConst>();
   }
-
-  gateway_->sendInvokeOk(invokeId, nodeId, payload);
   return true;
 }
 
-bool NodeCommandHandler::handleCc1101Command(const String &invokeId,
-                                             const String &nodeId,
-                                             const String &command,
-                                             JsonObjectConst params) {
-  DynamicJsonDocument payload(1024);
+// Runs an ordered list of registered commands as one background invoke.
+// Each step is {command, params?, delayMs?, onError?}; onError "continue"
+// keeps going after a failed step, otherwise the batch stops there. The job
+// runs at most one step per executor tick and waits out delays against
+// millis(), so the loop keeps serving the UI and the gateway in between.
+// Commands with a job form (packet RX, SD benchmark) cannot be steps.
+struct BatchStep {
+  const char *command = nullptr;
+  uint32_t delayMs = 0;
+  const char *onError = nullptr;
+};
+constexpr NodeCommandParam kBatchStepParams[] = {
+    requiredParam("command", NodeParamType::Text, offsetof(BatchStep, command), 1, 64),
+    optionalParam("delayMs", NodeParamType::UInt, offsetof(BatchStep, delayMs), 0, 5000, 0),
+    optionalParam("onError", NodeParamType::Text, offsetof(BatchStep, onError), 0, 0),
+    {"params", false},
+};
 
-  if (command == "cc1101.info") {
-    buildInfoPayload(payload.to<JsonObject>());
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+constexpr size_t kMaxBatchSteps = 20;
+constexpr uint32_t kMaxBatchDelayMs = 5000;
+constexpr size_t kBatchPlanCapacity = 3072;
+constexpr size_t kBatchStepResultCapacity = 1024;
+// Step outputs are collected here; the finished payload adds the summary,
+// so kBatchResultCapacity leaves room above it.
+constexpr size_t kBatchStepsCapacity = 4096;
+constexpr size_t kBatchResultCapacity = 6144;
+
+// A batch or step onError value: "stop" or "continue".
+bool decodeOnError(const char *policy, bool &keepGoing) {
+  if (!policy || (strcmp(policy, "stop") != 0 && strcmp(policy, "continue") != 0)) {
+    return false;
   }
+  keepGoing = strcmp(policy, "continue") == 0;
+  return true;
+}
 
-  if (command == "cc1101.set_freq") {
-    float mhz = 0.0f;
-    if (!readFloatFromJson(params["mhz"], mhz)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "mhz is required");
-      return true;
-    }
+// Owned by the job from start until finish or cancel. The steps are copied
+// because the invoke's params document is gone after dispatch.
+struct BatchRun {
+  BatchRun() : plan(kBatchPlanCapacity), stepsOut(kBatchStepsCapacity) {}
+
+  DynamicJsonDocument plan;
+  DynamicJsonDocument stepsOut;
+  const NodeCommandRegistry *registry = nullptr;
+  NodeInvokeExecutor *executor = nullptr;
+  const NodeCommandSpec *specs[kMaxBatchSteps] = {};
+  uint32_t delayMs[kMaxBatchSteps] = {};
+  bool keepGoing[kMaxBatchSteps] = {};
+  size_t count = 0;
+  size_t next = 0;
+  size_t completed = 0;
+  size_t failed = 0;
+  int stoppedAt = -1;
+  bool truncated = false;
+  unsigned long startedMs = 0;
+  unsigned long waitFromMs = 0;  // the next step's delay counts from here
+};
 
-    setCc1101FrequencyMhz(mhz);
-    payload["frequencyMhz"] = getCc1101FrequencyMhz();
-    payload["applied"] = true;
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+struct BatchJobState {
+  BatchRun *run;
+};
+static_assert(sizeof(BatchJobState) <= NodeInvokeExecutor::kJobStateBytes,
+              "batch job state too large");
+
+// Validates the whole batch before anything runs.
+bool planBatch(const NodeCommandCall &call, BatchRun &run, NodeCommandError &error) {
+  if (!call.params["steps"].is<JsonArrayConst>()) {
+    return invalid(error, "steps array required");
+  }
+  JsonArrayConst steps = call.params["steps"].as<JsonArrayConst>();
+  if (steps.size() == 0 || steps.size() > kMaxBatchSteps) {
+    return invalid(error, "steps must hold 1..20 commands");
   }
 
-  if (command == "cc1101.tx") {
-    uint64_t code64 = 0;
-    uint32_t bits = 0;
-    uint32_t pulseLength = 350;
-    uint32_t protocol = 1;
-    uint32_t repeat = 10;
+  bool continueByDefault = false;
+  if (!call.params["onError"].isNull() &&
+      !decodeOnError(call.params["onError"].as<const char *>(), continueByDefault)) {
+    return invalid(error, "onError must be stop or continue");
+  }
 
-    if (!readUInt64FromJson(params["code"], code64) || code64 > 0xFFFFFFFFULL) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "code must be uint32");
-      return true;
+  // Through text, so every string is copied into the plan.
+  String stepsJson;
+  serializeJson(steps, stepsJson);
+  if (deserializeJson(run.plan, stepsJson) != DeserializationError::Ok) {
+    return invalid(error, "steps too large for a batch");
+  }
+
+  uint32_t totalDelayMs = 0;
+  for (JsonVariantConst step : run.plan.as<JsonArrayConst>()) {
+    BatchStep planned;
+    if (!decodeNodeParams(step.as<JsonObjectConst>(), kBatchStepParams, planned, error)) {
+      return false;
     }
-    if (!readUInt32FromJson(params["bits"], bits)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "bits is required");
-      return true;
+    const NodeCommandSpec *spec = call.registry.find(planned.command);
+    if (!spec || !spec->handler || strncmp(planned.command, "system.", 7) == 0) {
+      return invalid(error, String("unsupported batch command: ") + planned.command);
     }
-    if (!params["pulseLength"].isNull() &&
-        !readUInt32FromJson(params["pulseLength"], pulseLength)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "invalid pulseLength");
-      return true;
+    if (spec->job) {
+      return invalid(error, String("runs as a background job, not in a batch: ") +
+                                planned.command);
     }
-    if (!params["protocol"].isNull() &&
-        !readUInt32FromJson(params["protocol"], protocol)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "invalid protocol");
-      return true;
+    bool keepGoing = continueByDefault;
+    if (planned.onError && !decodeOnError(planned.onError, keepGoing)) {
+      return invalid(error, String("onError must be stop or continue: ") + planned.command);
     }
-    if (!params["repeat"].isNull() &&
-        !readUInt32FromJson(params["repeat"], repeat)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "INVALID_REQUEST",
-                                "invalid repeat");
-      return true;
+    if (!step["params"].isNull() && !step["params"].is<JsonObjectConst>()) {
+      return invalid(error, String("params must be an object: ") + planned.command);
     }
-
-    String txErr;
-    if (!transmitCc1101(static_cast<uint32_t>(code64),
-                        static_cast<int>(bits),
-                        static_cast<int>(pulseLength),
-                        static_cast<int>(protocol),
-                        static_cast<int>(repeat),
-                        txErr)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "UNAVAILABLE",
-                                txErr);
-      return true;
+    if (call.executor && (spec->resources & call.executor->busyResources())) {
+      return failWith(error,
+                      "BUSY",
+                      String("resource in use by a running invoke: ") + planned.command);
     }
+    totalDelayMs += planned.delayMs;
+    run.specs[run.count] = spec;
+    run.delayMs[run.count] = planned.delayMs;
+    run.keepGoing[run.count] = keepGoing;
+    ++run.count;
+  }
+  if (totalDelayMs > kMaxBatchDelayMs) {
+    return invalid(error, "total delayMs exceeds 5000");
+  }
+  return true;
+}
 
-    payload["sent"] = true;
-    payload["code"] = static_cast<uint32_t>(code64);
-    payload["bits"] = bits;
-    payload["pulseLength"] = pulseLength;
-    payload["protocol"] = protocol;
-    payload["repeat"] = repeat;
-    payload["frequencyMhz"] = getCc1101FrequencyMhz();
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+bool startBatchJob(const NodeCommandCall &call, void *state, NodeCommandError &error) {
+  BatchRun *run = new (std::nothrow) BatchRun();
+  if (!run || run->plan.capacity() == 0 || run->stepsOut.capacity() == 0) {
+    delete run;
+    return failWith(error, "UNAVAILABLE", "out of memory for batch");
+  }
+  if (!planBatch(call, *run, error)) {
+    delete run;
+    return false;
   }
 
-  if (command == "cc1101.read_rssi") {
-    String rssiErr;
-    const int rssi = readCc1101RssiDbm(&rssiErr);
-    if (!rssiErr.isEmpty()) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "UNAVAILABLE",
-                                rssiErr);
-      return true;
-    }
+  run->registry = &call.registry;
+  run->executor = call.executor;
+  run->stepsOut.to<JsonArray>();
+  run->startedMs = millis();
+  run->waitFromMs = run->startedMs;
+  static_cast<BatchJobState *>(state)->run = run;
+  return true;
+}
 
-    payload["rssiDbm"] = rssi;
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+// Adds one step's output, or marks the batch truncated once the collected
+// outputs no longer fit; later steps still run and are counted.
+void recordBatchStep(BatchRun &run,
+                     const NodeCommandSpec &spec,
+                     bool ok,
+                     const DynamicJsonDocument &stepDoc,
+                     const NodeCommandError &stepError,
+                     uint32_t durationMs) {
+  if (run.truncated) {
+    return;
+  }
+  JsonArray stepsOut = run.stepsOut.as<JsonArray>();
+  JsonObject stepOut = stepsOut.createNestedObject();
+  stepOut["command"] = spec.name;
+  stepOut["ok"] = ok;
+  stepOut["durationMs"] = durationMs;
+  if (ok) {
+    if (stepDoc.overflowed()) {
+      stepOut["resultTruncated"] = true;
+    }
+    stepOut["result"] = stepDoc.as<JsonVariantConst>();
+  } else {
+    JsonObject errOut = stepOut.createNestedObject("error");
+    errOut["code"] = stepError.code;
+    errOut["message"] = stepError.message;
   }
+  if (run.stepsOut.overflowed()) {
+    stepsOut.remove(stepsOut.size() - 1);
+    run.truncated = true;
+  }
+}
 
-  if (command == "cc1101.packet_get") {
-    appendPacketConfigPayload(payload.to<JsonObject>(), getCc1101PacketConfig());
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+NodeJobStatus pollBatchJob(void *state, NodeCommandError &) {
+  BatchRun &run = *static_cast<BatchJobState *>(state)->run;
+  const unsigned long now = millis();
+  if (now - run.waitFromMs < run.delayMs[run.next]) {
+    return NodeJobStatus::Running;
   }
 
-  if (command == "cc1101.packet_set") {
-    Cc1101PacketConfig cfg = getCc1101PacketConfig();
-    uint32_t u32 = 0;
-    float fval = 0.0f;
-    bool bval = false;
+  const size_t index = run.next;
+  const NodeCommandSpec &spec = *run.specs[index];
+  JsonVariantConst step = run.plan.as<JsonArrayConst>()[index];
 
-    if (!params["modulation"].isNull()) {
-      if (!readUInt32FromJson(params["modulation"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid modulation");
-        return true;
-      }
-      cfg.modulation = static_cast<uint8_t>(u32);
-    }
-    if (!params["channel"].isNull()) {
-      if (!readUInt32FromJson(params["channel"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid channel");
-        return true;
-      }
-      cfg.channel = static_cast<uint8_t>(u32);
-    }
-    if (!params["dataRateKbps"].isNull()) {
-      if (!readFloatFromJson(params["dataRateKbps"], fval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid dataRateKbps");
-        return true;
-      }
-      cfg.dataRateKbps = fval;
-    }
-    if (!params["deviationKHz"].isNull()) {
-      if (!readFloatFromJson(params["deviationKHz"], fval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid deviationKHz");
-        return true;
-      }
-      cfg.deviationKHz = fval;
-    }
-    if (!params["rxBandwidthKHz"].isNull()) {
-      if (!readFloatFromJson(params["rxBandwidthKHz"], fval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid rxBandwidthKHz");
-        return true;
-      }
-      cfg.rxBandwidthKHz = fval;
-    }
-    if (!params["syncMode"].isNull()) {
-      if (!readUInt32FromJson(params["syncMode"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid syncMode");
-        return true;
-      }
-      cfg.syncMode = static_cast<uint8_t>(u32);
-    }
-    if (!params["packetFormat"].isNull()) {
-      if (!readUInt32FromJson(params["packetFormat"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid packetFormat");
-        return true;
-      }
-      cfg.packetFormat = static_cast<uint8_t>(u32);
-    }
-    if (!params["crcEnabled"].isNull()) {
-      if (!readBoolFromJson(params["crcEnabled"], bval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid crcEnabled");
-        return true;
-      }
-      cfg.crcEnabled = bval;
-    }
-    if (!params["lengthConfig"].isNull()) {
-      if (!readUInt32FromJson(params["lengthConfig"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid lengthConfig");
-        return true;
-      }
-      cfg.lengthConfig = static_cast<uint8_t>(u32);
-    }
-    if (!params["packetLength"].isNull()) {
-      if (!readUInt32FromJson(params["packetLength"], u32) || u32 > 255) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid packetLength");
-        return true;
-      }
-      cfg.packetLength = static_cast<uint8_t>(u32);
-    }
-    if (!params["whitening"].isNull()) {
-      if (!readBoolFromJson(params["whitening"], bval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid whitening");
-        return true;
-      }
-      cfg.whitening = bval;
+  DynamicJsonDocument stepDoc(kBatchStepResultCapacity);
+  NodeCommandError stepError;
+  bool ok = false;
+  if (run.executor && (spec.resources & run.executor->busyResources())) {
+    stepError.code = "BUSY";
+    stepError.message = "resource in use by a running invoke";
+  } else {
+    const NodeCommandCall stepCall{
+        *run.registry, step["params"].as<JsonObjectConst>(), run.executor};
+    ok = spec.handler(stepCall, stepDoc.to<JsonObject>(), stepError);
+  }
+  recordBatchStep(run, spec, ok, stepDoc, stepError, static_cast<uint32_t>(millis() - now));
+
+  ++run.next;
+  if (ok) {
+    ++run.completed;
+  } else {
+    ++run.failed;
+    if (!run.keepGoing[index]) {
+      run.stoppedAt = static_cast<int>(index);
+      return NodeJobStatus::Done;
     }
-    if (!params["manchester"].isNull()) {
-      if (!readBoolFromJson(params["manchester"], bval)) {
-        gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid manchester");
-        return true;
+  }
+  if (run.next >= run.count) {
+    return NodeJobStatus::Done;
+  }
+  run.waitFromMs = millis();
+  return NodeJobStatus::Running;
+}
+
+void finishBatchJob(const void *state, JsonObject result) {
+  BatchRun *run = static_cast<const BatchJobState *>(state)->run;
+  result["completed"] = static_cast<uint32_t>(run->completed);
+  result["failed"] = static_cast<uint32_t>(run->failed);
+  result["skipped"] = static_cast<uint32_t>(run->count - run->completed - run->failed);
+  if (run->stoppedAt >= 0) {
+    result["stoppedAt"] = run->stoppedAt;
+  } else {
+    result["stoppedAt"] = nullptr;
+  }
+  result["durationMs"] = static_cast<uint32_t>(millis() - run->startedMs);
+  // `steps` then holds the outputs of the first steps only.
+  result["truncated"] = run->truncated;
+  result["steps"] = run->stepsOut.as<JsonArrayConst>();
+  delete run;
+}
+
+void batchJobProgress(const void *state, JsonObject progress) {
+  const BatchRun *run = static_cast<const BatchJobState *>(state)->run;
+  progress["step"] = static_cast<uint32_t>(run->next);
+  progress["steps"] = static_cast<uint32_t>(run->count);
+}
+
+void cancelBatchJob(void *state) {
+  delete static_cast<BatchJobState *>(state)->run;
+}
+
+constexpr NodeCommandJobOps kBatchJob = {startBatchJob,
+                                         pollBatchJob,
+                                         finishBatchJob,
+                                         batchJobProgress,
+                                         cancelBatchJob,
+                                         kBatchResultCapacity};
+
+constexpr NodeCommandParam kWhichParams[] = {{"bins", true}};
+constexpr NodeCommandParam kBatchParams[] = {{"steps", true}, {"onError", false}};
+constexpr NodeCommandParam kRunParams[] = {{"command", true}};
+
+constexpr NodeCommandSpec kBuiltinCommands[] = {
+    makeNodeCommand("system.which", kWhichParams, cmdSystemWhich),
+    makeNodeCommand("system.run", kRunParams, cmdSystemRun),
+    makeNodeCommand("system.cancel", kCancelParams, cmdSystemCancel),
+    makeNodeCommand("system.batch", kBatchParams, nullptr, kNodeResourceNone, &kBatchJob),
+    makeNodeCommand("cc1101.info", cmdCc1101Info),
+    makeNodeCommand("cc1101.set_freq", kSetFreqParams, cmdCc1101SetFreq, kNodeResourceRadio),
+    makeNodeCommand("cc1101.tx", kTxParams, cmdCc1101Tx, kNodeResourceRadio),
+    makeNodeCommand("cc1101.read_rssi", cmdCc1101ReadRssi),
+    makeNodeCommand("cc1101.packet_get", cmdCc1101PacketGet),
+    makeNodeCommand("cc1101.packet_set", kPacketSetParams, cmdCc1101PacketSet, kNodeResourceRadio),
+    makeNodeCommand("cc1101.packet_tx_text",
+                    kPacketTxTextParams,
+                    cmdCc1101PacketTxText,
+                    kNodeResourceRadio),
+    makeNodeCommand("cc1101.packet_rx_once",
+                    kPacketRxOnceParams,
+                    cmdCc1101PacketRxOnce,
+                    kNodeResourceRadio,
+                    &kPacketRxJob),
+    makeNodeCommand("sd.bench", kSdBenchParams, nullptr, kNodeResourceSd, &kSdBenchJob),
+    makeNodeCommand("sd.bench_result", cmdSdBenchResult),
+};
+
+// Catch hash collisions between built-ins at compile time.
+constexpr bool builtinHashesUnique() {
+  for (size_t i = 0; i < sizeof(kBuiltinCommands) / sizeof(kBuiltinCommands[0]); ++i) {
+    for (size_t j = i + 1; j < sizeof(kBuiltinCommands) / sizeof(kBuiltinCommands[0]); ++j) {
+      if (kBuiltinCommands[i].hash == kBuiltinCommands[j].hash) {
+        return false;
       }
-      cfg.manchester = bval;
     }
+  }
+  return true;
+}
+static_assert(builtinHashesUnique(), "built-in node command names collide");
 
-    String applyErr;
-    if (!configureCc1101Packet(cfg, applyErr)) {
-      gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", applyErr);
-      return true;
-    }
+constexpr size_t kInvokeResultCapacity = 6144;
 
-    payload["applied"] = true;
-    appendPacketConfigPayload(payload.as<JsonObject>(), getCc1101PacketConfig());
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+}  // namespace
+
+NodeCommandHandler::NodeCommandHandler() {
+  for (const NodeCommandSpec &spec : kBuiltinCommands) {
+    registry_.add(spec);
   }
+}
 
-  if (command == "cc1101.packet_tx_text") {
-    const String text = params["text"].as<String>();
-    if (text.isEmpty()) {
-      gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "text is required");
-      return true;
-    }
+void NodeCommandHandler::setGatewayClient(GatewayClient *gateway) {
+  gateway_ = gateway;
+  executor_.setGatewayClient(gateway);
+}
 
-    int txDelayMs = 25;
-    if (!params["txDelayMs"].isNull() && !readIntFromJson(params["txDelayMs"], txDelayMs)) {
-      gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid txDelayMs");
-      return true;
-    }
+bool NodeCommandHandler::registerCommand(const NodeCommandSpec &spec) {
+  return registry_.add(spec);
+}
 
-    String txErr;
-    if (!sendCc1101PacketText(text, txDelayMs, txErr)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "UNAVAILABLE",
-                                txErr);
-      return true;
-    }
+const NodeCommandRegistry &NodeCommandHandler::registry() const {
+  return registry_;
+}
 
-    payload["sent"] = true;
-    payload["bytes"] = text.length();
-    payload["txDelayMs"] = txDelayMs;
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+void NodeCommandHandler::appendCommandNames(JsonArray out) const {
+  for (size_t i = 0; i < registry_.count(); ++i) {
+    out.add(registry_.at(i)->name);
   }
+}
 
-  if (command == "cc1101.packet_rx_once") {
-    int timeoutMs = 5000;
-    if (!params["timeoutMs"].isNull() && !readIntFromJson(params["timeoutMs"], timeoutMs)) {
-      gateway_->sendInvokeError(invokeId, nodeId, "INVALID_REQUEST", "invalid timeoutMs");
-      return true;
-    }
+void NodeCommandHandler::handleInvoke(const String &invokeId,
+                                      const String &nodeId,
+                                      const String &command,
+                                      JsonObjectConst params) {
+  if (!gateway_) {
+    return;
+  }
 
-    std::vector<uint8_t> packet;
-    int rssi = 0;
-    String rxErr;
-    if (!receiveCc1101Packet(packet, timeoutMs, &rssi, rxErr)) {
-      gateway_->sendInvokeError(invokeId,
-                                nodeId,
-                                "UNAVAILABLE",
-                                rxErr);
-      return true;
+  const NodeCommandSpec *spec = registry_.find(command.c_str());
+  if (!spec) {
+    gateway_->sendInvokeError(invokeId,
+                              nodeId,
+                              "UNAVAILABLE",
+                              "command not supported");
+    return;
+  }
+
+  // A retried invoke is answered from its first run, never executed twice.
+  const NodeInvokeCache::Entry *cached = cache_.find(invokeId, millis());
+  if (cached) {
+    replayCached(*cached, nodeId);
+    return;
+  }
+
+  const NodeInvokeReply reply = [this, invokeId, nodeId](JsonDocument *payload,
+                                                         const NodeCommandError &error) {
+    if (payload) {
+      cache_.storeOk(invokeId, *payload, millis());
+      gateway_->sendInvokeOk(invokeId, nodeId, *payload);
+    } else {
+      cache_.storeError(invokeId, error.code, error.message, millis());
+      gateway_->sendInvokeError(invokeId, nodeId, error.code, error.message);
     }
+  };
 
-    payload["size"] = static_cast<uint32_t>(packet.size());
-    payload["rssiDbm"] = rssi;
-    payload["hex"] = bytesToHex(packet);
-    payload["ascii"] = bytesToAscii(packet);
-    gateway_->sendInvokeOk(invokeId, nodeId, payload);
-    return true;
+  NodeCommandError refusal;
+  if (!dispatch(*spec, invokeId, nodeId, params, reply, refusal)) {
+    gateway_->sendInvokeError(invokeId, nodeId, refusal.code, refusal.message);
+    return;
+  }
+  if (executor_.isRunning(invokeId)) {
+    cache_.markRunning(invokeId, millis());
+  }
+}
+
+void NodeCommandHandler::invokeLocal(const String &requestId,
+                                     const String &command,
+                                     JsonObjectConst params,
+                                     NodeInvokeReply reply) {
+  NodeCommandError error;
+  const NodeCommandSpec *spec = registry_.find(command.c_str());
+  if (!spec) {
+    error.code = "UNAVAILABLE";
+    error.message = "command not supported";
+    reply(nullptr, error);
+    return;
+  }
+
+  // Local ids get their own namespace so they never match a gateway invoke.
+  if (!dispatch(*spec, "local:" + requestId, "", params, reply, error)) {
+    reply(nullptr, error);
+  }
+}
+
+bool NodeCommandHandler::dispatch(const NodeCommandSpec &spec,
+                                  const String &invokeId,
+                                  const String &nodeId,
+                                  JsonObjectConst params,
+                                  const NodeInvokeReply &reply,
+                                  NodeCommandError &refusal) {
+  const NodeCommandCall call{registry_, params, &executor_};
+  if (spec.resources & executor_.busyResources()) {
+    refusal.code = "BUSY";
+    refusal.message = "resource in use by a running invoke";
+    return false;
   }
+  if (spec.job) {
+    return executor_.start(spec, invokeId, nodeId, call, reply, refusal);
+  }
+
+  DynamicJsonDocument payload(kInvokeResultCapacity);
+  NodeCommandError error;
+  if (spec.handler(call, payload.to<JsonObject>(), error)) {
+    reply(&payload, error);
+  } else {
+    reply(nullptr, error);
+  }
+  return true;
+}
 
-  gateway_->sendInvokeError(invokeId,
+void NodeCommandHandler::replayCached(const NodeInvokeCache::Entry &entry, const String &nodeId) {
+  switch (entry.state) {
+    case NodeInvokeCache::State::Running:
+      // The job still owns this invoke and sends its result when done.
+      return;
+    case NodeInvokeCache::State::Ok: {
+      DynamicJsonDocument payload(kInvokeResultCapacity);
+      if (deserializeJson(payload, entry.payload) == DeserializationError::Ok) {
+        gateway_->sendInvokeOk(entry.invokeId, nodeId, payload);
+        return;
+      }
+      break;
+    }
+    case NodeInvokeCache::State::Error:
+      gateway_->sendInvokeError(entry.invokeId, nodeId, entry.code, entry.payload);
+      return;
+    case NodeInvokeCache::State::Oversize:
+    case NodeInvokeCache::State::Empty:
+    default:
+      break;
+  }
+  gateway_->sendInvokeError(entry.invokeId,
                             nodeId,
                             "UNAVAILABLE",
-                            "unsupported cc1101 command");
-  return true;
+                            "duplicate invoke; result not retained");
+}
+
+bool NodeCommandHandler::acquireResources(uint8_t mask) {
+  return executor_.acquireResources(mask);
+}
+
+void NodeCommandHandler::releaseResources(uint8_t mask) {
+  executor_.releaseResources(mask);
+}
+
+void NodeCommandHandler::tick() {
+  executor_.tick();
+}
+
+size_t NodeCommandHandler::runningInvokeCount() const {
+  return executor_.activeCount();
+}
+
+uint32_t NodeCommandHandler::duplicateInvokeCount() const {
+  return cache_.hitCount();
 }
@@ -3,30 +3,59 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
+#include "node_command_registry.h"
+#include "node_invoke_cache.h"
+#include "node_invoke_executor.h"
+
 class GatewayClient;
 
 class NodeCommandHandler {
  public:
+  NodeCommandHandler();
+
   void setGatewayClient(GatewayClient *gateway);
 
+  // Adds a command at startup; `spec` must have static storage duration.
+  bool registerCommand(const NodeCommandSpec &spec);
+  const NodeCommandRegistry &registry() const;
+  void appendCommandNames(JsonArray out) const;
+
   void handleInvoke(const String &invokeId,
                     const String &nodeId,
                     const String &command,
                     JsonObjectConst params);
 
- private:
-  GatewayClient *gateway_ = nullptr;
+  // Runs `command` for a local client (LAN control) through the same
+  // registry and job executor as gateway invokes. `reply` is called exactly
+  // once, immediately or later from tick() for background jobs.
+  void invokeLocal(const String &requestId,
+                   const String &command,
+                   JsonObjectConst params,
+                   NodeInvokeReply reply);
+
+  // Exclusive use of hardware outside of invokes; see NodeInvokeExecutor.
+  bool acquireResources(uint8_t mask);
+  void releaseResources(uint8_t mask);
 
-  bool handleSystemWhich(const String &invokeId,
-                         const String &nodeId,
-                         JsonObjectConst params);
+  // Advances background invokes; call from the main loop.
+  void tick();
+  size_t runningInvokeCount() const;
+  uint32_t duplicateInvokeCount() const;
 
-  bool handleSystemRun(const String &invokeId,
-                       const String &nodeId,
-                       JsonObjectConst params);
+ private:
+  // Runs `spec` now or starts it as a job. Returns false with `refusal`
+  // filled when it was not run at all; otherwise `reply` has been or will
+  // be called.
+  bool dispatch(const NodeCommandSpec &spec,
+                const String &invokeId,
+                const String &nodeId,
+                JsonObjectConst params,
+                const NodeInvokeReply &reply,
+                NodeCommandError &refusal);
+  void replayCached(const NodeInvokeCache::Entry &entry, const String &nodeId);
 
-  bool handleCc1101Command(const String &invokeId,
-                           const String &nodeId,
-                           const String &command,
-                           JsonObjectConst params);
+  GatewayClient *gateway_ = nullptr;
+  NodeCommandRegistry registry_;
+  NodeInvokeExecutor executor_;
+  NodeInvokeCache cache_;
 };
@@ -0,0 +1,43 @@
+#include "node_command_registry.h"
+
+#include <string.h>
+
+bool NodeCommandRegistry::add(const NodeCommandSpec &spec) {
+  if (!spec.name || (!spec.handler && !spec.job) || count_ >= kMaxCommands || find(spec.name)) {
+    return false;
+  }
+
+  size_t slot = spec.hash & (kTableSize - 1);
+  while (table_[slot] != 0) {
+    slot = (slot + 1) & (kTableSize - 1);
+  }
+  commands_[count_] = &spec;
+  table_[slot] = static_cast<uint8_t>(count_ + 1);
+  ++count_;
+  return true;
+}
+
+const NodeCommandSpec *NodeCommandRegistry::find(const char *name) const {
+  if (!name || name[0] == '\0') {
+    return nullptr;
+  }
+
+  const uint32_t hash = nodeCommandHash(name);
+  size_t slot = hash & (kTableSize - 1);
+  while (table_[slot] != 0) {
+    const NodeCommandSpec *spec = commands_[table_[slot] - 1];
+    if (spec->hash == hash && strcmp(spec->name, name) == 0) {
+      return spec;
+    }
+    slot = (slot + 1) & (kTableSize - 1);
+  }
+  return nullptr;
+}
+
+size_t NodeCommandRegistry::count() const {
+  return count_;
+}
+
+const NodeCommandSpec *NodeCommandRegistry::at(size_t index) const {
+  return index < count_ ? commands_[index] : nullptr;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "node_param_schema.h"
+
+// FNV-1a; usable at compile time for command specs and at runtime for lookup.
+constexpr uint32_t nodeCommandHash(const char *name) {
+  uint32_t hash = 2166136261UL;
+  while (*name) {
+    hash = (hash ^ static_cast<uint8_t>(*name++)) * 16777619UL;
+  }
+  return hash;
+}
+
+class NodeCommandRegistry;
+class NodeInvokeExecutor;
+
+struct NodeCommandError {
+  const char *code = "INVALID_REQUEST";
+  String message;
+};
+
+struct NodeCommandCall {
+  const NodeCommandRegistry &registry;
+  JsonObjectConst params;
+  NodeInvokeExecutor *executor = nullptr;
+};
+
+// Fills `result` and returns true, or fills `error` and returns false.
+using NodeCommandFn = bool (*)(const NodeCommandCall &call,
+                               JsonObject result,
+                               NodeCommandError &error);
+
+// Hardware a command needs exclusively; a command is refused with BUSY while
+// a running job holds any of its resources.
+enum NodeCommandResource : uint8_t {
+  kNodeResourceNone = 0,
+  kNodeResourceRadio = 1 << 0,
+  kNodeResourceSd = 1 << 1,
+};
+
+enum class NodeJobStatus : uint8_t {
+  Running = 0,
+  Done = 1,
+  Failed = 2,
+};
+
+// Cooperative long-running command. `start` validates params and sets up
+// `state` (NodeInvokeExecutor::kJobStateBytes of scratch); `poll` runs from
+// the background tick and must not block.
+struct NodeCommandJobOps {
+  bool (*start)(const NodeCommandCall &call, void *state, NodeCommandError &error);
+  NodeJobStatus (*poll)(void *state, NodeCommandError &error);
+  void (*finish)(const void *state, JsonObject result);
+  void (*progress)(const void *state, JsonObject progress);  // optional
+  void (*cancel)(void *state);                               // optional
+  size_t resultCapacity = 0;  // finish() document; 0 = executor default
+};
+
+// `handler` always runs the command to completion; invokes of commands with
+// `job` ops run as background jobs instead (system.run keeps the handler).
+// Job-only commands have no handler and are refused by system.run.
+struct NodeCommandSpec {
+  const char *name;
+  uint32_t hash;
+  const NodeCommandParam *params;
+  uint8_t paramCount;
+  NodeCommandFn handler;
+  uint8_t resources;
+  const NodeCommandJobOps *job;
+};
+
+template <size_t N>
+constexpr NodeCommandSpec makeNodeCommand(const char *name,
+                                          const NodeCommandParam (&params)[N],
+                                          NodeCommandFn handler,
+                                          uint8_t resources = kNodeResourceNone,
+                                          const NodeCommandJobOps *job = nullptr) {
+  return NodeCommandSpec{
+      name, nodeCommandHash(name), params, static_cast<uint8_t>(N), handler, resources, job};
+}
+
+constexpr NodeCommandSpec makeNodeCommand(const char *name,
+                                          NodeCommandFn handler,
+                                          uint8_t resources = kNodeResourceNone) {
+  return NodeCommandSpec{name, nodeCommandHash(name), nullptr, 0, handler, resources, nullptr};
+}
+
+// Fixed open-addressing table of command specs. Specs are referenced, not
+// copied, so they must have static storage duration.
+class NodeCommandRegistry {
+ public:
+  static constexpr size_t kMaxCommands = 48;
+  static constexpr size_t kTableSize = 128;  // power of two, > 2x kMaxCommands
+
+  bool add(const NodeCommandSpec &spec);
+  const NodeCommandSpec *find(const char *name) const;
+
+  size_t count() const;
+  // Registration order.
+  const NodeCommandSpec *at(size_t index) const;
+
+ private:
+  const NodeCommandSpec *commands_[kMaxCommands] = {};
+  uint8_t table_[kTableSize] = {};  // index + 1 into commands_, 0 = empty
+  size_t count_ = 0;
+};
@@ -0,0 +1,147 @@
+#include "node_invoke_cache.h"
+
+#include <esp_heap_caps.h>
+#include <limits.h>
+#include <string.h>
+
+#include "user_config.h"
+
+bool NodeInvokeCache::ensureArena() {
+  if (arena_) {
+    return true;
+  }
+  const bool psram = psramFound();
+  const size_t cap = psram ? kMaxPayloadBytes : kMaxInternalPayloadBytes;
+  const uint32_t caps = psram ? (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+                              : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  arena_ = static_cast<char *>(heap_caps_malloc(kMaxEntries * (cap + 1), caps));
+  if (!arena_) {
+    return false;
+  }
+  payloadCap_ = cap;
+  return true;
+}
+
+char *NodeInvokeCache::payloadSlot(const Entry *entry) {
+  return arena_ + static_cast<size_t>(entry - entries_) * (payloadCap_ + 1);
+}
+
+bool NodeInvokeCache::live(const Entry &entry, unsigned long nowMs) const {
+  if (entry.state == State::Empty) {
+    return false;
+  }
+  // A running entry stays until its job reports back.
+  return entry.state == State::Running || nowMs - entry.storedMs < USER_INVOKE_CACHE_TTL_MS;
+}
+
+const NodeInvokeCache::Entry *NodeInvokeCache::find(const String &invokeId, unsigned long nowMs) {
+  if (invokeId.isEmpty()) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    Entry &entry = entries_[i];
+    if (live(entry, nowMs) && entry.invokeId == invokeId) {
+      entry.lastUsedMs = nowMs;
+      ++hits_;
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+NodeInvokeCache::Entry *NodeInvokeCache::slotFor(const String &invokeId, unsigned long nowMs) {
+  if (invokeId.isEmpty()) {
+    return nullptr;
+  }
+
+  // Reuse the entry for this id, else the free or least recently used
+  // finished entry; running entries are never evicted.
+  Entry *victim = nullptr;
+  unsigned long victimAge = 0;
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    Entry &entry = entries_[i];
+    if (entry.state != State::Empty && entry.invokeId == invokeId) {
+      return &entry;
+    }
+    if (entry.state == State::Running) {
+      continue;
+    }
+    const unsigned long age = live(entry, nowMs) ? nowMs - entry.lastUsedMs : ULONG_MAX;
+    if (!victim || age > victimAge) {
+      victim = &entry;
+      victimAge = age;
+    }
+  }
+
+  if (victim) {
+    victim->invokeId = invokeId;
+    victim->payload = "";
+    victim->code = "";
+  }
+  return victim;
+}
+
+void NodeInvokeCache::markRunning(const String &invokeId, unsigned long nowMs) {
+  Entry *entry = slotFor(invokeId, nowMs);
+  if (!entry) {
+    return;
+  }
+  entry->state = State::Running;
+  entry->storedMs = nowMs;
+  entry->lastUsedMs = nowMs;
+}
+
+void NodeInvokeCache::storeOk(const String &invokeId, JsonDocument &payload, unsigned long nowMs) {
+  Entry *entry = slotFor(invokeId, nowMs);
+  if (!entry) {
+    return;
+  }
+  if (ensureArena() && measureJson(payload) <= payloadCap_) {
+    char *slot = payloadSlot(entry);
+    serializeJson(payload, slot, payloadCap_ + 1);
+    entry->state = State::Ok;
+    entry->payload = slot;
+  } else {
+    entry->state = State::Oversize;
+    entry->payload = "";
+  }
+  entry->storedMs = nowMs;
+  entry->lastUsedMs = nowMs;
+}
+
+void NodeInvokeCache::storeError(const String &invokeId,
+                                 const char *code,
+                                 const String &message,
+                                 unsigned long nowMs) {
+  Entry *entry = slotFor(invokeId, nowMs);
+  if (!entry) {
+    return;
+  }
+  entry->state = State::Error;
+  entry->code = code;
+  entry->payload = "";
+  if (ensureArena()) {
+    // Long messages are cut; the code is what the gateway acts on.
+    char *slot = payloadSlot(entry);
+    const size_t len = message.length() < payloadCap_ ? message.length() : payloadCap_;
+    memcpy(slot, message.c_str(), len);
+    slot[len] = '\0';
+    entry->payload = slot;
+  }
+  entry->storedMs = nowMs;
+  entry->lastUsedMs = nowMs;
+}
+
+size_t NodeInvokeCache::size(unsigned long nowMs) const {
+  size_t count = 0;
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    if (live(entries_[i], nowMs)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint32_t NodeInvokeCache::hitCount() const {
+  return hits_;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Recently seen invoke ids with their outcome, so an invoke the gateway
+// retries (typically after a reconnect) is answered from the cache or left
+// to the job already running it instead of executing twice. Entries are
+// kept across reconnects and age out after USER_INVOKE_CACHE_TTL_MS;
+// the least recently used finished entry is evicted when full.
+//
+// Payloads live in one arena allocated on first store: PSRAM when present,
+// otherwise a small internal one (kMaxInternalPayloadBytes per entry) so the
+// cache cannot eat into the internal heap TLS needs to reconnect.
+class NodeInvokeCache {
+ public:
+  static constexpr size_t kMaxEntries = 16;
+  static constexpr size_t kMaxPayloadBytes = 1024;
+  static constexpr size_t kMaxInternalPayloadBytes = 256;
+
+  enum class State : uint8_t {
+    Empty = 0,
+    Running = 1,
+    Ok = 2,
+    Error = 3,
+    Oversize = 4,  // finished, result too large to keep
+  };
+
+  struct Entry {
+    State state = State::Empty;
+    String invokeId;
+    const char *payload = "";  // serialized result for Ok, message for Error
+    const char *code = "";
+    unsigned long storedMs = 0;
+    unsigned long lastUsedMs = 0;
+  };
+
+  // Returns the live entry for `invokeId` and counts it as a hit, or null.
+  const Entry *find(const String &invokeId, unsigned long nowMs);
+
+  void markRunning(const String &invokeId, unsigned long nowMs);
+  void storeOk(const String &invokeId, JsonDocument &payload, unsigned long nowMs);
+  void storeError(const String &invokeId,
+                  const char *code,
+                  const String &message,
+                  unsigned long nowMs);
+
+  size_t size(unsigned long nowMs) const;
+  uint32_t hitCount() const;
+
+ private:
+  bool live(const Entry &entry, unsigned long nowMs) const;
+  Entry *slotFor(const String &invokeId, unsigned long nowMs);
+  bool ensureArena();
+  char *payloadSlot(const Entry *entry);
+
+  Entry entries_[kMaxEntries];
+  char *arena_ = nullptr;
+  size_t payloadCap_ = 0;
+  uint32_t hits_ = 0;
+};
@@ -0,0 +1,203 @@
+#include "node_invoke_executor.h"
+
+#include <string.h>
+
+#include "gateway_client.h"
+#include "user_config.h"
+
+namespace {
+
+constexpr size_t kJobResultCapacity = 2048;
+constexpr size_t kJobProgressCapacity = 512;
+
+}  // namespace
+
+void NodeInvokeExecutor::setGatewayClient(GatewayClient *gateway) {
+  gateway_ = gateway;
+}
+
+NodeInvokeExecutor::Job *NodeInvokeExecutor::findJob(const String &invokeId) {
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    if (jobs_[i].active && jobs_[i].invokeId == invokeId) {
+      return &jobs_[i];
+    }
+  }
+  return nullptr;
+}
+
+const NodeInvokeExecutor::Job *NodeInvokeExecutor::findJob(const String &invokeId) const {
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    if (jobs_[i].active && jobs_[i].invokeId == invokeId) {
+      return &jobs_[i];
+    }
+  }
+  return nullptr;
+}
+
+bool NodeInvokeExecutor::start(const NodeCommandSpec &spec,
+                               const String &invokeId,
+                               const String &nodeId,
+                               const NodeCommandCall &call,
+                               NodeInvokeReply reply,
+                               NodeCommandError &error) {
+  if (!spec.job || !spec.job->start || !spec.job->poll || !spec.job->finish) {
+    error.code = "UNAVAILABLE";
+    error.message = "command cannot run as a job";
+    return false;
+  }
+  if (findJob(invokeId)) {
+    error.code = "INVALID_REQUEST";
+    error.message = "invoke already running";
+    return false;
+  }
+  if (spec.resources & busyResources()) {
+    error.code = "BUSY";
+    error.message = "resource in use by a running invoke";
+    return false;
+  }
+
+  Job *slot = nullptr;
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    if (!jobs_[i].active) {
+      slot = &jobs_[i];
+      break;
+    }
+  }
+  if (!slot) {
+    error.code = "BUSY";
+    error.message = "too many running invokes";
+    return false;
+  }
+
+  memset(slot->state, 0, sizeof(slot->state));
+  if (!spec.job->start(call, slot->state, error)) {
+    return false;
+  }
+
+  slot->active = true;
+  slot->spec = &spec;
+  slot->invokeId = invokeId;
+  slot->nodeId = nodeId;
+  slot->reply = reply;
+  slot->startedMs = millis();
+  slot->lastProgressMs = slot->startedMs;
+  return true;
+}
+
+bool NodeInvokeExecutor::cancel(const String &invokeId) {
+  Job *job = findJob(invokeId);
+  if (!job) {
+    return false;
+  }
+
+  if (job->spec->job->cancel) {
+    job->spec->job->cancel(job->state);
+  }
+  NodeCommandError error;
+  error.code = "CANCELLED";
+  error.message = "invoke cancelled";
+  const NodeInvokeReply reply = job->reply;
+  release(*job);
+  if (reply) {
+    reply(nullptr, error);
+  }
+  return true;
+}
+
+bool NodeInvokeExecutor::isRunning(const String &invokeId) const {
+  return findJob(invokeId) != nullptr;
+}
+
+bool NodeInvokeExecutor::acquireResources(uint8_t mask) {
+  if (mask & busyResources()) {
+    return false;
+  }
+  heldResources_ |= mask;
+  return true;
+}
+
+void NodeInvokeExecutor::releaseResources(uint8_t mask) {
+  heldResources_ &= static_cast<uint8_t>(~mask);
+}
+
+uint8_t NodeInvokeExecutor::busyResources() const {
+  uint8_t busy = heldResources_;
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    if (jobs_[i].active) {
+      busy |= jobs_[i].spec->resources;
+    }
+  }
+  return busy;
+}
+
+size_t NodeInvokeExecutor::activeCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    if (jobs_[i].active) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void NodeInvokeExecutor::release(Job &job) {
+  job.active = false;
+  job.spec = nullptr;
+  job.invokeId = "";
+  job.nodeId = "";
+  job.reply = nullptr;
+}
+
+void NodeInvokeExecutor::sendProgress(Job &job, unsigned long now) {
+  job.lastProgressMs = now;
+  if (job.nodeId.isEmpty() || !gateway_ || !gateway_->isReady()) {
+    return;
+  }
+
+  DynamicJsonDocument payload(kJobProgressCapacity);
+  payload["invokeId"] = job.invokeId;
+  payload["nodeId"] = job.nodeId;
+  payload["command"] = job.spec->name;
+  payload["elapsedMs"] = static_cast<uint32_t>(now - job.startedMs);
+  if (job.spec->job->progress) {
+    job.spec->job->progress(job.state, payload.createNestedObject("progress"));
+  }
+  gateway_->sendNodeEvent("node.invoke.progress", payload);
+}
+
+void NodeInvokeExecutor::tick() {
+  for (size_t i = 0; i < kMaxJobs; ++i) {
+    Job &job = jobs_[i];
+    if (!job.active) {
+      continue;
+    }
+
+    NodeCommandError error;
+    const NodeJobStatus status = job.spec->job->poll(job.state, error);
+    if (status == NodeJobStatus::Running) {
+      const unsigned long now = millis();
+      if (now - job.lastProgressMs >= USER_INVOKE_PROGRESS_INTERVAL_MS) {
+        sendProgress(job, now);
+      }
+      continue;
+    }
+
+    // Release first so the reply can start or cancel other jobs.
+    const NodeInvokeReply reply = job.reply;
+    if (status == NodeJobStatus::Done) {
+      const size_t capacity = job.spec->job->resultCapacity ? job.spec->job->resultCapacity
+                                                            : kJobResultCapacity;
+      DynamicJsonDocument payload(capacity);
+      job.spec->job->finish(job.state, payload.to<JsonObject>());
+      release(job);
+      if (reply) {
+        reply(&payload, error);
+      }
+    } else {
+      release(job);
+      if (reply) {
+        reply(nullptr, error);
+      }
+    }
+  }
+}
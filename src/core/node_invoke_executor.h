@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <functional>
+
+#include "node_command_registry.h"
+
+class GatewayClient;
+
+// Delivers the outcome of an invoke: `payload` on success, null with
+// `error` filled otherwise.
+using NodeInvokeReply = std::function<void(JsonDocument *payload, const NodeCommandError &error)>;
+
+// Runs invokes of job-capable commands in the background: a few jobs at a
+// time, each polled from tick() and finished through its reply. Gateway
+// jobs (non-empty node id) also report `node.invoke.progress` events. Jobs
+// can be cancelled by invoke id.
+class NodeInvokeExecutor {
+ public:
+  static constexpr size_t kMaxJobs = 4;
+  static constexpr size_t kJobStateBytes = 96;
+
+  void setGatewayClient(GatewayClient *gateway);
+
+  // On success `reply` is called later, from tick() or cancel().
+  bool start(const NodeCommandSpec &spec,
+             const String &invokeId,
+             const String &nodeId,
+             const NodeCommandCall &call,
+             NodeInvokeReply reply,
+             NodeCommandError &error);
+  bool cancel(const String &invokeId);
+  bool isRunning(const String &invokeId) const;
+
+  // Holds resources outside of any job (e.g. a serial RPC stream) so
+  // commands needing them are refused with BUSY until released.
+  bool acquireResources(uint8_t mask);
+  void releaseResources(uint8_t mask);
+  uint8_t busyResources() const;
+  size_t activeCount() const;
+
+  void tick();
+
+ private:
+  struct Job {
+    bool active = false;
+    const NodeCommandSpec *spec = nullptr;
+    String invokeId;
+    String nodeId;
+    NodeInvokeReply reply;
+    unsigned long startedMs = 0;
+    unsigned long lastProgressMs = 0;
+    alignas(8) uint8_t state[kJobStateBytes] = {0};
+  };
+
+  Job *findJob(const String &invokeId);
+  const Job *findJob(const String &invokeId) const;
+  void sendProgress(Job &job, unsigned long now);
+  void release(Job &job);
+
+  GatewayClient *gateway_ = nullptr;
+  uint8_t heldResources_ = 0;
+  Job jobs_[kMaxJobs];
+};
@@ -0,0 +1,269 @@
+#include "node_param_schema.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "node_command_registry.h"
+
+namespace {
+
+const char *typeLabel(NodeParamType type) {
+  switch (type) {
+    case NodeParamType::Bool:
+      return "boolean";
+    case NodeParamType::Byte:
+    case NodeParamType::Int:
+    case NodeParamType::UInt:
+      return "integer";
+    case NodeParamType::Float:
+      return "number";
+    case NodeParamType::Text:
+      return "string";
+    case NodeParamType::Any:
+    default:
+      return "value";
+  }
+}
+
+bool hasRange(const NodeCommandParam &field) {
+  return field.minValue < field.maxValue;
+}
+
+// "invalid <name>: expected <type>[ <min>..<max>]"; only built on failure.
+bool fieldError(const NodeCommandParam &field, NodeCommandError &error) {
+  char text[96];
+  if (hasRange(field)) {
+    snprintf(text,
+             sizeof(text),
+             field.type == NodeParamType::Text ? "invalid %s: expected %s of %g..%g chars"
+                                               : "invalid %s: expected %s %g..%g",
+             field.name,
+             typeLabel(field.type),
+             field.minValue,
+             field.maxValue);
+  } else {
+    snprintf(text, sizeof(text), "invalid %s: expected %s", field.name, typeLabel(field.type));
+  }
+  error.code = "INVALID_REQUEST";
+  error.message = text;
+  return false;
+}
+
+// Integers are decimal unless written with a "0x" prefix, so "010" is ten.
+bool parseNumberText(const char *text, bool integral, double &out) {
+  if (!text || text[0] == '\0') {
+    return false;
+  }
+  char *endPtr = nullptr;
+  if (integral) {
+    const char *digits = text[0] == '-' || text[0] == '+' ? text + 1 : text;
+    const int base = digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X') ? 16 : 10;
+    if (text[0] == '-') {
+      out = static_cast<double>(strtoll(text, &endPtr, base));
+    } else {
+      out = static_cast<double>(strtoull(text, &endPtr, base));
+    }
+  } else {
+    out = strtod(text, &endPtr);
+  }
+  return endPtr != text && *endPtr == '\0';
+}
+
+// JSON numbers, or numeric strings as sent by `system.run` argument arrays.
+bool readNumber(JsonVariantConst value, bool integral, double &out) {
+  if (value.is<const char *>()) {
+    return parseNumberText(value.as<const char *>(), integral, out);
+  }
+  if (value.is<long long>()) {
+    out = static_cast<double>(value.as<long long>());
+    return true;
+  }
+  if (value.is<unsigned long long>()) {
+    out = static_cast<double>(value.as<unsigned long long>());
+    return true;
+  }
+  if (!integral && value.is<double>()) {
+    out = value.as<double>();
+    return true;
+  }
+  return false;
+}
+
+bool readBool(JsonVariantConst value, bool &out) {
+  if (value.is<bool>()) {
+    out = value.as<bool>();
+    return true;
+  }
+  if (value.is<int>()) {
+    out = value.as<int>() != 0;
+    return true;
+  }
+  if (!value.is<const char *>()) {
+    return false;
+  }
+
+  const char *text = value.as<const char *>();
+  while (*text == ' ') {
+    ++text;
+  }
+  static const char *const kTrue[] = {"1", "true", "yes", "on"};
+  static const char *const kFalse[] = {"0", "false", "no", "off"};
+  for (size_t i = 0; i < 4; ++i) {
+    if (strcasecmp(text, kTrue[i]) == 0) {
+      out = true;
+      return true;
+    }
+    if (strcasecmp(text, kFalse[i]) == 0) {
+      out = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool inRange(const NodeCommandParam &field, double value, double typeMin, double typeMax) {
+  if (isnan(value) || value < typeMin || value > typeMax) {
+    return false;
+  }
+  return !hasRange(field) || (value >= field.minValue && value <= field.maxValue);
+}
+
+void storeNumber(const NodeCommandParam &field, double value, uint8_t *dst) {
+  switch (field.type) {
+    case NodeParamType::Bool: {
+      const bool v = value != 0.0;
+      memcpy(dst, &v, sizeof(v));
+      break;
+    }
+    case NodeParamType::Byte: {
+      const uint8_t v = static_cast<uint8_t>(value);
+      memcpy(dst, &v, sizeof(v));
+      break;
+    }
+    case NodeParamType::Int: {
+      const int32_t v = static_cast<int32_t>(value);
+      memcpy(dst, &v, sizeof(v));
+      break;
+    }
+    case NodeParamType::UInt: {
+      const uint32_t v = static_cast<uint32_t>(value);
+      memcpy(dst, &v, sizeof(v));
+      break;
+    }
+    case NodeParamType::Float: {
+      const float v = static_cast<float>(value);
+      memcpy(dst, &v, sizeof(v));
+      break;
+    }
+    case NodeParamType::Text:
+    case NodeParamType::Any:
+    default:
+      break;
+  }
+}
+
+bool decodeField(const NodeCommandParam &field,
+                 JsonVariantConst value,
+                 uint8_t *dst,
+                 NodeCommandError &error) {
+  double number = 0.0;
+  switch (field.type) {
+    case NodeParamType::Bool: {
+      bool v = false;
+      if (!readBool(value, v)) {
+        return fieldError(field, error);
+      }
+      memcpy(dst, &v, sizeof(v));
+      return true;
+    }
+    case NodeParamType::Byte:
+      if (!readNumber(value, true, number) || !inRange(field, number, 0.0, 255.0)) {
+        return fieldError(field, error);
+      }
+      break;
+    case NodeParamType::Int:
+      if (!readNumber(value, true, number) ||
+          !inRange(field, number, -2147483648.0, 2147483647.0)) {
+        return fieldError(field, error);
+      }
+      break;
+    case NodeParamType::UInt:
+      if (!readNumber(value, true, number) || !inRange(field, number, 0.0, 4294967295.0)) {
+        return fieldError(field, error);
+      }
+      break;
+    case NodeParamType::Float:
+      if (!readNumber(value, false, number) || isinf(number) ||
+          !inRange(field, number, -3.4e38, 3.4e38)) {
+        return fieldError(field, error);
+      }
+      break;
+    case NodeParamType::Text: {
+      if (!value.is<const char *>()) {
+        return fieldError(field, error);
+      }
+      const char *text = value.as<const char *>();
+      if (hasRange(field)) {
+        const size_t len = strlen(text);
+        if (len < field.minValue || len > field.maxValue) {
+          return fieldError(field, error);
+        }
+      }
+      memcpy(dst, &text, sizeof(text));
+      return true;
+    }
+    case NodeParamType::Any:
+    default:
+      return true;
+  }
+
+  storeNumber(field, number, dst);
+  return true;
+}
+
+}  // namespace
+
+bool decodeNodeParams(JsonObjectConst params,
+                      const NodeCommandParam *fields,
+                      size_t count,
+                      void *out,
+                      NodeCommandError &error) {
+  uint8_t *base = static_cast<uint8_t *>(out);
+  uint32_t seen = 0;
+
+  for (JsonPairConst kv : params) {
+    const char *key = kv.key().c_str();
+    for (size_t i = 0; i < count; ++i) {
+      const NodeCommandParam &field = fields[i];
+      if (field.type == NodeParamType::Any || strcmp(field.name, key) != 0) {
+        continue;
+      }
+      if (!kv.value().isNull()) {
+        if (!decodeField(field, kv.value(), base + field.offset, error)) {
+          return false;
+        }
+        seen |= 1UL << i;
+      }
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const NodeCommandParam &field = fields[i];
+    if (field.type == NodeParamType::Any || (seen & (1UL << i))) {
+      continue;
+    }
+    if (field.required) {
+      error.code = "INVALID_REQUEST";
+      error.message = String(field.name) + " is required";
+      return false;
+    }
+    if (field.hasDefault) {
+      storeNumber(field, field.defaultValue, base + field.offset);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <type_traits>
+
+struct NodeCommandError;
+
+// Storage written by decodeNodeParams for each type:
+// Bool -> bool, Byte -> uint8_t, Int -> int32_t, UInt -> uint32_t,
+// Float -> float, Text -> const char * (points into the params document).
+// Any is not decoded; the handler reads the value itself (arrays, objects).
+enum class NodeParamType : uint8_t {
+  Any = 0,
+  Bool,
+  Byte,
+  Int,
+  UInt,
+  Float,
+  Text,
+};
+
+// Parameter in positional order, as used by `system.run` argument arrays,
+// plus the field it decodes into. Numbers are range-checked when
+// minValue < maxValue (string length for Text). Optional params without a
+// default leave the field untouched.
+struct NodeCommandParam {
+  const char *name;
+  bool required;
+  NodeParamType type = NodeParamType::Any;
+  uint16_t offset = 0;
+  double minValue = 0.0;
+  double maxValue = 0.0;
+  bool hasDefault = false;
+  double defaultValue = 0.0;
+};
+
+constexpr NodeCommandParam requiredParam(const char *name,
+                                         NodeParamType type,
+                                         size_t offset,
+                                         double minValue = 0.0,
+                                         double maxValue = 0.0) {
+  return NodeCommandParam{
+      name, true, type, static_cast<uint16_t>(offset), minValue, maxValue, false, 0.0};
+}
+
+constexpr NodeCommandParam optionalParam(const char *name,
+                                         NodeParamType type,
+                                         size_t offset,
+                                         double minValue,
+                                         double maxValue) {
+  return NodeCommandParam{
+      name, false, type, static_cast<uint16_t>(offset), minValue, maxValue, false, 0.0};
+}
+
+constexpr NodeCommandParam optionalParam(const char *name,
+                                         NodeParamType type,
+                                         size_t offset,
+                                         double minValue,
+                                         double maxValue,
+                                         double defaultValue) {
+  return NodeCommandParam{
+      name, false, type, static_cast<uint16_t>(offset), minValue, maxValue, true, defaultValue};
+}
+
+// Decodes `params` into `out` in one pass over its members without heap
+// allocation; unknown keys are ignored. On failure fills `error` with
+// INVALID_REQUEST and a message naming the parameter and what was expected.
+bool decodeNodeParams(JsonObjectConst params,
+                      const NodeCommandParam *fields,
+                      size_t count,
+                      void *out,
+                      NodeCommandError &error);
+
+template <typename T, size_t N>
+bool decodeNodeParams(JsonObjectConst params,
+                      const NodeCommandParam (&fields)[N],
+                      T &out,
+                      NodeCommandError &error) {
+  static_assert(std::is_standard_layout<T>::value, "params struct must be standard layout");
+  static_assert(N <= 32, "too many params for one schema");
+  return decodeNodeParams(params, fields, N, &out, error);
+}
@@ -3,10 +3,12 @@
 #include <ArduinoJson.h>
 #include <Preferences.h>
 #include <SD.h>
-#include <SPI.h>
+#include <ctype.h>
+#include <esp_rom_crc.h>
 
-#include "board_pins.h"
-#include "shared_spi_bus.h"
+#include <vector>
+
+#include "sd_storage.h"
 #include "user_config.h"
 
 namespace {
@@ -14,17 +16,132 @@ namespace {
 constexpr const char *kPrefsNamespace = "oc_cfg";
 constexpr const char *kConfigVersionKey = "cfg_ver";
 constexpr const char *kConfigBlobKey = "cfg_blob";
+constexpr const char *kConfigRecordKey = "cfg_rec";
 constexpr uint32_t kConfigVersion = 2;
+constexpr uint32_t kRecordMagic = 0x4746434FUL;  // "OCFG"
+constexpr uint8_t kRecordFormat = 1;
+constexpr size_t kRecordHeaderLen = 12;
+constexpr size_t kRecordMaxLen = 4096;
+// Changed fields are appended as one NVS entry each ("cfg_jXX", listed in
+// the mask key) and folded back into the record once too many accumulate.
+constexpr const char *kJournalMaskKey = "cfg_jmask";
+constexpr int kJournalCompactFields = 8;
+// Saves are coalesced until the config has been quiet for the debounce
+// window, but never held longer than the max delay. The SD export follows
+// once the config has been stable for longer.
+constexpr unsigned long kSaveDebounceMs = 1500UL;
+constexpr unsigned long kSaveMaxDelayMs = 10000UL;
+constexpr unsigned long kSdExportDelayMs = 30000UL;
 constexpr const char *kSdConfigPath = "/oc_cfg.json";
-constexpr const char *kSdConfigTempPath = "/oc_cfg.tmp";
+constexpr const char *kSdConfigTempPath = "/oc_cfg.json.tmp";
 constexpr const char *kSdEnvPath = "/.env";
-constexpr uint32_t kSdSpiFrequencyHz = 25000000UL;
 
 void fromJson(const JsonObjectConst &obj, RuntimeConfig &config);
-bool mountSd(String *reason);
+GatewayAuthMode sanitizeAuthMode(int mode);
+uint8_t sanitizeDisplayBrightnessPercent(int value);
+
+// Config record field tags. Tags are append-only: never renumber or reuse
+// one, so older records keep decoding and tags from newer firmware are
+// skipped.
+enum ConfigTag : uint8_t {
+  kTagDeviceName = 1,
+  kTagWifiSsid = 2,
+  kTagWifiPassword = 3,
+  kTagGatewayUrl = 4,
+  kTagGatewayFallbackUrls = 5,
+  kTagGatewayAuthMode = 6,
+  kTagGatewayToken = 7,
+  kTagGatewayPassword = 8,
+  kTagGatewayDeviceId = 9,
+  kTagGatewayDevicePublicKey = 10,
+  kTagGatewayDevicePrivateKey = 11,
+  kTagGatewayDeviceToken = 12,
+  kTagAutoConnect = 13,
+  kTagLanControlEnabled = 14,
+  kTagLanControlToken = 15,
+  kTagBleDeviceAddress = 16,
+  kTagBleAutoConnect = 17,
+  kTagAppMarketGithubRepo = 18,
+  kTagAppMarketReleaseAsset = 19,
+  kTagUiLanguage = 20,
+  kTagKoreanFontInstalled = 21,
+  kTagTimezoneTz = 22,
+  kTagDisplayBrightness = 23,
+  kTagSdConfigStamp = 0xF0,
+  kTagEnvStamp = 0xF1,
+};
+
+struct StringField {
+  uint8_t tag;
+  String RuntimeConfig::*member;
+};
+
+constexpr StringField kStringFields[] = {
+    {kTagDeviceName, &RuntimeConfig::deviceName},
+    {kTagWifiSsid, &RuntimeConfig::wifiSsid},
+    {kTagWifiPassword, &RuntimeConfig::wifiPassword},
+    {kTagGatewayUrl, &RuntimeConfig::gatewayUrl},
+    {kTagGatewayFallbackUrls, &RuntimeConfig::gatewayFallbackUrls},
+    {kTagGatewayToken, &RuntimeConfig::gatewayToken},
+    {kTagGatewayPassword, &RuntimeConfig::gatewayPassword},
+    {kTagGatewayDeviceId, &RuntimeConfig::gatewayDeviceId},
+    {kTagGatewayDevicePublicKey, &RuntimeConfig::gatewayDevicePublicKey},
+    {kTagGatewayDevicePrivateKey, &RuntimeConfig::gatewayDevicePrivateKey},
+    {kTagGatewayDeviceToken, &RuntimeConfig::gatewayDeviceToken},
+    {kTagLanControlToken, &RuntimeConfig::lanControlToken},
+    {kTagBleDeviceAddress, &RuntimeConfig::bleDeviceAddress},
+    {kTagAppMarketGithubRepo, &RuntimeConfig::appMarketGithubRepo},
+    {kTagAppMarketReleaseAsset, &RuntimeConfig::appMarketReleaseAsset},
+    {kTagUiLanguage, &RuntimeConfig::uiLanguage},
+    {kTagTimezoneTz, &RuntimeConfig::timezoneTz},
+};
+
+struct FlagField {
+  uint8_t tag;
+  bool RuntimeConfig::*member;
+};
+
+constexpr FlagField kFlagFields[] = {
+    {kTagAutoConnect, &RuntimeConfig::autoConnect},
+    {kTagLanControlEnabled, &RuntimeConfig::lanControlEnabled},
+    {kTagBleAutoConnect, &RuntimeConfig::bleAutoConnect},
+    {kTagKoreanFontInstalled, &RuntimeConfig::koreanFontInstalled},
+};
+
+// Identifies the version of an SD file a config record was built from.
+struct SourceStamp {
+  bool present = false;
+  uint32_t size = 0;
+  uint32_t mtime = 0;
+  uint32_t hash = 0;
+};
+
+struct SourceStamps {
+  SourceStamp sdConfig;
+  SourceStamp env;
+};
+
+// What NVS holds (record plus journal); saves are diffed against it.
+RuntimeConfig gStoredConfig;
+SourceStamps gSourceStamps;
+bool gRecordStored = false;
+uint32_t gJournalMask = 0;
+
+// Latest saveConfig() request that is not in NVS yet.
+RuntimeConfig gPendingConfig;
+bool gNvsPending = false;
+bool gSdExportPending = false;
+unsigned long gFirstPendingMs = 0;
+unsigned long gLastSaveMs = 0;
+// Why the last NVS commit failed; cleared by the next one that succeeds.
+String gLastFlushError;
+
+ConfigPersistStats gPersistStats;
+uint32_t gLastLoadMicros = 0;
 
 struct EnvGatewayOverrides {
   bool hasGatewayUrl = false;
+  bool hasGatewayFallbackUrls = false;
   bool hasGatewayToken = false;
   bool hasGatewayPassword = false;
   bool hasGatewayAuthMode = false;
@@ -34,6 +151,7 @@ struct EnvGatewayOverrides {
   bool hasGatewayDeviceToken = false;
 
   String gatewayUrl;
+  String gatewayFallbackUrls;
   String gatewayToken;
   String gatewayPassword;
   GatewayAuthMode gatewayAuthMode = GatewayAuthMode::Token;
@@ -67,6 +185,22 @@ bool startsWithWsScheme(const String &url) {
   return url.startsWith("ws://") || url.startsWith("wss://");
 }
 
+bool isValidGatewayUrlList(const String &urls) {
+  const size_t len = urls.length();
+  size_t start = 0;
+  for (size_t i = 0; i <= len; ++i) {
+    const bool separator = i == len || urls[i] == ',' || isspace(static_cast<unsigned char>(urls[i]));
+    if (!separator) {
+      continue;
+    }
+    if (i > start && !startsWithWsScheme(urls.substring(start, i))) {
+      return false;
+    }
+    start = i + 1;
+  }
+  return true;
+}
+
 bool isLikelyHexString(const String &value) {
   for (size_t i = 0; i < value.length(); ++i) {
     const char c = value[static_cast<unsigned int>(i)];
@@ -127,6 +261,11 @@ bool applyEnvGatewayKey(const String &key,
     overrides.gatewayUrl = value;
     return true;
   }
+  if (key == "OPENCLAW_GATEWAY_FALLBACK_URLS" || key == "GATEWAY_FALLBACK_URLS") {
+    overrides.hasGatewayFallbackUrls = true;
+    overrides.gatewayFallbackUrls = value;
+    return true;
+  }
   if (key == "OPENCLAW_GATEWAY_TOKEN" || key == "GATEWAY_TOKEN") {
     overrides.hasGatewayToken = true;
     overrides.gatewayToken = value;
@@ -205,7 +344,7 @@ bool readEnvGatewayOverridesFromSd(EnvGatewayOverrides &overrides,
   found = false;
 
   String mountErr;
-  if (!mountSd(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     return true;
   }
 
@@ -235,6 +374,9 @@ void applyEnvGatewayOverrides(RuntimeConfig &config,
   if (overrides.hasGatewayUrl) {
     config.gatewayUrl = overrides.gatewayUrl;
   }
+  if (overrides.hasGatewayFallbackUrls) {
+    config.gatewayFallbackUrls = overrides.gatewayFallbackUrls;
+  }
   if (overrides.hasGatewayToken) {
     config.gatewayToken = overrides.gatewayToken;
   }
@@ -276,38 +418,6 @@ void applyEnvGatewayOverrides(RuntimeConfig &config,
   }
 }
 
-bool mountSd(String *reason) {
-  if (boardpins::kTftCs >= 0) {
-    pinMode(boardpins::kTftCs, OUTPUT);
-    digitalWrite(boardpins::kTftCs, HIGH);
-  }
-  if (boardpins::kCc1101Cs >= 0) {
-    pinMode(boardpins::kCc1101Cs, OUTPUT);
-    digitalWrite(boardpins::kCc1101Cs, HIGH);
-  }
-  if (boardpins::kSdCs >= 0) {
-    pinMode(boardpins::kSdCs, OUTPUT);
-    digitalWrite(boardpins::kSdCs, HIGH);
-  }
-
-#if !HAL_HAS_SD_CARD
-  if (reason) *reason = "No SD card support on this board";
-  return false;
-#else
-  SPIClass *spiBus = sharedspi::bus();
-  const bool mounted = SD.begin(boardpins::kSdCs,
-                                *spiBus,
-                                kSdSpiFrequencyHz,
-                                "/sd",
-                                8,
-                                false);
-  if (!mounted && reason) {
-    *reason = "SD mount failed";
-  }
-  return mounted;
-#endif  // HAL_HAS_SD_CARD
-}
-
 bool parseConfigBlob(const String &blob,
                      RuntimeConfig &outConfig,
                      String *error = nullptr) {
@@ -341,7 +451,7 @@ bool readConfigFromSd(RuntimeConfig &outConfig,
   found = false;
 
   String mountErr;
-  if (!mountSd(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     return true;
   }
 
@@ -422,52 +532,494 @@ bool readConfigFromNvs(RuntimeConfig &outConfig,
 }
 
 bool writeConfigToSd(const String &blob, String *error = nullptr) {
-  String mountErr;
-  if (!mountSd(&mountErr)) {
+  return sdstorage::writeFileAtomic(kSdConfigPath,
+                                    reinterpret_cast<const uint8_t *>(blob.c_str()),
+                                    blob.length(),
+                                    error);
+}
+
+void putLe(std::vector<uint8_t> &out, uint32_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint32_t getLe(const uint8_t *data, size_t bytes) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    value |= static_cast<uint32_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+void putField(std::vector<uint8_t> &out, uint8_t tag, const void *value, size_t len) {
+  out.push_back(tag);
+  putLe(out, static_cast<uint32_t>(len), 2);
+  const uint8_t *bytes = static_cast<const uint8_t *>(value);
+  out.insert(out.end(), bytes, bytes + len);
+}
+
+void writeLe(uint8_t *out, uint32_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+// An absent file is stored as an empty value so a journal entry can record
+// that the file went away.
+void readStamp(const uint8_t *value, size_t len, SourceStamp &stamp) {
+  stamp = SourceStamp();
+  if (len != 12) {
+    return;
+  }
+  stamp.present = true;
+  stamp.size = getLe(value, 4);
+  stamp.mtime = getLe(value + 4, 4);
+  stamp.hash = getLe(value + 8, 4);
+}
+
+// Calls `fn(tag, value, len)` for every persisted field, in record order.
+template <typename Fn>
+void forEachRecordField(const RuntimeConfig &config, const SourceStamps &stamps, Fn fn) {
+  for (const StringField &field : kStringFields) {
+    const String &value = config.*field.member;
+    fn(field.tag, reinterpret_cast<const uint8_t *>(value.c_str()), value.length());
+  }
+  for (const FlagField &field : kFlagFields) {
+    const uint8_t value = config.*field.member ? 1 : 0;
+    fn(field.tag, &value, 1);
+  }
+  const uint8_t authMode = static_cast<uint8_t>(config.gatewayAuthMode);
+  fn(kTagGatewayAuthMode, &authMode, 1);
+  fn(kTagDisplayBrightness, &config.displayBrightnessPercent, 1);
+
+  const SourceStamp *stampValues[] = {&stamps.sdConfig, &stamps.env};
+  const uint8_t stampTags[] = {kTagSdConfigStamp, kTagEnvStamp};
+  for (size_t i = 0; i < 2; ++i) {
+    uint8_t value[12];
+    const SourceStamp &stamp = *stampValues[i];
+    writeLe(value, stamp.size, 4);
+    writeLe(value + 4, stamp.mtime, 4);
+    writeLe(value + 8, stamp.hash, 4);
+    fn(stampTags[i], value, stamp.present ? sizeof(value) : 0);
+  }
+}
+
+// Record layout: magic(4) format(1) reserved(1) payloadLen(2) crc32(4), then
+// tag(1) len(2) value TLVs. All integers are little-endian.
+void encodeConfigRecord(const RuntimeConfig &config,
+                        const SourceStamps &stamps,
+                        std::vector<uint8_t> &out) {
+  out.clear();
+  out.reserve(512);
+  out.resize(kRecordHeaderLen);
+  forEachRecordField(config, stamps, [&](uint8_t tag, const uint8_t *value, size_t len) {
+    putField(out, tag, value, len);
+  });
+
+  const size_t payloadLen = out.size() - kRecordHeaderLen;
+  writeLe(out.data(), kRecordMagic, 4);
+  out[4] = kRecordFormat;
+  out[5] = 0;
+  writeLe(out.data() + 6, static_cast<uint32_t>(payloadLen), 2);
+  writeLe(out.data() + 8, esp_rom_crc32_le(0, out.data() + kRecordHeaderLen, payloadLen), 4);
+}
+
+void applyRecordField(RuntimeConfig &config,
+                      SourceStamps &stamps,
+                      uint8_t tag,
+                      const uint8_t *value,
+                      size_t len) {
+  for (const StringField &field : kStringFields) {
+    if (field.tag == tag) {
+      String &target = config.*field.member;
+      target = "";
+      target.concat(reinterpret_cast<const char *>(value), len);
+      return;
+    }
+  }
+  for (const FlagField &field : kFlagFields) {
+    if (field.tag == tag && len == 1) {
+      config.*field.member = value[0] != 0;
+      return;
+    }
+  }
+
+  switch (tag) {
+    case kTagGatewayAuthMode:
+      if (len == 1) {
+        config.gatewayAuthMode = sanitizeAuthMode(value[0]);
+      }
+      return;
+    case kTagDisplayBrightness:
+      if (len == 1) {
+        config.displayBrightnessPercent = sanitizeDisplayBrightnessPercent(value[0]);
+      }
+      return;
+    case kTagSdConfigStamp:
+      readStamp(value, len, stamps.sdConfig);
+      return;
+    case kTagEnvStamp:
+      readStamp(value, len, stamps.env);
+      return;
+    default:
+      // Written by newer firmware.
+      return;
+  }
+}
+
+bool decodeConfigRecord(const uint8_t *data,
+                        size_t len,
+                        RuntimeConfig &outConfig,
+                        SourceStamps &outStamps,
+                        String *error = nullptr) {
+  if (len < kRecordHeaderLen || getLe(data, 4) != kRecordMagic ||
+      data[4] != kRecordFormat) {
     if (error) {
-      *error = mountErr;
+      *error = "NVS config record header invalid";
     }
     return false;
   }
 
-  if (SD.exists(kSdConfigTempPath)) {
-    SD.remove(kSdConfigTempPath);
+  const size_t payloadLen = getLe(data + 6, 2);
+  if (kRecordHeaderLen + payloadLen != len ||
+      esp_rom_crc32_le(0, data + kRecordHeaderLen, payloadLen) != getLe(data + 8, 4)) {
+    if (error) {
+      *error = "NVS config record CRC mismatch";
+    }
+    return false;
   }
 
-  File temp = SD.open(kSdConfigTempPath, FILE_WRITE);
-  if (!temp || temp.isDirectory()) {
-    if (temp) {
-      temp.close();
+  RuntimeConfig config = makeDefaultConfig();
+  SourceStamps stamps;
+  const uint8_t *cursor = data + kRecordHeaderLen;
+  const uint8_t *end = cursor + payloadLen;
+  while (cursor < end) {
+    if (end - cursor < 3) {
+      break;
+    }
+    const uint8_t tag = cursor[0];
+    const size_t fieldLen = getLe(cursor + 1, 2);
+    cursor += 3;
+    if (fieldLen > static_cast<size_t>(end - cursor)) {
+      break;
     }
+    applyRecordField(config, stamps, tag, cursor, fieldLen);
+    cursor += fieldLen;
+  }
+  if (cursor != end) {
     if (error) {
-      *error = "SD temp write open failed";
+      *error = "NVS config record truncated";
     }
     return false;
   }
 
-  const size_t written = temp.print(blob);
-  temp.close();
-  if (written != blob.length()) {
-    SD.remove(kSdConfigTempPath);
+  config.deviceName = trimDeviceName(config.deviceName);
+  if (config.deviceName.isEmpty()) {
+    config.deviceName = defaultDeviceNameValue();
+  }
+
+  String validateErr;
+  if (!validateConfig(config, &validateErr)) {
+    if (error) {
+      *error = "NVS config record validation failed: " + validateErr;
+    }
+    return false;
+  }
+
+  outConfig = config;
+  outStamps = stamps;
+  return true;
+}
+
+int journalBit(uint8_t tag) {
+  if (tag > 0 && tag < 30) {
+    return tag;
+  }
+  if (tag == kTagSdConfigStamp) {
+    return 30;
+  }
+  if (tag == kTagEnvStamp) {
+    return 31;
+  }
+  return -1;
+}
+
+uint8_t journalTag(int bit) {
+  if (bit < 30) {
+    return static_cast<uint8_t>(bit);
+  }
+  return bit == 30 ? kTagSdConfigStamp : kTagEnvStamp;
+}
+
+void journalKey(uint8_t tag, char *key, size_t size) {
+  snprintf(key, size, "cfg_j%02x", tag);
+}
+
+// Journal entries are stored as tag + value so none is ever zero length.
+void applyConfigJournal(Preferences &prefs,
+                        uint32_t mask,
+                        RuntimeConfig &config,
+                        SourceStamps &stamps) {
+  RuntimeConfig journaled = config;
+  SourceStamps journaledStamps = stamps;
+  for (int bit = 0; bit < 32; ++bit) {
+    if ((mask & (1UL << bit)) == 0) {
+      continue;
+    }
+    const uint8_t tag = journalTag(bit);
+    char key[12];
+    journalKey(tag, key, sizeof(key));
+    const size_t len = prefs.getBytesLength(key);
+    if (len == 0) {
+      continue;
+    }
+    std::vector<uint8_t> entry(len);
+    if (prefs.getBytes(key, entry.data(), len) != len || entry[0] != tag) {
+      continue;
+    }
+    applyRecordField(journaled, journaledStamps, tag, entry.data() + 1, len - 1);
+  }
+
+  String validateErr;
+  if (!validateConfig(journaled, &validateErr)) {
+    Serial.printf("[config] warning: NVS journal ignored: %s\n", validateErr.c_str());
+    return;
+  }
+  config = journaled;
+  stamps = journaledStamps;
+}
+
+bool readConfigRecord(RuntimeConfig &outConfig,
+                      SourceStamps &stamps,
+                      bool &found,
+                      String *error = nullptr) {
+  found = false;
+
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
+    return true;
+  }
+
+  const size_t len = prefs.getBytesLength(kConfigRecordKey);
+  if (len == 0 || len > kRecordMaxLen) {
+    prefs.end();
+    return true;
+  }
+
+  std::vector<uint8_t> record(len);
+  const size_t read = prefs.getBytes(kConfigRecordKey, record.data(), len);
+  if (read != len) {
+    prefs.end();
     if (error) {
-      *error = "SD write failed";
+      *error = "NVS config record read failed";
     }
     return false;
   }
 
-  if (SD.exists(kSdConfigPath)) {
-    SD.remove(kSdConfigPath);
+  if (!decodeConfigRecord(record.data(), record.size(), outConfig, stamps, error)) {
+    prefs.end();
+    return false;
   }
-  if (!SD.rename(kSdConfigTempPath, kSdConfigPath)) {
-    SD.remove(kSdConfigTempPath);
+
+  gJournalMask = prefs.getULong(kJournalMaskKey, 0);
+  if (gJournalMask != 0) {
+    applyConfigJournal(prefs, gJournalMask, outConfig, stamps);
+  }
+  prefs.end();
+  found = true;
+  return true;
+}
+
+// Rewrites the whole record and drops the journal.
+bool writeConfigRecord(const RuntimeConfig &config,
+                       const SourceStamps &stamps,
+                       String *error = nullptr) {
+  std::vector<uint8_t> record;
+  encodeConfigRecord(config, stamps, record);
+  if (record.size() > kRecordMaxLen) {
+    if (error) {
+      *error = "Config too large for NVS record";
+    }
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
     if (error) {
-      *error = "SD rename failed";
+      *error = "Failed to open NVS namespace";
     }
     return false;
   }
+
+  const bool ok = prefs.putBytes(kConfigRecordKey, record.data(), record.size()) ==
+                  record.size();
+  if (ok) {
+    for (int bit = 0; bit < 32; ++bit) {
+      if (gJournalMask & (1UL << bit)) {
+        char key[12];
+        journalKey(journalTag(bit), key, sizeof(key));
+        prefs.remove(key);
+      }
+    }
+    if (gJournalMask != 0) {
+      prefs.remove(kJournalMaskKey);
+    }
+    if (prefs.isKey(kConfigBlobKey)) {
+      // The record supersedes the JSON blob older firmware kept.
+      prefs.remove(kConfigBlobKey);
+      prefs.remove(kConfigVersionKey);
+    }
+  }
+  prefs.end();
+
+  if (!ok) {
+    if (error) {
+      *error = "Failed to write NVS config record";
+    }
+    return false;
+  }
+
+  gStoredConfig = config;
+  gSourceStamps = stamps;
+  gRecordStored = true;
+  gJournalMask = 0;
+  ++gPersistStats.nvsRecordWrites;
+  gPersistStats.nvsBytes += record.size();
   return true;
 }
 
+// Writes only the fields that differ from what NVS holds, as journal
+// entries, or the whole record when there is none yet or the journal is full.
+bool commitConfigToNvs(const RuntimeConfig &config,
+                       const SourceStamps &stamps,
+                       String *error = nullptr) {
+  std::vector<uint8_t> stored[32];
+  forEachRecordField(gStoredConfig, gSourceStamps,
+                     [&](uint8_t tag, const uint8_t *value, size_t len) {
+                       const int bit = journalBit(tag);
+                       if (bit >= 0) {
+                         stored[bit].assign(value, value + len);
+                       }
+                     });
+
+  std::vector<std::vector<uint8_t>> entries;
+  uint32_t changedMask = 0;
+  forEachRecordField(config, stamps, [&](uint8_t tag, const uint8_t *value, size_t len) {
+    const int bit = journalBit(tag);
+    if (bit < 0) {
+      return;
+    }
+    const std::vector<uint8_t> &before = stored[bit];
+    if (before.size() == len && (len == 0 || memcmp(before.data(), value, len) == 0)) {
+      return;
+    }
+    changedMask |= 1UL << bit;
+    std::vector<uint8_t> entry;
+    entry.reserve(len + 1);
+    entry.push_back(tag);
+    entry.insert(entry.end(), value, value + len);
+    entries.push_back(entry);
+  });
+
+  if (changedMask == 0 && gRecordStored) {
+    return true;
+  }
+  ++gPersistStats.nvsCommits;
+  if (!gRecordStored ||
+      __builtin_popcount(gJournalMask | changedMask) > kJournalCompactFields) {
+    return writeConfigRecord(config, stamps, error);
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
+    if (error) {
+      *error = "Failed to open NVS namespace";
+    }
+    return false;
+  }
+
+  bool ok = true;
+  for (const std::vector<uint8_t> &entry : entries) {
+    char key[12];
+    journalKey(entry[0], key, sizeof(key));
+    if (prefs.putBytes(key, entry.data(), entry.size()) != entry.size()) {
+      ok = false;
+      break;
+    }
+    ++gPersistStats.nvsFieldWrites;
+    gPersistStats.nvsBytes += entry.size();
+  }
+  const uint32_t mask = gJournalMask | changedMask;
+  if (ok && mask != gJournalMask) {
+    ok = prefs.putULong(kJournalMaskKey, mask) > 0;
+    gPersistStats.nvsBytes += sizeof(mask);
+  }
+  prefs.end();
+
+  if (!ok) {
+    if (error) {
+      *error = "Failed to write NVS config fields";
+    }
+    return false;
+  }
+
+  gStoredConfig = config;
+  gSourceStamps = stamps;
+  gJournalMask = mask;
+  return true;
+}
+
+uint32_t hashOpenFile(File &file) {
+  uint8_t buffer[256];
+  uint32_t crc = 0;
+  while (true) {
+    const int read = file.read(buffer, sizeof(buffer));
+    if (read <= 0) {
+      break;
+    }
+    crc = esp_rom_crc32_le(crc, buffer, static_cast<uint32_t>(read));
+  }
+  return crc;
+}
+
+// Compares an SD file with the stamp it was last imported at. Size and mtime
+// are checked first; the content is only hashed when either moved, so an
+// untouched card costs a stat per file.
+bool sdFileChanged(const char *path, const SourceStamp &known, SourceStamp &current) {
+  current = SourceStamp();
+  if (!SD.exists(path)) {
+    return known.present;
+  }
+  File file = SD.open(path, FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    return known.present;
+  }
+
+  current.present = true;
+  current.size = static_cast<uint32_t>(file.size());
+  current.mtime = static_cast<uint32_t>(file.getLastWrite());
+  if (known.present && known.size == current.size && known.mtime == current.mtime) {
+    current.hash = known.hash;
+    file.close();
+    return false;
+  }
+  current.hash = hashOpenFile(file);
+  file.close();
+  return !known.present || known.hash != current.hash;
+}
+
+// Stamps the SD sources as they are now. The card must be mounted.
+SourceStamps currentSdStamps() {
+  SourceStamps stamps;
+  sdFileChanged(kSdConfigPath, SourceStamp(), stamps.sdConfig);
+  sdFileChanged(kSdEnvPath, SourceStamp(), stamps.env);
+  return stamps;
+}
+
 bool isHexDigitChar(char c) {
   return (c >= '0' && c <= '9') ||
          (c >= 'a' && c <= 'f') ||
@@ -563,6 +1115,7 @@ void toJson(const RuntimeConfig &config, JsonObject obj) {
   obj["wifiSsid"] = config.wifiSsid;
   obj["wifiPassword"] = config.wifiPassword;
   obj["gatewayUrl"] = config.gatewayUrl;
+  obj["gatewayFallbackUrls"] = config.gatewayFallbackUrls;
   obj["gatewayAuthMode"] = static_cast<uint8_t>(config.gatewayAuthMode);
   obj["gatewayToken"] = config.gatewayToken;
   obj["gatewayPassword"] = config.gatewayPassword;
@@ -571,6 +1124,8 @@ void toJson(const RuntimeConfig &config, JsonObject obj) {
   obj["gatewayDevicePrivateKey"] = config.gatewayDevicePrivateKey;
   obj["gatewayDeviceToken"] = config.gatewayDeviceToken;
   obj["autoConnect"] = config.autoConnect;
+  obj["lanControlEnabled"] = config.lanControlEnabled;
+  obj["lanControlToken"] = config.lanControlToken;
   obj["bleDeviceAddress"] = config.bleDeviceAddress;
   obj["bleAutoConnect"] = config.bleAutoConnect;
   obj["appMarketGithubRepo"] = config.appMarketGithubRepo;
@@ -595,6 +1150,8 @@ void fromJson(const JsonObjectConst &obj, RuntimeConfig &config) {
   config.wifiSsid = String(static_cast<const char *>(obj["wifiSsid"] | ""));
   config.wifiPassword = String(static_cast<const char *>(obj["wifiPassword"] | ""));
   config.gatewayUrl = String(static_cast<const char *>(obj["gatewayUrl"] | ""));
+  config.gatewayFallbackUrls =
+      String(static_cast<const char *>(obj["gatewayFallbackUrls"] | ""));
   config.gatewayAuthMode = sanitizeAuthMode(obj["gatewayAuthMode"] | 0);
   config.gatewayToken = String(static_cast<const char *>(obj["gatewayToken"] | ""));
   config.gatewayPassword = String(static_cast<const char *>(obj["gatewayPassword"] | ""));
@@ -607,6 +1164,8 @@ void fromJson(const JsonObjectConst &obj, RuntimeConfig &config) {
   config.gatewayDeviceToken =
       String(static_cast<const char *>(obj["gatewayDeviceToken"] | ""));
   config.autoConnect = obj["autoConnect"] | false;
+  config.lanControlEnabled = obj["lanControlEnabled"] | false;
+  config.lanControlToken = String(static_cast<const char *>(obj["lanControlToken"] | ""));
   config.bleDeviceAddress = String(static_cast<const char *>(obj["bleDeviceAddress"] | ""));
   config.bleAutoConnect = obj["bleAutoConnect"] | false;
   config.appMarketGithubRepo =
@@ -623,6 +1182,50 @@ void fromJson(const JsonObjectConst &obj, RuntimeConfig &config) {
       obj["displayBrightnessPercent"] | USER_DISPLAY_BRIGHTNESS_PERCENT);
 }
 
+bool commitPendingConfig(String *error) {
+  const uint32_t startUs = micros();
+  gNvsPending = false;
+  String commitErr;
+  if (!commitConfigToNvs(gPendingConfig, gSourceStamps, &commitErr)) {
+    // Retry after another debounce window.
+    gNvsPending = true;
+    gFirstPendingMs = gLastSaveMs = millis();
+    gLastFlushError = commitErr.isEmpty() ? String("NVS write failed") : commitErr;
+    if (error) {
+      *error = gLastFlushError;
+    }
+    return false;
+  }
+  gLastFlushError = "";
+  gPersistStats.lastCommitUs = micros() - startUs;
+  return true;
+}
+
+// The SD copy is an export for editing on a computer; its stamp goes into
+// NVS so the device does not re-import its own write.
+bool exportConfigToSd(String *error) {
+  gSdExportPending = false;
+
+  DynamicJsonDocument doc(4096);
+  toJson(gStoredConfig, doc.to<JsonObject>());
+  String blob;
+  serializeJson(doc, blob);
+
+  String sdErr;
+  if (!writeConfigToSd(blob, &sdErr)) {
+    if (error) {
+      *error = "SD export skipped: " + sdErr;
+    }
+    return false;
+  }
+  ++gPersistStats.sdExports;
+  gPersistStats.sdBytes += blob.length();
+
+  SourceStamps stamps = gSourceStamps;
+  sdFileChanged(kSdConfigPath, SourceStamp(), stamps.sdConfig);
+  return commitConfigToNvs(gStoredConfig, stamps, error);
+}
+
 }  // namespace
 
 RuntimeConfig makeDefaultConfig() {
@@ -640,6 +1243,9 @@ RuntimeConfig makeDefaultConfig() {
   if (!isPlaceholder(USER_GATEWAY_URL)) {
     config.gatewayUrl = USER_GATEWAY_URL;
   }
+  if (!isPlaceholder(USER_GATEWAY_FALLBACK_URLS)) {
+    config.gatewayFallbackUrls = USER_GATEWAY_FALLBACK_URLS;
+  }
 
   config.gatewayAuthMode = sanitizeAuthMode(USER_GATEWAY_AUTH_MODE);
   if (!isPlaceholder(USER_GATEWAY_TOKEN)) {
@@ -654,6 +1260,9 @@ RuntimeConfig makeDefaultConfig() {
   }
 
   config.autoConnect = USER_AUTO_CONNECT_DEFAULT;
+  if (!isPlaceholder(USER_LAN_CONTROL_TOKEN)) {
+    config.lanControlToken = USER_LAN_CONTROL_TOKEN;
+  }
   if (!isPlaceholder(USER_APPMARKET_GITHUB_REPO)) {
     config.appMarketGithubRepo = USER_APPMARKET_GITHUB_REPO;
   }
@@ -745,6 +1354,28 @@ bool validateConfig(const RuntimeConfig &config, String *error) {
     }
   }
 
+  if (!config.gatewayFallbackUrls.isEmpty()) {
+    if (config.gatewayUrl.isEmpty()) {
+      if (error) {
+        *error = "Gateway fallback URLs need a primary URL";
+      }
+      return false;
+    }
+    if (!isValidGatewayUrlList(config.gatewayFallbackUrls)) {
+      if (error) {
+        *error = "Gateway fallback URLs must start with ws:// or wss://";
+      }
+      return false;
+    }
+  }
+
+  if (config.lanControlEnabled && config.lanControlToken.length() < 8) {
+    if (error) {
+      *error = "LAN control token must be 8+ chars";
+    }
+    return false;
+  }
+
   if (!isValidBleAddress(config.bleDeviceAddress)) {
     if (error) {
       *error = "BLE address format must be XX:XX:XX:XX:XX:XX";
@@ -787,6 +1418,7 @@ bool loadConfig(RuntimeConfig &outConfig,
                 ConfigLoadSource *source,
                 bool *loadedFromNvs,
                 String *error) {
+  const uint32_t startUs = micros();
   RuntimeConfig config = makeDefaultConfig();
   outConfig = config;
   if (source) {
@@ -797,23 +1429,48 @@ bool loadConfig(RuntimeConfig &outConfig,
   }
   String warnings;
 
+  // The NVS record is the primary source; SD files are only re-read by
+  // syncConfigFromSd() when they changed, off the boot path.
+  RuntimeConfig recordConfig = config;
+  SourceStamps recordStamps;
+  bool recordFound = false;
+  String recordErr;
+  if (readConfigRecord(recordConfig, recordStamps, recordFound, &recordErr) &&
+      recordFound) {
+    outConfig = recordConfig;
+    gStoredConfig = recordConfig;
+    gSourceStamps = recordStamps;
+    gRecordStored = true;
+    if (source) {
+      *source = ConfigLoadSource::Nvs;
+    }
+    if (loadedFromNvs) {
+      *loadedFromNvs = true;
+    }
+    if (error) {
+      error->clear();
+    }
+    gLastLoadMicros = micros() - startUs;
+    return true;
+  }
+  appendMessage(warnings, recordErr);
+
+  // No usable record yet (first boot after an update, or after a reset):
+  // load the legacy sources and migrate them into a record.
+  ConfigLoadSource loadedFrom = ConfigLoadSource::Defaults;
   RuntimeConfig sdConfig = config;
   bool sdFound = false;
   String sdErr;
   if (readConfigFromSd(sdConfig, sdFound, &sdErr) && sdFound) {
     outConfig = sdConfig;
-    if (source) {
-      *source = ConfigLoadSource::SdCard;
-    }
+    loadedFrom = ConfigLoadSource::SdCard;
   } else {
     RuntimeConfig nvsConfig = config;
     bool nvsFound = false;
     String nvsErr;
     if (readConfigFromNvs(nvsConfig, nvsFound, &nvsErr) && nvsFound) {
       outConfig = nvsConfig;
-      if (source) {
-        *source = ConfigLoadSource::Nvs;
-      }
+      loadedFrom = ConfigLoadSource::Nvs;
       if (loadedFromNvs) {
         *loadedFromNvs = true;
       }
@@ -829,6 +1486,7 @@ bool loadConfig(RuntimeConfig &outConfig,
   EnvGatewayOverrides envOverrides;
   bool envFound = false;
   String envErr;
+  bool envApplied = false;
   if (!readEnvGatewayOverridesFromSd(envOverrides, envFound, &envErr)) {
     appendMessage(warnings, envErr);
   } else if (envFound) {
@@ -838,18 +1496,129 @@ bool loadConfig(RuntimeConfig &outConfig,
     String envValidateErr;
     if (validateConfig(envConfig, &envValidateErr)) {
       outConfig = envConfig;
+      envApplied = true;
     } else {
       appendMessage(warnings, ".env ignored: " + envValidateErr);
     }
   }
 
+  String mountErr;
+  SourceStamps stamps;
+  if (sdstorage::ensureMounted(&mountErr)) {
+    stamps = currentSdStamps();
+  }
+  gStoredConfig = outConfig;
+  gSourceStamps = stamps;
+  gRecordStored = false;
+  // Pure defaults are not persisted so new compile-time seeds still apply.
+  if (loadedFrom != ConfigLoadSource::Defaults || envApplied) {
+    String migrateErr;
+    if (!writeConfigRecord(outConfig, stamps, &migrateErr)) {
+      Serial.printf("[config] warning: %s\n", migrateErr.c_str());
+    }
+  }
+
+  if (source) {
+    *source = loadedFrom;
+  }
   if (error) {
     *error = warnings;
   }
 
+  gLastLoadMicros = micros() - startUs;
   return true;
 }
 
+bool syncConfigFromSd(RuntimeConfig &config, bool force, bool *changed, String *error) {
+  if (changed) {
+    *changed = false;
+  }
+  if (error) {
+    error->clear();
+  }
+
+  String mountErr;
+  if (!sdstorage::ensureMounted(&mountErr)) {
+    if (force && error) {
+      *error = mountErr;
+    }
+    return !force;
+  }
+
+  // Land queued saves first so the import is compared against them.
+  if (gNvsPending) {
+    gNvsPending = false;
+    commitConfigToNvs(gPendingConfig, gSourceStamps);
+  }
+
+  SourceStamps stamps;
+  const bool sdChanged =
+      sdFileChanged(kSdConfigPath, gSourceStamps.sdConfig, stamps.sdConfig) || force;
+  const bool envChanged = sdFileChanged(kSdEnvPath, gSourceStamps.env, stamps.env) || force;
+  if (!sdChanged && !envChanged) {
+    return true;
+  }
+
+  String warnings;
+  RuntimeConfig next = config;
+  if (sdChanged && stamps.sdConfig.present) {
+    RuntimeConfig sdConfig = makeDefaultConfig();
+    bool sdFound = false;
+    String sdErr;
+    if (readConfigFromSd(sdConfig, sdFound, &sdErr) && sdFound) {
+      next = sdConfig;
+    } else {
+      appendMessage(warnings, sdErr);
+    }
+  }
+
+  // .env layers over the JSON config, so re-apply it when either changed.
+  if (stamps.env.present) {
+    EnvGatewayOverrides envOverrides;
+    bool envFound = false;
+    String envErr;
+    if (!readEnvGatewayOverridesFromSd(envOverrides, envFound, &envErr)) {
+      appendMessage(warnings, envErr);
+    } else if (envFound) {
+      RuntimeConfig envConfig = next;
+      applyEnvGatewayOverrides(envConfig, envOverrides);
+      String envValidateErr;
+      if (validateConfig(envConfig, &envValidateErr)) {
+        next = envConfig;
+      } else {
+        appendMessage(warnings, ".env ignored: " + envValidateErr);
+      }
+    }
+  }
+
+  std::vector<uint8_t> before;
+  std::vector<uint8_t> after;
+  encodeConfigRecord(config, stamps, before);
+  encodeConfigRecord(next, stamps, after);
+
+  // Store the new stamps even when the content is unchanged or invalid so an
+  // untouched file is not parsed again on every boot.
+  String recordErr;
+  if (!commitConfigToNvs(next, stamps, &recordErr)) {
+    appendMessage(warnings, recordErr);
+  }
+
+  if (before != after) {
+    config = next;
+    if (changed) {
+      *changed = true;
+    }
+  }
+  if (error) {
+    *error = warnings;
+  }
+  return warnings.isEmpty();
+}
+
+uint32_t lastConfigLoadMicros() {
+  return gLastLoadMicros;
+}
+
 bool saveConfig(const RuntimeConfig &config, String *error) {
   if (error) {
     error->clear();
@@ -863,37 +1632,68 @@ bool saveConfig(const RuntimeConfig &config, String *error) {
     return false;
   }
 
-  DynamicJsonDocument doc(4096);
-  toJson(config, doc.to<JsonObject>());
+  const unsigned long now = millis();
+  gPendingConfig = config;
+  if (!gNvsPending) {
+    gFirstPendingMs = now;
+  }
+  gNvsPending = true;
+  gSdExportPending = true;
+  gLastSaveMs = now;
+  ++gPersistStats.saveRequests;
+  return true;
+}
 
-  String blob;
-  serializeJson(doc, blob);
+void tickConfigPersistence() {
+  if (!gNvsPending && !gSdExportPending) {
+    return;
+  }
 
-  String sdErr;
-  if (!writeConfigToSd(blob, &sdErr)) {
-    if (error) {
-      *error = "Failed to write config to SD: " + sdErr;
+  const unsigned long now = millis();
+  String persistErr;
+  if (gNvsPending) {
+    if (now - gLastSaveMs < kSaveDebounceMs && now - gFirstPendingMs < kSaveMaxDelayMs) {
+      return;
     }
-    return false;
+    if (!commitPendingConfig(&persistErr)) {
+      Serial.printf("[config] warning: %s\n", persistErr.c_str());
+    }
+    return;
   }
 
-  Preferences prefs;
-  if (!prefs.begin(kPrefsNamespace, false)) {
-    Serial.println("[config] warning: failed to open NVS namespace for backup");
-    return true;
+  if (now - gLastSaveMs >= kSdExportDelayMs && !exportConfigToSd(&persistErr)) {
+    Serial.printf("[config] warning: %s\n", persistErr.c_str());
   }
+}
 
-  const bool okVersion = prefs.putULong(kConfigVersionKey, kConfigVersion) > 0;
-  const bool okBlob = prefs.putString(kConfigBlobKey, blob) > 0;
-  prefs.end();
-
-  if (!okVersion || !okBlob) {
-    Serial.println("[config] warning: failed to write NVS backup");
+bool flushConfig(String *error) {
+  if (error) {
+    error->clear();
+  }
+  if (gNvsPending && !commitPendingConfig(error)) {
+    return false;
+  }
+  if (gSdExportPending) {
+    String sdErr;
+    if (!exportConfigToSd(&sdErr)) {
+      Serial.printf("[config] warning: %s\n", sdErr.c_str());
+    }
   }
-
   return true;
 }
 
+bool configSavePending() {
+  return gNvsPending || gSdExportPending;
+}
+
+String lastConfigFlushError() {
+  return gLastFlushError;
+}
+
+ConfigPersistStats configPersistStats() {
+  return gPersistStats;
+}
+
 bool resetConfig(String *error) {
   if (error) {
     error->clear();
@@ -909,6 +1709,13 @@ bool resetConfig(String *error) {
 
   const bool cleared = prefs.clear();
   prefs.end();
+  gNvsPending = false;
+  gSdExportPending = false;
+  gLastFlushError = "";
+  gStoredConfig = makeDefaultConfig();
+  gSourceStamps = SourceStamps();
+  gRecordStored = false;
+  gJournalMask = 0;
 
   if (!cleared) {
     if (error) {
@@ -918,7 +1725,7 @@ bool resetConfig(String *error) {
   }
 
   String mountErr;
-  if (!mountSd(&mountErr)) {
+  if (!sdstorage::ensureMounted(&mountErr)) {
     // SD card missing/unavailable: treat as reset complete for NVS.
     return true;
   }
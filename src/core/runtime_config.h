@@ -16,6 +16,7 @@ struct RuntimeConfig {
   String wifiSsid;
   String wifiPassword;
   String gatewayUrl;
+  String gatewayFallbackUrls;  // comma-separated, same credentials as gatewayUrl
   GatewayAuthMode gatewayAuthMode = GatewayAuthMode::Token;
   String gatewayToken;
   String gatewayPassword;
@@ -24,6 +25,8 @@ struct RuntimeConfig {
   String gatewayDevicePrivateKey;
   String gatewayDeviceToken;
   bool autoConnect = false;
+  bool lanControlEnabled = false;
+  String lanControlToken;
   String bleDeviceAddress;
   bool bleAutoConnect = false;
   String appMarketGithubRepo;
@@ -34,6 +37,18 @@ struct RuntimeConfig {
   uint8_t displayBrightnessPercent = USER_DISPLAY_BRIGHTNESS_PERCENT;
 };
 
+// Write volume since boot. Bytes count payload written, not flash pages.
+struct ConfigPersistStats {
+  uint32_t saveRequests = 0;
+  uint32_t nvsCommits = 0;
+  uint32_t nvsFieldWrites = 0;
+  uint32_t nvsRecordWrites = 0;
+  uint32_t nvsBytes = 0;
+  uint32_t sdExports = 0;
+  uint32_t sdBytes = 0;
+  uint32_t lastCommitUs = 0;
+};
+
 enum class ConfigLoadSource : uint8_t {
   Defaults = 0,
   SdCard = 1,
@@ -50,7 +65,28 @@ bool loadConfig(RuntimeConfig &outConfig,
                 ConfigLoadSource *source = nullptr,
                 bool *loadedFromNvs = nullptr,
                 String *error = nullptr);
+// Re-imports /oc_cfg.json and /.env when they changed on the SD card since
+// the stored config record was built (always when `force`), then persists
+// the result. `changed` is set when `config` was updated.
+bool syncConfigFromSd(RuntimeConfig &config,
+                      bool force,
+                      bool *changed = nullptr,
+                      String *error = nullptr);
+// Duration of the last loadConfig() call.
+uint32_t lastConfigLoadMicros();
+// Validates `config` and queues it. Changed fields reach NVS once saves have
+// been quiet for a moment (tickConfigPersistence); /oc_cfg.json is exported
+// later still. Only validation errors are reported here; a failed NVS write
+// shows up in lastConfigFlushError().
 bool saveConfig(const RuntimeConfig &config, String *error = nullptr);
+void tickConfigPersistence();
+// Writes anything queued now; call before sleep or restart.
+bool flushConfig(String *error = nullptr);
+bool configSavePending();
+// Why the last NVS write of queued changes failed (they stay queued and are
+// retried), or empty once one succeeds.
+String lastConfigFlushError();
+ConfigPersistStats configPersistStats();
 bool resetConfig(String *error = nullptr);
 
 bool isKoreanFontInstalled(const RuntimeConfig &config);
@@ -0,0 +1,574 @@
+#include "sd_benchmark.h"
+
+#include <SD.h>
+#include <stdlib.h>
+
+#include "sd_storage.h"
+
+namespace {
+
+constexpr const char *kBenchDir = "/sdbench";
+constexpr const char *kBenchFile = "/sdbench/bench.bin";
+constexpr size_t kBufferBytes = 16384;
+constexpr size_t kRandomBlockBytes = 4096;
+constexpr uint32_t kRandomOps = 128;
+constexpr uint32_t kSmallFiles = 32;
+constexpr size_t kSmallFileBytes = 512;
+constexpr uint32_t kMinFileKb = 64;
+constexpr uint32_t kMaxFileKb = 4096;
+// Kept free on the card beyond the test file.
+constexpr uint64_t kFreeSpaceMarginBytes = 1024ULL * 1024ULL;
+// Slower clocks measured after the probed one.
+constexpr uint32_t kSlowerClocksHz[] = {20000000UL, 10000000UL, 4000000UL};
+// Per clock: seq write + seq read per chunk size, then random read, random
+// write, create, delete.
+constexpr uint32_t kPhasesPerClock = sdbench::kChunkCount * 2U + 4U;
+
+enum class Phase : uint8_t {
+  Mount,
+  SeqWrite,
+  SeqRead,
+  RandRead,
+  RandWrite,
+  Create,
+  Delete,
+};
+
+sdbench::Report gReport;
+String gError;
+bool gRunning = false;
+Phase gPhase = Phase::Mount;
+uint8_t gClockIndex = 0;
+uint8_t gChunkIndex = 0;
+uint32_t gClocksHz[sdbench::kMaxClocks] = {};
+uint8_t gClockCount = 0;
+uint32_t gBaseHz = 0;
+uint32_t gFileBytes = 0;
+uint32_t gDone = 0;  // bytes or operations finished in the current phase
+bool gPhaseOpen = false;
+uint64_t gBusyUs = 0;
+uint32_t gRng = 1;
+unsigned long gStartedMs = 0;
+uint8_t *gBuffer = nullptr;
+File gFile;
+
+uint32_t nextRandom() {
+  // xorshift32: cheap and reproducible per run.
+  gRng ^= gRng << 13;
+  gRng ^= gRng >> 17;
+  gRng ^= gRng << 5;
+  return gRng;
+}
+
+uint8_t patternByte(uint32_t offset) {
+  return static_cast<uint8_t>(((offset ^ 0x5AC3E1F7UL) * 2654435761UL) >> 24);
+}
+
+void fillPattern(uint8_t *buf, uint32_t offset, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    buf[i] = patternByte(offset + static_cast<uint32_t>(i));
+  }
+}
+
+bool matchesPattern(const uint8_t *buf, uint32_t offset, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (buf[i] != patternByte(offset + static_cast<uint32_t>(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+String smallFilePath(uint32_t index) {
+  char path[32];
+  snprintf(path, sizeof(path), "%s/f%02lu.tmp", kBenchDir, static_cast<unsigned long>(index));
+  return String(path);
+}
+
+uint32_t perSecond(uint64_t units, uint64_t busyUs) {
+  if (busyUs == 0) {
+    busyUs = 1;
+  }
+  return static_cast<uint32_t>(units * 1000000ULL / busyUs);
+}
+
+sdbench::ClockResult &current() {
+  return gReport.clocks[gClockIndex];
+}
+
+void closeFile() {
+  if (gFile) {
+    gFile.close();
+  }
+  gPhaseOpen = false;
+}
+
+void removeBenchFiles() {
+  closeFile();
+  SD.remove(kBenchFile);
+  for (uint32_t i = 0; i < kSmallFiles; ++i) {
+    const String path = smallFilePath(i);
+    if (SD.exists(path.c_str())) {
+      SD.remove(path.c_str());
+    }
+  }
+}
+
+void releaseBuffer() {
+  free(gBuffer);
+  gBuffer = nullptr;
+}
+
+// Cleans up and puts the card back on the probed clock.
+void stopRun() {
+  removeBenchFiles();
+  releaseBuffer();
+  if (gBaseHz != 0 && sdstorage::info().spiHz != gBaseHz) {
+    sdstorage::remountAt(gBaseHz);
+  }
+  sdstorage::releaseExclusive();
+  gRunning = false;
+}
+
+bool abortRun(const String &message) {
+  gError = message;
+  stopRun();
+  Serial.printf("[sdbench] aborted: %s\n", message.c_str());
+  return false;
+}
+
+void enterPhase(Phase phase) {
+  gPhase = phase;
+  gDone = 0;
+  gBusyUs = 0;
+  gPhaseOpen = false;
+}
+
+bool saveReport() {
+  DynamicJsonDocument doc(4096);
+  sdbench::reportToJson(gReport, doc.to<JsonObject>());
+  String text;
+  serializeJson(doc, text);
+  String err;
+  if (!sdstorage::writeFileAtomic(sdbench::kResultsPath,
+                                  reinterpret_cast<const uint8_t *>(text.c_str()),
+                                  text.length(),
+                                  &err)) {
+    gError = "Results not saved: " + err;
+    return false;
+  }
+  return true;
+}
+
+void finishRun() {
+  gReport.complete = true;
+  gReport.durationMs = millis() - gStartedMs;
+  stopRun();
+  saveReport();
+  Serial.printf("[sdbench] done in %lu ms\n", static_cast<unsigned long>(gReport.durationMs));
+}
+
+// Moves on once the phase's last operation is done.
+void advance() {
+  switch (gPhase) {
+    case Phase::Mount:
+      gChunkIndex = 0;
+      enterPhase(Phase::SeqWrite);
+      return;
+    case Phase::SeqWrite:
+      enterPhase(Phase::SeqRead);
+      return;
+    case Phase::SeqRead:
+      if (++gChunkIndex < sdbench::kChunkCount) {
+        enterPhase(Phase::SeqWrite);
+      } else {
+        enterPhase(Phase::RandRead);
+      }
+      return;
+    case Phase::RandRead:
+      enterPhase(Phase::RandWrite);
+      return;
+    case Phase::RandWrite:
+      enterPhase(Phase::Create);
+      return;
+    case Phase::Create:
+      enterPhase(Phase::Delete);
+      return;
+    case Phase::Delete:
+      ++gReport.clockCount;
+      if (++gClockIndex < gClockCount) {
+        enterPhase(Phase::Mount);
+      } else {
+        finishRun();
+      }
+      return;
+  }
+}
+
+bool openForPhase(const char *path, const char *mode) {
+  gFile = SD.open(path, mode);
+  if (!gFile || gFile.isDirectory()) {
+    closeFile();
+    return false;
+  }
+  gPhaseOpen = true;
+  return true;
+}
+
+// One unit of work: a mount, one chunk, one random block or one file.
+bool runOperation() {
+  sdbench::ClockResult &result = current();
+  const size_t chunk =
+      sdbench::kChunkSizes[gChunkIndex < sdbench::kChunkCount ? gChunkIndex : 0];
+
+  switch (gPhase) {
+    case Phase::Mount: {
+      String err;
+      if (!sdstorage::remountAt(gClocksHz[gClockIndex], &err)) {
+        return abortRun(err);
+      }
+      result.spiHz = gClocksHz[gClockIndex];
+      advance();
+      return true;
+    }
+
+    case Phase::SeqWrite: {
+      if (!gPhaseOpen && !openForPhase(kBenchFile, FILE_WRITE)) {
+        return abortRun("Bench file open failed");
+      }
+      if (gDone < gFileBytes) {
+        fillPattern(gBuffer, gDone, chunk);
+        const uint32_t t0 = micros();
+        const size_t put = gFile.write(gBuffer, chunk);
+        gBusyUs += micros() - t0;
+        if (put != chunk) {
+          return abortRun("SD write failed at offset " + String(gDone + put));
+        }
+        gDone += chunk;
+        return true;
+      }
+      const uint32_t t0 = micros();
+      closeFile();
+      gBusyUs += micros() - t0;
+      result.seqWriteKBps[gChunkIndex] = perSecond(gFileBytes / 1024U, gBusyUs);
+      advance();
+      return true;
+    }
+
+    case Phase::SeqRead: {
+      if (!gPhaseOpen && !openForPhase(kBenchFile, FILE_READ)) {
+        return abortRun("Bench file open failed");
+      }
+      if (gDone < gFileBytes) {
+        const uint32_t t0 = micros();
+        const size_t got = gFile.read(gBuffer, chunk);
+        gBusyUs += micros() - t0;
+        if (got != chunk) {
+          return abortRun("SD read failed at offset " + String(gDone + got));
+        }
+        if (!matchesPattern(gBuffer, gDone, chunk)) {
+          result.verifyOk = false;
+        }
+        gDone += chunk;
+        return true;
+      }
+      closeFile();
+      result.seqReadKBps[gChunkIndex] = perSecond(gFileBytes / 1024U, gBusyUs);
+      advance();
+      return true;
+    }
+
+    case Phase::RandRead:
+    case Phase::RandWrite: {
+      const bool writing = gPhase == Phase::RandWrite;
+      if (!gPhaseOpen && !openForPhase(kBenchFile, writing ? "r+" : FILE_READ)) {
+        return abortRun("Bench file open failed");
+      }
+      if (gDone < kRandomOps) {
+        const uint32_t blocks = gFileBytes / kRandomBlockBytes;
+        const uint32_t offset = (nextRandom() % blocks) * kRandomBlockBytes;
+        if (writing) {
+          fillPattern(gBuffer, offset, kRandomBlockBytes);
+        }
+        const uint32_t t0 = micros();
+        const bool seeked = gFile.seek(offset);
+        const size_t moved = !seeked ? 0
+                             : writing ? gFile.write(gBuffer, kRandomBlockBytes)
+                                       : gFile.read(gBuffer, kRandomBlockBytes);
+        gBusyUs += micros() - t0;
+        if (moved != kRandomBlockBytes) {
+          return abortRun(String(writing ? "SD write" : "SD read") + " failed at offset " +
+                          String(offset));
+        }
+        if (!writing && !matchesPattern(gBuffer, offset, kRandomBlockBytes)) {
+          result.verifyOk = false;
+        }
+        ++gDone;
+        return true;
+      }
+      const uint32_t t0 = micros();
+      closeFile();
+      gBusyUs += micros() - t0;
+      if (writing) {
+        result.randWriteIops = perSecond(kRandomOps, gBusyUs);
+      } else {
+        result.randReadIops = perSecond(kRandomOps, gBusyUs);
+      }
+      advance();
+      return true;
+    }
+
+    case Phase::Create: {
+      if (gDone < kSmallFiles) {
+        const String path = smallFilePath(gDone);
+        fillPattern(gBuffer, gDone, kSmallFileBytes);
+        const uint32_t t0 = micros();
+        File file = SD.open(path.c_str(), FILE_WRITE);
+        const bool ok = file && file.write(gBuffer, kSmallFileBytes) == kSmallFileBytes;
+        if (file) {
+          file.close();
+        }
+        gBusyUs += micros() - t0;
+        if (!ok) {
+          return abortRun("SD file create failed");
+        }
+        ++gDone;
+        return true;
+      }
+      result.createPerSec = perSecond(kSmallFiles, gBusyUs);
+      advance();
+      return true;
+    }
+
+    case Phase::Delete: {
+      if (gDone < kSmallFiles) {
+        const String path = smallFilePath(gDone);
+        const uint32_t t0 = micros();
+        const bool ok = SD.remove(path.c_str());
+        gBusyUs += micros() - t0;
+        if (!ok) {
+          return abortRun("SD file delete failed");
+        }
+        ++gDone;
+        return true;
+      }
+      result.deletePerSec = perSecond(kSmallFiles, gBusyUs);
+      advance();
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t phaseOrdinal() {
+  switch (gPhase) {
+    case Phase::Mount:
+      return 0;
+    case Phase::SeqWrite:
+      return gChunkIndex * 2U;
+    case Phase::SeqRead:
+      return gChunkIndex * 2U + 1U;
+    case Phase::RandRead:
+      return sdbench::kChunkCount * 2U;
+    case Phase::RandWrite:
+      return sdbench::kChunkCount * 2U + 1U;
+    case Phase::Create:
+      return sdbench::kChunkCount * 2U + 2U;
+    case Phase::Delete:
+      return sdbench::kChunkCount * 2U + 3U;
+  }
+  return 0;
+}
+
+uint32_t phaseTotal() {
+  switch (gPhase) {
+    case Phase::SeqWrite:
+    case Phase::SeqRead:
+      return gFileBytes;
+    case Phase::RandRead:
+    case Phase::RandWrite:
+      return kRandomOps;
+    case Phase::Create:
+    case Phase::Delete:
+      return kSmallFiles;
+    case Phase::Mount:
+    default:
+      return 1;
+  }
+}
+
+}  // namespace
+
+namespace sdbench {
+
+bool start(uint32_t fileKb, String *error) {
+  auto refuse = [error](const String &message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  if (gRunning) {
+    return refuse("Benchmark already running");
+  }
+  if (fileKb < kMinFileKb || fileKb > kMaxFileKb) {
+    return refuse("File size must be 64..4096 KB");
+  }
+  String mountErr;
+  if (!sdstorage::ensureMounted(&mountErr)) {
+    return refuse(mountErr);
+  }
+
+  // Whole multiples of the largest chunk, so every pass reads full chunks.
+  const uint32_t largestChunk = kChunkSizes[kChunkCount - 1];
+  gFileBytes = fileKb * 1024U / largestChunk * largestChunk;
+  const uint64_t total = SD.totalBytes();
+  const uint64_t used = SD.usedBytes();
+  const uint64_t freeBytes = total > used ? total - used : 0;
+  if (freeBytes < static_cast<uint64_t>(gFileBytes) + kFreeSpaceMarginBytes) {
+    return refuse("Not enough free space on SD");
+  }
+  if (!SD.exists(kBenchDir) && !SD.mkdir(kBenchDir)) {
+    return refuse("Cannot create /sdbench");
+  }
+
+  gBuffer = static_cast<uint8_t *>(malloc(kBufferBytes));
+  if (!gBuffer) {
+    return refuse("Out of memory for benchmark buffer");
+  }
+  // Held until stopRun(): other SD users are refused while clocks change.
+  if (!sdstorage::acquireExclusive(&mountErr)) {
+    releaseBuffer();
+    return refuse(mountErr);
+  }
+
+  gBaseHz = sdstorage::info().spiHz;
+  gClockCount = 0;
+  gClocksHz[gClockCount++] = gBaseHz;
+  for (const uint32_t hz : kSlowerClocksHz) {
+    if (hz < gBaseHz && gClockCount < kMaxClocks) {
+      gClocksHz[gClockCount++] = hz;
+    }
+  }
+
+  gReport = Report();
+  gReport.fileBytes = gFileBytes;
+  gError = "";
+  gClockIndex = 0;
+  gChunkIndex = 0;
+  gRng = millis() | 1U;
+  gStartedMs = millis();
+  gRunning = true;
+  enterPhase(Phase::Mount);
+  Serial.printf("[sdbench] start: %lu KB file, %u clocks from %lu Hz\n",
+                static_cast<unsigned long>(fileKb),
+                static_cast<unsigned>(gClockCount),
+                static_cast<unsigned long>(gBaseHz));
+  return true;
+}
+
+bool step(uint32_t budgetMs) {
+  const unsigned long startMs = millis();
+  while (gRunning && millis() - startMs < budgetMs) {
+    if (!runOperation()) {
+      break;
+    }
+  }
+  return gRunning;
+}
+
+void cancel() {
+  if (!gRunning) {
+    return;
+  }
+  gError = "Cancelled";
+  stopRun();
+}
+
+bool running() {
+  return gRunning;
+}
+
+uint8_t progressPercent() {
+  if (!gRunning) {
+    return gReport.complete ? 100 : 0;
+  }
+  const uint64_t perClock = kPhasesPerClock;
+  const uint64_t total = perClock * gClockCount;
+  const uint64_t doneUnits = gClockIndex * perClock + phaseOrdinal();
+  const uint64_t scaled = doneUnits * 100ULL + static_cast<uint64_t>(gDone) * 100ULL / phaseTotal();
+  return static_cast<uint8_t>(scaled / total);
+}
+
+String phaseLabel() {
+  if (!gRunning) {
+    return gReport.complete ? String("Done") : gError;
+  }
+  String label = String(gClocksHz[gClockIndex] / 1000000UL) + " MHz ";
+  switch (gPhase) {
+    case Phase::Mount:
+      return label + "mount";
+    case Phase::SeqWrite:
+      return label + "seq write " + String(kChunkSizes[gChunkIndex]) + " B";
+    case Phase::SeqRead:
+      return label + "seq read " + String(kChunkSizes[gChunkIndex]) + " B";
+    case Phase::RandRead:
+      return label + "4K random read";
+    case Phase::RandWrite:
+      return label + "4K random write";
+    case Phase::Create:
+      return label + "create files";
+    case Phase::Delete:
+      return label + "delete files";
+  }
+  return label;
+}
+
+const Report &report() {
+  return gReport;
+}
+
+const String &lastError() {
+  return gError;
+}
+
+void reportToJson(const Report &report, JsonObject out) {
+  out["complete"] = report.complete;
+  out["fileBytes"] = report.fileBytes;
+  out["durationMs"] = report.durationMs;
+  JsonArray clocks = out.createNestedArray("clocks");
+  for (uint8_t i = 0; i < report.clockCount; ++i) {
+    const ClockResult &c = report.clocks[i];
+    JsonObject clock = clocks.createNestedObject();
+    clock["spiHz"] = c.spiHz;
+    clock["verifyOk"] = c.verifyOk;
+    JsonArray seq = clock.createNestedArray("seq");
+    for (size_t k = 0; k < kChunkCount; ++k) {
+      JsonObject row = seq.createNestedObject();
+      row["chunk"] = kChunkSizes[k];
+      row["writeKBps"] = c.seqWriteKBps[k];
+      row["readKBps"] = c.seqReadKBps[k];
+    }
+    clock["rand4kReadIops"] = c.randReadIops;
+    clock["rand4kWriteIops"] = c.randWriteIops;
+    clock["createPerSec"] = c.createPerSec;
+    clock["deletePerSec"] = c.deletePerSec;
+  }
+}
+
+bool loadSaved(JsonDocument &out, String *error) {
+  String text;
+  if (!sdstorage::readFile(kResultsPath, text, 8192, error)) {
+    return false;
+  }
+  if (deserializeJson(out, text) != DeserializationError::Ok) {
+    if (error) {
+      *error = "Results file is corrupt";
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace sdbench
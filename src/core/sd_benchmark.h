@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Measures the mounted SD card: sequential write/read at several chunk
+// sizes, 4 KB random read/write, and small-file create/delete, repeated at
+// the probed SPI clock and a few slower ones. Faster clocks than the probed
+// one are never tried, so a marginal bus cannot corrupt the filesystem.
+//
+// All I/O stays inside /sdbench, and the test file is removed afterwards.
+// A run holds the card exclusively (sdstorage::acquireExclusive()), so it
+// refuses to start during a recording or download and other SD users are
+// refused until it ends.
+// The run is split into short steps so the UI and the node command executor
+// can drive it from the background tick. The last report is kept in RAM and
+// saved to /sdbench/results.json.
+namespace sdbench {
+
+constexpr const char *kResultsPath = "/sdbench/results.json";
+constexpr size_t kChunkCount = 3;
+constexpr uint16_t kChunkSizes[kChunkCount] = {512, 4096, 16384};
+constexpr size_t kMaxClocks = 3;
+
+struct ClockResult {
+  uint32_t spiHz = 0;
+  uint32_t seqWriteKBps[kChunkCount] = {};
+  uint32_t seqReadKBps[kChunkCount] = {};
+  uint32_t randReadIops = 0;
+  uint32_t randWriteIops = 0;
+  uint32_t createPerSec = 0;
+  uint32_t deletePerSec = 0;
+  bool verifyOk = true;  // every byte read back matched what was written
+};
+
+struct Report {
+  bool complete = false;
+  uint32_t fileBytes = 0;
+  uint32_t durationMs = 0;
+  uint8_t clockCount = 0;
+  ClockResult clocks[kMaxClocks];
+};
+
+// `fileKb` is the sequential test file size (64..4096 KB).
+bool start(uint32_t fileKb = 512, String *error = nullptr);
+// Runs I/O for about `budgetMs`. Returns true while the benchmark still has
+// work left; afterwards report() and lastError() tell how it ended.
+bool step(uint32_t budgetMs);
+void cancel();
+bool running();
+
+uint8_t progressPercent();
+// Short label of the phase in progress, e.g. "20 MHz seq write 4 KB".
+String phaseLabel();
+
+const Report &report();
+const String &lastError();
+
+void reportToJson(const Report &report, JsonObject out);
+// Reads the saved results file into `out`.
+bool loadSaved(JsonDocument &out, String *error = nullptr);
+
+}  // namespace sdbench
@@ -0,0 +1,289 @@
+#include "sd_buffered_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sd_storage.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+uint8_t *allocateBlock(size_t bytes) {
+  void *ptr = nullptr;
+#if defined(ARDUINO_ARCH_ESP32)
+  if (psramFound()) {
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  if (!ptr) {
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+#else
+  ptr = malloc(bytes);
+#endif
+  return static_cast<uint8_t *>(ptr);
+}
+
+void freeBlock(uint8_t *ptr) {
+#if defined(ARDUINO_ARCH_ESP32)
+  heap_caps_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+size_t roundUpToSector(size_t bytes) {
+  const size_t sector = SdBufferedWriter::kSectorBytes;
+  if (bytes < sector) {
+    return sector;
+  }
+  return (bytes + sector - 1) / sector * sector;
+}
+
+}  // namespace
+
+SdBufferedWriter::SdBufferedWriter(size_t bufferBytes, Mode mode)
+    : mode_(mode), requestedBytes_(roundUpToSector(bufferBytes)) {}
+
+SdBufferedWriter::~SdBufferedWriter() {
+  // Unflushed data is dropped; callers end() before closing the file.
+  releaseBuffers();
+  if (retained_) {
+    sdstorage::release();
+  }
+}
+
+bool SdBufferedWriter::begin(File &file, String *error) {
+  releaseBuffers();
+  file_ = nullptr;
+  active_ = 0;
+  fill_ = 0;
+  pendingData_ = nullptr;
+  pendingLen_ = 0;
+  pendingDone_ = 0;
+  queued_ = 0;
+  written_ = 0;
+  failed_ = false;
+  lastError_ = "";
+
+  if (!file) {
+    fail("SD file not open");
+  } else if (!allocateBuffers()) {
+    fail("Out of memory for SD write buffer");
+  }
+  if (failed_) {
+    if (error) {
+      *error = lastError_;
+    }
+    return false;
+  }
+
+  file_ = &file;
+  if (!retained_) {
+    sdstorage::retain();
+    retained_ = true;
+  }
+  fileOffset_ = static_cast<uint32_t>(file.position());
+  return true;
+}
+
+bool SdBufferedWriter::write(const uint8_t *data, size_t len) {
+  if (!file_) {
+    if (!failed_) {
+      fail("SD writer not started");
+    }
+    return false;
+  }
+  if (failed_) {
+    return false;
+  }
+
+  while (len > 0) {
+    const size_t limit = blockLimit();
+    const size_t room = limit - fill_;
+    const size_t take = len < room ? len : room;
+    memcpy(buffers_[active_] + fill_, data, take);
+    fill_ += take;
+    data += take;
+    len -= take;
+    queued_ += static_cast<uint32_t>(take);
+    if (fill_ == limit && !submitBlock()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SdBufferedWriter::pump() {
+  if (!file_ || failed_) {
+    return false;
+  }
+  return !pendingData_ || writePendingSlice();
+}
+
+bool SdBufferedWriter::flush() {
+  if (!file_ || failed_) {
+    return false;
+  }
+  if (!submitBlock() || !drainPending()) {
+    return false;
+  }
+  file_->flush();
+  return true;
+}
+
+bool SdBufferedWriter::end(String *error) {
+  bool ok = !failed_;
+  if (file_) {
+    ok = flush();
+  }
+  releaseBuffers();
+  file_ = nullptr;
+  if (retained_) {
+    sdstorage::release();
+    retained_ = false;
+  }
+  if (!ok && error) {
+    *error = lastError_;
+  }
+  return ok;
+}
+
+bool SdBufferedWriter::active() const {
+  return file_ != nullptr;
+}
+
+bool SdBufferedWriter::failed() const {
+  return failed_;
+}
+
+bool SdBufferedWriter::background() const {
+  return buffers_[1] != nullptr;
+}
+
+size_t SdBufferedWriter::bufferBytes() const {
+  return bufferBytes_;
+}
+
+uint32_t SdBufferedWriter::bytesQueued() const {
+  return queued_;
+}
+
+uint32_t SdBufferedWriter::bytesWritten() const {
+  return written_;
+}
+
+const String &SdBufferedWriter::lastError() const {
+  return lastError_;
+}
+
+bool SdBufferedWriter::allocateBuffers() {
+  // Halve the block until it fits, down to a single sector.
+  size_t bytes = requestedBytes_;
+  while (true) {
+    buffers_[0] = allocateBlock(bytes);
+    if (buffers_[0]) {
+      break;
+    }
+    if (bytes <= kSectorBytes) {
+      return false;
+    }
+    bytes = roundUpToSector(bytes / 2);
+  }
+  bufferBytes_ = bytes;
+  if (mode_ == Mode::Background) {
+    buffers_[1] = allocateBlock(bytes);
+  }
+  return true;
+}
+
+void SdBufferedWriter::releaseBuffers() {
+  for (uint8_t *&buffer : buffers_) {
+    if (buffer) {
+      freeBlock(buffer);
+      buffer = nullptr;
+    }
+  }
+  bufferBytes_ = 0;
+  pendingData_ = nullptr;
+}
+
+// Ends the block on a sector boundary of the file.
+size_t SdBufferedWriter::blockLimit() const {
+  return bufferBytes_ - (fileOffset_ % kSectorBytes);
+}
+
+bool SdBufferedWriter::submitBlock() {
+  if (fill_ == 0) {
+    return true;
+  }
+
+  if (buffers_[1]) {
+    // Set the block aside for pump(); an older one must be out first.
+    if (!drainPending()) {
+      return false;
+    }
+    pendingData_ = buffers_[active_];
+    pendingLen_ = fill_;
+    pendingDone_ = 0;
+    pendingOffset_ = fileOffset_;
+    active_ ^= 1U;
+    fileOffset_ += static_cast<uint32_t>(fill_);
+    fill_ = 0;
+    return true;
+  }
+
+  const size_t len = fill_;
+  const uint32_t offset = fileOffset_;
+  const size_t put = writeBlock(buffers_[active_], len);
+  fileOffset_ += static_cast<uint32_t>(len);
+  fill_ = 0;
+  return checkBlock(offset, put, len);
+}
+
+size_t SdBufferedWriter::writeBlock(const uint8_t *data, size_t len) {
+  return file_->write(data, len);
+}
+
+bool SdBufferedWriter::checkBlock(uint32_t offset, size_t put, size_t len) {
+  written_ += static_cast<uint32_t>(put);
+  if (put == len) {
+    return true;
+  }
+  fail("SD write failed at offset " + String(offset + static_cast<uint32_t>(put)) +
+       " (" + String(static_cast<uint32_t>(put)) + "/" +
+       String(static_cast<uint32_t>(len)) + " bytes)");
+  return false;
+}
+
+// Slices end on sector boundaries of the file, like whole blocks.
+bool SdBufferedWriter::writePendingSlice() {
+  const uint32_t offset = pendingOffset_ + static_cast<uint32_t>(pendingDone_);
+  size_t len = pendingLen_ - pendingDone_;
+  const size_t sliceEnd = (offset + kPumpSliceBytes) / kSectorBytes * kSectorBytes;
+  if (offset + len > sliceEnd) {
+    len = sliceEnd - offset;
+  }
+  const size_t put = writeBlock(pendingData_ + pendingDone_, len);
+  pendingDone_ += len;
+  if (pendingDone_ == pendingLen_) {
+    pendingData_ = nullptr;
+  }
+  return checkBlock(offset, put, len);
+}
+
+bool SdBufferedWriter::drainPending() {
+  while (pendingData_) {
+    if (!writePendingSlice()) {
+      return false;
+    }
+  }
+  return !failed_;
+}
+
+void SdBufferedWriter::fail(const String &message) {
+  failed_ = true;
+  lastError_ = message;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Collects small writes into large blocks before they reach the SD file.
+// Block boundaries are kept on 512-byte sector boundaries of the file (the
+// first block is shortened when the file starts mid-sector), so FAT writes
+// whole sectors instead of read-modify-writing partial ones.
+//
+// In background mode two buffers are used: a full block is set aside and
+// written a sector-aligned slice at a time by pump(), which the caller runs
+// between samples, while it fills the other buffer. All writes stay on the
+// caller's task, so they never overlap the display or radio on the shared
+// SPI bus; the slices keep each stall short during recordings. If the other
+// buffer fills before the set-aside block is written, write() finishes that
+// block first. Without a second buffer the writer writes whole blocks inline.
+//
+// A started writer retains the card (sdstorage::retain()) until end(), so the
+// SD benchmark cannot remount it mid-file.
+//
+// The first failed SD write latches: later calls return false and
+// lastError() describes the failure, including the file offset.
+class SdBufferedWriter {
+ public:
+  static constexpr size_t kSectorBytes = 512;
+  static constexpr size_t kDefaultBufferBytes = 16384;
+  // Most pump() writes per call: a whole number of sectors.
+  static constexpr size_t kPumpSliceBytes = 2048;
+
+  enum class Mode : uint8_t {
+    Inline,
+    Background,
+  };
+
+  explicit SdBufferedWriter(size_t bufferBytes = kDefaultBufferBytes,
+                            Mode mode = Mode::Inline);
+  ~SdBufferedWriter();
+
+  SdBufferedWriter(const SdBufferedWriter &) = delete;
+  SdBufferedWriter &operator=(const SdBufferedWriter &) = delete;
+
+  // Writes continue at the file's current position. The file must stay open
+  // until end(); the writer never closes it.
+  bool begin(File &file, String *error = nullptr);
+  bool write(const uint8_t *data, size_t len);
+  // Background mode: writes the next slice of the block set aside, if any.
+  bool pump();
+  // Writes out everything buffered so far and flushes the file.
+  bool flush();
+  // flush() plus releasing the buffers. Safe to call twice.
+  bool end(String *error = nullptr);
+
+  bool active() const;
+  bool failed() const;
+  bool background() const;
+  size_t bufferBytes() const;
+  // Bytes accepted by write(), buffered or not.
+  uint32_t bytesQueued() const;
+  // Bytes the SD file has acknowledged.
+  uint32_t bytesWritten() const;
+  const String &lastError() const;
+
+ private:
+  bool allocateBuffers();
+  void releaseBuffers();
+  size_t blockLimit() const;
+  bool submitBlock();
+  size_t writeBlock(const uint8_t *data, size_t len);
+  bool checkBlock(uint32_t offset, size_t put, size_t len);
+  bool writePendingSlice();
+  bool drainPending();
+  void fail(const String &message);
+
+  File *file_ = nullptr;
+  Mode mode_ = Mode::Inline;
+  size_t requestedBytes_ = 0;
+  size_t bufferBytes_ = 0;
+  uint8_t *buffers_[2] = {nullptr, nullptr};
+  uint8_t active_ = 0;
+  size_t fill_ = 0;
+  uint32_t fileOffset_ = 0;
+  uint32_t queued_ = 0;
+  uint32_t written_ = 0;
+  bool failed_ = false;
+  bool retained_ = false;
+  String lastError_;
+
+  // Background mode: the full block set aside for pump().
+  const uint8_t *pendingData_ = nullptr;
+  size_t pendingLen_ = 0;
+  size_t pendingDone_ = 0;
+  uint32_t pendingOffset_ = 0;
+};
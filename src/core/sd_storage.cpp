@@ -0,0 +1,467 @@
+#include "sd_storage.h"
+
+#include <Preferences.h>
+#include <SD.h>
+#include <SPI.h>
+#include <esp_random.h>
+#include <esp_rom_crc.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "board_pins.h"
+#include "shared_spi_bus.h"
+#include "../hal/board_config.h"
+
+namespace {
+
+constexpr const char *kPrefsNamespace = "sd_cfg";
+constexpr const char *kClockKey = "hz";
+constexpr const char *kCardKey = "card";
+constexpr const char *kMountPoint = "/sd";
+constexpr uint32_t kReferenceHz = 4000000UL;
+constexpr uint32_t kClockLadderHz[] = {40000000UL, 26666667UL, 20000000UL,
+                                       16000000UL, 10000000UL};
+constexpr uint32_t kProbeSectors = 8;
+constexpr const char *kProbePath = "/.sdprobe";
+constexpr unsigned long kRetryAfterFailMs = 2000UL;
+constexpr unsigned long kPresenceCheckMs = 5000UL;
+
+bool gMounted = false;
+bool gExclusive = false;
+uint8_t gRetainers = 0;
+unsigned long gLastFailMs = 0;
+unsigned long gLastPresenceCheckMs = 0;
+sdstorage::Info gInfo;
+uint8_t gSector[512];
+
+void setError(String *error, const char *message) {
+  if (error) {
+    *error = message;
+  }
+}
+
+// writeFileAtomic moves the old file to "<path>.bak" before renaming the new
+// one into place. If power was lost between the two renames, the backup is
+// the current file; put it back.
+void restoreBackup(const char *path) {
+  const String backupPath = String(path) + ".bak";
+  if (!SD.exists(backupPath.c_str())) {
+    return;
+  }
+  if (SD.exists(path)) {
+    SD.remove(backupPath.c_str());
+  } else if (SD.rename(backupPath.c_str(), path)) {
+    Serial.printf("[sd] restored %s from backup\n", path);
+  }
+}
+
+#if HAL_HAS_SD_CARD
+
+bool beginAt(uint32_t hz) {
+  SD.end();
+  sharedspi::prepareChipSelects();
+  return SD.begin(boardpins::kSdCs, *sharedspi::bus(), hz, kMountPoint, 8, false);
+}
+
+// Sector 0 (MBR or boot sector) does not change with file writes, so it
+// plus the capacity identifies a card well enough to reuse its clock.
+bool cardSignature(uint32_t &signature) {
+  if (!SD.readRAW(gSector, 0)) {
+    return false;
+  }
+  signature = esp_rom_crc32_le(0, gSector, sizeof(gSector)) ^
+              static_cast<uint32_t>(SD.cardSize() >> 9);
+  return true;
+}
+
+// Writes kProbeSectors of pseudo-random bytes to kProbePath, so a clock that
+// flips bits cannot pass by reading the zeros that fill most early sectors.
+bool writeProbeFile(uint32_t &crc) {
+  File file = SD.open(kProbePath, FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  crc = 0;
+  uint32_t state = esp_random() | 1U;
+  bool ok = true;
+  for (uint32_t sector = 0; sector < kProbeSectors && ok; ++sector) {
+    for (size_t i = 0; i < sizeof(gSector); i += 4) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      memcpy(gSector + i, &state, 4);
+    }
+    crc = esp_rom_crc32_le(crc, gSector, sizeof(gSector));
+    ok = file.write(gSector, sizeof(gSector)) == sizeof(gSector);
+  }
+  file.close();
+  return ok;
+}
+
+bool readProbeFileCrc(uint32_t &crc) {
+  File file = SD.open(kProbePath, FILE_READ);
+  if (!file) {
+    return false;
+  }
+  crc = 0;
+  bool ok = true;
+  for (uint32_t sector = 0; sector < kProbeSectors && ok; ++sector) {
+    ok = file.read(gSector, sizeof(gSector)) == static_cast<int>(sizeof(gSector));
+    crc = esp_rom_crc32_le(crc, gSector, sizeof(gSector));
+  }
+  file.close();
+  return ok;
+}
+
+// Fallback for cards that refuse the probe file (full or write-protected):
+// sectors spread over the whole card, which hold more than the zeros near
+// the start of a freshly formatted one.
+bool readSpreadSectorsCrc(uint32_t &crc) {
+  const uint32_t stride = static_cast<uint32_t>((SD.cardSize() >> 9) / kProbeSectors);
+  crc = 0;
+  for (uint32_t i = 0; i < kProbeSectors; ++i) {
+    if (!SD.readRAW(gSector, i * stride)) {
+      return false;
+    }
+    crc = esp_rom_crc32_le(crc, gSector, sizeof(gSector));
+  }
+  return true;
+}
+
+bool readProbeCrc(bool useFile, uint32_t &crc) {
+  return useFile ? readProbeFileCrc(crc) : readSpreadSectorsCrc(crc);
+}
+
+// Picks the fastest clock whose reads match data written and read back at a
+// slow reference clock.
+bool probeClock(uint32_t &chosenHz, String *error) {
+  if (!beginAt(kReferenceHz)) {
+    setError(error, "SD mount failed");
+    return false;
+  }
+  uint32_t written = 0;
+  uint32_t reference = 0;
+  const bool useFile = writeProbeFile(written) && readProbeFileCrc(reference) &&
+                       reference == written;
+  if (!useFile && !readSpreadSectorsCrc(reference)) {
+    setError(error, "SD read failed");
+    return false;
+  }
+
+  chosenHz = kReferenceHz;
+  for (const uint32_t hz : kClockLadderHz) {
+    if (hz > HAL_SD_SPI_MAX_FREQ || !beginAt(hz)) {
+      continue;
+    }
+    uint32_t first = 0;
+    uint32_t second = 0;
+    if (readProbeCrc(useFile, first) && readProbeCrc(useFile, second) &&
+        first == reference && second == reference) {
+      chosenHz = hz;
+      break;
+    }
+  }
+
+  if (chosenHz == kReferenceHz && !beginAt(kReferenceHz)) {
+    setError(error, "SD mount failed");
+    return false;
+  }
+  if (useFile) {
+    SD.remove(kProbePath);
+  }
+  return true;
+}
+
+bool mountCard(bool forceProbe, String *error) {
+  const unsigned long startMs = millis();
+  gMounted = false;
+  gInfo.clockProbed = false;
+
+  Preferences prefs;
+  uint32_t cachedHz = 0;
+  uint32_t cachedCard = 0;
+  // Read-write so the first boot creates the namespace without a NOT_FOUND log.
+  if (prefs.begin(kPrefsNamespace, false)) {
+    cachedHz = prefs.getULong(kClockKey, 0);
+    cachedCard = prefs.getULong(kCardKey, 0);
+    prefs.end();
+  }
+
+  uint32_t hz = 0;
+  uint32_t signature = 0;
+  if (!forceProbe && cachedHz != 0 && beginAt(cachedHz) && cardSignature(signature) &&
+      signature == cachedCard) {
+    hz = cachedHz;
+  } else {
+    if (!probeClock(hz, error)) {
+      SD.end();
+      gLastFailMs = millis();
+      return false;
+    }
+    gInfo.clockProbed = true;
+    if (cardSignature(signature) && prefs.begin(kPrefsNamespace, false)) {
+      prefs.putULong(kClockKey, hz);
+      prefs.putULong(kCardKey, signature);
+      prefs.end();
+    }
+  }
+
+  gMounted = true;
+  gLastFailMs = 0;
+  gLastPresenceCheckMs = millis();
+  gInfo.spiHz = hz;
+  gInfo.lastMountMs = millis() - startMs;
+  ++gInfo.mounts;
+  Serial.printf("[sd] mounted at %lu Hz in %lu ms%s\n",
+                static_cast<unsigned long>(hz),
+                static_cast<unsigned long>(gInfo.lastMountMs),
+                gInfo.clockProbed ? " (clock probed)" : "");
+  return true;
+}
+
+#endif  // HAL_HAS_SD_CARD
+
+}  // namespace
+
+namespace sdstorage {
+
+bool ensureMounted(String *error) {
+#if HAL_HAS_SD_CARD
+  if (gExclusive) {
+    setError(error, "SD card busy with the benchmark");
+    return false;
+  }
+  if (gMounted) {
+    return true;
+  }
+  if (gLastFailMs != 0 && millis() - gLastFailMs < kRetryAfterFailMs) {
+    setError(error, "SD card not found");
+    return false;
+  }
+  return mountCard(false, error);
+#else
+  setError(error, "SD card not available on this board");
+  return false;
+#endif
+}
+
+bool remount(String *error) {
+#if HAL_HAS_SD_CARD
+  if (gExclusive || gRetainers > 0) {
+    setError(error, "SD card in use");
+    return false;
+  }
+  SD.end();
+  gMounted = false;
+  return mountCard(true, error);
+#else
+  setError(error, "SD card not available on this board");
+  return false;
+#endif
+}
+
+bool remountAt(uint32_t hz, String *error) {
+#if HAL_HAS_SD_CARD
+  const unsigned long startMs = millis();
+  gMounted = false;
+  if (hz == 0 || !beginAt(hz)) {
+    SD.end();
+    gLastFailMs = millis();
+    setError(error, "SD mount failed");
+    return false;
+  }
+  gMounted = true;
+  gLastFailMs = 0;
+  gLastPresenceCheckMs = millis();
+  gInfo.clockProbed = false;
+  gInfo.spiHz = hz;
+  gInfo.lastMountMs = millis() - startMs;
+  ++gInfo.mounts;
+  return true;
+#else
+  (void)hz;
+  setError(error, "SD card not available on this board");
+  return false;
+#endif
+}
+
+bool isMounted() {
+  return gMounted;
+}
+
+void retain() {
+  ++gRetainers;
+}
+
+void release() {
+  if (gRetainers > 0) {
+    --gRetainers;
+  }
+}
+
+bool acquireExclusive(String *error) {
+  if (gExclusive) {
+    setError(error, "SD card busy with the benchmark");
+    return false;
+  }
+  if (gRetainers > 0) {
+    setError(error, "SD busy with a recording or download");
+    return false;
+  }
+  gExclusive = true;
+  return true;
+}
+
+void releaseExclusive() {
+  gExclusive = false;
+}
+
+bool exclusiveHeld() {
+  return gExclusive;
+}
+
+void tick() {
+#if HAL_HAS_SD_CARD
+  // The benchmark remounts the card; do not interleave.
+  if (!gMounted || gExclusive) {
+    return;
+  }
+  const unsigned long now = millis();
+  if (now - gLastPresenceCheckMs < kPresenceCheckMs) {
+    return;
+  }
+  gLastPresenceCheckMs = now;
+
+  if (SD.readRAW(gSector, 0)) {
+    return;
+  }
+  Serial.println("[sd] card removed");
+  SD.end();
+  gMounted = false;
+  gLastFailMs = now;
+  ++gInfo.removals;
+#endif
+}
+
+Info info() {
+  Info out = gInfo;
+  out.mounted = gMounted;
+  return out;
+}
+
+bool readFile(const char *path, String &out, size_t maxLen, String *error) {
+  out = "";
+  if (!ensureMounted(error)) {
+    return false;
+  }
+  restoreBackup(path);
+
+  File file = SD.open(path, FILE_READ);
+  if (!file || file.isDirectory()) {
+    if (file) {
+      file.close();
+    }
+    setError(error, "File open failed");
+    return false;
+  }
+
+  const size_t size = file.size();
+  if (size > maxLen) {
+    file.close();
+    setError(error, "File too large");
+    return false;
+  }
+
+  out.reserve(size);
+  char chunk[512];
+  size_t total = 0;
+  while (total < size) {
+    const int read = file.read(reinterpret_cast<uint8_t *>(chunk), sizeof(chunk));
+    if (read <= 0) {
+      break;
+    }
+    out.concat(chunk, static_cast<unsigned int>(read));
+    total += static_cast<size_t>(read);
+  }
+  file.close();
+
+  if (total != size) {
+    setError(error, "File read failed");
+    return false;
+  }
+  return true;
+}
+
+bool truncateFile(const char *path, uint32_t size, String *error) {
+  if (!ensureMounted(error)) {
+    return false;
+  }
+  // The Arduino File API has no truncate; FATFS supports it through VFS.
+  const String vfsPath = String(kMountPoint) + path;
+  if (::truncate(vfsPath.c_str(), static_cast<off_t>(size)) != 0) {
+    setError(error, "SD truncate failed");
+    return false;
+  }
+  return true;
+}
+
+bool writeFileAtomic(const char *path, const uint8_t *data, size_t len, String *error) {
+  if (!ensureMounted(error)) {
+    return false;
+  }
+
+  restoreBackup(path);
+  const String tempPath = String(path) + ".tmp";
+  if (SD.exists(tempPath.c_str())) {
+    SD.remove(tempPath.c_str());
+  }
+
+  File temp = SD.open(tempPath.c_str(), FILE_WRITE);
+  if (!temp || temp.isDirectory()) {
+    if (temp) {
+      temp.close();
+    }
+    setError(error, "SD temp write open failed");
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < len) {
+    const size_t chunk = len - written < kIoChunkBytes ? len - written : kIoChunkBytes;
+    const size_t put = temp.write(data + written, chunk);
+    written += put;
+    if (put != chunk) {
+      break;
+    }
+  }
+  temp.close();
+  if (written != len) {
+    SD.remove(tempPath.c_str());
+    setError(error, "SD write failed");
+    return false;
+  }
+
+  // tmp -> path never runs with neither file on the card: the old one is
+  // kept as .bak until the new one is in place.
+  const String backupPath = String(path) + ".bak";
+  const bool hadOld = SD.exists(path);
+  if (hadOld && !SD.rename(path, backupPath.c_str())) {
+    SD.remove(tempPath.c_str());
+    setError(error, "SD rename failed");
+    return false;
+  }
+  if (!SD.rename(tempPath.c_str(), path)) {
+    if (hadOld) {
+      SD.rename(backupPath.c_str(), path);
+    }
+    SD.remove(tempPath.c_str());
+    setError(error, "SD rename failed");
+    return false;
+  }
+  if (hadOld) {
+    SD.remove(backupPath.c_str());
+  }
+  return true;
+}
+
+}  // namespace sdstorage
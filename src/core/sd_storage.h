@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Owns the SD card mount for every app and service. The first mount of a
+// card probes the highest SPI clock whose sector reads match a slow
+// reference read and caches it in NVS; later mounts reuse it. While mounted,
+// a periodic sector read notices a removed card.
+namespace sdstorage {
+
+// Transfer chunk for file I/O: a whole number of 512-byte sectors.
+constexpr size_t kIoChunkBytes = 4096;
+
+struct Info {
+  bool mounted = false;
+  bool clockProbed = false;  // last mount ran the clock probe
+  uint32_t spiHz = 0;
+  uint32_t lastMountMs = 0;
+  uint32_t mounts = 0;
+  uint32_t removals = 0;
+};
+
+// Returns at once while mounted. After a failed attempt, further calls fail
+// fast for a couple of seconds instead of re-probing the bus.
+bool ensureMounted(String *error = nullptr);
+// Unmounts and probes again, e.g. after the card was swapped.
+bool remount(String *error = nullptr);
+// Mounts at exactly `hz` without probing or touching the cached clock. The
+// SD benchmark uses it, under acquireExclusive(), to step through clocks and
+// then restore the probed one.
+bool remountAt(uint32_t hz, String *error = nullptr);
+bool isMounted();
+
+// Files kept open across loop iterations (recordings, downloads) hold the
+// card so nothing remounts it under them.
+void retain();
+void release();
+// Exclusive use for the SD benchmark, which remounts the card. Fails while
+// the card is retained; while held, ensureMounted() and remount() refuse
+// every other caller.
+bool acquireExclusive(String *error = nullptr);
+void releaseExclusive();
+bool exclusiveHeld();
+void tick();
+Info info();
+
+// Reads a whole file of at most `maxLen` bytes.
+bool readFile(const char *path, String &out, size_t maxLen, String *error = nullptr);
+// Cuts `path` to `size` bytes.
+bool truncateFile(const char *path, uint32_t size, String *error = nullptr);
+// Writes "<path>.tmp", renames the old file to "<path>.bak", renames the
+// temp file into place, then removes the backup. A failed write keeps the
+// previous file; a backup left by a power loss is restored on the next read
+// or write of `path`.
+bool writeFileAtomic(const char *path,
+                     const uint8_t *data,
+                     size_t len,
+                     String *error = nullptr);
+
+}  // namespace sdstorage
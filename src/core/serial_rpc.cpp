@@ -0,0 +1,363 @@
+#include "serial_rpc.h"
+
+#include <ArduinoJson.h>
+
+#include "cc1101_radio.h"
+#include "node_command_handler.h"
+
+namespace {
+
+constexpr size_t kFrameOverhead = kSerialRpcFrameOverhead;
+constexpr size_t kReplyCapacity = 6144;
+constexpr size_t kReadChunkBytes = 256;
+constexpr size_t kReadBudgetBytes = 16 * 1024;  // per tick, keeps the loop responsive
+constexpr unsigned long kActiveWindowMs = 5000;
+// Streams hold the radio; stop them if the host goes quiet (clients ping).
+constexpr unsigned long kStreamIdleTimeoutMs = 10000;
+constexpr unsigned long kRssiFlushMs = 50;
+
+enum StreamStatus : uint8_t {
+  kStreamOk = 0,
+  kStreamBusy = 1,
+  kStreamInvalid = 2,
+  kStreamUnavailable = 3,
+};
+
+enum ErrorReason : uint8_t {
+  kErrorCrc = 1,
+  kErrorTooLong = 2,
+  kErrorUnknownType = 3,
+  kErrorMalformed = 4,
+};
+
+uint16_t readLe16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void writeLe16(uint8_t *p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void writeLe32(uint8_t *p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+int8_t clampRssi(int rssi) {
+  return static_cast<int8_t>(rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi));
+}
+
+}  // namespace
+
+void SerialRpc::begin(NodeCommandHandler *commands) {
+  commands_ = commands;
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+  // Larger CDC queues let bulk transfers run without per-packet stalls.
+  Serial.setRxBufferSize(8192);
+  Serial.setTxBufferSize(8192);
+#endif
+}
+
+bool SerialRpc::isActive() const {
+  return packetStream_ || rssiStream_ ||
+         (seenHost_ && millis() - lastFrameMs_ < kActiveWindowMs);
+}
+
+const SerialRpcStats &SerialRpc::stats() const {
+  return stats_;
+}
+
+void SerialRpc::tick() {
+  if (!commands_) {
+    return;
+  }
+
+  uint8_t chunk[kReadChunkBytes];
+  size_t budget = kReadBudgetBytes;
+  while (budget > 0) {
+    const int available = Serial.available();
+    if (available <= 0) {
+      break;
+    }
+    size_t want = static_cast<size_t>(available);
+    if (want > sizeof(chunk)) {
+      want = sizeof(chunk);
+    }
+    const size_t got = Serial.read(chunk, want);
+    if (got == 0) {
+      break;
+    }
+    stats_.bytesIn += got;
+    budget = got >= budget ? 0 : budget - got;
+
+    for (size_t i = 0; i < got; ++i) {
+      const uint8_t b = chunk[i];
+      if (b != 0) {
+        if (rxLen_ < sizeof(rx_)) {
+          rx_[rxLen_++] = b;
+        } else {
+          rxOverflow_ = true;
+        }
+        continue;
+      }
+
+      if (rxOverflow_) {
+        ++stats_.badFrames;
+        const uint8_t reason = kErrorTooLong;
+        sendFrame(kSerialRpcError, 0, &reason, 1, nullptr, 0, true);
+      } else if (rxLen_ > 0) {
+        const size_t len = cobsDecode(rx_, rxLen_, rx_, sizeof(rx_));
+        handleFrame(rx_, len);
+      }
+      rxLen_ = 0;
+      rxOverflow_ = false;
+    }
+  }
+
+  tickStreams(millis());
+}
+
+void SerialRpc::handleFrame(uint8_t *frame, size_t len) {
+  if (len < kFrameOverhead) {
+    ++stats_.badFrames;
+    const uint8_t reason = kErrorMalformed;
+    sendFrame(kSerialRpcError, 0, &reason, 1, nullptr, 0, true);
+    return;
+  }
+  if (serialRpcCrc(frame, len - 4) != readLe32(frame + len - 4)) {
+    ++stats_.badFrames;
+    const uint8_t reason = kErrorCrc;
+    sendFrame(kSerialRpcError, 0, &reason, 1, nullptr, 0, true);
+    return;
+  }
+
+  ++stats_.framesIn;
+  seenHost_ = true;
+  lastFrameMs_ = millis();
+
+  const uint8_t type = frame[0];
+  const uint16_t seq = readLe16(frame + 1);
+  const uint8_t *payload = frame + 3;
+  const size_t payloadLen = len - kFrameOverhead;
+
+  switch (type) {
+    case kSerialRpcCall:
+      handleCall(seq, payload, payloadLen);
+      break;
+    case kSerialRpcPing:
+      sendFrame(kSerialRpcPong, seq, payload, payloadLen, nullptr, 0, false);
+      break;
+    case kSerialRpcStreamStart:
+      handleStreamStart(seq, payload, payloadLen);
+      break;
+    case kSerialRpcStreamStop:
+      handleStreamStop(seq, payload, payloadLen);
+      break;
+    default: {
+      const uint8_t reason = kErrorUnknownType;
+      sendFrame(kSerialRpcError, seq, &reason, 1, nullptr, 0, true);
+      break;
+    }
+  }
+}
+
+void SerialRpc::handleCall(uint16_t seq, const uint8_t *payload, size_t len) {
+  auto reply = [this, seq](JsonDocument *result, const NodeCommandError &error) {
+    DynamicJsonDocument doc(kReplyCapacity);
+    doc["ok"] = result != nullptr;
+    if (result) {
+      doc["result"] = result->as<JsonVariantConst>();
+    } else {
+      JsonObject err = doc.createNestedObject("error");
+      err["code"] = error.code;
+      err["message"] = error.message;
+    }
+    if (measureJson(doc) + kFrameOverhead > kMaxFrameBytes) {
+      doc.clear();
+      doc["ok"] = false;
+      JsonObject err = doc.createNestedObject("error");
+      err["code"] = "UNAVAILABLE";
+      err["message"] = "result exceeds serial frame size";
+    }
+    String text;
+    serializeJson(doc, text);
+    sendFrame(kSerialRpcResult,
+              seq,
+              reinterpret_cast<const uint8_t *>(text.c_str()),
+              text.length(),
+              nullptr,
+              0,
+              false);
+  };
+
+  DynamicJsonDocument request(kMaxFrameBytes + 512);
+  const auto parseErr =
+      deserializeJson(request, reinterpret_cast<const char *>(payload), len);
+  if (parseErr || !request["command"].is<const char *>()) {
+    NodeCommandError error;
+    error.message = "expected {\"command\",\"params\"}";
+    reply(nullptr, error);
+    return;
+  }
+
+  commands_->invokeLocal("serial:" + String(seq),
+                         request["command"].as<const char *>(),
+                         request["params"].as<JsonObjectConst>(),
+                         reply);
+}
+
+void SerialRpc::handleStreamStart(uint16_t seq, const uint8_t *payload, size_t len) {
+  uint8_t ack[2] = {len > 0 ? payload[0] : static_cast<uint8_t>(0), kStreamOk};
+  const uint8_t channel = ack[0];
+  if (len < 3 || (channel != kSerialRpcChannelPackets && channel != kSerialRpcChannelRssi)) {
+    ack[1] = kStreamInvalid;
+    sendFrame(kSerialRpcStreamAck, seq, ack, sizeof(ack), nullptr, 0, false);
+    return;
+  }
+
+  // Both channels share the radio; take it once for the first stream.
+  if (!packetStream_ && !rssiStream_) {
+    String rxErr;
+    if (!commands_->acquireResources(kNodeResourceRadio)) {
+      ack[1] = kStreamBusy;
+    } else if (!startCc1101PacketReceive(rxErr)) {
+      commands_->releaseResources(kNodeResourceRadio);
+      ack[1] = kStreamUnavailable;
+    }
+    if (ack[1] != kStreamOk) {
+      sendFrame(kSerialRpcStreamAck, seq, ack, sizeof(ack), nullptr, 0, false);
+      return;
+    }
+  }
+
+  if (channel == kSerialRpcChannelPackets) {
+    packetStream_ = true;
+  } else {
+    uint16_t interval = readLe16(payload + 1);
+    rssiIntervalMs_ = interval < 1 ? 1 : (interval > 1000 ? 1000 : interval);
+    rssiStream_ = true;
+    rssiCount_ = 0;
+    nextRssiMs_ = millis();
+  }
+  sendFrame(kSerialRpcStreamAck, seq, ack, sizeof(ack), nullptr, 0, false);
+}
+
+void SerialRpc::handleStreamStop(uint16_t seq, const uint8_t *payload, size_t len) {
+  uint8_t ack[2] = {len > 0 ? payload[0] : static_cast<uint8_t>(0), kStreamOk};
+  if (ack[0] == kSerialRpcChannelPackets) {
+    packetStream_ = false;
+  } else if (ack[0] == kSerialRpcChannelRssi) {
+    flushRssi();
+    rssiStream_ = false;
+  } else {
+    ack[1] = kStreamInvalid;
+  }
+  if (!packetStream_ && !rssiStream_) {
+    commands_->releaseResources(kNodeResourceRadio);
+  }
+  sendFrame(kSerialRpcStreamAck, seq, ack, sizeof(ack), nullptr, 0, false);
+}
+
+void SerialRpc::stopStreams() {
+  if (!packetStream_ && !rssiStream_) {
+    return;
+  }
+  flushRssi();
+  packetStream_ = false;
+  rssiStream_ = false;
+  commands_->releaseResources(kNodeResourceRadio);
+}
+
+void SerialRpc::tickStreams(unsigned long nowMs) {
+  if (!packetStream_ && !rssiStream_) {
+    return;
+  }
+  if (nowMs - lastFrameMs_ >= kStreamIdleTimeoutMs) {
+    stopStreams();
+    return;
+  }
+
+  if (packetStream_) {
+    uint8_t packet[2 + 64];
+    size_t len = 0;
+    int rssi = 0;
+    if (pollCc1101PacketReceive(packet + 2, sizeof(packet) - 2, len, &rssi)) {
+      const uint8_t channel = kSerialRpcChannelPackets;
+      packet[0] = static_cast<uint8_t>(clampRssi(rssi));
+      packet[1] = static_cast<uint8_t>(len);
+      sendFrame(kSerialRpcStreamData, streamSeq_++, &channel, 1, packet, len + 2, true);
+    }
+  }
+
+  if (rssiStream_) {
+    if (static_cast<long>(nowMs - nextRssiMs_) >= 0) {
+      int rssi = 0;
+      if (sampleCc1101RssiDbm(rssi)) {
+        if (rssiCount_ == 0) {
+          rssiFirstMs_ = nowMs;
+        }
+        rssiBatch_[rssiCount_++] = clampRssi(rssi);
+      }
+      nextRssiMs_ += rssiIntervalMs_;
+      if (static_cast<long>(nowMs - nextRssiMs_) > static_cast<long>(rssiIntervalMs_)) {
+        nextRssiMs_ = nowMs + rssiIntervalMs_;  // fell behind; don't burst
+      }
+    }
+    if (rssiCount_ >= kMaxRssiBatch ||
+        (rssiCount_ > 0 && nowMs - rssiFirstMs_ >= kRssiFlushMs)) {
+      flushRssi();
+    }
+  }
+}
+
+void SerialRpc::flushRssi() {
+  if (rssiCount_ == 0) {
+    return;
+  }
+  uint8_t head[8];
+  head[0] = kSerialRpcChannelRssi;
+  writeLe32(head + 1, static_cast<uint32_t>(rssiFirstMs_));
+  writeLe16(head + 5, rssiIntervalMs_);
+  head[7] = rssiCount_;
+  sendFrame(kSerialRpcStreamData,
+            streamSeq_++,
+            head,
+            sizeof(head),
+            reinterpret_cast<const uint8_t *>(rssiBatch_),
+            rssiCount_,
+            true);
+  rssiCount_ = 0;
+}
+
+bool SerialRpc::sendFrame(uint8_t type,
+                          uint16_t seq,
+                          const uint8_t *head,
+                          size_t headLen,
+                          const uint8_t *body,
+                          size_t bodyLen,
+                          bool droppable) {
+  const size_t encodedLen = serialRpcEncodeFrame(
+      type, seq, head, headLen, body, bodyLen, raw_, sizeof(raw_), encoded_, sizeof(encoded_));
+  if (encodedLen == 0) {
+    ++stats_.droppedOut;
+    return false;
+  }
+
+  // Stream data is dropped rather than stalling the loop on a slow host.
+  if (droppable && static_cast<size_t>(Serial.availableForWrite()) < encodedLen) {
+    ++stats_.droppedOut;
+    return false;
+  }
+  Serial.write(encoded_, encodedLen);
+  ++stats_.framesOut;
+  stats_.bytesOut += encodedLen;
+  return true;
+}
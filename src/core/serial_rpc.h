@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "serial_rpc_frame.h"
+
+class NodeCommandHandler;
+
+// Frame types; the layout is in serial_rpc_frame.h.
+enum SerialRpcFrameType : uint8_t {
+  kSerialRpcCall = 0x01,         // JSON {"command","params"}
+  kSerialRpcPing = 0x02,         // echoed back as Pong
+  kSerialRpcStreamStart = 0x03,  // channel(1) intervalMs(2)
+  kSerialRpcStreamStop = 0x04,   // channel(1)
+  kSerialRpcResult = 0x81,       // JSON {"ok","result"|"error"}
+  kSerialRpcPong = 0x82,
+  kSerialRpcStreamAck = 0x83,    // channel(1) status(1)
+  kSerialRpcStreamData = 0x90,   // channel(1) body
+  kSerialRpcError = 0xFF,        // reason(1)
+};
+
+enum SerialRpcChannel : uint8_t {
+  kSerialRpcChannelPackets = 1,  // body: rssi(i8) len(1) bytes
+  kSerialRpcChannelRssi = 2,     // body: firstMs(4) intervalMs(2) count(1) rssi(i8)...
+};
+
+struct SerialRpcStats {
+  uint32_t framesIn = 0;
+  uint32_t framesOut = 0;
+  uint32_t badFrames = 0;
+  uint32_t droppedOut = 0;
+  uint32_t bytesIn = 0;
+  uint32_t bytesOut = 0;
+};
+
+// Binary RPC over the USB CDC serial port: the node command set plus
+// streaming packet/RSSI channels. Log text on the same port never contains
+// 0x00, and every frame starts with a 0x00, so log text between frames is
+// seen by hosts as a separate chunk that fails the CRC and is skipped. A log
+// line another task prints in the middle of a frame corrupts that frame; the
+// CRC rejects it and only that frame is lost.
+class SerialRpc {
+ public:
+  static constexpr size_t kMaxFrameBytes = 2048;
+
+  void begin(NodeCommandHandler *commands);
+  void tick();
+
+  // A host has sent a valid frame within the last few seconds.
+  bool isActive() const;
+  const SerialRpcStats &stats() const;
+
+ private:
+  static constexpr size_t kMaxEncodedBytes = cobsMaxEncodedSize(kMaxFrameBytes) + 1;
+  static constexpr size_t kMaxRssiBatch = 64;
+
+  void handleFrame(uint8_t *frame, size_t len);
+  void handleCall(uint16_t seq, const uint8_t *payload, size_t len);
+  void handleStreamStart(uint16_t seq, const uint8_t *payload, size_t len);
+  void handleStreamStop(uint16_t seq, const uint8_t *payload, size_t len);
+  void stopStreams();
+  void tickStreams(unsigned long nowMs);
+  void flushRssi();
+  bool sendFrame(uint8_t type,
+                 uint16_t seq,
+                 const uint8_t *head,
+                 size_t headLen,
+                 const uint8_t *body,
+                 size_t bodyLen,
+                 bool droppable);
+
+  NodeCommandHandler *commands_ = nullptr;
+  SerialRpcStats stats_;
+  unsigned long lastFrameMs_ = 0;
+  bool seenHost_ = false;
+
+  uint8_t rx_[kMaxEncodedBytes];
+  size_t rxLen_ = 0;
+  bool rxOverflow_ = false;
+  uint8_t raw_[kMaxFrameBytes];
+  uint8_t encoded_[serialRpcMaxWireSize(kMaxFrameBytes)];
+  uint16_t streamSeq_ = 0;
+
+  bool packetStream_ = false;
+  bool rssiStream_ = false;
+  uint16_t rssiIntervalMs_ = 10;
+  unsigned long nextRssiMs_ = 0;
+  unsigned long rssiFirstMs_ = 0;
+  int8_t rssiBatch_[kMaxRssiBatch];
+  uint8_t rssiCount_ = 0;
+};
@@ -0,0 +1,43 @@
+#include "serial_rpc_frame.h"
+
+#include <esp_rom_crc.h>
+#include <string.h>
+
+uint32_t serialRpcCrc(const uint8_t *data, size_t len) {
+  return esp_rom_crc32_le(0, data, len);
+}
+
+size_t serialRpcEncodeFrame(uint8_t type,
+                            uint16_t seq,
+                            const uint8_t *head,
+                            size_t headLen,
+                            const uint8_t *body,
+                            size_t bodyLen,
+                            uint8_t *raw,
+                            size_t rawCapacity,
+                            uint8_t *out,
+                            size_t outCapacity) {
+  const size_t rawLen = kSerialRpcFrameOverhead + headLen + bodyLen;
+  if (rawLen > rawCapacity || outCapacity < serialRpcMaxWireSize(rawLen)) {
+    return 0;
+  }
+
+  raw[0] = type;
+  raw[1] = static_cast<uint8_t>(seq);
+  raw[2] = static_cast<uint8_t>(seq >> 8);
+  if (headLen > 0) {
+    memcpy(raw + 3, head, headLen);
+  }
+  if (bodyLen > 0) {
+    memcpy(raw + 3 + headLen, body, bodyLen);
+  }
+  const uint32_t crc = serialRpcCrc(raw, rawLen - 4);
+  for (size_t i = 0; i < 4; ++i) {
+    raw[rawLen - 4 + i] = static_cast<uint8_t>(crc >> (8 * i));
+  }
+
+  out[0] = 0;
+  size_t len = 1 + cobsEncode(raw, rawLen, out + 1, outCapacity - 2);
+  out[len++] = 0;
+  return len;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cobs.h"
+
+// Wire format of the serial RPC, kept free of Arduino so host tests build
+// it. Decoded frame: type(1) seq(2, LE) payload crc32(4, LE over
+// type..payload). On the wire each frame is COBS-encoded and sent between
+// two 0x00 bytes: the leading one ends any log text printed before it, so
+// that text is discarded as its own chunk instead of corrupting the frame.
+
+constexpr size_t kSerialRpcFrameOverhead = 7;  // type + seq + crc
+
+constexpr size_t serialRpcMaxWireSize(size_t rawLen) {
+  return cobsMaxEncodedSize(rawLen) + 2;
+}
+
+uint32_t serialRpcCrc(const uint8_t *data, size_t len);
+
+// Builds the frame in `raw` and its wire form in `out`. Returns the wire
+// length, or 0 if either buffer is too small.
+size_t serialRpcEncodeFrame(uint8_t type,
+                            uint16_t seq,
+                            const uint8_t *head,
+                            size_t headLen,
+                            const uint8_t *body,
+                            size_t bodyLen,
+                            uint8_t *raw,
+                            size_t rawCapacity,
+                            uint8_t *out,
+                            size_t outCapacity);
@@ -0,0 +1,205 @@
+#include "telemetry_encoder.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+uint32_t hashText(const char *text) {
+  uint32_t hash = 2166136261UL;
+  for (const char *p = text; *p; ++p) {
+    hash ^= static_cast<uint8_t>(*p);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// Writes `value` as a JSON string literal into dst, truncating on overflow.
+void quoteJsonString(char *dst, size_t dstSize, const char *value) {
+  size_t out = 0;
+  const size_t limit = dstSize - 2;  // room for the closing quote and NUL
+  dst[out++] = '"';
+  for (const char *p = value ? value : ""; *p && out < limit; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      if (out + 2 > limit) {
+        break;
+      }
+      dst[out++] = '\\';
+      dst[out++] = static_cast<char>(c);
+    } else if (c < 0x20) {
+      if (out + 6 > limit) {
+        break;
+      }
+      snprintf(dst + out, 7, "\\u%04x", c);
+      out += 6;
+    } else {
+      dst[out++] = static_cast<char>(c);
+    }
+  }
+  dst[out++] = '"';
+  dst[out] = '\0';
+}
+
+}  // namespace
+
+TelemetryEncoder::Field *TelemetryEncoder::fieldFor(const char *name) {
+  if (!name || name[0] == '\0') {
+    return nullptr;
+  }
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    if (strcmp(fields_[i].name, name) == 0) {
+      return &fields_[i];
+    }
+  }
+  if (fieldCount_ >= kMaxFields) {
+    return nullptr;
+  }
+  Field &field = fields_[fieldCount_++];
+  strncpy(field.name, name, kMaxNameLen);
+  field.name[kMaxNameLen] = '\0';
+  return &field;
+}
+
+void TelemetryEncoder::setText(Field &field, const char *text) {
+  strncpy(field.value, text, kMaxValueLen);
+  field.value[kMaxValueLen] = '\0';
+  field.valueHash = hashText(field.value);
+}
+
+void TelemetryEncoder::setBool(const char *name, bool value) {
+  Field *field = fieldFor(name);
+  if (!field) {
+    return;
+  }
+  field->numeric = false;
+  setText(*field, value ? "true" : "false");
+}
+
+void TelemetryEncoder::setInt(const char *name, int32_t value, uint32_t deadband) {
+  Field *field = fieldFor(name);
+  if (!field) {
+    return;
+  }
+  char text[16];
+  snprintf(text, sizeof(text), "%ld", static_cast<long>(value));
+  field->numeric = true;
+  field->number = value;
+  field->deadband = deadband;
+  setText(*field, text);
+}
+
+void TelemetryEncoder::setFloat(const char *name, float value, uint8_t decimals) {
+  Field *field = fieldFor(name);
+  if (!field) {
+    return;
+  }
+  char text[24];
+  if (isnan(value) || isinf(value)) {
+    strcpy(text, "null");
+  } else {
+    snprintf(text, sizeof(text), "%.*f", static_cast<int>(decimals), static_cast<double>(value));
+  }
+  field->numeric = false;
+  setText(*field, text);
+}
+
+void TelemetryEncoder::setString(const char *name, const char *value) {
+  Field *field = fieldFor(name);
+  if (!field) {
+    return;
+  }
+  char text[kMaxValueLen + 1];
+  quoteJsonString(text, sizeof(text), value);
+  field->numeric = false;
+  setText(*field, text);
+}
+
+void TelemetryEncoder::setPassive(const char *name, uint32_t value) {
+  Field *field = fieldFor(name);
+  if (!field) {
+    return;
+  }
+  char text[16];
+  snprintf(text, sizeof(text), "%lu", static_cast<unsigned long>(value));
+  field->numeric = false;
+  field->passive = true;
+  setText(*field, text);
+}
+
+bool TelemetryEncoder::changed(const Field &field) const {
+  if (!field.acked) {
+    return true;
+  }
+  if (field.valueHash == field.ackedHash) {
+    return false;
+  }
+  if (field.numeric && field.deadband > 0) {
+    const int64_t diff = static_cast<int64_t>(field.number) - field.ackedNumber;
+    const uint64_t magnitude = diff < 0 ? static_cast<uint64_t>(-diff) : static_cast<uint64_t>(diff);
+    return magnitude >= field.deadband;
+  }
+  return true;
+}
+
+bool TelemetryEncoder::hasChanges() const {
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    if (!fields_[i].passive && changed(fields_[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t TelemetryEncoder::writeFields(String &out, bool full) {
+  size_t written = 0;
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    Field &field = fields_[i];
+    if (!full && !field.passive && !changed(field)) {
+      continue;
+    }
+    if (written > 0) {
+      out += ',';
+    }
+    out += '"';
+    out += field.name;
+    out += "\":";
+    out += field.value;
+    field.pending = true;
+    field.pendingHash = field.valueHash;
+    field.pendingNumber = field.number;
+    ++written;
+  }
+  return written;
+}
+
+void TelemetryEncoder::commitPending() {
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    Field &field = fields_[i];
+    if (!field.pending) {
+      continue;
+    }
+    field.acked = true;
+    field.ackedHash = field.pendingHash;
+    field.ackedNumber = field.pendingNumber;
+    field.pending = false;
+  }
+}
+
+void TelemetryEncoder::discardPending() {
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    fields_[i].pending = false;
+  }
+}
+
+void TelemetryEncoder::invalidate() {
+  for (size_t i = 0; i < fieldCount_; ++i) {
+    fields_[i].acked = false;
+    fields_[i].pending = false;
+  }
+}
+
+size_t TelemetryEncoder::fieldCount() const {
+  return fieldCount_;
+}
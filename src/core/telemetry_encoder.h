@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Flat telemetry snapshot that serializes straight to JSON text. Each field
+// remembers the value last acknowledged by the gateway, so a frame can carry
+// only what changed since then; keyframes carry everything.
+//
+// Usage per sample: set*() every field, then writeFields() if hasChanges().
+// After the send is acknowledged call commitPending(), otherwise
+// discardPending() and the same fields are reported again next time.
+class TelemetryEncoder {
+ public:
+  static constexpr size_t kMaxFields = 24;
+  static constexpr size_t kMaxNameLen = 23;
+  static constexpr size_t kMaxValueLen = 47;
+
+  void setBool(const char *name, bool value);
+  // Changes smaller than `deadband` (vs. the acked value) are not reported.
+  void setInt(const char *name, int32_t value, uint32_t deadband = 0);
+  void setFloat(const char *name, float value, uint8_t decimals = 2);
+  void setString(const char *name, const char *value);
+  // Reported with other changes and keyframes but never a change on its own
+  // (uptime, counters).
+  void setPassive(const char *name, uint32_t value);
+
+  bool hasChanges() const;
+  // Appends `"name":value` members separated by commas, without braces.
+  // Returns the number of fields written and marks them pending.
+  size_t writeFields(String &out, bool full);
+  void commitPending();
+  void discardPending();
+  // Forgets the acknowledged baseline (gateway reconnected).
+  void invalidate();
+
+  size_t fieldCount() const;
+
+ private:
+  struct Field {
+    char name[kMaxNameLen + 1] = {0};
+    char value[kMaxValueLen + 1] = {0};
+    uint32_t valueHash = 0;
+    uint32_t ackedHash = 0;
+    uint32_t pendingHash = 0;
+    int32_t number = 0;
+    int32_t ackedNumber = 0;
+    int32_t pendingNumber = 0;
+    uint32_t deadband = 0;
+    bool numeric = false;
+    bool passive = false;
+    bool acked = false;
+    bool pending = false;
+  };
+
+  Field *fieldFor(const char *name);
+  void setText(Field &field, const char *text);
+  bool changed(const Field &field) const;
+
+  Field fields_[kMaxFields];
+  size_t fieldCount_ = 0;
+};
@@ -83,6 +83,9 @@
 #ifndef HAL_HAS_IR
   #define HAL_HAS_IR 0
 #endif
+#ifndef HAL_HAS_PSRAM
+  #define HAL_HAS_PSRAM 0
+#endif
 
 // Display defaults
 #ifndef HAL_DISPLAY_WIDTH
@@ -95,6 +98,28 @@
   #define HAL_DISPLAY_ROTATION 3
 #endif
 
+// LVGL render buffer policy. Every board renders partial chunks into
+// internal DMA-capable RAM, so the SPI DMA reads the render buffers
+// directly. A board header may opt in to direct or full mode with PSRAM
+// frame buffers; those frames go out through internal bounce buffers that
+// the CPU fills row by row, so only opt in once the render benchmark shows
+// a gain on that board.
+#define HAL_RENDER_MODE_PARTIAL 0
+#define HAL_RENDER_MODE_DIRECT  1
+#define HAL_RENDER_MODE_FULL    2
+#define HAL_RENDER_BUF_INTERNAL 0
+#define HAL_RENDER_BUF_PSRAM    1
+#ifndef HAL_RENDER_MODE
+  #define HAL_RENDER_MODE HAL_RENDER_MODE_PARTIAL
+#endif
+#ifndef HAL_RENDER_BUF_LOCATION
+  #define HAL_RENDER_BUF_LOCATION HAL_RENDER_BUF_INTERNAL
+#endif
+// Rows per partial chunk; direct and full mode always use whole frames.
+#ifndef HAL_RENDER_BUF_LINES
+  #define HAL_RENDER_BUF_LINES 24
+#endif
+
 // SPI bus defaults (board must override if it has SPI peripherals)
 #ifndef HAL_SPI_SCK
   #define HAL_SPI_SCK -1
@@ -105,6 +130,10 @@
 #ifndef HAL_SPI_MOSI
   #define HAL_SPI_MOSI -1
 #endif
+// Highest SD card SPI clock to try; the SD storage service probes down from it.
+#ifndef HAL_SD_SPI_MAX_FREQ
+  #define HAL_SD_SPI_MAX_FREQ 40000000
+#endif
 
 // I2C defaults
 #ifndef HAL_I2C_SDA
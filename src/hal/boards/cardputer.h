@@ -24,6 +24,7 @@
 #define HAL_HAS_ANTENNA_SWITCH 0
 #define HAL_HAS_POWER_ENABLE  0
 #define HAL_HAS_IR            1
+#define HAL_HAS_PSRAM         0
 
 // --- Display (ST7789, SPI) ---
 #define HAL_DISPLAY_WIDTH     240
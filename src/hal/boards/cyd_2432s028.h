@@ -23,6 +23,7 @@
 #define HAL_HAS_MIC           0
 #define HAL_HAS_ANTENNA_SWITCH 0
 #define HAL_HAS_POWER_ENABLE  0
+#define HAL_HAS_PSRAM         0
 
 // --- Display (ILI9341, SPI) ---
 #define HAL_DISPLAY_WIDTH     320
@@ -33,6 +34,7 @@
 #define HAL_PIN_TFT_RST       -1
 #define HAL_PIN_TFT_BACKLIGHT 21
 #define HAL_TFT_INVERSION_OFF 1
+#define HAL_RENDER_BUF_LINES  16    // classic ESP32: keep internal RAM for Wi-Fi/TLS
 
 // --- SPI Bus ---
 #define HAL_SPI_SCK           14
@@ -22,6 +22,7 @@
 #define HAL_HAS_MIC           0
 #define HAL_HAS_ANTENNA_SWITCH 0
 #define HAL_HAS_POWER_ENABLE  0
+#define HAL_HAS_PSRAM         0
 
 // --- SPI Bus (default ESP32-S3 FSPI) ---
 #define HAL_SPI_SCK           12
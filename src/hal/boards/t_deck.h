@@ -25,6 +25,7 @@
 #define HAL_HAS_ANTENNA_SWITCH 0
 #define HAL_HAS_POWER_ENABLE  1
 #define HAL_HAS_TRACKBALL     1
+#define HAL_HAS_PSRAM         1
 
 // --- Power ---
 #define HAL_PIN_POWER_ENABLE  10
@@ -22,6 +22,7 @@
 #define HAL_HAS_MIC           1
 #define HAL_HAS_ANTENNA_SWITCH 1
 #define HAL_HAS_POWER_ENABLE  1
+#define HAL_HAS_PSRAM         1
 
 // --- Power ---
 #define HAL_PIN_POWER_ENABLE  15
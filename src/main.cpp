@@ -19,11 +19,16 @@
 #include "core/ble_manager.h"
 #include "core/board_pins.h"
 #include "core/gateway_client.h"
+#include "core/lan_control_server.h"
+#include "core/message_log.h"
 #include "core/node_command_handler.h"
 #include "core/runtime_config.h"
+#include "core/sd_storage.h"
+#include "core/serial_rpc.h"
 #include "core/wifi_manager.h"
 #include "ui/i18n.h"
 #include "ui/ui_navigator.h"
+#include "ui/ui_perf.h"
 #include "ui/ui_runtime.h"
 
 // RTC memory persists across software resets (ESP.restart()), allowing the
@@ -37,8 +42,13 @@ UiRuntime gUiRuntime;
 UiNavigator gUiNav;
 WifiManager gWifi;
 GatewayClient gGateway;
+LanControlServer gLanControl;
+MessageLog gMessageLog;
 BleManager gBle;
 NodeCommandHandler gNodeHandler;
+#if USER_SERIAL_RPC_ENABLED
+SerialRpc gSerialRpc;
+#endif
 AppContext gAppContext;
 #if HAL_HAS_PMU
 XPowersPPM gPmu;
@@ -52,6 +62,7 @@ constexpr unsigned long kRamWatchPollMs = 1000UL;
 constexpr uint8_t kRamWatchRebootPercent = 100U;
 constexpr uint8_t kBacklightFullDuty = 254U;
 constexpr unsigned long kMemTraceLogMs = 5000UL;
+constexpr unsigned long kConfigSdSyncDelayMs = 3000UL;
 
 // Returns a user-visible description for hardware-level reset reasons that
 // indicate a system problem.  Returns nullptr for normal (non-problem) resets.
@@ -131,6 +142,7 @@ void tickRamWatchdog() {
                 static_cast<unsigned int>(psramPct));
   Serial.flush();
   saveRtcRebootReason("Out of Memory (RAM Watchdog)");
+  flushConfig();
   ESP.restart();
 }
 
@@ -167,6 +179,7 @@ void waitTopButtonReleased() {
 
 [[noreturn]] void enterDeepSleepNow() {
   Serial.println("[power] entering deep sleep");
+  flushConfig();
 
   gGateway.disconnectNow();
   gBle.disconnectNow();
@@ -223,14 +236,73 @@ void tickDeepSleepButton() {
 void tickDeepSleepButton() {}
 #endif  // deep sleep button support
 
+// Boot loads the NVS config record only; the SD card is checked for edited
+// config files once the device is up.
+void tickConfigSdSync() {
+  static bool synced = false;
+  if (synced || millis() < kConfigSdSyncDelayMs || gAppContext.configDirty) {
+    return;
+  }
+  synced = true;
+
+  bool changed = false;
+  String syncErr;
+  syncConfigFromSd(gAppContext.config, false, &changed, &syncErr);
+  if (!syncErr.isEmpty()) {
+    Serial.printf("[config] SD sync: %s\n", syncErr.c_str());
+  }
+  if (changed) {
+    Serial.println("[config] applied config updated on SD");
+    applyRuntimeConfig(gAppContext);
+  }
+}
+
+#if HAL_HAS_DISPLAY
+// A device updated with the font pack flag set but no pack on the card would
+// otherwise stay on Montserrat without saying why.
+void tickFontPackCheck() {
+  String err;
+  if (!gUiRuntime.takeKoreanFontLoadFailure(&err)) {
+    return;
+  }
+  if (!sdstorage::isMounted()) {
+    // No card: keep the flag so the pack is used again once it is back.
+    Serial.printf("[ui] korean font pack unavailable: %s\n", err.c_str());
+    return;
+  }
+  Serial.printf("[ui] korean font pack unavailable: %s; marked not installed\n", err.c_str());
+  gAppContext.config.koreanFontInstalled = false;
+  if (uiLanguageFromConfigCode(gAppContext.config.uiLanguage) == UiLanguage::Korean) {
+    gAppContext.config.uiLanguage = uiLanguageCode(UiLanguage::English);
+    gUiRuntime.setLanguage(UiLanguage::English);
+  }
+  // Unsaved Settings edits go out with the user's own save.
+  if (!gAppContext.configDirty) {
+    String saveErr;
+    if (!saveConfig(gAppContext.config, &saveErr)) {
+      Serial.printf("[config] save failed: %s\n", saveErr.c_str());
+    }
+  }
+}
+#endif
+
 void runBackgroundTick() {
   tickDeepSleepButton();
   tickRamWatchdog();
+  sdstorage::tick();
+  tickConfigSdSync();
+  tickConfigPersistence();
   gWifi.tick();
   gGateway.tick();
+  gNodeHandler.tick();
+  gLanControl.tick();
+#if USER_SERIAL_RPC_ENABLED
+  gSerialRpc.tick();
+#endif
   gBle.tick();
 #if HAL_HAS_DISPLAY
   gUiRuntime.tick();
+  tickFontPackCheck();
 #endif
 }
 
@@ -242,12 +314,27 @@ void configureGatewayCallbacks() {
     gNodeHandler.handleInvoke(invokeId, nodeId, command, params);
   });
 
-  gGateway.setTelemetryBuilder([](JsonObject payload) {
-    appendCc1101Info(payload);
-    payload["wifiConnected"] = WiFi.status() == WL_CONNECTED;
-    payload["wifiRssi"] = (WiFi.status() == WL_CONNECTED) ? WiFi.RSSI() : 0;
-    payload["ip"] = (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : String("");
-    payload["uptimeMs"] = millis();
+  gGateway.setCommandCatalog([](JsonArray commands) {
+    gNodeHandler.appendCommandNames(commands);
+  });
+
+  gGateway.setMessageHandler([](const MessageView &message) {
+    gMessageLog.append(message, false);
+  });
+
+  gGateway.setTelemetryBuilder([](TelemetryEncoder &telemetry) {
+    appendCc1101Telemetry(telemetry);
+    const bool wifiConnected = WiFi.status() == WL_CONNECTED;
+    telemetry.setBool("wifiConnected", wifiConnected);
+    telemetry.setInt("wifiRssi", wifiConnected ? WiFi.RSSI() : 0, USER_TELEMETRY_RSSI_DEADBAND_DB);
+    telemetry.setString("ip", wifiConnected ? WiFi.localIP().toString().c_str() : "");
+    telemetry.setPassive("uptimeMs", millis());
+    telemetry.setInt("invokesRunning", static_cast<int32_t>(gNodeHandler.runningInvokeCount()));
+    telemetry.setInt("invokeDuplicates", static_cast<int32_t>(gNodeHandler.duplicateInvokeCount()));
+    const ConfigPersistStats cfg = configPersistStats();
+    telemetry.setPassive("cfgSaves", cfg.saveRequests);
+    telemetry.setPassive("cfgNvsBytes", cfg.nvsBytes);
+    telemetry.setPassive("cfgSdBytes", cfg.sdBytes);
   });
 }
 
@@ -363,14 +450,15 @@ void setup() {
   if (!loadConfig(gAppContext.config, &configLoadSource, nullptr, &loadErr)) {
     gAppContext.config = makeDefaultConfig();
   }
+  Serial.printf("[boot] config loaded in %lu us\n",
+                static_cast<unsigned long>(lastConfigLoadMicros()));
   Serial.printf("[boot] cfg.uiLanguage=%s koreanFont=%d\n",
                 gAppContext.config.uiLanguage.c_str(),
                 gAppContext.config.koreanFontInstalled ? 1 : 0);
+  // The font pack is opened on the first UI service pass, not here.
+  gAppContext.uiRuntime = &gUiRuntime;
 #if HAL_HAS_DISPLAY
-  gUiRuntime.setKoreanFontInstalled(gAppContext.config.koreanFontInstalled);
-  gUiRuntime.setLanguage(uiLanguageFromConfigCode(gAppContext.config.uiLanguage));
-  gUiRuntime.setTimezone(gAppContext.config.timezoneTz);
-  gUiRuntime.setDisplayBrightnessPercent(gAppContext.config.displayBrightnessPercent);
+  applyUiConfig(gAppContext);
 #endif
 
   gWifi.begin();
@@ -378,17 +466,27 @@ void setup() {
 
   gGateway.begin();
   gGateway.configure(gAppContext.config);
+  // Same key the OpenClaw messenger uses for its main session.
+  gMessageLog.setSession("agent:main:main");
   configureGatewayCallbacks();
 
   gBle.configure(gAppContext.config);
   gBle.begin();
 
   gNodeHandler.setGatewayClient(&gGateway);
+  uiperf::registerCommands(gNodeHandler);
+  gLanControl.setCommandHandler(&gNodeHandler);
+  gLanControl.configure(gAppContext.config);
+#if USER_SERIAL_RPC_ENABLED
+  gSerialRpc.begin(&gNodeHandler);
+#endif
 
   gAppContext.wifi = &gWifi;
   gAppContext.gateway = &gGateway;
+  gAppContext.messageLog = &gMessageLog;
+  gAppContext.nodeCommands = &gNodeHandler;
+  gAppContext.lanControl = &gLanControl;
   gAppContext.ble = &gBle;
-  gAppContext.uiRuntime = &gUiRuntime;
   gAppContext.uiNav = &gUiNav;
   gAppContext.configDirty = false;
 
@@ -418,6 +516,11 @@ void loop() {
 #else
   // Headless mode: just run background services.
   runBackgroundTick();
+#if USER_SERIAL_RPC_ENABLED
+  // Poll quickly while a serial host is talking to keep round trips short.
+  delay(gSerialRpc.isActive() ? 1 : 10);
+#else
   delay(10);
 #endif
+#endif
 }
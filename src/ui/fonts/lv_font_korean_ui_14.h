@@ -1,5 +0,0 @@
-#pragma once
-
-#include <lvgl.h>
-
-LV_FONT_DECLARE(lv_font_korean_ui_14);
@@ -54,6 +54,8 @@ const char *textEn(UiTextKey key) {
       return "Installed";
     case UiTextKey::NotInstalled:
       return "Not Installed";
+    case UiTextKey::PackUnavailable:
+      return "Pack unavailable";
     case UiTextKey::FontInstalled:
       return "Korean font installed";
     case UiTextKey::FontUninstalled:
@@ -121,6 +123,8 @@ const char *textKo(UiTextKey key) {
       return "설치됨";
     case UiTextKey::NotInstalled:
       return "미설치";
+    case UiTextKey::PackUnavailable:
+      return "팩 사용 불가";
     case UiTextKey::FontInstalled:
       return "한국어 글꼴 설치됨";
     case UiTextKey::FontUninstalled:
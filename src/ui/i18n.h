@@ -33,6 +33,7 @@ enum class UiTextKey : uint8_t {
   Uninstall,
   Installed,
   NotInstalled,
+  PackUnavailable,
   FontInstalled,
   FontUninstalled,
   FontRequiredForKorean,
@@ -1,14 +1,33 @@
 #include "launcher_icons.h"
 
+#include <esp_heap_caps.h>
+
 namespace {
 
 constexpr int kDesignSize = 46;
 constexpr int kMainRenderSize = 69;
 constexpr int kSideRenderSize = 36;
 constexpr int kIconCount = 4;
+constexpr int kVariantCount = 2;
+// Round line caps reach up to 2 px past the icon box (see the ext draw size
+// in launcherIconEvent), so cached images carry that margin on every side.
+constexpr int kIconPad = 2;
 
 bool gInitialized = false;
 
+// One A8 coverage mask per icon and size; the color is applied when the
+// image is drawn, so every color state shares the same mask.
+struct CachedIcon {
+  lv_draw_buf_t buf;
+  uint8_t *data = nullptr;
+};
+
+CachedIcon gCache[kIconCount][kVariantCount];
+bool gCacheReady = false;
+bool gCacheInPsram = false;
+size_t gCacheBytes = 0;
+uint32_t gRasterizeUs = 0;
+
 constexpr LauncherIconId kIconUserData[kIconCount] = {
     LauncherIconId::AppMarket,
     LauncherIconId::Settings,
@@ -265,13 +284,161 @@ void launcherIconEvent(lv_event_t *e) {
   drawById(ctx, *id);
 }
 
+int renderSizeOf(int variantIndex) {
+  return variantIndex == static_cast<int>(LauncherIconVariant::Side) ? kSideRenderSize
+                                                                     : kMainRenderSize;
+}
+
+void *allocateIconMemory(size_t bytes, bool psram) {
+  if (psram) {
+    return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void releaseIconCache() {
+  for (auto &variants : gCache) {
+    for (CachedIcon &icon : variants) {
+      heap_caps_free(icon.data);
+      icon.data = nullptr;
+    }
+  }
+  gCacheBytes = 0;
+  gCacheReady = false;
+}
+
+// Draws the icon in white on a transparent ARGB8888 canvas with the same
+// primitives as launcherIconEvent, then keeps only the alpha channel.
+bool rasterizeIcon(LauncherIconId id,
+                   int size,
+                   lv_obj_t *canvas,
+                   lv_draw_buf_t *scratch,
+                   CachedIcon &out) {
+  const uint32_t dim = static_cast<uint32_t>(size + (kIconPad * 2));
+  const uint32_t stride = lv_draw_buf_width_to_stride(dim, LV_COLOR_FORMAT_A8);
+  const size_t bytes = static_cast<size_t>(stride) * dim;
+  out.data = static_cast<uint8_t *>(allocateIconMemory(bytes, gCacheInPsram));
+  if (!out.data) {
+    return false;
+  }
+
+  lv_draw_buf_clear(scratch, nullptr);
+  lv_canvas_set_draw_buf(canvas, scratch);
+
+  lv_layer_t layer;
+  lv_canvas_init_layer(canvas, &layer);
+  DrawCtx ctx;
+  ctx.layer = &layer;
+  ctx.area.x1 = kIconPad;
+  ctx.area.y1 = kIconPad;
+  ctx.area.x2 = kIconPad + size - 1;
+  ctx.area.y2 = kIconPad + size - 1;
+  ctx.color = lv_color_white();
+  ctx.w = size;
+  ctx.h = size;
+  ctx.minSide = size;
+  drawById(ctx, id);
+  lv_canvas_finish_layer(canvas, &layer);
+
+  for (uint32_t y = 0; y < dim; ++y) {
+    const uint32_t *src = reinterpret_cast<const uint32_t *>(
+        scratch->data + static_cast<size_t>(y) * scratch->header.stride);
+    uint8_t *dst = out.data + static_cast<size_t>(y) * stride;
+    for (uint32_t x = 0; x < dim; ++x) {
+      dst[x] = static_cast<uint8_t>(src[x] >> 24);
+    }
+  }
+
+  lv_draw_buf_init(&out.buf, dim, dim, LV_COLOR_FORMAT_A8, stride, out.data,
+                   static_cast<uint32_t>(bytes));
+  gCacheBytes += bytes;
+  return true;
+}
+
+bool buildIconCache() {
+  const uint32_t startUs = micros();
+  gCacheInPsram = psramFound();
+
+  // Scratch canvas sized for the largest icon, freed once all are cached.
+  const uint32_t maxDim = static_cast<uint32_t>(kMainRenderSize + (kIconPad * 2));
+  const uint32_t scratchStride = lv_draw_buf_width_to_stride(maxDim, LV_COLOR_FORMAT_ARGB8888);
+  const size_t scratchBytes = static_cast<size_t>(scratchStride) * maxDim;
+  void *scratchData = allocateIconMemory(scratchBytes, gCacheInPsram);
+  if (!scratchData) {
+    return false;
+  }
+  lv_obj_t *canvas = lv_canvas_create(nullptr);
+  if (!canvas) {
+    heap_caps_free(scratchData);
+    return false;
+  }
+
+  bool ok = true;
+  for (int variant = 0; variant < kVariantCount && ok; ++variant) {
+    const int size = renderSizeOf(variant);
+    const uint32_t dim = static_cast<uint32_t>(size + (kIconPad * 2));
+    lv_draw_buf_t scratch;
+    lv_draw_buf_init(&scratch, dim, dim, LV_COLOR_FORMAT_ARGB8888,
+                     lv_draw_buf_width_to_stride(dim, LV_COLOR_FORMAT_ARGB8888), scratchData,
+                     static_cast<uint32_t>(scratchBytes));
+    for (int i = 0; i < kIconCount && ok; ++i) {
+      ok = rasterizeIcon(kIconUserData[i], size, canvas, &scratch, gCache[i][variant]);
+    }
+  }
+
+  lv_obj_delete(canvas);
+  heap_caps_free(scratchData);
+  if (!ok) {
+    releaseIconCache();
+    return false;
+  }
+  gRasterizeUs = micros() - startUs;
+  gCacheReady = true;
+  return true;
+}
+
+lv_obj_t *createCachedIcon(lv_obj_t *parent, int idx, LauncherIconVariant variant, lv_color_t color) {
+  lv_obj_t *image = lv_image_create(parent);
+  if (!image) {
+    return nullptr;
+  }
+  lv_image_set_src(image, &gCache[idx][static_cast<int>(variant)].buf);
+  // A8 images take their color from the recolor style.
+  lv_obj_set_style_image_recolor(image, color, 0);
+  lv_obj_set_style_image_recolor_opa(image, LV_OPA_COVER, 0);
+  lv_obj_set_style_opa(image, LV_OPA_COVER, 0);
+  lv_obj_clear_flag(image, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_clear_flag(image, LV_OBJ_FLAG_CLICKABLE);
+  return image;
+}
+
 }  // namespace
 
 bool initLauncherIcons() {
+  if (!gCacheReady) {
+    if (buildIconCache()) {
+      Serial.printf("[ui] launcher icons cached: %u bytes in %s, %lu us\n",
+                    static_cast<unsigned int>(gCacheBytes),
+                    gCacheInPsram ? "PSRAM" : "internal RAM",
+                    static_cast<unsigned long>(gRasterizeUs));
+    } else {
+      Serial.println("[ui] launcher icon cache alloc failed, drawing icons per frame");
+    }
+  }
   gInitialized = true;
   return true;
 }
 
+LauncherIconCacheInfo launcherIconCacheInfo() {
+  LauncherIconCacheInfo info;
+  info.ready = gCacheReady;
+  info.inPsram = gCacheInPsram;
+  info.images = gCacheReady ? static_cast<uint8_t>(kIconCount * kVariantCount) : 0;
+  info.bytes = static_cast<uint32_t>(gCacheBytes);
+  info.rasterizeUs = gRasterizeUs;
+  return info;
+}
+
 bool launcherIconsReady() {
   return gInitialized;
 }
@@ -295,6 +462,9 @@ lv_obj_t *createLauncherIcon(lv_obj_t *parent,
   if (idx < 0 || idx >= kIconCount) {
     return nullptr;
   }
+  if (gCacheReady) {
+    return createCachedIcon(parent, idx, variant, color);
+  }
 
   lv_obj_t *icon = lv_obj_create(parent);
   if (!icon) {
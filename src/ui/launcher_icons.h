@@ -15,7 +15,18 @@ enum class LauncherIconVariant : uint8_t {
   Side = 1,
 };
 
+struct LauncherIconCacheInfo {
+  bool ready = false;    // icons are blitted from cached A8 masks
+  bool inPsram = false;
+  uint8_t images = 0;
+  uint32_t bytes = 0;
+  uint32_t rasterizeUs = 0;
+};
+
+// Rasterizes every icon once per render size into A8 masks. Without memory
+// for the cache, icons are drawn from vector primitives on each redraw.
 bool initLauncherIcons();
+LauncherIconCacheInfo launcherIconCacheInfo();
 bool launcherIconsReady();
 int launcherIconRenderSize(LauncherIconVariant variant);
 lv_obj_t *createLauncherIcon(lv_obj_t *parent,
@@ -1,30 +1,84 @@
 #include "lvgl_port.h"
 
 #include <esp_heap_caps.h>
+#include <esp_memory_utils.h>
 
 #include "../core/board_pins.h"
 #include "../core/shared_spi_bus.h"
 #include "../hal/board_config.h"
+#include "user_config.h"
 
 namespace {
 
-constexpr uint16_t kBufferLines = 24;
 constexpr uint8_t kBacklightFullDuty = 254;
+constexpr uint32_t kFpsWindowMs = 1000;
+// Used when the board's policy cannot be allocated at boot.
+constexpr uint16_t kFallbackLines = 12;
+// Rows per bounce buffer when draw buffers are not DMA-capable.
+constexpr uint16_t kBounceLines = 16;
+// Input that no frame answers within this time did not cause a redraw.
+constexpr uint32_t kMaxInputLatencyUs = 1000000UL;
+
+lv_display_render_mode_t toLvRenderMode(LvglRenderMode mode) {
+  switch (mode) {
+    case LvglRenderMode::Direct:
+      return LV_DISPLAY_RENDER_MODE_DIRECT;
+    case LvglRenderMode::Full:
+      return LV_DISPLAY_RENDER_MODE_FULL;
+    case LvglRenderMode::Partial:
+    default:
+      return LV_DISPLAY_RENDER_MODE_PARTIAL;
+  }
+}
+
+const char *flushPathName(bool dma, bool bounce) {
+  if (!dma) {
+    return "blocking";
+  }
+  return bounce ? "dma+bounce" : "dma";
+}
 
 }  // namespace
 
+LvglRenderPolicy LvglRenderPolicy::boardDefault() {
+  LvglRenderPolicy policy;
+#if HAL_RENDER_MODE == HAL_RENDER_MODE_DIRECT
+  policy.mode = LvglRenderMode::Direct;
+#elif HAL_RENDER_MODE == HAL_RENDER_MODE_FULL
+  policy.mode = LvglRenderMode::Full;
+#else
+  policy.mode = LvglRenderMode::Partial;
+#endif
+  policy.psram = HAL_RENDER_BUF_LOCATION == HAL_RENDER_BUF_PSRAM;
+  policy.lines = HAL_RENDER_BUF_LINES;
+  return policy;
+}
+
+const char *lvglRenderModeName(LvglRenderMode mode) {
+  switch (mode) {
+    case LvglRenderMode::Direct:
+      return "direct";
+    case LvglRenderMode::Full:
+      return "full";
+    case LvglRenderMode::Partial:
+    default:
+      return "partial";
+  }
+}
+
 LvglPort::LvglPort() = default;
 
-void *LvglPort::allocateBuffer(size_t bytes) {
+void *LvglPort::allocateBuffer(size_t bytes, bool psram, bool dmaCapable) {
+  if (psram) {
+    return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  // The SPI DMA engine only reads internal RAM.
   void *ptr = nullptr;
-#if CONFIG_SPIRAM || BOARD_HAS_PSRAM
-  ptr = ps_malloc(bytes);
-#endif
-  if (!ptr) {
-    ptr = heap_caps_malloc(bytes, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+  if (dmaCapable) {
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
   }
   if (!ptr) {
-    ptr = malloc(bytes);
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
   }
   return ptr;
 }
@@ -49,7 +103,9 @@ bool LvglPort::begin() {
   sharedspi::adoptInitializedBus(&TFT_eSPI::getSPIinstance());
   tft_.setRotation(HAL_DISPLAY_ROTATION);
   tft_.fillScreen(TFT_BLACK);
-  tft_.setSwapBytes(true);
+  // LVGL renders RGB565_SWAPPED, i.e. already in the panel's byte order, so
+  // neither flush path swaps pixels on the CPU.
+  tft_.setSwapBytes(false);
   tft_.setTextColor(TFT_WHITE, TFT_RED);
   tft_.setTextDatum(TL_DATUM);
 
@@ -58,23 +114,17 @@ bool LvglPort::begin() {
     tft_.drawString(msg, 4, 4, 2);
   };
 
+#if USER_DISPLAY_DMA_ENABLED
+  dmaReady_ = tft_.initDMA();
+  if (!dmaReady_) {
+    Serial.println("[ui] display DMA unavailable, using blocking flush");
+  }
+#endif
+
   lv_init();
 
   const uint32_t width = static_cast<uint32_t>(tft_.width());
   const uint32_t height = static_cast<uint32_t>(tft_.height());
-  const size_t bufPixels = static_cast<size_t>(width) * kBufferLines;
-  const size_t bufBytes = bufPixels * sizeof(lv_color_t);
-
-  buf1_ = static_cast<lv_color_t *>(allocateBuffer(bufBytes));
-  buf2_ = static_cast<lv_color_t *>(allocateBuffer(bufBytes));
-  if (!buf1_) {
-    Serial.println("[ui] LVGL draw buffer alloc failed");
-    showFatal("LVGL buf1 alloc failed");
-    return false;
-  }
-  if (!buf2_) {
-    Serial.println("[ui] LVGL second buffer alloc failed, falling back to single buffer");
-  }
 
   display_ = lv_display_create(static_cast<int32_t>(width), static_cast<int32_t>(height));
   if (!display_) {
@@ -84,16 +134,30 @@ bool LvglPort::begin() {
   }
 
   lv_display_set_user_data(display_, this);
-  lv_display_set_color_format(display_, LV_COLOR_FORMAT_RGB565);
+  lv_display_set_color_format(display_, LV_COLOR_FORMAT_RGB565_SWAPPED);
   lv_display_set_flush_cb(display_, flushCb);
-  lv_display_set_buffers(display_,
-                         reinterpret_cast<void *>(buf1_),
-                         reinterpret_cast<void *>(buf2_),
-                         static_cast<uint32_t>(bufBytes),
-                         LV_DISPLAY_RENDER_MODE_PARTIAL);
+  if (dmaReady_) {
+    lv_display_set_flush_wait_cb(display_, flushWaitCb);
+  }
+  lv_display_add_event_cb(display_, refreshStartCb, LV_EVENT_REFR_START, this);
+
+  String bufferErr;
+  if (!setRenderPolicy(LvglRenderPolicy::boardDefault(), &bufferErr)) {
+    Serial.printf("[ui] %s, falling back to %u-line internal buffers\n",
+                  bufferErr.c_str(),
+                  static_cast<unsigned int>(kFallbackLines));
+    LvglRenderPolicy fallback;
+    fallback.lines = kFallbackLines;
+    if (!setRenderPolicy(fallback, &bufferErr)) {
+      Serial.println("[ui] LVGL draw buffer alloc failed");
+      showFatal("LVGL buf1 alloc failed");
+      return false;
+    }
+  }
   lv_display_set_default(display_);
 
   lastTickMs_ = millis();
+  fpsWindowStartMs_ = lastTickMs_;
   initialized_ = true;
   return true;
 }
@@ -114,6 +178,28 @@ void LvglPort::pump() {
   }
 
   lv_timer_handler();
+
+  // The last chunk of a frame may still be on the wire. Finish it here: the
+  // SD card and radio share the SPI bus and run from the same loop.
+  if (flushPending_) {
+    finishFlush();
+  }
+
+  const uint32_t windowMs = millis() - fpsWindowStartMs_;
+  if (windowMs >= kFpsWindowMs) {
+    stats_.fps = static_cast<uint16_t>((fpsWindowFrames_ * 1000U + windowMs / 2U) / windowMs);
+#if USER_UI_FRAME_TRACE_ENABLED
+    if (fpsWindowFrames_ > 0) {
+      Serial.printf("[ui] fps=%u frame=%luus wait=%luus flush=%s\n",
+                    static_cast<unsigned int>(stats_.fps),
+                    static_cast<unsigned long>(stats_.frameUs),
+                    static_cast<unsigned long>(stats_.flushWaitUs),
+                    flushPathName(stats_.dma, flushPath_ == FlushPath::DmaBounce));
+    }
+#endif
+    fpsWindowStartMs_ += windowMs;
+    fpsWindowFrames_ = 0;
+  }
 }
 
 lv_display_t *LvglPort::display() const {
@@ -128,6 +214,182 @@ bool LvglPort::ready() const {
   return initialized_ && display_ != nullptr;
 }
 
+const LvglFrameStats &LvglPort::frameStats() const {
+  return stats_;
+}
+
+void LvglPort::resetFrameStats() {
+  const bool dma = stats_.dma;
+  stats_ = LvglFrameStats();
+  stats_.dma = dma;
+}
+
+void LvglPort::noteInput() {
+  if (!inputPending_) {
+    inputAtUs_ = micros();
+    inputPending_ = true;
+  }
+}
+
+void LvglPort::releaseBus() {
+  if (flushPending_) {
+    finishFlush();
+  }
+}
+
+bool LvglPort::setRenderPolicy(const LvglRenderPolicy &policy, String *error) {
+  auto fail = [&](const String &message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  if (!display_) {
+    return fail("Display not started");
+  }
+  if (policy.psram && !psramFound()) {
+    return fail("No PSRAM for render buffers");
+  }
+
+  LvglRenderPolicy next = policy;
+  const uint32_t width = static_cast<uint32_t>(lv_display_get_horizontal_resolution(display_));
+  const uint32_t height = static_cast<uint32_t>(lv_display_get_vertical_resolution(display_));
+  if (next.mode != LvglRenderMode::Partial || next.lines == 0 || next.lines > height) {
+    next.lines = static_cast<uint16_t>(height);
+  }
+  const size_t bytes = static_cast<size_t>(width) * next.lines * sizeof(uint16_t);
+
+  const bool wantDma = dmaReady_ && !next.psram;
+  void *buf1 = allocateBuffer(bytes, next.psram, wantDma);
+  void *buf2 = buf1 ? allocateBuffer(bytes, next.psram, wantDma) : nullptr;
+  if (!buf1) {
+    return fail("Out of memory for " + String(static_cast<uint32_t>(bytes / 1024U)) +
+                " KB render buffer");
+  }
+  if (!buf2) {
+    Serial.println("[ui] LVGL second buffer alloc failed, falling back to single buffer");
+  }
+
+  if (flushPending_) {
+    finishFlush();
+  }
+  lv_display_set_buffers(display_, buf1, buf2, static_cast<uint32_t>(bytes),
+                         toLvRenderMode(next.mode));
+  heap_caps_free(buf1_);
+  heap_caps_free(buf2_);
+  buf1_ = buf1;
+  buf2_ = buf2;
+  bufBytes_ = bytes;
+  policy_ = next;
+
+  // Partial chunks are contiguous; frame buffers are sent as sub-rectangles
+  // with the full-width stride, which pushImageDMA() cannot take directly.
+  const bool dmaCapable = esp_ptr_dma_capable(buf1) && (!buf2 || esp_ptr_dma_capable(buf2));
+  if (dmaReady_ && next.mode == LvglRenderMode::Partial && dmaCapable) {
+    releaseBounceBuffers();
+    flushPath_ = FlushPath::Dma;
+  } else if (dmaReady_ && allocateBounceBuffers()) {
+    flushPath_ = FlushPath::DmaBounce;
+  } else {
+    flushPath_ = FlushPath::Blocking;
+  }
+  stats_.dma = flushPath_ != FlushPath::Blocking;
+
+  Serial.printf("[ui] render %s, %u lines in %s, %u x %u bytes, flush=%s\n",
+                lvglRenderModeName(next.mode),
+                static_cast<unsigned int>(next.lines),
+                next.psram ? "PSRAM" : "internal RAM",
+                buf2 ? 2U : 1U,
+                static_cast<unsigned int>(bytes),
+                flushPathName(stats_.dma, flushPath_ == FlushPath::DmaBounce));
+
+  lv_obj_invalidate(lv_display_get_screen_active(display_));
+  return true;
+}
+
+const LvglRenderPolicy &LvglPort::renderPolicy() const {
+  return policy_;
+}
+
+size_t LvglPort::bufferBytes() const {
+  return bufBytes_;
+}
+
+uint32_t LvglPort::refreshNow() {
+  if (!ready()) {
+    return 0;
+  }
+  const uint32_t startUs = micros();
+  lv_refr_now(display_);
+  if (flushPending_) {
+    finishFlush();
+  }
+  return micros() - startUs;
+}
+
+bool LvglPort::allocateBounceBuffers() {
+  if (bounce_[0] && bounce_[1]) {
+    return true;
+  }
+  releaseBounceBuffers();
+  const uint32_t width = static_cast<uint32_t>(lv_display_get_horizontal_resolution(display_));
+  const size_t bytes = static_cast<size_t>(width) * kBounceLines * sizeof(uint16_t);
+  for (uint16_t *&buffer : bounce_) {
+    buffer = static_cast<uint16_t *>(
+        heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (!buffer) {
+      releaseBounceBuffers();
+      return false;
+    }
+  }
+  bounceLines_ = kBounceLines;
+  return true;
+}
+
+void LvglPort::releaseBounceBuffers() {
+  for (uint16_t *&buffer : bounce_) {
+    heap_caps_free(buffer);
+    buffer = nullptr;
+  }
+  bounceLines_ = 0;
+}
+
+void LvglPort::finishFlush() {
+  const uint32_t startUs = micros();
+  tft_.dmaWait();
+  tft_.endWrite();
+  const uint32_t doneUs = micros();
+  frameWaitUs_ += doneUs - startUs;
+  frameFlushUs_ += doneUs - flushStartUs_;
+  flushPending_ = false;
+  if (flushPendingLast_) {
+    recordFrame();
+  }
+  lv_display_flush_ready(display_);
+}
+
+void LvglPort::recordFrame() {
+  const uint32_t nowUs = micros();
+  stats_.frameUs = nowUs - refreshStartUs_;
+  stats_.flushWaitUs = frameWaitUs_;
+  stats_.renderUs = stats_.frameUs > frameWaitUs_ ? stats_.frameUs - frameWaitUs_ : 0;
+  stats_.flushUs = frameFlushUs_;
+  stats_.dirtyPixels = frameDirtyPixels_;
+  if (inputPending_) {
+    inputPending_ = false;
+    const uint32_t latencyUs = nowUs - inputAtUs_;
+    if (latencyUs <= kMaxInputLatencyUs) {
+      stats_.inputLatencyUs = latencyUs;
+      if (latencyUs > stats_.inputLatencyMaxUs) {
+        stats_.inputLatencyMaxUs = latencyUs;
+      }
+    }
+  }
+  ++stats_.frames;
+  ++fpsWindowFrames_;
+}
+
 void LvglPort::flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap) {
   LvglPort *self = static_cast<LvglPort *>(lv_display_get_user_data(disp));
   if (!self) {
@@ -137,11 +399,81 @@ void LvglPort::flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap
 
   const uint32_t width = static_cast<uint32_t>(area->x2 - area->x1 + 1);
   const uint32_t height = static_cast<uint32_t>(area->y2 - area->y1 + 1);
+  self->flushStartUs_ = micros();
+  self->frameDirtyPixels_ += width * height;
+
+  // Partial buffers hold just the area; frame buffers hold the whole screen.
+  uint16_t *pixels = reinterpret_cast<uint16_t *>(pxMap);
+  uint32_t stride = width;
+  if (self->policy_.mode != LvglRenderMode::Partial) {
+    stride = static_cast<uint32_t>(lv_display_get_horizontal_resolution(disp));
+    pixels += static_cast<size_t>(area->y1) * stride + static_cast<uint32_t>(area->x1);
+  }
+
+  if (self->flushPath_ == FlushPath::Dma) {
+    // Returns as soon as the transfer is queued; LVGL renders the next chunk
+    // into the other buffer and calls flushWaitCb() before reusing this one.
+    self->tft_.startWrite();
+    self->tft_.pushImageDMA(area->x1, area->y1, width, height, pixels);
+    self->flushPending_ = true;
+    self->flushPendingLast_ = lv_display_flush_is_last(disp);
+    return;
+  }
+
+  if (self->flushPath_ == FlushPath::DmaBounce) {
+    // Copy one band while the previous one is on the wire. pushImageDMA()
+    // waits for the band before last, so the buffer being refilled is idle.
+    // LVGL cannot render during the copies; only the last band's transfer
+    // overlaps the next render. Used only by boards that opt in to PSRAM
+    // frame buffers (board_config.h).
+    self->tft_.startWrite();
+    uint8_t slot = 0;
+    for (uint32_t row = 0; row < height; row += self->bounceLines_) {
+      const uint32_t rows =
+          height - row < self->bounceLines_ ? height - row : self->bounceLines_;
+      uint16_t *band = self->bounce_[slot];
+      for (uint32_t r = 0; r < rows; ++r) {
+        memcpy(band + r * width, pixels + (row + r) * stride, width * sizeof(uint16_t));
+      }
+      self->tft_.pushImageDMA(area->x1, area->y1 + static_cast<int32_t>(row), width, rows, band);
+      slot ^= 1U;
+    }
+    self->flushPending_ = true;
+    self->flushPendingLast_ = lv_display_flush_is_last(disp);
+    return;
+  }
 
   self->tft_.startWrite();
   self->tft_.setAddrWindow(area->x1, area->y1, width, height);
-  self->tft_.pushColors(reinterpret_cast<uint16_t *>(pxMap), width * height, true);
+  if (stride == width) {
+    self->tft_.pushColors(pixels, width * height, false);
+  } else {
+    for (uint32_t row = 0; row < height; ++row) {
+      self->tft_.pushColors(pixels + row * stride, width, false);
+    }
+  }
   self->tft_.endWrite();
+  const uint32_t flushUs = micros() - self->flushStartUs_;
+  self->frameWaitUs_ += flushUs;
+  self->frameFlushUs_ += flushUs;
+  if (lv_display_flush_is_last(disp)) {
+    self->recordFrame();
+  }
 
   lv_display_flush_ready(disp);
 }
+
+void LvglPort::flushWaitCb(lv_display_t *disp) {
+  LvglPort *self = static_cast<LvglPort *>(lv_display_get_user_data(disp));
+  if (self && self->flushPending_) {
+    self->finishFlush();
+  }
+}
+
+void LvglPort::refreshStartCb(lv_event_t *event) {
+  LvglPort *self = static_cast<LvglPort *>(lv_event_get_user_data(event));
+  self->refreshStartUs_ = micros();
+  self->frameWaitUs_ = 0;
+  self->frameFlushUs_ = 0;
+  self->frameDirtyPixels_ = 0;
+}
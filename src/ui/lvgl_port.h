@@ -4,6 +4,39 @@
 #include <TFT_eSPI.h>
 #include <lvgl.h>
 
+// Frame timing of the LVGL display, updated as frames reach the panel.
+// Collection is a few integer operations per flushed chunk.
+struct LvglFrameStats {
+  uint32_t frames = 0;             // frames completed since boot (or reset)
+  uint16_t fps = 0;                // frames completed in the last 1 s window
+  uint32_t frameUs = 0;            // last frame: refresh start to last pixel sent
+  uint32_t renderUs = 0;           // last frame: frameUs minus flushWaitUs
+  uint32_t flushUs = 0;            // last frame: chunks in transfer, summed
+  uint32_t flushWaitUs = 0;        // last frame: time LVGL waited on the SPI transfer
+  uint32_t dirtyPixels = 0;        // last frame: pixels rendered and sent
+  uint32_t inputLatencyUs = 0;     // last input event to the next frame on the panel
+  uint32_t inputLatencyMaxUs = 0;  // worst inputLatencyUs since boot (or reset)
+  bool dma = false;                // flushes use DMA (false: blocking pushColors)
+};
+
+enum class LvglRenderMode : uint8_t {
+  Partial,  // render dirty areas in chunks of `lines` rows
+  Direct,   // two frame buffers; only dirty areas are rendered and sent
+  Full,     // two frame buffers; every refresh renders and sends the frame
+};
+
+// Where and how LVGL renders. boardDefault() follows the HAL_RENDER_*
+// settings in board_config.h.
+struct LvglRenderPolicy {
+  LvglRenderMode mode = LvglRenderMode::Partial;
+  bool psram = false;
+  uint16_t lines = 24;  // Partial only; Direct and Full always use whole frames
+
+  static LvglRenderPolicy boardDefault();
+};
+
+const char *lvglRenderModeName(LvglRenderMode mode);
+
 class LvglPort {
  public:
   LvglPort();
@@ -14,16 +47,67 @@ class LvglPort {
   lv_display_t *display() const;
   TFT_eSPI &tft();
   bool ready() const;
+  const LvglFrameStats &frameStats() const;
+  void resetFrameStats();
+  // Marks a consumed input event; the next completed frame closes the
+  // input-to-photon measurement.
+  void noteInput();
+  // Completes a DMA flush still on the wire and ends its SPI transaction, so
+  // code running inside a render (e.g. a font reading glyphs from SD) can
+  // use another device on the bus.
+  void releaseBus();
+
+  // Swaps the draw buffers at runtime and redraws the screen. On failure the
+  // current buffers stay in place.
+  bool setRenderPolicy(const LvglRenderPolicy &policy, String *error = nullptr);
+  const LvglRenderPolicy &renderPolicy() const;
+  size_t bufferBytes() const;
+  // Renders pending invalidations now and returns the time until the last
+  // pixel was sent, in microseconds.
+  uint32_t refreshNow();
 
  private:
+  enum class FlushPath : uint8_t {
+    Blocking,
+    Dma,        // DMA straight from the draw buffer
+    DmaBounce,  // copy rows into internal bounce buffers, DMA from those
+  };
+
   static void flushCb(lv_display_t *disp, const lv_area_t *area, uint8_t *pxMap);
-  static void *allocateBuffer(size_t bytes);
+  static void flushWaitCb(lv_display_t *disp);
+  static void refreshStartCb(lv_event_t *event);
+  static void *allocateBuffer(size_t bytes, bool psram, bool dmaCapable);
+
+  bool allocateBounceBuffers();
+  void releaseBounceBuffers();
+  void finishFlush();
+  void recordFrame();
 
   TFT_eSPI tft_;
   lv_display_t *display_ = nullptr;
-  lv_color_t *buf1_ = nullptr;
-  lv_color_t *buf2_ = nullptr;
+  void *buf1_ = nullptr;
+  void *buf2_ = nullptr;
+  size_t bufBytes_ = 0;
+  uint16_t *bounce_[2] = {nullptr, nullptr};
+  uint16_t bounceLines_ = 0;
+  LvglRenderPolicy policy_;
+  FlushPath flushPath_ = FlushPath::Blocking;
   uint32_t lastTickMs_ = 0;
   bool initialized_ = false;
-};
+  bool dmaReady_ = false;
 
+  // One DMA flush may be in flight; the SPI transaction stays open until
+  // finishFlush() so no other bus user can select its chip meanwhile.
+  bool flushPending_ = false;
+  bool flushPendingLast_ = false;
+  uint32_t refreshStartUs_ = 0;
+  uint32_t flushStartUs_ = 0;
+  uint32_t frameWaitUs_ = 0;
+  uint32_t frameFlushUs_ = 0;
+  uint32_t frameDirtyPixels_ = 0;
+  uint32_t inputAtUs_ = 0;
+  bool inputPending_ = false;
+  uint32_t fpsWindowStartMs_ = 0;
+  uint16_t fpsWindowFrames_ = 0;
+  LvglFrameStats stats_;
+};
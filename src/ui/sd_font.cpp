@@ -0,0 +1,597 @@
+#include "sd_font.h"
+
+#include <FS.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#include "../core/sd_storage.h"
+#include "lvgl_port.h"
+
+namespace {
+
+constexpr char kMagic[4] = {'Z', 'X', 'G', 'P'};
+constexpr uint16_t kVersion = 1;
+// Must match MAX_RECORD_BYTES in scripts/font_pack/build_font_pack.py.
+constexpr uint16_t kMaxRecordBytes = 512;
+constexpr uint16_t kMaxRanges = 256;
+constexpr uint16_t kCacheGlyphsPsram = 1024;
+constexpr uint16_t kCacheGlyphsInternal = 128;
+constexpr uint16_t kMinCacheGlyphs = 32;
+constexpr uint16_t kNoSlot = 0xFFFF;
+constexpr uint32_t kNoLetter = 0xFFFFFFFFU;
+constexpr uint32_t kReopenBackoffMs = 2000;
+
+struct __attribute__((packed)) PackHeader {
+  char magic[4];
+  uint16_t version;
+  uint8_t bpp;
+  uint8_t bitmapFormat;
+  uint16_t lineHeight;
+  int16_t baseLine;
+  int8_t underlinePosition;
+  uint8_t underlineThickness;
+  uint16_t rangeCount;
+  uint32_t glyphCount;
+  uint16_t maxRecordBytes;
+  uint16_t reserved;
+  uint32_t rangesOffset;
+  uint32_t offsetsOffset;
+};
+static_assert(sizeof(PackHeader) == 32, "pack header layout");
+
+struct __attribute__((packed)) PackRange {
+  uint32_t start;
+  uint32_t length;
+  uint32_t glyphIdStart;
+};
+static_assert(sizeof(PackRange) == 12, "pack range layout");
+
+// Followed by `bitmapBytes` of bitmap.
+struct __attribute__((packed)) GlyphRecord {
+  uint16_t advW;  // 1/16 px
+  uint8_t boxW;
+  uint8_t boxH;
+  int8_t ofsX;
+  int8_t ofsY;
+  uint16_t bitmapBytes;
+};
+static_assert(sizeof(GlyphRecord) == 8, "glyph record layout");
+
+// Cache slot bookkeeping; the record bytes live in gSlotData.
+struct Slot {
+  uint32_t letter;
+  uint16_t prev;   // LRU list, towards the most recent
+  uint16_t next;   // LRU list, towards the least recent
+  uint16_t chain;  // next slot in the same hash bucket
+};
+
+bool getGlyphDsc(const lv_font_t *font, lv_font_glyph_dsc_t *out, uint32_t letter, uint32_t letterNext);
+const void *getGlyphBitmap(lv_font_glyph_dsc_t *glyph, lv_draw_buf_t *drawBuf);
+
+LvglPort *gPort = nullptr;
+lv_font_t gFont = {};
+bool gOpen = false;
+String gPath;
+File gFile;
+uint32_t gFileBytes = 0;
+uint32_t gMountSeq = 0;
+uint32_t gLastReopenMs = 0;
+PackHeader gHeader = {};
+PackRange *gRanges = nullptr;
+uint32_t *gOffsets = nullptr;
+
+Slot *gSlots = nullptr;
+uint8_t *gSlotData = nullptr;
+uint16_t *gBuckets = nullptr;
+uint16_t gBucketMask = 0;
+uint16_t gSlotBytes = 0;
+uint16_t gCapacity = 0;
+uint16_t gUsed = 0;
+uint16_t gHead = kNoSlot;
+uint16_t gTail = kNoSlot;
+bool gPsram = false;
+sdfont::Stats gStats;
+
+// Handed to lv_font_get_bitmap_fmt_txt() so LVGL decodes one cached bitmap
+// with its own (RLE + prefilter) decompressor. Id 0 is reserved by LVGL.
+lv_font_fmt_txt_glyph_dsc_t gProxyGlyphs[2] = {};
+lv_font_fmt_txt_dsc_t gProxyDsc = {};
+lv_font_t gProxyFont = {};
+
+void *allocate(size_t bytes, bool psram) {
+  if (psram) {
+    return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  }
+  return heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+template <typename T>
+void release(T *&ptr) {
+  if (ptr) {
+    heap_caps_free(ptr);
+    ptr = nullptr;
+  }
+}
+
+void setError(String *error, const String &message) {
+  if (error) {
+    *error = message;
+  }
+}
+
+void releaseCache() {
+  release(gSlots);
+  release(gSlotData);
+  release(gBuckets);
+  gCapacity = 0;
+  gUsed = 0;
+  gHead = kNoSlot;
+  gTail = kNoSlot;
+}
+
+bool allocateCache(uint16_t glyphs, bool psram) {
+  gSlotBytes = static_cast<uint16_t>((gHeader.maxRecordBytes + 3U) & ~3U);
+  // Halve the slot count until it fits.
+  for (uint16_t count = glyphs; count >= kMinCacheGlyphs; count /= 2) {
+    uint16_t buckets = 1;
+    while (buckets < count) {
+      buckets <<= 1;
+    }
+    gSlots = static_cast<Slot *>(allocate(sizeof(Slot) * count, psram));
+    gSlotData = static_cast<uint8_t *>(allocate(static_cast<size_t>(gSlotBytes) * count, psram));
+    gBuckets = static_cast<uint16_t *>(allocate(sizeof(uint16_t) * buckets, psram));
+    if (gSlots && gSlotData && gBuckets) {
+      for (uint16_t i = 0; i < buckets; ++i) {
+        gBuckets[i] = kNoSlot;
+      }
+      gBucketMask = static_cast<uint16_t>(buckets - 1U);
+      gCapacity = count;
+      gStats.cacheBytes = static_cast<uint32_t>(sizeof(Slot) + gSlotBytes) * count +
+                          sizeof(uint16_t) * buckets;
+      return true;
+    }
+    releaseCache();
+  }
+  return false;
+}
+
+bool readAt(uint32_t offset, void *out, size_t len) {
+  return gFile && gFile.seek(offset) && gFile.read(static_cast<uint8_t *>(out), len) == len;
+}
+
+// Re-opens the pack after the card was remounted or a read failed.
+bool ensureFile() {
+  // The SD benchmark remounts the card; draw from the fallback until it ends.
+  if (sdstorage::exclusiveHeld()) {
+    return false;
+  }
+  const uint32_t mounts = sdstorage::info().mounts;
+  if (gFile && mounts == gMountSeq) {
+    return true;
+  }
+  if (gLastReopenMs != 0 && millis() - gLastReopenMs < kReopenBackoffMs) {
+    return false;
+  }
+  gLastReopenMs = millis();
+  if (gFile) {
+    gFile.close();
+  }
+  if (!sdstorage::ensureMounted()) {
+    return false;
+  }
+  gFile = SD.open(gPath.c_str(), FILE_READ);
+  if (gFile && gFile.size() != gFileBytes) {
+    // A different pack under the same name; its offsets do not match ours.
+    gFile.close();
+  }
+  gMountSeq = sdstorage::info().mounts;
+  return static_cast<bool>(gFile);
+}
+
+// Ranges are sorted by start code point.
+uint32_t glyphId(uint32_t letter) {
+  uint16_t lo = 0;
+  uint16_t hi = gHeader.rangeCount;
+  while (lo < hi) {
+    const uint16_t mid = static_cast<uint16_t>((lo + hi) / 2U);
+    const PackRange &range = gRanges[mid];
+    if (letter < range.start) {
+      hi = mid;
+    } else if (letter - range.start >= range.length) {
+      lo = static_cast<uint16_t>(mid + 1U);
+    } else {
+      const uint32_t gid = range.glyphIdStart + (letter - range.start);
+      return gid < gHeader.glyphCount ? gid : 0;
+    }
+  }
+  return 0;
+}
+
+const GlyphRecord *recordOf(uint16_t slot) {
+  return reinterpret_cast<const GlyphRecord *>(gSlotData + static_cast<size_t>(slot) * gSlotBytes);
+}
+
+void unlink(uint16_t slot) {
+  Slot &s = gSlots[slot];
+  if (s.prev != kNoSlot) {
+    gSlots[s.prev].next = s.next;
+  } else {
+    gHead = s.next;
+  }
+  if (s.next != kNoSlot) {
+    gSlots[s.next].prev = s.prev;
+  } else {
+    gTail = s.prev;
+  }
+}
+
+void pushFront(uint16_t slot) {
+  Slot &s = gSlots[slot];
+  s.prev = kNoSlot;
+  s.next = gHead;
+  if (gHead != kNoSlot) {
+    gSlots[gHead].prev = slot;
+  }
+  gHead = slot;
+  if (gTail == kNoSlot) {
+    gTail = slot;
+  }
+}
+
+uint16_t find(uint32_t letter) {
+  for (uint16_t slot = gBuckets[letter & gBucketMask]; slot != kNoSlot; slot = gSlots[slot].chain) {
+    if (gSlots[slot].letter == letter) {
+      return slot;
+    }
+  }
+  return kNoSlot;
+}
+
+void unhash(uint16_t slot) {
+  uint16_t *link = &gBuckets[gSlots[slot].letter & gBucketMask];
+  while (*link != kNoSlot) {
+    if (*link == slot) {
+      *link = gSlots[slot].chain;
+      return;
+    }
+    link = &gSlots[*link].chain;
+  }
+}
+
+// A free slot, or the least recently used one, detached from list and hash.
+uint16_t takeSlot() {
+  if (gUsed < gCapacity) {
+    return gUsed++;
+  }
+  const uint16_t slot = gTail;
+  unlink(slot);
+  if (gSlots[slot].letter != kNoLetter) {
+    unhash(slot);
+    ++gStats.evictions;
+  }
+  return slot;
+}
+
+void giveBack(uint16_t slot) {
+  // Park the slot at the LRU tail so it is the next one reused.
+  Slot &s = gSlots[slot];
+  s.letter = kNoLetter;
+  s.chain = kNoSlot;
+  s.next = kNoSlot;
+  s.prev = gTail;
+  if (gTail != kNoSlot) {
+    gSlots[gTail].next = slot;
+  } else {
+    gHead = slot;
+  }
+  gTail = slot;
+}
+
+uint16_t load(uint32_t letter, uint32_t gid) {
+  const uint32_t startUs = micros();
+  if (gPort) {
+    gPort->releaseBus();
+  }
+  if (!ensureFile()) {
+    ++gStats.readErrors;
+    return kNoSlot;
+  }
+
+  uint32_t offset = 0;
+  if (gOffsets) {
+    offset = gOffsets[gid];
+  } else if (!readAt(gHeader.offsetsOffset + gid * sizeof(uint32_t), &offset, sizeof(offset))) {
+    offset = 0;
+  }
+
+  const uint16_t slot = takeSlot();
+  uint8_t *data = gSlotData + static_cast<size_t>(slot) * gSlotBytes;
+  // The record length is in its header; reading a whole slot (clamped at the
+  // end of the file) avoids a second seek.
+  size_t len = gSlotBytes;
+  if (offset < gFileBytes && gFileBytes - offset < len) {
+    len = gFileBytes - offset;
+  }
+  const GlyphRecord *record = reinterpret_cast<const GlyphRecord *>(data);
+  const bool ok = offset >= sizeof(PackHeader) && offset < gFileBytes &&
+                  len >= sizeof(GlyphRecord) && readAt(offset, data, len) &&
+                  sizeof(GlyphRecord) + record->bitmapBytes <= len;
+  if (!ok) {
+    giveBack(slot);
+    ++gStats.readErrors;
+    // Drop the handle; ensureFile() re-opens it after a short back-off.
+    gFile.close();
+    return kNoSlot;
+  }
+
+  Slot &s = gSlots[slot];
+  s.letter = letter;
+  s.chain = gBuckets[letter & gBucketMask];
+  gBuckets[letter & gBucketMask] = slot;
+  pushFront(slot);
+
+  const uint32_t us = micros() - startUs;
+  gStats.missUsTotal += us;
+  if (us > gStats.missUsMax) {
+    gStats.missUsMax = us;
+  }
+  return slot;
+}
+
+const GlyphRecord *glyph(uint32_t letter, bool count) {
+  if (!gOpen) {
+    return nullptr;
+  }
+  const uint32_t gid = glyphId(letter);
+  if (gid == 0) {
+    return nullptr;
+  }
+  if (count) {
+    ++gStats.lookups;
+  }
+  uint16_t slot = find(letter);
+  if (slot != kNoSlot) {
+    if (count) {
+      ++gStats.hits;
+    }
+    if (slot != gHead) {
+      unlink(slot);
+      pushFront(slot);
+    }
+    return recordOf(slot);
+  }
+  if (count) {
+    ++gStats.misses;
+  }
+  slot = load(letter, gid);
+  return slot == kNoSlot ? nullptr : recordOf(slot);
+}
+
+bool getGlyphDsc(const lv_font_t *font, lv_font_glyph_dsc_t *out, uint32_t letter, uint32_t letterNext) {
+  (void)font;
+  (void)letterNext;
+  const GlyphRecord *record = glyph(letter, true);
+  if (!record) {
+    return false;
+  }
+  // Same rounding as lv_font_get_glyph_dsc_fmt_txt().
+  out->adv_w = static_cast<uint16_t>((record->advW + (1U << 3)) >> 4);
+  out->box_w = record->boxW;
+  out->box_h = record->boxH;
+  out->ofs_x = record->ofsX;
+  out->ofs_y = record->ofsY;
+  out->format = static_cast<lv_font_glyph_format_t>(gHeader.bpp);
+  out->is_placeholder = false;
+  // The letter, not a glyph id: getGlyphBitmap() finds the cache slot by it.
+  out->gid.index = letter;
+  return true;
+}
+
+const void *getGlyphBitmap(lv_font_glyph_dsc_t *glyphDsc, lv_draw_buf_t *drawBuf) {
+  const uint32_t letter = glyphDsc->gid.index;
+  // Normally still cached from getGlyphDsc() just before.
+  const GlyphRecord *record = glyph(letter, false);
+  if (!record || record->bitmapBytes == 0) {
+    return nullptr;
+  }
+
+  lv_font_fmt_txt_glyph_dsc_t &proxy = gProxyGlyphs[1];
+  proxy.bitmap_index = 0;
+  proxy.adv_w = record->advW;
+  proxy.box_w = record->boxW;
+  proxy.box_h = record->boxH;
+  proxy.ofs_x = record->ofsX;
+  proxy.ofs_y = record->ofsY;
+  gProxyDsc.glyph_bitmap = reinterpret_cast<const uint8_t *>(record + 1);
+
+  const lv_font_t *resolved = glyphDsc->resolved_font;
+  glyphDsc->resolved_font = &gProxyFont;
+  glyphDsc->gid.index = 1;
+  const void *bitmap = lv_font_get_bitmap_fmt_txt(glyphDsc, drawBuf);
+  glyphDsc->resolved_font = resolved;
+  glyphDsc->gid.index = letter;
+  return bitmap;
+}
+
+bool readHeader(String *error) {
+  if (!readAt(0, &gHeader, sizeof(gHeader)) || memcmp(gHeader.magic, kMagic, sizeof(kMagic)) != 0) {
+    setError(error, "Not a font pack: " + gPath);
+    return false;
+  }
+  const uint8_t bpp = gHeader.bpp;
+  const uint64_t tableEnd =
+      static_cast<uint64_t>(gHeader.offsetsOffset) + static_cast<uint64_t>(gHeader.glyphCount) * 4U;
+  if (gHeader.version != kVersion || (bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8) ||
+      gHeader.bitmapFormat > LV_FONT_FMT_TXT_COMPRESSED_NO_PREFILTER ||
+      gHeader.maxRecordBytes < sizeof(GlyphRecord) || gHeader.maxRecordBytes > kMaxRecordBytes ||
+      gHeader.rangeCount == 0 || gHeader.rangeCount > kMaxRanges ||
+      gHeader.rangesOffset + sizeof(PackRange) * gHeader.rangeCount > gFileBytes ||
+      tableEnd > gFileBytes) {
+    setError(error, "Unsupported font pack: " + gPath);
+    return false;
+  }
+  return true;
+}
+
+void setupFonts() {
+  gFont.get_glyph_dsc = getGlyphDsc;
+  gFont.get_glyph_bitmap = getGlyphBitmap;
+  gFont.release_glyph = nullptr;
+  gFont.line_height = static_cast<int32_t>(gHeader.lineHeight);
+  gFont.base_line = static_cast<int32_t>(gHeader.baseLine);
+  gFont.subpx = LV_FONT_SUBPX_NONE;
+  gFont.underline_position = gHeader.underlinePosition;
+  gFont.underline_thickness = gHeader.underlineThickness;
+  gFont.dsc = nullptr;
+  gFont.fallback = &lv_font_montserrat_14;
+  gFont.user_data = nullptr;
+
+  gProxyDsc.glyph_bitmap = nullptr;
+  gProxyDsc.glyph_dsc = gProxyGlyphs;
+  gProxyDsc.cmaps = nullptr;
+  gProxyDsc.kern_dsc = nullptr;
+  gProxyDsc.kern_scale = 0;
+  gProxyDsc.cmap_num = 0;
+  gProxyDsc.bpp = gHeader.bpp;
+  gProxyDsc.kern_classes = 0;
+  gProxyDsc.bitmap_format = gHeader.bitmapFormat;
+  gProxyFont = gFont;
+  gProxyFont.dsc = &gProxyDsc;
+}
+
+}  // namespace
+
+namespace sdfont {
+
+namespace {
+
+String gLastError;
+
+bool openPack(const char *path, String *error) {
+  if (gOpen && gPath == path) {
+    return true;
+  }
+  close();
+  gPath = path;
+
+  if (gPort) {
+    gPort->releaseBus();
+  }
+  if (!sdstorage::ensureMounted(error)) {
+    return false;
+  }
+  auto fail = [&](const String &message) {
+    close();
+    setError(error, message);
+    return false;
+  };
+  gFile = SD.open(path, FILE_READ);
+  if (!gFile || gFile.isDirectory()) {
+    return fail(String("Font pack not found: ") + path);
+  }
+  gFileBytes = static_cast<uint32_t>(gFile.size());
+  gMountSeq = sdstorage::info().mounts;
+  gLastReopenMs = 0;
+
+  if (!readHeader(error)) {
+    close();
+    return false;
+  }
+
+  const size_t rangeBytes = sizeof(PackRange) * gHeader.rangeCount;
+  gRanges = static_cast<PackRange *>(allocate(rangeBytes, false));
+  if (!gRanges) {
+    return fail("Out of memory for font pack");
+  }
+  if (!readAt(gHeader.rangesOffset, gRanges, rangeBytes)) {
+    return fail("Font pack read failed: " + gPath);
+  }
+
+  gStats = sdfont::Stats();
+  gPsram = psramFound();
+  if (!allocateCache(gPsram ? kCacheGlyphsPsram : kCacheGlyphsInternal, gPsram) &&
+      !(gPsram && allocateCache(kCacheGlyphsInternal, false))) {
+    return fail("Out of memory for glyph cache");
+  }
+  if (gPsram) {
+    // One sequential read here saves a seek on every miss.
+    const size_t offsetBytes = sizeof(uint32_t) * gHeader.glyphCount;
+    gOffsets = static_cast<uint32_t *>(allocate(offsetBytes, true));
+    if (gOffsets && !readAt(gHeader.offsetsOffset, gOffsets, offsetBytes)) {
+      release(gOffsets);
+    }
+  }
+
+  setupFonts();
+  gOpen = true;
+  Serial.printf("[ui] font pack %s: %lu glyphs, cache %u x %u B in %s, offsets %s\n",
+                gPath.c_str(),
+                static_cast<unsigned long>(gHeader.glyphCount - 1U),
+                static_cast<unsigned>(gCapacity),
+                static_cast<unsigned>(gSlotBytes),
+                gPsram ? "PSRAM" : "internal RAM",
+                gOffsets ? "in RAM" : "on SD");
+  return true;
+}
+
+}  // namespace
+
+void attach(LvglPort *port) {
+  gPort = port;
+}
+
+bool open(const char *path, String *error) {
+  String err;
+  const bool ok = openPack(path, &err);
+  gLastError = ok ? String() : err;
+  if (!ok) {
+    setError(error, err);
+  }
+  return ok;
+}
+
+void close() {
+  gOpen = false;
+  if (gFile) {
+    gFile.close();
+  }
+  release(gRanges);
+  release(gOffsets);
+  releaseCache();
+  gFileBytes = 0;
+}
+
+bool isOpen() {
+  return gOpen;
+}
+
+String lastError() {
+  return gLastError;
+}
+
+const lv_font_t *font() {
+  return &gFont;
+}
+
+Stats stats() {
+  Stats out = gStats;
+  out.open = gOpen;
+  out.psram = gOpen && gPsram;
+  out.offsetsInRam = gOffsets != nullptr;
+  out.glyphs = gOpen ? gHeader.glyphCount - 1U : 0;
+  out.capacity = gCapacity;
+  out.cached = gUsed;
+  if (!gOpen) {
+    out.cacheBytes = 0;
+  }
+  return out;
+}
+
+void resetStats() {
+  const uint32_t cacheBytes = gStats.cacheBytes;
+  gStats = Stats();
+  gStats.cacheBytes = cacheBytes;
+}
+
+}  // namespace sdfont
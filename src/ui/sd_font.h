@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+class LvglPort;
+
+// LVGL font backed by a glyph pack on the SD card (built by
+// scripts/font_pack/build_font_pack.py). Only the range table is kept in
+// RAM, plus the glyph offset table when PSRAM is present. Glyph records are
+// read on first use into a fixed-size LRU cache: PSRAM when present,
+// otherwise a smaller internal one. Bitmaps stay compressed in the cache and
+// are expanded by LVGL's own glyph decoder when drawn.
+//
+// A miss reads the SD card from inside an LVGL render, so the display's DMA
+// flush is finished first (see attach()). Glyphs that are not in the pack, or
+// cannot be read while the card is out, come from Montserrat 14.
+namespace sdfont {
+
+constexpr const char *kKoreanPackPath = "/fonts/korean_ui_14.zxgp";
+
+struct Stats {
+  bool open = false;
+  bool psram = false;          // cache (and offset table) in PSRAM
+  bool offsetsInRam = false;   // false: a miss reads the glyph offset from SD too
+  uint32_t glyphs = 0;         // glyphs in the pack
+  uint16_t capacity = 0;       // cache slots
+  uint16_t cached = 0;
+  uint32_t cacheBytes = 0;
+  uint32_t lookups = 0;        // glyph lookups for letters the pack has
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t evictions = 0;
+  uint32_t readErrors = 0;
+  uint32_t missUsTotal = 0;    // SD time spent on misses
+  uint32_t missUsMax = 0;
+};
+
+// Lets cache misses release the display's SPI transaction before reading.
+void attach(LvglPort *port);
+
+// Opens `path` and allocates the cache. Opening the pack already open
+// returns at once.
+bool open(const char *path, String *error = nullptr);
+void close();
+bool isOpen();
+// Why the last open() failed; empty after a successful one.
+String lastError();
+// Valid while open. Kept alive after close(); lookups then fall back to
+// Montserrat 14, so labels still using it draw Latin text.
+const lv_font_t *font();
+
+Stats stats();
+void resetStats();
+
+}  // namespace sdfont
@@ -0,0 +1,239 @@
+#include "ui_perf.h"
+
+#include <lvgl.h>
+
+#include "../core/node_command_handler.h"
+#include "launcher_icons.h"
+#include "lvgl_port.h"
+#include "sd_font.h"
+
+namespace {
+
+constexpr uint32_t kOverlayRefreshMs = 500;
+constexpr uint32_t kOverlayBg = 0x000000;
+constexpr uint32_t kOverlayText = 0x7CFC9A;
+
+LvglPort *gPort = nullptr;
+lv_obj_t *gOverlay = nullptr;
+bool gOverlayEnabled = false;
+uint32_t gLastOverlayMs = 0;
+
+struct LvMemUsage {
+  bool known = false;
+  uint32_t totalBytes = 0;
+  uint32_t usedBytes = 0;
+  uint32_t maxUsedBytes = 0;
+  uint8_t usedPercent = 0;
+  uint8_t fragPercent = 0;
+};
+
+LvMemUsage readLvMem() {
+  LvMemUsage usage;
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  usage.known = true;
+  usage.totalBytes = static_cast<uint32_t>(mon.total_size);
+  usage.usedBytes = static_cast<uint32_t>(mon.total_size - mon.free_size);
+  usage.maxUsedBytes = static_cast<uint32_t>(mon.max_used);
+  usage.usedPercent = mon.used_pct;
+  usage.fragPercent = mon.frag_pct;
+#endif
+  return usage;
+}
+
+uint8_t dirtyPercent(const LvglFrameStats &stats) {
+  lv_display_t *display = gPort ? gPort->display() : nullptr;
+  if (!display) {
+    return 0;
+  }
+  const uint32_t screenPixels =
+      static_cast<uint32_t>(lv_display_get_horizontal_resolution(display)) *
+      static_cast<uint32_t>(lv_display_get_vertical_resolution(display));
+  if (screenPixels == 0) {
+    return 0;
+  }
+  const uint32_t pct = (stats.dirtyPixels * 100U + screenPixels / 2U) / screenPixels;
+  return static_cast<uint8_t>(pct > 100U ? 100U : pct);
+}
+
+uint8_t hitPercent(const sdfont::Stats &stats) {
+  if (stats.lookups == 0) {
+    return 0;
+  }
+  return static_cast<uint8_t>((static_cast<uint64_t>(stats.hits) * 100U) / stats.lookups);
+}
+
+String msText(uint32_t us) {
+  return String(static_cast<float>(us) / 1000.0f, 1);
+}
+
+void createOverlay() {
+  gOverlay = lv_label_create(lv_layer_top());
+  lv_obj_set_style_bg_color(gOverlay, lv_color_hex(kOverlayBg), 0);
+  lv_obj_set_style_bg_opa(gOverlay, LV_OPA_70, 0);
+  lv_obj_set_style_text_color(gOverlay, lv_color_hex(kOverlayText), 0);
+  lv_obj_set_style_text_font(gOverlay, &lv_font_montserrat_14, 0);
+  lv_obj_set_style_pad_hor(gOverlay, 3, 0);
+  lv_obj_set_style_pad_ver(gOverlay, 1, 0);
+  lv_obj_align(gOverlay, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+  lv_label_set_text(gOverlay, "");
+}
+
+void updateOverlay() {
+  const LvglFrameStats &stats = gPort->frameStats();
+  const LvMemUsage mem = readLvMem();
+  String text = String(stats.fps) + " fps  f" + msText(stats.frameUs) + " r" +
+                msText(stats.renderUs) + " s" + msText(stats.flushUs) + " ms\n";
+  text += "dirty " + String(dirtyPercent(stats)) + "%  in " +
+          msText(stats.inputLatencyUs) + " ms";
+  if (mem.known) {
+    text += "  lv " + String(mem.usedPercent) + "%";
+  }
+  const sdfont::Stats glyphs = sdfont::stats();
+  if (glyphs.open) {
+    text += "  gl " + String(hitPercent(glyphs)) + "%";
+  }
+  lv_label_set_text(gOverlay, text.c_str());
+}
+
+struct UiPerfParams {
+  bool overlay = false;
+  bool reset = false;
+};
+constexpr NodeCommandParam kUiPerfParams[] = {
+    optionalParam("overlay", NodeParamType::Bool, offsetof(UiPerfParams, overlay), 0, 0),
+    optionalParam("reset", NodeParamType::Bool, offsetof(UiPerfParams, reset), 0, 0, 0),
+};
+
+bool cmdUiPerf(const NodeCommandCall &call, JsonObject result, NodeCommandError &error) {
+  UiPerfParams args;
+  if (!decodeNodeParams(call.params, kUiPerfParams, args, error)) {
+    return false;
+  }
+  if (!call.params["overlay"].isNull()) {
+    uiperf::setOverlayEnabled(args.overlay);
+  }
+  if (!uiperf::toJson(result)) {
+    error.code = "UNAVAILABLE";
+    error.message = "display not running";
+    return false;
+  }
+  // Report first, then clear, so a reset call still returns the old values.
+  if (args.reset) {
+    gPort->resetFrameStats();
+    sdfont::resetStats();
+  }
+  return true;
+}
+
+constexpr NodeCommandSpec kUiPerfCommand = makeNodeCommand("ui.perf", kUiPerfParams, cmdUiPerf);
+
+}  // namespace
+
+namespace uiperf {
+
+void attach(LvglPort *port) {
+  gPort = port;
+}
+
+void setOverlayEnabled(bool enabled) {
+  gOverlayEnabled = enabled;
+  if (!enabled && gOverlay) {
+    lv_obj_delete(gOverlay);
+    gOverlay = nullptr;
+  }
+  gLastOverlayMs = 0;
+}
+
+bool overlayEnabled() {
+  return gOverlayEnabled;
+}
+
+void tick() {
+  if (!gOverlayEnabled || !gPort || !gPort->ready()) {
+    return;
+  }
+  const uint32_t now = millis();
+  if (gLastOverlayMs != 0 && now - gLastOverlayMs < kOverlayRefreshMs) {
+    return;
+  }
+  gLastOverlayMs = now;
+  if (!gOverlay) {
+    createOverlay();
+  }
+  updateOverlay();
+}
+
+bool toJson(JsonObject out) {
+  if (!gPort || !gPort->ready()) {
+    return false;
+  }
+  const LvglFrameStats &stats = gPort->frameStats();
+  const LvglRenderPolicy &policy = gPort->renderPolicy();
+  out["overlay"] = gOverlayEnabled;
+  out["fps"] = stats.fps;
+  out["frames"] = stats.frames;
+  out["frameUs"] = stats.frameUs;
+  out["renderUs"] = stats.renderUs;
+  out["flushUs"] = stats.flushUs;
+  out["flushWaitUs"] = stats.flushWaitUs;
+  out["dirtyPixels"] = stats.dirtyPixels;
+  out["dirtyPct"] = dirtyPercent(stats);
+  out["inputLatencyUs"] = stats.inputLatencyUs;
+  out["inputLatencyMaxUs"] = stats.inputLatencyMaxUs;
+  out["dma"] = stats.dma;
+  out["renderMode"] = lvglRenderModeName(policy.mode);
+  out["renderLines"] = policy.lines;
+  out["renderPsram"] = policy.psram;
+
+  const LvMemUsage mem = readLvMem();
+  if (mem.known) {
+    JsonObject lvMem = out.createNestedObject("lvMem");
+    lvMem["total"] = mem.totalBytes;
+    lvMem["used"] = mem.usedBytes;
+    lvMem["maxUsed"] = mem.maxUsedBytes;
+    lvMem["usedPct"] = mem.usedPercent;
+    lvMem["fragPct"] = mem.fragPercent;
+  }
+
+  const LauncherIconCacheInfo icons = launcherIconCacheInfo();
+  JsonObject iconCache = out.createNestedObject("iconCache");
+  iconCache["ready"] = icons.ready;
+  iconCache["images"] = icons.images;
+  iconCache["bytes"] = icons.bytes;
+  iconCache["psram"] = icons.inPsram;
+  iconCache["rasterizeUs"] = icons.rasterizeUs;
+
+  const sdfont::Stats glyphs = sdfont::stats();
+  JsonObject fontCache = out.createNestedObject("fontCache");
+  fontCache["open"] = glyphs.open;
+  const String openError = sdfont::lastError();
+  if (!openError.isEmpty()) {
+    fontCache["error"] = openError;
+  }
+  if (glyphs.open) {
+    fontCache["glyphs"] = glyphs.glyphs;
+    fontCache["capacity"] = glyphs.capacity;
+    fontCache["cached"] = glyphs.cached;
+    fontCache["bytes"] = glyphs.cacheBytes;
+    fontCache["psram"] = glyphs.psram;
+    fontCache["offsetsInRam"] = glyphs.offsetsInRam;
+  }
+  // LRU counters survive a close, so they are reported either way.
+  fontCache["lookups"] = glyphs.lookups;
+  fontCache["hits"] = glyphs.hits;
+  fontCache["misses"] = glyphs.misses;
+  fontCache["hitPct"] = hitPercent(glyphs);
+  fontCache["evictions"] = glyphs.evictions;
+  fontCache["readErrors"] = glyphs.readErrors;
+  fontCache["missUsAvg"] = glyphs.misses ? glyphs.missUsTotal / glyphs.misses : 0;
+  fontCache["missUsMax"] = glyphs.missUsMax;
+  return true;
+}
+
+void registerCommands(NodeCommandHandler &handler) {
+  handler.registerCommand(kUiPerfCommand);
+}
+
+}  // namespace uiperf
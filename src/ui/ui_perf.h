@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class LvglPort;
+class NodeCommandHandler;
+
+// UI cost counters and an optional on-screen overlay. Frame counters are
+// kept by LvglPort all the time; this module only reads them. The overlay
+// label and the LVGL heap walk cost nothing until the overlay is turned on
+// or `ui.perf` is invoked.
+//
+// The overlay sits on LVGL's top layer and refreshes twice a second, so it
+// adds one small dirty area of its own to those frames.
+namespace uiperf {
+
+void attach(LvglPort *port);
+
+void setOverlayEnabled(bool enabled);
+bool overlayEnabled();
+// Updates the overlay; call after LvglPort::pump().
+void tick();
+
+// Counters, render policy and LVGL heap use as a `ui.perf` result.
+bool toJson(JsonObject out);
+// Registers `ui.perf [overlay] [reset]`.
+void registerCommands(NodeCommandHandler &handler);
+
+}  // namespace uiperf
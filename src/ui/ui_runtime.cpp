@@ -14,10 +14,11 @@
 #include <sys/time.h>
 
 #include "../core/board_pins.h"
-#include "fonts/lv_font_korean_ui_14.h"
 #include "input_adapter.h"
 #include "launcher_icons.h"
 #include "lvgl_port.h"
+#include "sd_font.h"
+#include "ui_perf.h"
 #include "user_config.h"
 
 namespace {
@@ -52,6 +53,7 @@ constexpr unsigned long kUnixSyncRetryMs = 30000UL;
 constexpr unsigned long kUnixSyncRefreshMs = 15UL * 60UL * 1000UL;
 constexpr unsigned long kUiLoopDelayMs = 2UL;
 constexpr unsigned long kBackgroundTickMinIntervalMs = 20UL;
+constexpr int kRenderBenchRounds = 8;
 constexpr uint32_t kTlsMinInternalFreeBytesUi = 36000U;
 constexpr uint32_t kTlsMinInternalLargestBytesUi = 18000U;
 constexpr time_t kMinValidUnixTimeSec = 946684800;  // 2000-01-01T00:00:00Z
@@ -356,6 +358,8 @@ class UiRuntime::Impl {
   String statusLine;
   UiLanguage language = UiLanguage::English;
   bool koreanFontInstalled = false;
+  bool koreanFontPending = false;  // installed, pack not opened yet
+  bool koreanFontFailed = false;   // deferred open failed, not yet reported
   String timezoneTz = USER_TIMEZONE_TZ;
   String timezonePosixTz = USER_TIMEZONE_TZ;
 
@@ -399,6 +403,8 @@ class UiRuntime::Impl {
     }
 
     applyBacklight();
+    uiperf::attach(&port);
+    sdfont::attach(&port);
     input.begin(port.display());
     applyTheme();
     launcherIconsAvailable = initLauncherIcons();
@@ -429,12 +435,38 @@ class UiRuntime::Impl {
   }
 
   const lv_font_t *font() const {
-    if (koreanFontInstalled) {
-      return &lv_font_korean_ui_14;
+    if (koreanFontInstalled && sdfont::isOpen()) {
+      return sdfont::font();
     }
     return &lv_font_montserrat_14;
   }
 
+  bool openKoreanFont(String *error) {
+    String err;
+    if (sdfont::open(sdfont::kKoreanPackPath, &err)) {
+      return true;
+    }
+    Serial.printf("[ui] korean font: %s\n", err.c_str());
+    if (error) {
+      *error = err;
+    }
+    return false;
+  }
+
+  // Opens the pack flagged by setKoreanFontInstalledDeferred().
+  void openPendingKoreanFont() {
+    if (!koreanFontPending || !port.ready()) {
+      return;
+    }
+    koreanFontPending = false;
+    if (openKoreanFont(nullptr)) {
+      applyTheme();
+      return;
+    }
+    koreanFontInstalled = false;
+    koreanFontFailed = true;
+  }
+
   void service(const std::function<void()> *backgroundTick = nullptr) {
     if (serviceActive) {
       return;
@@ -442,8 +474,10 @@ class UiRuntime::Impl {
 
     serviceActive = true;
     const unsigned long startMs = millis();
+    openPendingKoreanFont();
     input.tick();
     port.pump();
+    uiperf::tick();
     const unsigned long now = millis();
     if (backgroundTick && *backgroundTick &&
         (lastBackgroundTickMs == 0 ||
@@ -474,6 +508,9 @@ class UiRuntime::Impl {
     out.okCount = ev.okCount;
     out.backCount = ev.backCount;
     out.okLongCount = ev.okLongCount;
+    if (out.delta != 0 || out.ok || out.back || out.okLong) {
+      port.noteInput();
+    }
     return out;
   }
 
@@ -2251,17 +2288,45 @@ UiLanguage UiRuntime::language() const {
   return impl_->language;
 }
 
-void UiRuntime::setKoreanFontInstalled(bool installed) {
+bool UiRuntime::setKoreanFontInstalled(bool installed, String *error) {
+  const bool ok = !installed || impl_->openKoreanFont(error);
+  impl_->koreanFontPending = false;
+  impl_->koreanFontFailed = false;
   impl_->koreanFontInstalled = installed;
   if (impl_->port.ready()) {
     impl_->applyTheme();
   }
+  if (!installed) {
+    // After the theme switch, so no new object picks up the SD font.
+    sdfont::close();
+  }
+  return ok;
+}
+
+void UiRuntime::setKoreanFontInstalledDeferred(bool installed) {
+  if (!installed) {
+    setKoreanFontInstalled(false);
+    return;
+  }
+  impl_->koreanFontInstalled = true;
+  impl_->koreanFontPending = !sdfont::isOpen();
 }
 
 bool UiRuntime::isKoreanFontInstalled() const {
   return impl_->koreanFontInstalled;
 }
 
+bool UiRuntime::takeKoreanFontLoadFailure(String *error) {
+  if (!impl_->koreanFontFailed) {
+    return false;
+  }
+  impl_->koreanFontFailed = false;
+  if (error) {
+    *error = sdfont::lastError();
+  }
+  return true;
+}
+
 void UiRuntime::setTimezone(const String &tz) {
   impl_->setTimezone(tz);
 }
@@ -2933,3 +2998,91 @@ void UiRuntime::showBootSplash(const String &subtitle,
     delay(kUiLoopDelayMs);
   }
 }
+
+void UiRuntime::setPerfOverlayEnabled(bool enabled) {
+  uiperf::setOverlayEnabled(enabled);
+}
+
+bool UiRuntime::perfOverlayEnabled() const {
+  return uiperf::overlayEnabled();
+}
+
+void UiRuntime::runRenderBenchmark(const std::function<void()> &backgroundTick) {
+  LvglPort &port = impl_->port;
+  const LvglRenderPolicy original = port.renderPolicy();
+  const uint16_t height =
+      static_cast<uint16_t>(lv_display_get_vertical_resolution(port.display()));
+
+  std::vector<LvglRenderPolicy> candidates;
+  auto addCandidate = [&](LvglRenderMode mode, bool psram, uint16_t lines) {
+    LvglRenderPolicy policy;
+    policy.mode = mode;
+    policy.psram = psram;
+    policy.lines = lines;
+    candidates.push_back(policy);
+  };
+  addCandidate(LvglRenderMode::Partial, false, 12);
+  addCandidate(LvglRenderMode::Partial, false, 24);
+  if (psramFound()) {
+    addCandidate(LvglRenderMode::Partial, true, 24);
+    addCandidate(LvglRenderMode::Partial, true, height / 2);
+    addCandidate(LvglRenderMode::Direct, true, 0);
+    addCandidate(LvglRenderMode::Full, true, 0);
+  }
+
+  const std::vector<String> launcherItems = {"APPMarket", "Settings", "File Explorer", "OpenClaw"};
+  const std::vector<String> listItems = {"Wi-Fi", "BLE", "System", "Firmware Update",
+                                         "Language", "Timezone", "Brightness", "Back"};
+
+  // Each round moves the selection, which rebuilds the screen like the loops do.
+  auto averageMs = [&](const std::function<void(int)> &render) {
+    render(0);
+    port.refreshNow();
+    uint32_t totalUs = 0;
+    for (int i = 1; i <= kRenderBenchRounds; ++i) {
+      render(i);
+      totalUs += port.refreshNow();
+    }
+    return String(static_cast<float>(totalUs) / kRenderBenchRounds / 1000.0f, 1);
+  };
+
+  std::vector<String> lines;
+  Serial.println("[ui] render benchmark (ms per redraw)");
+  Serial.println("| mode | buffer | launcher | list |");
+  Serial.println("|---|---|---|---|");
+  for (const LvglRenderPolicy &policy : candidates) {
+    String label = String(lvglRenderModeName(policy.mode));
+    if (policy.mode == LvglRenderMode::Partial) {
+      label += " " + String(policy.lines);
+    }
+    label += policy.psram ? " PSRAM" : " int";
+
+    String err;
+    if (!port.setRenderPolicy(policy, &err)) {
+      lines.push_back(label + ": " + err);
+      Serial.printf("| %s | - | %s | - |\n", label.c_str(), err.c_str());
+      continue;
+    }
+    const String bufferKb = String(static_cast<uint32_t>(port.bufferBytes() / 1024U)) + " KB";
+    const String launcherMs = averageMs([&](int i) {
+      impl_->renderLauncher("Launcher", launcherItems, i % static_cast<int>(launcherItems.size()));
+    });
+    const String listMs = averageMs([&](int i) {
+      impl_->renderMenu("Setting", listItems, i % static_cast<int>(listItems.size()), "", "");
+    });
+    lines.push_back(label + ": L " + launcherMs + " / M " + listMs + " ms");
+    Serial.printf("| %s | %s | %s | %s |\n",
+                  label.c_str(), bufferKb.c_str(), launcherMs.c_str(), listMs.c_str());
+    if (backgroundTick) {
+      backgroundTick();
+    }
+  }
+
+  String restoreErr;
+  if (!port.setRenderPolicy(original, &restoreErr)) {
+    Serial.printf("[ui] render policy restore failed: %s\n", restoreErr.c_str());
+  }
+  lines.push_back(String("Active: ") + lvglRenderModeName(original.mode) +
+                  (original.psram ? " PSRAM" : " int"));
+  showInfo("Render Benchmark", lines, backgroundTick);
+}
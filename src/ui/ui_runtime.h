@@ -41,7 +41,15 @@ class UiRuntime {
   void setLanguage(UiLanguage language);
   UiLanguage language() const;
 
-  void setKoreanFontInstalled(bool installed);
+  // Installing opens the Korean glyph pack on the SD card; returns false
+  // (and keeps Montserrat) when it cannot be opened.
+  bool setKoreanFontInstalled(bool installed, String *error = nullptr);
+  // Records the flag without touching the SD card; the pack is opened on the
+  // next UI service pass. Used at boot and by config imports.
+  void setKoreanFontInstalledDeferred(bool installed);
+  // True once after a deferred open failed; the runtime then behaves as
+  // uninstalled and the caller clears the saved flag.
+  bool takeKoreanFontLoadFailure(String *error = nullptr);
   bool isKoreanFontInstalled() const;
 
   void setTimezone(const String &tz);
@@ -105,6 +113,14 @@ class UiRuntime {
                       unsigned long durationMs,
                       const std::function<void()> &backgroundTick);
 
+  // FPS / frame timing / LVGL heap overlay; see ui_perf.h.
+  void setPerfOverlayEnabled(bool enabled);
+  bool perfOverlayEnabled() const;
+
+  // Redraws a launcher and a list screen under each render buffer policy that
+  // fits in memory, then shows the average redraw times (also logged as a table).
+  void runRenderBenchmark(const std::function<void()> &backgroundTick);
+
  private:
   class Impl;
   Impl *impl_;